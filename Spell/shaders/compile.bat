@@ -1,3 +1,10 @@
 C:\VulkanSDK\1.4.341.0\Bin\glslc.exe shader.vert --target-env=vulkan1.2 -o vert.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe shader_packed.vert --target-env=vulkan1.2 -o packed_vert.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe shader_position.vert --target-env=vulkan1.2 -o position_vert.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe shader_packed_position.vert --target-env=vulkan1.2 -o packed_position_vert.spv
 C:\VulkanSDK\1.4.341.0\Bin\glslc.exe shader.frag --target-env=vulkan1.2 -o frag.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe flat_color.frag --target-env=vulkan1.2 -o flat_color_frag.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe cluster_cull.comp --target-env=vulkan1.2 -o cluster_cull_comp.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe hiz_build.comp --target-env=vulkan1.2 -o hiz_build_comp.spv
+C:\VulkanSDK\1.4.341.0\Bin\glslc.exe hiz_build.comp -DMULTISAMPLED_SOURCE --target-env=vulkan1.2 -o hiz_build_ms_comp.spv
 pause
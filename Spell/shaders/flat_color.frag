@@ -24,9 +24,17 @@ void main() {
 	vec3 N = fragNormalW;
 	float nLen = length(N);
 	if (nLen < 0.0001) {
+		// No vertex normal (position-only pipelines): face normal from screen-space derivatives.
+		// Lines and points have no face, so they are drawn unlit.
 		vec3 fdx = dFdx(fragPositionW);
 		vec3 fdy = dFdy(fragPositionW);
-		N = normalize(cross(fdx, fdy));
+		vec3 faceN = cross(fdx, fdy);
+		float faceLen = length(faceN);
+		if (faceLen <= 0.001 * length(fdx) * length(fdy)) {
+			outColor = vec4(1.0);
+			return;
+		}
+		N = faceN / faceLen;
 	} else {
 		N = N / nLen;
 	}
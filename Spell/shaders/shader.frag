@@ -8,7 +8,12 @@ layout(binding = 0) uniform UniformBufferObject {
 	vec3 camPos;
 } ubo;
 
-layout(binding = 1) uniform sampler2D textures[];
+// Material texture slot -> index into textures[] (see MaterialTextureTable)
+layout(binding = 1) readonly buffer MaterialTextureTable {
+	uint materialTextures[];
+};
+
+layout(binding = 2) uniform sampler2D textures[];
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -62,19 +67,23 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0) {
 }
 
 void main() {
-	// Texture index calculation:
-	// Layout: [fallback_diff(0), fallback_norm(1), fallback_metal(2), fallback_rough(3),
-	//          mat0_diff(4), mat0_norm(5), mat0_metal(6), mat0_rough(7), ...]
-	// Each material occupies 4 slots starting at offset 4
-	int diffuseIdx   = fragMaterialIndex >= 0 ? (fragMaterialIndex + 1) * 4     : 0;
-	int normalIdx    = fragMaterialIndex >= 0 ? (fragMaterialIndex + 1) * 4 + 1 : 1;
-	int metallicIdx  = fragMaterialIndex >= 0 ? (fragMaterialIndex + 1) * 4 + 2 : 2;
-	int roughnessIdx = fragMaterialIndex >= 0 ? (fragMaterialIndex + 1) * 4 + 3 : 3;
-
-	// Sample textures
+	// Texture index lookup:
+	// Table layout: [no material: diff(0), norm(1), metal(2), rough(3),
+	//                mat0_diff(4), mat0_norm(5), mat0_metal(6), mat0_rough(7), ...]
+	// Each material occupies 4 slots starting at offset 4; missing maps point at the
+	// shared fallback textures
+	int slot = fragMaterialIndex >= 0 ? (fragMaterialIndex + 1) * 4 : 0;
+	int diffuseIdx   = int(materialTextures[slot]);
+	int normalIdx    = int(materialTextures[slot + 1]);
+	int metallicIdx  = int(materialTextures[slot + 2]);
+	int roughnessIdx = int(materialTextures[slot + 3]);
+
+	// Sample textures. Metallic is in R and roughness in G: a glTF metallic-roughness map is
+	// packed into one RG8 / BC5 texture that way, and the views of separate single-channel
+	// (R8 / BC4) maps replicate R into G.
 	vec3 albedo = pow(texture(textures[nonuniformEXT(diffuseIdx)], fragTexCoord).rgb, vec3(2.2));
 	float metallic = texture(textures[nonuniformEXT(metallicIdx)], fragTexCoord).r;
-	float roughness = texture(textures[nonuniformEXT(roughnessIdx)], fragTexCoord).r;
+	float roughness = texture(textures[nonuniformEXT(roughnessIdx)], fragTexCoord).g;
 	roughness = max(roughness, 0.04);
 
 	// Build TBN matrix from screen-space derivatives
@@ -102,9 +111,10 @@ void main() {
 	}
 	mat3 TBN = mat3(T, B, N);
 
-	// Sample normal map and transform to world space
-	vec3 normalMap = texture(textures[nonuniformEXT(normalIdx)], fragTexCoord).rgb;
-	normalMap = normalMap * 2.0 - 1.0;
+	// Sample normal map and transform to world space. Only X and Y are read: RG8 and BC5 normal
+	// maps store two channels, so Z is rebuilt from the unit length.
+	vec2 normalXY = texture(textures[nonuniformEXT(normalIdx)], fragTexCoord).rg * 2.0 - 1.0;
+	vec3 normalMap = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
 	N = normalize(TBN * normalMap);
 
 	// View and light directions
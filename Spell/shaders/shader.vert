@@ -2,10 +2,10 @@
 #version 450
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec3 inNormal;
 layout(location = 4) in int inMaterialIndex;
+layout(location = 5) in mat4 inInstanceModel; // per-instance, locations 5..8
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
@@ -20,15 +20,16 @@ layout(binding = 0) uniform UniformBufferObject {
 } ubo;
 
 void main() {
-	vec4 worldPos = ubo.model * vec4(inPosition, 1.0);
+	mat4 model = ubo.model * inInstanceModel;
+	vec4 worldPos = model * vec4(inPosition, 1.0);
 	gl_Position = ubo.proj * ubo.view * worldPos;
 	gl_PointSize = 1.0;
 
-	fragColor = inColor;
+	fragColor = vec3(1.0); // vertex colors are always white and are not fetched
 	fragTexCoord = inTexCoord;
 	fragPositionW = worldPos.xyz;
 
-	mat3 normalMatrix = transpose(inverse(mat3(ubo.model)));
+	mat3 normalMatrix = transpose(inverse(mat3(model)));
 	fragNormalW = normalMatrix * inNormal;
 
 	fragMaterialIndex = inMaterialIndex;
@@ -0,0 +1,46 @@
+#version 450
+
+// shader.vert for PackedVertex (see VertexQuantization.h): same outputs, compact inputs
+
+layout(location = 0) in uvec4 inPositionMaterial; // xyz quantized position, w material (0xFFFF = none)
+layout(location = 1) in vec2 inNormalOct;         // octahedral normal, snorm16
+layout(location = 2) in vec2 inTexCoord;          // half float
+layout(location = 5) in mat4 inInstanceModel;     // per-instance, locations 5..8
+layout(location = 9) in vec4 inDequant;           // per-instance: xyz offset, w scale of the mesh
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragNormalW;
+layout(location = 3) out vec3 fragPositionW;
+layout(location = 4) flat out int fragMaterialIndex;
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+vec3 octDecode(vec2 p) {
+	vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+	float t = max(-n.z, 0.0);
+	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
+
+void main() {
+	vec3 position = vec3(inPositionMaterial.xyz) * inDequant.w + inDequant.xyz;
+
+	mat4 model = ubo.model * inInstanceModel;
+	vec4 worldPos = model * vec4(position, 1.0);
+	gl_Position = ubo.proj * ubo.view * worldPos;
+	gl_PointSize = 1.0;
+
+	fragColor = vec3(1.0);
+	fragTexCoord = inTexCoord;
+	fragPositionW = worldPos.xyz;
+
+	mat3 normalMatrix = transpose(inverse(mat3(model)));
+	fragNormalW = normalMatrix * octDecode(inNormalOct);
+
+	fragMaterialIndex = inPositionMaterial.w == 0xFFFFu ? -1 : int(inPositionMaterial.w);
+}
@@ -0,0 +1,33 @@
+#version 450
+
+// Position-only shader_packed.vert for split vertex streams (see VertexStreams.h)
+
+layout(location = 0) in uvec4 inPositionMaterial; // xyz quantized position, w material (unused)
+layout(location = 5) in mat4 inInstanceModel;     // per-instance, locations 5..8
+layout(location = 9) in vec4 inDequant;           // per-instance: xyz offset, w scale of the mesh
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragNormalW;
+layout(location = 3) out vec3 fragPositionW;
+layout(location = 4) flat out int fragMaterialIndex;
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+void main() {
+	vec3 position = vec3(inPositionMaterial.xyz) * inDequant.w + inDequant.xyz;
+
+	vec4 worldPos = ubo.model * inInstanceModel * vec4(position, 1.0);
+	gl_Position = ubo.proj * ubo.view * worldPos;
+	gl_PointSize = 1.0;
+
+	fragColor = vec3(1.0);
+	fragTexCoord = vec2(0.0);
+	fragNormalW = vec3(0.0);
+	fragPositionW = worldPos.xyz;
+	fragMaterialIndex = -1;
+}
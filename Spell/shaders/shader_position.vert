@@ -0,0 +1,31 @@
+#version 450
+
+// Position-only shader.vert for split vertex streams (see VertexStreams.h): fetches binding 0
+// and the instance data only. Outputs no normal, so flat_color.frag falls back to face normals.
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 5) in mat4 inInstanceModel; // per-instance, locations 5..8
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragNormalW;
+layout(location = 3) out vec3 fragPositionW;
+layout(location = 4) flat out int fragMaterialIndex;
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+void main() {
+	vec4 worldPos = ubo.model * inInstanceModel * vec4(inPosition, 1.0);
+	gl_Position = ubo.proj * ubo.view * worldPos;
+	gl_PointSize = 1.0;
+
+	fragColor = vec3(1.0);
+	fragTexCoord = vec2(0.0);
+	fragNormalW = vec3(0.0);
+	fragPositionW = worldPos.xyz;
+	fragMaterialIndex = -1;
+}
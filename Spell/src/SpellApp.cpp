@@ -3,10 +3,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "SpellApp.h"
+#include "resources/VertexStreams.h"
 #include <imgui.h>
 #include <chrono>
+#include <iomanip>
+#include <iostream>
 #include <stdexcept>
 #include <array>
+#include <algorithm>
 
 namespace Spell {
 
@@ -14,12 +18,13 @@ SpellApp::SpellApp() {
 	createDescriptorSetLayout();
 	createPipelineLayout();
 	createPipeline();
+	createClusterCuller();
 
+	selectAvailableVertexInput();
 	resources_.loadInitialResources();
 
 	createUniformBuffers();
-	createDescriptorPool();
-	createDescriptorSets();
+	descriptors_ = createDescriptors(*resources_.model(), resources_.textures(), resources_.textureTable());
 
 	imgui_ = std::make_unique<SpellImGui>(
 		window_, device_, renderer_.getSwapChainRenderPass(),
@@ -40,22 +45,42 @@ SpellApp::SpellApp() {
 	if (vkCreateQueryPool(device_.device(), &queryPoolInfo, nullptr, &statsQueryPool_) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create pipeline statistics query pool!");
 	}
+
+	// Timestamp query pool for the GPU scene time
+	VkPhysicalDeviceLimits limits = device_.getProperties().limits;
+	if (limits.timestampComputeAndGraphics) {
+		VkQueryPoolCreateInfo timestampPoolInfo{};
+		timestampPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		timestampPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		timestampPoolInfo.queryCount = 2 * SpellSwapChain::MAX_FRAMES_IN_FLIGHT;
+		if (vkCreateQueryPool(device_.device(), &timestampPoolInfo, nullptr, &timestampQueryPool_) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create timestamp query pool!");
+		}
+		timestampPeriodNs_ = limits.timestampPeriod;
+	}
 }
 
 SpellApp::~SpellApp() {
-	vkDeviceWaitIdle(device_.device());
+	device_.waitIdle();
 	imgui_.reset();
 
 	if (statsQueryPool_ != VK_NULL_HANDLE) {
 		vkDestroyQueryPool(device_.device(), statsQueryPool_, nullptr);
 	}
+	if (timestampQueryPool_ != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device_.device(), timestampQueryPool_, nullptr);
+	}
 
 	for (size_t i = 0; i < uniformBuffers_.size(); i++) {
 		vkDestroyBuffer(device_.device(), uniformBuffers_[i], nullptr);
 		vkFreeMemory(device_.device(), uniformBuffersMemory_[i], nullptr);
 	}
 
-	vkDestroyDescriptorPool(device_.device(), descriptorPool_, nullptr);
+	destroyDescriptors(descriptors_);
+	destroyDescriptors(pendingDescriptors_);
+	for (auto& retired : retiredDescriptors_) {
+		destroyDescriptors(retired.descriptors);
+	}
 	vkDestroyDescriptorSetLayout(device_.device(), descriptorSetLayout_, nullptr);
 	vkDestroyPipelineLayout(device_.device(), pipelineLayout_, nullptr);
 }
@@ -65,7 +90,7 @@ void SpellApp::run() {
 		glfwPollEvents();
 		renderFrame();
 	}
-	vkDeviceWaitIdle(device_.device());
+	device_.waitIdle();
 }
 
 void SpellApp::createDescriptorSetLayout() {
@@ -76,19 +101,29 @@ void SpellApp::createDescriptorSetLayout() {
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
 
+	// Material texture slot -> bindless index (see MaterialTextureTable)
+	VkDescriptorSetLayoutBinding textureTableBinding{};
+	textureTableBinding.binding = 1;
+	textureTableBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	textureTableBinding.descriptorCount = 1;
+	textureTableBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	textureTableBinding.pImmutableSamplers = nullptr;
+
+	// Variable-count binding, so it has to be the last one
 	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-	samplerLayoutBinding.binding = 1;
+	samplerLayoutBinding.binding = 2;
 	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	samplerLayoutBinding.descriptorCount = MAX_BINDLESS_TEXTURES;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings = { uboLayoutBinding, textureTableBinding, samplerLayoutBinding };
 
 	// Binding flags for bindless
-	std::array<VkDescriptorBindingFlags, 2> bindingFlags{};
+	std::array<VkDescriptorBindingFlags, 3> bindingFlags{};
 	bindingFlags[0] = 0; // UBO: no special flags
-	bindingFlags[1] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+	bindingFlags[1] = 0; // texture table: written once per descriptor generation
+	bindingFlags[2] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
 		| VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
 		| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
 
@@ -128,46 +163,112 @@ void SpellApp::createPipelineLayout() {
 }
 
 void SpellApp::createPipeline() {
+	const char* formatNames[] = { "Full", "Packed" };
+	const char* layoutNames[] = { "interleaved", "split" };
+	for (uint32_t format = 0; format < static_cast<uint32_t>(VertexFormat::Count); format++) {
+		for (uint32_t layout = 0; layout < static_cast<uint32_t>(VertexLayout::Count); layout++) {
+			PipelineSet& set = pipelines_[format][layout];
+			try {
+				createPipelineSet(static_cast<VertexFormat>(format), static_cast<VertexLayout>(layout), set);
+			} catch (const std::exception& e) {
+				// Full interleaved is what every other vertex input falls back to
+				if (format == static_cast<uint32_t>(VertexFormat::Full)
+					&& layout == static_cast<uint32_t>(VertexLayout::Interleaved)) {
+					throw;
+				}
+				std::cerr << "[Spell] " << formatNames[format] << " " << layoutNames[layout]
+					<< " vertex input disabled: " << e.what() << std::endl;
+				set = PipelineSet{};
+			}
+		}
+	}
+}
+
+bool SpellApp::isVertexInputAvailable(VertexFormat format, VertexLayout layout) const {
+	return pipelines_[static_cast<size_t>(format)][static_cast<size_t>(layout)].isAvailable();
+}
+
+void SpellApp::selectAvailableVertexInput() {
+	const VertexFormat format = resources_.vertexFormat();
+	const VertexLayout layout = resources_.vertexLayout();
+	if (isVertexInputAvailable(format, layout)) return;
+
+	// Keep the layout if the full format has it, otherwise both fall back
+	resources_.setVertexFormat(VertexFormat::Full);
+	if (!isVertexInputAvailable(VertexFormat::Full, layout)) {
+		resources_.setVertexLayout(VertexLayout::Interleaved);
+	}
+	std::cout << "[Spell] Requested vertex input has no pipelines, loading the full format instead" << std::endl;
+}
+
+void SpellApp::createPipelineSet(VertexFormat format, VertexLayout layout, PipelineSet& out) {
+	const bool packed = format == VertexFormat::Packed;
+	const std::string vertShaderPath = packed ? "shaders/packed_vert.spv" : "shaders/vert.spv";
+	// With split streams, wireframe and points draw unlit from the position stream alone
+	const bool positionOnly = layout == VertexLayout::Split;
+	const std::string lineVertShaderPath = !positionOnly ? vertShaderPath
+		: packed ? "shaders/packed_position_vert.spv" : "shaders/position_vert.spv";
+
 	// 1. Textured pipeline (default - full PBR with textures)
 	PipelineConfigInfo pipelineConfig{};
 	SpellPipeline::defaultPipelineConfigInfo(pipelineConfig, device_.msaaSamples());
 	pipelineConfig.renderPass = renderer_.getSwapChainRenderPass();
 	pipelineConfig.pipelineLayout = pipelineLayout_;
+	pipelineConfig.vertexFormat = format;
+	pipelineConfig.vertexLayout = layout;
 
-	pipeline_ = std::make_unique<SpellPipeline>(
-		device_, "shaders/vert.spv", "shaders/frag.spv", pipelineConfig);
+	out.textured = std::make_unique<SpellPipeline>(
+		device_, vertShaderPath, "shaders/frag.spv", pipelineConfig);
 
 	// 2. Flat White pipeline (no textures, simple Lambert lighting)
 	PipelineConfigInfo flatConfig{};
 	SpellPipeline::defaultPipelineConfigInfo(flatConfig, device_.msaaSamples());
 	flatConfig.renderPass = renderer_.getSwapChainRenderPass();
 	flatConfig.pipelineLayout = pipelineLayout_;
+	flatConfig.vertexFormat = format;
+	flatConfig.vertexLayout = layout;
 
-	pipelineFlatWhite_ = std::make_unique<SpellPipeline>(
-		device_, "shaders/vert.spv", "shaders/flat_color_frag.spv", flatConfig);
+	out.flatWhite = std::make_unique<SpellPipeline>(
+		device_, vertShaderPath, "shaders/flat_color_frag.spv", flatConfig);
 
 	// 3. Wireframe pipeline
 	PipelineConfigInfo wireConfig{};
 	SpellPipeline::defaultPipelineConfigInfo(wireConfig, device_.msaaSamples());
 	wireConfig.renderPass = renderer_.getSwapChainRenderPass();
 	wireConfig.pipelineLayout = pipelineLayout_;
+	wireConfig.vertexFormat = format;
+	wireConfig.vertexLayout = layout;
+	wireConfig.positionOnly = positionOnly;
 	wireConfig.rasterizationInfo.polygonMode = VK_POLYGON_MODE_LINE;
 	wireConfig.rasterizationInfo.lineWidth = 1.0f;
 	wireConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
 
-	pipelineWireframe_ = std::make_unique<SpellPipeline>(
-		device_, "shaders/vert.spv", "shaders/flat_color_frag.spv", wireConfig);
+	out.wireframe = std::make_unique<SpellPipeline>(
+		device_, lineVertShaderPath, "shaders/flat_color_frag.spv", wireConfig);
 
 	// 4. Point Cloud pipeline
 	PipelineConfigInfo pointConfig{};
 	SpellPipeline::defaultPipelineConfigInfo(pointConfig, device_.msaaSamples());
 	pointConfig.renderPass = renderer_.getSwapChainRenderPass();
 	pointConfig.pipelineLayout = pipelineLayout_;
+	pointConfig.vertexFormat = format;
+	pointConfig.vertexLayout = layout;
+	pointConfig.positionOnly = positionOnly;
 	pointConfig.rasterizationInfo.polygonMode = VK_POLYGON_MODE_POINT;
 	pointConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
 
-	pipelinePointCloud_ = std::make_unique<SpellPipeline>(
-		device_, "shaders/vert.spv", "shaders/flat_color_frag.spv", pointConfig);
+	out.pointCloud = std::make_unique<SpellPipeline>(
+		device_, lineVertShaderPath, "shaders/flat_color_frag.spv", pointConfig);
+}
+
+SpellPipeline& SpellApp::PipelineSet::get(RenderMode mode) const {
+	switch (mode) {
+	case RenderMode::FlatWhite:  return *flatWhite;
+	case RenderMode::Wireframe:  return *wireframe;
+	case RenderMode::PointCloud: return *pointCloud;
+	case RenderMode::Textured:
+	default:                     return *textured;
+	}
 }
 
 void SpellApp::createUniformBuffers() {
@@ -184,30 +285,76 @@ void SpellApp::createUniformBuffers() {
 	}
 }
 
-void SpellApp::createDescriptorPool() {
-	size_t imageCount = renderer_.getSwapChainImageCount();
+void SpellApp::createClusterCuller() {
+	if (!SpellClusterCuller::isSupported(device_)) {
+		std::cout << "[Spell] Cluster culling disabled: drawIndirectFirstInstance not supported" << std::endl;
+		return;
+	}
+	try {
+		depthPyramid_ = std::make_unique<SpellDepthPyramid>(device_, "shaders/hiz_build_comp.spv",
+			"shaders/hiz_build_ms_comp.spv");
+		clusterCuller_ = std::make_unique<SpellClusterCuller>(device_, "shaders/cluster_cull_comp.spv",
+			depthPyramid_->getCullSetLayout());
+	} catch (const std::exception& e) {
+		std::cerr << "[Spell] Cluster culling disabled: " << e.what() << std::endl;
+		clusterCuller_.reset();
+		depthPyramid_.reset();
+		return;
+	}
+	if (!renderer_.isDepthSampleable()) {
+		std::cout << "[Spell] Occlusion culling disabled: depth buffer cannot be sampled" << std::endl;
+	}
+}
+
+SpellApp::DescriptorGeneration SpellApp::createDescriptors(const SpellModel& model,
+	const std::vector<SpellTexture*>& textures, const MaterialTextureTable& textureTable) {
+	const uint32_t cullSetCount = clusterCuller_ && model.hasClusters() ? SpellSwapChain::MAX_FRAMES_IN_FLIGHT : 0;
+
+	DescriptorGeneration descriptors;
+	descriptors.pool = createDescriptorPool(static_cast<uint32_t>(uniformBuffers_.size()), cullSetCount);
+	createDescriptorSets(textures, textureTable, descriptors);
+	if (cullSetCount > 0) {
+		createCullDescriptorSets(model, descriptors);
+	}
+	return descriptors;
+}
+
+void SpellApp::destroyDescriptors(DescriptorGeneration& descriptors) {
+	if (descriptors.pool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(device_.device(), descriptors.pool, nullptr);
+	}
+	descriptors.pool = VK_NULL_HANDLE;
+	descriptors.sets.clear();
+}
 
-	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+VkDescriptorPool SpellApp::createDescriptorPool(uint32_t setCount, uint32_t cullSetCount) {
+	std::vector<VkDescriptorPoolSize> poolSizes(3);
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = static_cast<uint32_t>(imageCount);
+	poolSizes[0].descriptorCount = setCount;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = MAX_BINDLESS_TEXTURES * static_cast<uint32_t>(imageCount);
+	poolSizes[1].descriptorCount = MAX_BINDLESS_TEXTURES * setCount;
+	// Texture table, plus the cluster cull sets (storage buffers only, see SpellClusterCuller)
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = setCount + SpellClusterCuller::STORAGE_BUFFERS_PER_SET * cullSetCount;
 
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = static_cast<uint32_t>(imageCount);
+	poolInfo.maxSets = setCount + cullSetCount;
 
-	if (vkCreateDescriptorPool(device_.device(), &poolInfo, nullptr, &descriptorPool_) != VK_SUCCESS) {
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device_.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create descriptor pool!");
 	}
+	return pool;
 }
 
-void SpellApp::createDescriptorSets() {
-	size_t imageCount = renderer_.getSwapChainImageCount();
-	uint32_t actualTextureCount = resources_.textureCount();
+void SpellApp::createDescriptorSets(const std::vector<SpellTexture*>& textures, const MaterialTextureTable& textureTable,
+	DescriptorGeneration& out) {
+	size_t imageCount = uniformBuffers_.size();
+	uint32_t actualTextureCount = static_cast<uint32_t>(textures.size());
 	if (actualTextureCount == 0) actualTextureCount = 1;
 
 	std::vector<VkDescriptorSetLayout> layouts(imageCount, descriptorSetLayout_);
@@ -223,12 +370,12 @@ void SpellApp::createDescriptorSets() {
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.pNext = &variableCountInfo;
-	allocInfo.descriptorPool = descriptorPool_;
+	allocInfo.descriptorPool = out.pool;
 	allocInfo.descriptorSetCount = static_cast<uint32_t>(imageCount);
 	allocInfo.pSetLayouts = layouts.data();
 
-	descriptorSets_.resize(imageCount);
-	if (vkAllocateDescriptorSets(device_.device(), &allocInfo, descriptorSets_.data()) != VK_SUCCESS) {
+	out.sets.resize(imageCount);
+	if (vkAllocateDescriptorSets(device_.device(), &allocInfo, out.sets.data()) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate descriptor sets!");
 	}
 
@@ -241,37 +388,71 @@ void SpellApp::createDescriptorSets() {
 
 		VkWriteDescriptorSet uboWrite{};
 		uboWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		uboWrite.dstSet = descriptorSets_[i];
+		uboWrite.dstSet = out.sets[i];
 		uboWrite.dstBinding = 0;
 		uboWrite.dstArrayElement = 0;
 		uboWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 		uboWrite.descriptorCount = 1;
 		uboWrite.pBufferInfo = &bufferInfo;
 
+		// Texture table write
+		VkDescriptorBufferInfo tableInfo{};
+		tableInfo.buffer = textureTable.getBuffer();
+		tableInfo.offset = 0;
+		tableInfo.range = textureTable.getSize();
+
+		VkWriteDescriptorSet tableWrite{};
+		tableWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		tableWrite.dstSet = out.sets[i];
+		tableWrite.dstBinding = 1;
+		tableWrite.dstArrayElement = 0;
+		tableWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		tableWrite.descriptorCount = 1;
+		tableWrite.pBufferInfo = &tableInfo;
+
 		// Bindless texture array write
 		std::vector<VkDescriptorImageInfo> imageInfos(actualTextureCount);
 		for (uint32_t t = 0; t < actualTextureCount; t++) {
 			imageInfos[t].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfos[t].imageView = resources_.textures()[t]->getImageView();
-			imageInfos[t].sampler = resources_.textures()[t]->getSampler();
+			imageInfos[t].imageView = textures[t]->getImageView();
+			imageInfos[t].sampler = textures[t]->getSampler();
 		}
 
 		VkWriteDescriptorSet textureWrite{};
 		textureWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		textureWrite.dstSet = descriptorSets_[i];
-		textureWrite.dstBinding = 1;
+		textureWrite.dstSet = out.sets[i];
+		textureWrite.dstBinding = 2;
 		textureWrite.dstArrayElement = 0;
 		textureWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 		textureWrite.descriptorCount = actualTextureCount;
 		textureWrite.pImageInfo = imageInfos.data();
 
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites = { uboWrite, textureWrite };
+		std::array<VkWriteDescriptorSet, 3> descriptorWrites = { uboWrite, tableWrite, textureWrite };
 		vkUpdateDescriptorSets(device_.device(), static_cast<uint32_t>(descriptorWrites.size()),
 			descriptorWrites.data(), 0, nullptr);
 	}
 }
 
-void SpellApp::updateUniformBuffer(int frameIndex) {
+void SpellApp::createCullDescriptorSets(const SpellModel& model, DescriptorGeneration& out) {
+	std::vector<VkDescriptorSetLayout> layouts(SpellSwapChain::MAX_FRAMES_IN_FLIGHT,
+		clusterCuller_->getDescriptorSetLayout());
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = out.pool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
+
+	out.cullSets.resize(layouts.size());
+	if (vkAllocateDescriptorSets(device_.device(), &allocInfo, out.cullSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate cluster cull descriptor sets!");
+	}
+	for (uint32_t i = 0; i < out.cullSets.size(); i++) {
+		clusterCuller_->writeDescriptorSet(out.cullSets[i], model, i);
+	}
+}
+
+UniformBufferObject SpellApp::updateUniformBuffer(int frameIndex) {
 	static auto startTime = std::chrono::high_resolution_clock::now();
 	auto currentTime = std::chrono::high_resolution_clock::now();
 	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
@@ -310,48 +491,119 @@ void SpellApp::updateUniformBuffer(int frameIndex) {
 	vkMapMemory(device_.device(), uniformBuffersMemory_[frameIndex], 0, sizeof(ubo), 0, &data);
 	memcpy(data, &ubo, sizeof(ubo));
 	vkUnmapMemory(device_.device(), uniformBuffersMemory_[frameIndex]);
+	return ubo;
 }
 
 void SpellApp::renderFrame() {
-	if (needReload_) {
-		resources_.reloadResources();
-		rebuildDescriptors();
+	// Reloads run on a background thread; the current model keeps rendering meanwhile.
+	// A request made during a reload starts once the running one has been swapped in;
+	// an LOD build for the old model is cancelled instead of waited for.
+	auto prepareDescriptors = [this](const SpellModel& model, const std::vector<SpellTexture*>& textures,
+		const MaterialTextureTable& textureTable) {
+		pendingDescriptors_ = createDescriptors(model, textures, textureTable);
+	};
+	if (needReload_ && resources_.isBuildingLods()) {
+		resources_.cancelLodBuild();
+	}
+	if (needReload_ && !resources_.isReloading()) {
+		selectAvailableVertexInput();
+		resources_.beginReload(prepareDescriptors);
 		needReload_ = false;
 	}
+	applyPendingReload();
+
+	// LODs are generated once the model is on screen, so they never delay the first frame
+	if (!needReload_ && frameNumber_ > 0 && !resources_.isReloading() && resources_.needsLods()) {
+		resources_.beginLodBuild(prepareDescriptors);
+	}
 
 	auto commandBuffer = renderer_.beginFrame();
 	if (commandBuffer == nullptr) return;
 
+	// beginFrame() waited on this frame slot's fence, so older frames can be retired
+	resources_.collectRetired(frameNumber_);
+	retiredDescriptors_.erase(std::remove_if(retiredDescriptors_.begin(), retiredDescriptors_.end(),
+		[this](RetiredDescriptors& retired) {
+			if (frameNumber_ < retired.swapFrame + SpellSwapChain::MAX_FRAMES_IN_FLIGHT) return false;
+			destroyDescriptors(retired.descriptors);
+			return true;
+		}), retiredDescriptors_.end());
+
 	int frameIndex = renderer_.getFrameIndex();
-	updateUniformBuffer(frameIndex);
+	UniformBufferObject ubo = updateUniformBuffer(frameIndex);
+	SpellModel& model = *resources_.model();
+
+	// A recreated swap chain has a new depth buffer; recreateSwapChain() left the device idle
+	if (depthPyramid_ && renderer_.isDepthSampleable() &&
+		depthPyramidGeneration_ != renderer_.getSwapChainGeneration()) {
+		depthPyramid_->resize(renderer_.getDepthImageView(), renderer_.getDepthFormat(),
+			renderer_.getSwapChainExtent());
+		depthPyramidGeneration_ = renderer_.getSwapChainGeneration();
+	}
 
 	// Pipeline statistics query: reset must be outside render pass
 	vkCmdResetQueryPool(commandBuffer, statsQueryPool_, frameIndex, 1);
+	if (timestampQueryPool_ != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool_, 2 * frameIndex, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool_, 2 * frameIndex);
+	}
+
+	// Both the direct draws and the cull pass use this frame's LOD selection
+	model.selectLods(ubo, static_cast<float>(renderer_.getSwapChainExtent().height), lodPixelError_, frameIndex);
+
+	// GPU cluster culling: compute pass before the render pass writes this frame's draw list.
+	// The counter read here is from this slot's previous frame, whose fence beginFrame() waited on.
+	const bool cullClusters = clusterCulling_ && clusterCuller_ && !descriptors_.cullSets.empty();
+	// Wireframe and point modes draw back faces and leave holes in the depth buffer, so only
+	// the frustum test applies there
+	const bool solidMode = renderMode_ == RenderMode::Textured || renderMode_ == RenderMode::FlatWhite;
+	const bool occlusionCulling = cullClusters && occlusionCulling_ && solidMode && renderer_.isDepthSampleable();
+	if (cullClusters) {
+		renderStats_.visibleClusters = model.readVisibleClusterCount(frameIndex);
+		renderStats_.occludedClusters = model.readOccludedClusterCount(frameIndex);
+		depthPyramid_->updateCullData(frameIndex, occlusionCulling);
+		clusterCuller_->dispatch(commandBuffer, descriptors_.cullSets[frameIndex], depthPyramid_->getCullSet(frameIndex),
+			model, frameIndex, SpellClusterCuller::makePushConstants(ubo, model.getClusterCount(), solidMode));
+	}
 
 	renderer_.beginRenderPass(commandBuffer);
 
 	vkCmdPushConstants(commandBuffer, pipelineLayout_, VK_SHADER_STAGE_FRAGMENT_BIT,
 		0, sizeof(LightPushConstantData), &lightData_);
 
-	switch (renderMode_) {
-	case RenderMode::FlatWhite:  pipelineFlatWhite_->bind(commandBuffer); break;
-	case RenderMode::Wireframe:  pipelineWireframe_->bind(commandBuffer); break;
-	case RenderMode::PointCloud: pipelinePointCloud_->bind(commandBuffer); break;
-	case RenderMode::Textured:
-	default:                     pipeline_->bind(commandBuffer); break;
-	}
-	resources_.model()->bind(commandBuffer);
+	// The pipeline's vertex input has to match the layout the model was uploaded with
+	const PipelineSet& pipelines = pipelines_[static_cast<size_t>(model.getVertexFormat())]
+		[static_cast<size_t>(model.getVertexLayout())];
+	pipelines.get(renderMode_).bind(commandBuffer);
+	model.bind(commandBuffer);
 
 	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-		pipelineLayout_, 0, 1, &descriptorSets_[frameIndex], 0, nullptr);
+		pipelineLayout_, 0, 1, &descriptors_.sets[frameIndex], 0, nullptr);
 
 	// Begin query (inside render pass is fine)
 	vkCmdBeginQuery(commandBuffer, statsQueryPool_, frameIndex, 0);
 
-	resources_.model()->draw(commandBuffer);
+	if (cullClusters) {
+		clusterCuller_->draw(commandBuffer, model, frameIndex);
+	} else {
+		// Submeshes whose material range has no triangle in the view are left out
+		const MeshBvh* bvh = resources_.bvh();
+		const bool bvhCulling = bvhCulling_ && bvh;
+		if (bvhCulling) {
+			auto queryStart = std::chrono::high_resolution_clock::now();
+			bvh->queryFrustum(ubo.proj * ubo.view * ubo.model, visibleRanges_);
+			auto queryEnd = std::chrono::high_resolution_clock::now();
+			renderStats_.bvhQueryMs = std::chrono::duration<float, std::milli>(queryEnd - queryStart).count();
+		}
+		model.orderDraws(ubo, sortDraws_, bvhCulling ? &visibleRanges_ : nullptr);
+		model.draw(commandBuffer);
+	}
 
 	// End query before ImGui rendering so we only measure scene draw calls
 	vkCmdEndQuery(commandBuffer, statsQueryPool_, frameIndex);
+	if (timestampQueryPool_ != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool_, 2 * frameIndex + 1);
+	}
 
 	// Read previous frame's query results (avoids GPU stall)
 	int prevFrame = (frameIndex + SpellSwapChain::MAX_FRAMES_IN_FLIGHT - 1) % SpellSwapChain::MAX_FRAMES_IN_FLIGHT;
@@ -369,15 +621,38 @@ void SpellApp::renderFrame() {
 			renderStats_.gpuClippingPrimitives = stats[3];
 			renderStats_.gpuFSInvocations = stats[4];
 		}
+		uint64_t timestamps[2]{};
+		if (timestampQueryPool_ != VK_NULL_HANDLE && vkGetQueryPoolResults(
+			device_.device(), timestampQueryPool_,
+			2 * prevFrame, 2,
+			sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			renderStats_.gpuSceneMs = static_cast<float>((timestamps[1] - timestamps[0]) * timestampPeriodNs_ * 1e-6);
+		}
 	}
 	statsQueryReady_ = true;
 
 	// Collect render stats
-	renderStats_.drawCalls = 1;
+	const MeshBvh* bvh = resources_.bvh();
+	renderStats_.bvhCulling = !cullClusters && bvhCulling_ && bvh;
+	renderStats_.bvhCulledDraws = renderStats_.bvhCulling ? model.getFrustumCulledDraws() : 0;
+	if (!renderStats_.bvhCulling) renderStats_.bvhQueryMs = 0.0f;
+	renderStats_.bvhNodes = bvh ? bvh->getNodeCount() : 0;
+	renderStats_.bvhBytes = bvh ? bvh->getMemoryBytes() : 0;
+	renderStats_.bvhBuildTimeMs = resources_.lastBvhBuildTimeMs();
+	renderStats_.drawCalls = resources_.model()->getDrawCount() - renderStats_.bvhCulledDraws;
 	renderStats_.vertices = resources_.model()->getVertexCount();
 	renderStats_.indices = resources_.model()->getIndexCount();
-	renderStats_.triangles = renderStats_.indices / 3;
+	renderStats_.triangles = resources_.model()->getRenderedTriangleCount();
+	renderStats_.instances = resources_.model()->getInstanceCount();
+	renderStats_.clusters = model.getClusterCount();
+	renderStats_.meshlets = model.getMeshletCount();
+	renderStats_.clusterCulling = cullClusters;
+	renderStats_.occlusionCulling = occlusionCulling;
+	if (!cullClusters) renderStats_.visibleClusters = renderStats_.clusters;
+	if (!occlusionCulling) renderStats_.occludedClusters = 0;
 	renderStats_.textureCount = resources_.textureCount();
+	renderStats_.textureSlotCount = resources_.textureSlotCount();
 	renderStats_.materialCount = static_cast<uint32_t>(resources_.model()->getMaterials().size());
 	renderStats_.fps = ImGui::GetIO().Framerate;
 	renderStats_.frameTimeMs = 1000.0f / renderStats_.fps;
@@ -385,27 +660,195 @@ void SpellApp::renderFrame() {
 	renderStats_.textureLoadTimeMs = resources_.lastTextureLoadTimeMs();
 	renderStats_.totalLoadTimeMs = resources_.lastTotalLoadTimeMs();
 	renderStats_.decodeOverlapMs = resources_.lastDecodeOverlapMs();
+	renderStats_.modelCacheHit = resources_.lastModelCacheHit();
+	renderStats_.textureCacheHits = resources_.lastTextureCacheHits();
+	renderStats_.textureCacheMisses = resources_.lastTextureCacheMisses();
+	renderStats_.compressedTextures = resources_.lastCompressedTextures();
+	const MeshOptimizeStats& optimizeStats = resources_.lastMeshOptimizeStats();
+	renderStats_.meshOptimized = optimizeStats.optimized;
+	renderStats_.acmrBefore = optimizeStats.before.acmr;
+	renderStats_.acmrAfter = optimizeStats.after.acmr;
+	renderStats_.atvrBefore = optimizeStats.before.atvr;
+	renderStats_.atvrAfter = optimizeStats.after.atvr;
+	renderStats_.meshOptimizeTimeMs = optimizeStats.timeMs;
+	renderStats_.lodLevels = model.getLodLevelCount();
+	renderStats_.activeLodMin = model.getActiveLodMin();
+	renderStats_.activeLodMax = model.getActiveLodMax();
+	renderStats_.trianglesSaved = model.getTrianglesSaved();
+	renderStats_.lodBuildTimeMs = resources_.lastLodBuildTimeMs();
+	renderStats_.packedVertices = model.getVertexFormat() == VertexFormat::Packed;
+	renderStats_.splitVertexStreams = model.getVertexLayout() == VertexLayout::Split;
+	renderStats_.vertexStride = vertexSize(model.getVertexFormat(), model.getVertexLayout());
+	renderStats_.vertexBufferBytes = model.getVertexBufferSize();
+	renderStats_.index16 = model.getIndexType() == VK_INDEX_TYPE_UINT16;
+	renderStats_.submeshCount = model.getSubmeshCount();
+	renderStats_.indexBufferBytes = model.getIndexBufferSize();
+	renderStats_.drawsSorted = sortDraws_ && !cullClusters;
+	renderStats_.materialSwitches = cullClusters ? 0 : model.getMaterialSwitches();
+
+	updateVertexFormatBenchmark(model);
+	renderStats_.vertexBenchmarkActive = vertexBenchmark_.active;
 
 	imgui_->newFrame();
+	pickAtCursor(ubo);
 	drawImGuiPanels();
 	imgui_->render(commandBuffer);
 
 	renderer_.endRenderPass(commandBuffer);
+
+	// The next frame's occlusion test reads this frame's depth
+	if (occlusionCulling) {
+		depthPyramid_->build(commandBuffer, renderer_.getDepthImage(), ubo.proj * ubo.view * ubo.model);
+	} else if (depthPyramid_) {
+		depthPyramid_->invalidate();
+	}
+
 	renderer_.endFrame();
+	frameNumber_++;
+}
+
+void SpellApp::pickAtCursor(const UniformBufferObject& ubo) {
+	const ImGuiIO& io = ImGui::GetIO();
+	const MeshBvh* bvh = resources_.bvh();
+	if (!io.MouseClicked[0] || io.WantCaptureMouse || !bvh || io.DisplaySize.x <= 0.0f || io.DisplaySize.y <= 0.0f) {
+		return;
+	}
+
+	// Cursor ray in the BVH's space (before ubo.model); with the flipped projection, NDC y grows
+	// downwards like window coordinates
+	const glm::mat4 invClip = glm::inverse(ubo.proj * ubo.view * ubo.model);
+	const glm::vec2 ndc(2.0f * io.MousePos.x / io.DisplaySize.x - 1.0f, 2.0f * io.MousePos.y / io.DisplaySize.y - 1.0f);
+	auto unproject = [&](float depth) {
+		const glm::vec4 p = invClip * glm::vec4(ndc, depth, 1.0f);
+		return glm::vec3(p) / p.w;
+	};
+	const glm::vec3 origin = unproject(-1.0f);
+	const glm::vec3 direction = unproject(1.0f) - origin;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	BvhHit hit;
+	const bool found = bvh->raycast(origin, direction, hit);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	renderStats_.pickValid = true;
+	renderStats_.pickHit = found;
+	renderStats_.pickTimeUs = std::chrono::duration<float, std::micro>(end - start).count();
+	if (!found) return;
+
+	const std::vector<MaterialRange>& ranges = resources_.model()->getMaterialRanges();
+	renderStats_.pickPosition = glm::vec3(ubo.model * glm::vec4(hit.position, 1.0f));
+	renderStats_.pickDistance = glm::length(renderStats_.pickPosition - ubo.camPos);
+	renderStats_.pickTriangle = hit.triangle;
+	renderStats_.pickInstance = hit.instance;
+	renderStats_.pickMaterial = hit.range < ranges.size() ? ranges[hit.range].materialIndex : -1;
 }
 
 void SpellApp::drawImGuiPanels() {
-	if (inspector_.draw(resources_, lightData_, convertYUp_, renderStats_, renderMode_)) {
+	if (inspector_.draw(resources_, lightData_, convertYUp_, renderStats_, renderMode_, clusterCulling_,
+		occlusionCulling_, sortDraws_, bvhCulling_, lodPixelError_, startVertexBenchmark_)) {
 		needReload_ = true;
 	}
+	if (startVertexBenchmark_) {
+		startVertexBenchmark_ = false;
+		startVertexFormatBenchmark();
+	}
+}
+
+void SpellApp::applyPendingReload() {
+	// Swap at the frame boundary: frames already submitted keep the old model, textures and
+	// descriptor sets alive until they are retired in renderFrame()
+	if (!resources_.applyPendingReload(frameNumber_)) return;
+
+	retiredDescriptors_.push_back({ std::move(descriptors_), frameNumber_ });
+	descriptors_ = std::move(pendingDescriptors_);
+	pendingDescriptors_ = DescriptorGeneration{};
+	// The pyramid holds the old model's depth
+	if (depthPyramid_) depthPyramid_->invalidate();
+}
+
+void SpellApp::startVertexFormatBenchmark() {
+	if (vertexBenchmark_.active) return;
+	vertexBenchmark_ = VertexFormatBenchmark{};
+	vertexBenchmark_.active = true;
+	vertexBenchmark_.originalFormat = resources_.vertexFormat();
+	vertexBenchmark_.originalLayout = resources_.vertexLayout();
+	// Full interleaved (config 0) always has pipelines
+	resources_.setVertexFormat(VertexFormatBenchmark::formatOf(0));
+	resources_.setVertexLayout(VertexFormatBenchmark::layoutOf(0));
+	needReload_ = true;
+	std::cout << "[Spell] Vertex format benchmark started" << std::endl;
 }
 
-void SpellApp::rebuildDescriptors() {
-	vkDestroyDescriptorPool(device_.device(), descriptorPool_, nullptr);
-	descriptorSets_.clear();
+void SpellApp::updateVertexFormatBenchmark(const SpellModel& model) {
+	VertexFormatBenchmark& bench = vertexBenchmark_;
+	if (!bench.active) return;
+
+	// Only measure the requested vertex input once it is on screen with its final LOD chain
+	if (needReload_ || resources_.isReloading() || resources_.isBuildingLods() || resources_.needsLods()
+		|| model.getVertexFormat() != VertexFormatBenchmark::formatOf(bench.config)
+		|| model.getVertexLayout() != VertexFormatBenchmark::layoutOf(bench.config)) {
+		bench.frame = 0;
+		return;
+	}
+
+	VertexFormatBenchmark::Result& result = bench.results[bench.config];
+	if (++bench.frame <= VertexFormatBenchmark::WARMUP_FRAMES) {
+		result = VertexFormatBenchmark::Result{};
+		bench.gpuSamples = 0;
+		return;
+	}
+	result.frameMs += ImGui::GetIO().DeltaTime * 1000.0;
+	if (timestampQueryPool_ != VK_NULL_HANDLE) {
+		result.gpuSceneMs += renderStats_.gpuSceneMs;
+		bench.gpuSamples++;
+	}
+	if (bench.frame < VertexFormatBenchmark::WARMUP_FRAMES + VertexFormatBenchmark::BENCH_FRAMES) return;
 
-	createDescriptorPool();
-	createDescriptorSets();
+	result.frameMs /= VertexFormatBenchmark::BENCH_FRAMES;
+	result.gpuSceneMs = bench.gpuSamples > 0 ? result.gpuSceneMs / bench.gpuSamples : 0.0;
+	result.vertexBufferBytes = model.getVertexBufferSize();
+
+	// Vertex inputs without pipelines are skipped and reported as such
+	while (++bench.config < VertexFormatBenchmark::CONFIG_COUNT
+		&& !isVertexInputAvailable(VertexFormatBenchmark::formatOf(bench.config),
+			VertexFormatBenchmark::layoutOf(bench.config))) {
+	}
+	if (bench.config < VertexFormatBenchmark::CONFIG_COUNT) {
+		bench.frame = 0;
+		resources_.setVertexFormat(VertexFormatBenchmark::formatOf(bench.config));
+		resources_.setVertexLayout(VertexFormatBenchmark::layoutOf(bench.config));
+		needReload_ = true;
+		return;
+	}
+
+	const char* formatNames[] = { "Full", "Packed" };
+	const char* layoutNames[] = { "interleaved", "split" };
+	const char* modeNames[] = { "Textured", "Flat White", "Wireframe", "Point Cloud" };
+	std::cout << std::fixed << std::setprecision(3)
+		<< "[Spell] Vertex format benchmark (" << modeNames[static_cast<int>(renderMode_)] << ", "
+		<< VertexFormatBenchmark::BENCH_FRAMES << " frames each):" << std::endl;
+	for (uint32_t c = 0; c < VertexFormatBenchmark::CONFIG_COUNT; c++) {
+		const VertexFormatBenchmark::Result& r = bench.results[c];
+		const VertexFormat format = VertexFormatBenchmark::formatOf(c);
+		const VertexLayout layout = VertexFormatBenchmark::layoutOf(c);
+		std::cout << "  " << std::setw(6) << formatNames[static_cast<int>(format)]
+			<< " " << std::setw(11) << layoutNames[static_cast<int>(layout)] << ": ";
+		if (!isVertexInputAvailable(format, layout)) {
+			std::cout << "no pipelines" << std::endl;
+			continue;
+		}
+		std::cout << vertexSize(format, layout) << " B/vertex, "
+			<< std::setprecision(2) << r.vertexBufferBytes / (1024.0 * 1024.0) << " MB vertex buffers, "
+			<< std::setprecision(3) << r.frameMs << " ms/frame, "
+			<< (timestampQueryPool_ != VK_NULL_HANDLE ? r.gpuSceneMs : 0.0) << " ms GPU scene" << std::endl;
+	}
+
+	bench.active = false;
+	if (bench.originalFormat != resources_.vertexFormat() || bench.originalLayout != resources_.vertexLayout()) {
+		resources_.setVertexFormat(bench.originalFormat);
+		resources_.setVertexLayout(bench.originalLayout);
+		needReload_ = true;
+	}
 }
 
 } // namespace Spell
@@ -4,12 +4,16 @@
 #include "core/SpellDevice.h"
 #include "renderer/SpellRenderer.h"
 #include "renderer/SpellPipeline.h"
+#include "renderer/SpellClusterCuller.h"
+#include "renderer/SpellDepthPyramid.h"
 #include "renderer/SpellTypes.h"
 #include "resources/SpellResourceManager.h"
 #include "ui/SpellImGui.h"
 #include "ui/SpellInspector.h"
 
+#include <array>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Spell {
@@ -28,29 +32,98 @@ public:
 	void run();
 
 private:
+	// Descriptor pool + per-image sets bound to one generation of model and textures
+	struct DescriptorGeneration {
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> sets;
+		std::vector<VkDescriptorSet> cullSets; // per frame in flight, empty without cluster culling
+	};
+
+	struct RetiredDescriptors {
+		DescriptorGeneration descriptors;
+		uint64_t swapFrame;
+	};
+
+	// The four display-mode pipelines for one vertex input layout
+	struct PipelineSet {
+		std::unique_ptr<SpellPipeline> textured;
+		std::unique_ptr<SpellPipeline> flatWhite;
+		std::unique_ptr<SpellPipeline> wireframe;
+		std::unique_ptr<SpellPipeline> pointCloud;
+
+		SpellPipeline& get(RenderMode mode) const;
+		// False when a shader of the set failed to load; models are not uploaded in its vertex input
+		bool isAvailable() const { return pointCloud != nullptr; }
+	};
+
+	// Vertex input A/B run started from the inspector: every format and layout is loaded in turn
+	// and renders the same view for BENCH_FRAMES frames after a warm-up, then the original
+	// format and layout are restored and the results are printed
+	struct VertexFormatBenchmark {
+		static constexpr uint32_t WARMUP_FRAMES = 60;
+		static constexpr uint32_t BENCH_FRAMES = 300;
+		static constexpr uint32_t FORMAT_COUNT = static_cast<uint32_t>(VertexFormat::Count);
+		static constexpr uint32_t CONFIG_COUNT = FORMAT_COUNT * static_cast<uint32_t>(VertexLayout::Count);
+
+		static VertexFormat formatOf(uint32_t config) { return static_cast<VertexFormat>(config % FORMAT_COUNT); }
+		static VertexLayout layoutOf(uint32_t config) { return static_cast<VertexLayout>(config / FORMAT_COUNT); }
+
+		struct Result {
+			double frameMs = 0.0;
+			double gpuSceneMs = 0.0;
+			uint64_t vertexBufferBytes = 0;
+		};
+
+		bool active = false;
+		VertexFormat originalFormat = VertexFormat::Full;
+		VertexLayout originalLayout = VertexLayout::Interleaved;
+		uint32_t config = 0;
+		uint32_t frame = 0;
+		uint32_t gpuSamples = 0;
+		std::array<Result, CONFIG_COUNT> results{};
+	};
+
 	void createPipelineLayout();
 	void createPipeline();
+	void createPipelineSet(VertexFormat format, VertexLayout layout, PipelineSet& out);
+	bool isVertexInputAvailable(VertexFormat format, VertexLayout layout) const;
+	// Points the resource manager at an available vertex input if the requested one has no pipelines
+	void selectAvailableVertexInput();
 	void createDescriptorSetLayout();
 	void createUniformBuffers();
-	void createDescriptorPool();
-	void createDescriptorSets();
-	void updateUniformBuffer(int frameIndex);
+	void createClusterCuller();
+	// Thread-safe: only reads the layouts and uniform buffers, which never change after startup
+	DescriptorGeneration createDescriptors(const SpellModel& model,
+		const std::vector<SpellTexture*>& textures, const MaterialTextureTable& textureTable);
+	VkDescriptorPool createDescriptorPool(uint32_t setCount, uint32_t cullSetCount);
+	void createDescriptorSets(const std::vector<SpellTexture*>& textures, const MaterialTextureTable& textureTable,
+		DescriptorGeneration& out);
+	void createCullDescriptorSets(const SpellModel& model, DescriptorGeneration& out);
+	void destroyDescriptors(DescriptorGeneration& descriptors);
+	UniformBufferObject updateUniformBuffer(int frameIndex);
+	// Casts the cursor ray into the model's BVH on a left click outside the UI
+	void pickAtCursor(const UniformBufferObject& ubo);
 	void renderFrame();
 	void drawImGuiPanels();
-	void rebuildDescriptors();
+	void applyPendingReload();
+	void startVertexFormatBenchmark();
+	void updateVertexFormatBenchmark(const SpellModel& model);
 
 	SpellWindow window_{ WIDTH, HEIGHT, "Spell Engine" };
 	SpellDevice device_{ window_ };
 	SpellRenderer renderer_{ window_, device_ };
 
-	std::unique_ptr<SpellPipeline> pipeline_;
-	std::unique_ptr<SpellPipeline> pipelineFlatWhite_;
-	std::unique_ptr<SpellPipeline> pipelineWireframe_;
-	std::unique_ptr<SpellPipeline> pipelinePointCloud_;
+	// Indexed by [VertexFormat][VertexLayout]
+	std::array<std::array<PipelineSet, static_cast<size_t>(VertexLayout::Count)>,
+		static_cast<size_t>(VertexFormat::Count)> pipelines_;
+	std::unique_ptr<SpellDepthPyramid> depthPyramid_;   // set 1 of the cull pass, created with clusterCuller_
+	std::unique_ptr<SpellClusterCuller> clusterCuller_; // null if the device or shader lacks support
+	uint32_t depthPyramidGeneration_ = 0;               // swap chain generation the pyramid was sized for
 	VkPipelineLayout pipelineLayout_;
 	VkDescriptorSetLayout descriptorSetLayout_;
-	VkDescriptorPool descriptorPool_;
-	std::vector<VkDescriptorSet> descriptorSets_;
+	DescriptorGeneration descriptors_;
+	DescriptorGeneration pendingDescriptors_;  // written by the reload thread, swapped in with the resources
+	std::vector<RetiredDescriptors> retiredDescriptors_;
 
 	std::vector<VkBuffer> uniformBuffers_;
 	std::vector<VkDeviceMemory> uniformBuffersMemory_;
@@ -62,15 +135,28 @@ private:
 	static constexpr uint32_t STATS_QUERY_COUNT = 5; // number of pipeline statistic bits
 	bool statsQueryReady_ = false;
 
+	// GPU timestamps around the cull pass and scene draws, two per frame in flight
+	VkQueryPool timestampQueryPool_ = VK_NULL_HANDLE; // null if the graphics queue has no timestamps
+	float timestampPeriodNs_ = 0.0f;
+
 	// Subsystems
 	SpellResourceManager resources_{ device_ };
 	SpellInspector inspector_;
 
 	bool needReload_{ false };
+	uint64_t frameNumber_{ 0 };
 	bool convertYUp_{ false };
+	bool clusterCulling_{ true };
+	bool occlusionCulling_{ true };  // HiZ test in the cull pass, needs a sampleable depth buffer
+	bool sortDraws_{ true };         // material-grouped, front-to-back direct draws
+	bool bvhCulling_{ true };        // CPU BVH frustum query before the direct draws
+	std::vector<uint8_t> visibleRanges_; // per material range of the model, from the last query
+	float lodPixelError_{ 1.0f }; // screen-space LOD error budget; 0 = always full detail
 	RenderMode renderMode_{ RenderMode::Textured };
 	LightPushConstantData lightData_{ glm::vec3(23.47f, 21.31f, 20.79f), glm::vec3(2.0f, 2.0f, 2.0f) };
 	RenderStats renderStats_{};
+	VertexFormatBenchmark vertexBenchmark_;
+	bool startVertexBenchmark_{ false };
 };
 
 } // namespace Spell
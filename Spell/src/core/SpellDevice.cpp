@@ -6,7 +6,7 @@
 
 namespace Spell {
 
-SpellDevice::SpellDevice(SpellWindow& window) : window_(window) {
+SpellDevice::SpellDevice(SpellWindow& window) : ownerThread_(std::this_thread::get_id()), window_(window) {
 	createInstance();
 	createSurface();
 	pickPhysicalDevice();
@@ -15,6 +15,9 @@ SpellDevice::SpellDevice(SpellWindow& window) : window_(window) {
 }
 
 SpellDevice::~SpellDevice() {
+	for (auto& [thread, pool] : threadCommandPools_) {
+		vkDestroyCommandPool(device_, pool, nullptr);
+	}
 	vkDestroyCommandPool(device_, commandPool_, nullptr);
 	vkDestroyDevice(device_, nullptr);
 	vkDestroySurfaceKHR(instance_, surface_, nullptr);
@@ -115,27 +118,29 @@ void SpellDevice::createLogicalDevice() {
 	deviceFeatures_.pipelineStatisticsQuery = VK_TRUE;
 	deviceFeatures_.fillModeNonSolid = VK_TRUE;
 
-	// Query descriptor indexing features
-	descriptorIndexingFeatures_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
-	descriptorIndexingFeatures_.pNext = nullptr;
+	// Query the Vulkan 1.2 features (descriptor indexing, indirect count)
+	supportedFeatures12_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	supportedFeatures12_.pNext = nullptr;
 
 	VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
 	physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-	physicalDeviceFeatures2.pNext = &descriptorIndexingFeatures_;
+	physicalDeviceFeatures2.pNext = &supportedFeatures12_;
 	vkGetPhysicalDeviceFeatures2(physicalDevice_, &physicalDeviceFeatures2);
 
-	// Enable the descriptor indexing features we need
-	VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexingFeatures{};
-	enabledIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
-	enabledIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
-	enabledIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
-	enabledIndexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
-	enabledIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
-	enabledIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	// Enable the descriptor indexing features we need, plus vkCmdDrawIndexedIndirectCount when present
+	VkPhysicalDeviceVulkan12Features enabledFeatures12{};
+	enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	enabledFeatures12.runtimeDescriptorArray = VK_TRUE;
+	enabledFeatures12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+	enabledFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+	enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	enabledFeatures12.drawIndirectCount = supportedFeatures12_.drawIndirectCount;
+	drawIndirectCount_ = supportedFeatures12_.drawIndirectCount == VK_TRUE;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	createInfo.pNext = &enabledIndexingFeatures;
+	createInfo.pNext = &enabledFeatures12;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pEnabledFeatures = &deviceFeatures_;
@@ -170,6 +175,41 @@ void SpellDevice::createCommandPool() {
 	}
 }
 
+VkCommandPool SpellDevice::commandPoolForCurrentThread() {
+	std::thread::id thread = std::this_thread::get_id();
+	if (thread == ownerThread_) return commandPool_;
+
+	std::lock_guard<std::mutex> lock(threadCommandPoolsMutex_);
+	auto it = threadCommandPools_.find(thread);
+	if (it != threadCommandPools_.end()) return it->second;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = findPhysicalQueueFamilies().graphicsFamily.value();
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandPool pool;
+	if (vkCreateCommandPool(device_, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create worker command pool!");
+	}
+	threadCommandPools_.emplace(thread, pool);
+	return pool;
+}
+
+void SpellDevice::releaseThreadCommandPool() {
+	std::lock_guard<std::mutex> lock(threadCommandPoolsMutex_);
+	auto it = threadCommandPools_.find(std::this_thread::get_id());
+	if (it != threadCommandPools_.end()) {
+		vkDestroyCommandPool(device_, it->second, nullptr);
+		threadCommandPools_.erase(it);
+	}
+}
+
+void SpellDevice::waitIdle() {
+	std::lock_guard<std::mutex> lock(queueMutex_);
+	vkDeviceWaitIdle(device_);
+}
+
 bool SpellDevice::isDeviceSuitable(VkPhysicalDevice device) {
 	QueueFamilyIndices indices = findQueueFamilies(device);
 	bool extensionSupported = checkDeviceExtensionSupport(device);
@@ -372,12 +412,14 @@ void SpellDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLevel
 	vkBindImageMemory(device_, image, imageMemory, 0);
 }
 
-VkImageView SpellDevice::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
+VkImageView SpellDevice::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels,
+	VkComponentMapping components) {
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = image;
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewInfo.format = format;
+	viewInfo.components = components;
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 	viewInfo.subresourceRange.baseMipLevel = 0;
 	viewInfo.subresourceRange.levelCount = mipLevels;
@@ -395,7 +437,7 @@ VkCommandBuffer SpellDevice::beginSingleTimeCommands() {
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool_;
+	allocInfo.commandPool = commandPoolForCurrentThread();
 	allocInfo.commandBufferCount = 1;
 
 	VkCommandBuffer commandBuffer;
@@ -410,6 +452,11 @@ VkCommandBuffer SpellDevice::beginSingleTimeCommands() {
 }
 
 void SpellDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+	VkFence fence = submitSingleTimeCommands(commandBuffer);
+	waitSingleTimeCommands(commandBuffer, fence);
+}
+
+VkFence SpellDevice::submitSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	vkEndCommandBuffer(commandBuffer);
 
 	VkSubmitInfo submitInfo{};
@@ -417,10 +464,27 @@ void SpellDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue_);
+	// Wait on a fence for this submit only, so a loader thread never stalls on frames
+	// queued by the render thread (and never holds the queue lock while waiting)
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create upload fence!");
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex_);
+		vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence);
+	}
+	return fence;
+}
+
+void SpellDevice::waitSingleTimeCommands(VkCommandBuffer commandBuffer, VkFence fence) {
+	vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+	vkDestroyFence(device_, fence, nullptr);
 
-	vkFreeCommandBuffers(device_, commandPool_, 1, &commandBuffer);
+	vkFreeCommandBuffers(device_, commandPoolForCurrentThread(), 1, &commandBuffer);
 }
 
 void SpellDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
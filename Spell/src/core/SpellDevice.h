@@ -3,6 +3,9 @@
 #include "core/SpellWindow.h"
 #include <vector>
 #include <optional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace Spell {
 
@@ -43,6 +46,10 @@ public:
 	VkSurfaceKHR surface() { return surface_; }
 	VkInstance getInstance() { return instance_; }
 	VkSampleCountFlagBits msaaSamples() { return msaaSamples_; }
+	// Core features enabled on the logical device (everything the physical device supports)
+	const VkPhysicalDeviceFeatures& enabledFeatures() const { return deviceFeatures_; }
+	// Vulkan 1.2 drawIndirectCount (vkCmdDrawIndexedIndirectCount) is enabled
+	bool drawIndirectCountEnabled() const { return drawIndirectCount_; }
 
 	SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice_); }
 	QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice_); }
@@ -51,10 +58,25 @@ public:
 
 	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels,
+		VkComponentMapping components = {});
 
+	// Single-time commands may be recorded on any thread: worker threads get their own
+	// command pool, and the submit waits on a fence instead of idling the whole queue.
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	// The two halves of endSingleTimeCommands, for several submits in flight at once: submit
+	// returns the fence the commands signal, wait blocks on it and frees both. Both have to be
+	// called on the thread that began the commands.
+	VkFence submitSingleTimeCommands(VkCommandBuffer commandBuffer);
+	void waitSingleTimeCommands(VkCommandBuffer commandBuffer, VkFence fence);
+	// Destroys the calling worker thread's command pool (call before the thread exits)
+	void releaseThreadCommandPool();
+
+	// Guards graphicsQueue/presentQueue, which are shared by the render and loader threads
+	std::mutex& queueMutex() { return queueMutex_; }
+	// vkDeviceWaitIdle under the queue lock
+	void waitIdle();
 
 	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
@@ -77,6 +99,7 @@ private:
 	void pickPhysicalDevice();
 	void createLogicalDevice();
 	void createCommandPool();
+	VkCommandPool commandPoolForCurrentThread();
 
 	bool isDeviceSuitable(VkPhysicalDevice device);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
@@ -90,9 +113,14 @@ private:
 	VkDevice device_;
 	VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
 	VkPhysicalDeviceFeatures deviceFeatures_{};
-	VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures_{};
+	VkPhysicalDeviceVulkan12Features supportedFeatures12_{};
+	bool drawIndirectCount_ = false;
 	VkSurfaceKHR surface_;
 	VkCommandPool commandPool_;
+	std::thread::id ownerThread_;
+	std::mutex threadCommandPoolsMutex_;
+	std::unordered_map<std::thread::id, VkCommandPool> threadCommandPools_;
+	std::mutex queueMutex_;
 	VkQueue graphicsQueue_;
 	VkQueue presentQueue_;
 	VkSampleCountFlagBits msaaSamples_ = VK_SAMPLE_COUNT_1_BIT;
@@ -22,6 +22,7 @@ SpellSwapChain::SpellSwapChain(SpellDevice& device, VkExtent2D windowExtent, std
 void SpellSwapChain::init() {
 	createSwapChain();
 	createImageViews();
+	depthFormat_ = findDepthFormat();
 	createRenderPass();
 	createColorResources();
 	createDepthResources();
@@ -130,10 +131,10 @@ void SpellSwapChain::createImageViews() {
 
 void SpellSwapChain::createRenderPass() {
 	VkAttachmentDescription depthAttachment{};
-	depthAttachment.format = findDepthFormat();
+	depthAttachment.format = depthFormat_;
 	depthAttachment.samples = device_.msaaSamples();
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.storeOp = depthSampleable_ ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -213,13 +214,14 @@ void SpellSwapChain::createColorResources() {
 }
 
 void SpellSwapChain::createDepthResources() {
-	VkFormat depthFormat = findDepthFormat();
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (depthSampleable_) usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
 	device_.createImage(
-		swapChainExtent_.width, swapChainExtent_.height, 1, device_.msaaSamples(), depthFormat,
+		swapChainExtent_.width, swapChainExtent_.height, 1, device_.msaaSamples(), depthFormat_,
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		usage,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage_, depthImageMemory_);
-	depthImageView_ = device_.createImageView(depthImage_, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+	depthImageView_ = device_.createImageView(depthImage_, depthFormat_, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
 void SpellSwapChain::createFramebuffers() {
@@ -312,6 +314,7 @@ VkResult SpellSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, ui
 
 	vkResetFences(device_.device(), 1, &inFlightFences_[currentFrame_]);
 
+	std::lock_guard<std::mutex> queueLock(device_.queueMutex());
 	if (vkQueueSubmit(device_.graphicsQueue(), 1, &submitInfo, inFlightFences_[currentFrame_]) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
@@ -363,9 +366,24 @@ VkExtent2D SpellSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capa
 }
 
 VkFormat SpellSwapChain::findDepthFormat() {
-	return device_.findSupportedFormat(
-		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-		VK_IMAGE_TILING_OPTIMAL,
+	const std::vector<VkFormat> candidates = {
+		VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT
+	};
+
+	// Prefer a format compute can sample at the MSAA sample count, for the depth pyramid
+	const VkSampleCountFlags sampledCounts = device_.getProperties().limits.sampledImageDepthSampleCounts;
+	if (sampledCounts & device_.msaaSamples()) {
+		try {
+			VkFormat format = device_.findSupportedFormat(candidates, VK_IMAGE_TILING_OPTIMAL,
+				VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+			depthSampleable_ = true;
+			return format;
+		} catch (const std::runtime_error&) {
+		}
+	}
+
+	depthSampleable_ = false;
+	return device_.findSupportedFormat(candidates, VK_IMAGE_TILING_OPTIMAL,
 		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 }
 
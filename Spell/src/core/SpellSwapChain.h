@@ -30,8 +30,16 @@ public:
 		return static_cast<float>(swapChainExtent_.width) / static_cast<float>(swapChainExtent_.height);
 	}
 
+	// Also decides isDepthSampleable(): the format and sample count must support sampling
 	VkFormat findDepthFormat();
 
+	// Scene depth, kept after the render pass (store op STORE) so it can be sampled by compute
+	// when isDepthSampleable(); it is left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL layout
+	VkImage getDepthImage() { return depthImage_; }
+	VkImageView getDepthImageView() { return depthImageView_; }
+	VkFormat getDepthFormat() { return depthFormat_; }
+	bool isDepthSampleable() { return depthSampleable_; }
+
 	VkResult acquireNextImage(uint32_t* imageIndex);
 	VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
@@ -63,6 +71,8 @@ private:
 	VkImage depthImage_;
 	VkDeviceMemory depthImageMemory_;
 	VkImageView depthImageView_;
+	VkFormat depthFormat_ = VK_FORMAT_UNDEFINED;
+	bool depthSampleable_ = false;
 
 	// MSAA color resources
 	VkImage colorImage_;
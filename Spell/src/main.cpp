@@ -1,10 +1,17 @@
 #include "SpellApp.h"
+#include "tools/SpellBenchmark.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <cstdlib>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--bench") {
+		return Spell::SpellBenchmark::run(std::vector<std::string>(argv + 2, argv + argc));
+	}
 
-int main() {
 	Spell::SpellApp app{};
 
 	try {
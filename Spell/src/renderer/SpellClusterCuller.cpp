@@ -0,0 +1,197 @@
+#include "SpellClusterCuller.h"
+#include "SpellPipeline.h"
+#include "resources/SpellModel.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace Spell {
+
+namespace {
+
+constexpr uint32_t CULL_GROUP_SIZE = 64; // local_size_x in cluster_cull.comp
+constexpr uint32_t BINDING_COUNT = SpellClusterCuller::STORAGE_BUFFERS_PER_SET;
+
+} // namespace
+
+SpellClusterCuller::SpellClusterCuller(SpellDevice& device, const std::string& compFilepath,
+	VkDescriptorSetLayout occlusionSetLayout)
+	: device_(device) {
+	if (device_.enabledFeatures().multiDrawIndirect) {
+		maxDrawsPerCall_ = std::max(1u, device_.getProperties().limits.maxDrawIndirectCount);
+		drawIndirectCount_ = device_.drawIndirectCountEnabled();
+	}
+	createDescriptorSetLayout();
+	createPipeline(compFilepath, occlusionSetLayout);
+}
+
+SpellClusterCuller::~SpellClusterCuller() {
+	vkDestroyPipeline(device_.device(), pipeline_, nullptr);
+	vkDestroyPipelineLayout(device_.device(), pipelineLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_.device(), descriptorSetLayout_, nullptr);
+}
+
+bool SpellClusterCuller::isSupported(SpellDevice& device) {
+	return device.enabledFeatures().drawIndirectFirstInstance == VK_TRUE;
+}
+
+void SpellClusterCuller::createDescriptorSetLayout() {
+	// 0 meshlets, 1 instance transforms, 2 clusters, 3 draw commands, 4 draw counters
+	std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device_.device(), &layoutInfo, nullptr, &descriptorSetLayout_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create cluster cull descriptor set layout");
+	}
+}
+
+void SpellClusterCuller::createPipeline(const std::string& compFilepath, VkDescriptorSetLayout occlusionSetLayout) {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ClusterCullPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	const std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout_, occlusionSetLayout };
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device_.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create cluster cull pipeline layout");
+	}
+
+	auto code = SpellPipeline::readFile(compFilepath);
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device_.device(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create cluster cull shader module");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout_;
+
+	VkResult result = vkCreateComputePipelines(device_.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_);
+	vkDestroyShaderModule(device_.device(), shaderModule, nullptr);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create cluster cull pipeline");
+	}
+}
+
+void SpellClusterCuller::writeDescriptorSet(VkDescriptorSet set, const SpellModel& model, uint32_t frameIndex) const {
+	std::array<VkDescriptorBufferInfo, BINDING_COUNT> bufferInfos{};
+	bufferInfos[0].buffer = model.getMeshletBuffer();
+	bufferInfos[1].buffer = model.getInstanceBuffer();
+	bufferInfos[2].buffer = model.getClusterBuffer();
+	bufferInfos[3].buffer = model.getDrawCommandBuffer(frameIndex);
+	bufferInfos[4].buffer = model.getDrawCountBuffer(frameIndex);
+	bufferInfos[5].buffer = model.getLodSelectionBuffer(frameIndex);
+
+	std::array<VkWriteDescriptorSet, BINDING_COUNT> writes{};
+	for (uint32_t i = 0; i < BINDING_COUNT; i++) {
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = set;
+		writes[i].dstBinding = i;
+		writes[i].dstArrayElement = 0;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].descriptorCount = 1;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(device_.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+ClusterCullPushConstants SpellClusterCuller::makePushConstants(const UniformBufferObject& ubo,
+	uint32_t clusterCount, bool coneCulling) {
+	ClusterCullPushConstants constants{};
+
+	// Gribb/Hartmann plane extraction for Vulkan clip space (0 <= z <= w)
+	const glm::mat4 m = ubo.proj * ubo.view * ubo.model;
+	auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+	constants.frustumPlanes[0] = row(3) + row(0); // left
+	constants.frustumPlanes[1] = row(3) - row(0); // right
+	constants.frustumPlanes[2] = row(3) + row(1); // bottom
+	constants.frustumPlanes[3] = row(3) - row(1); // top
+	constants.frustumPlanes[4] = row(2);          // near
+	constants.frustumPlanes[5] = row(3) - row(2); // far
+	for (auto& plane : constants.frustumPlanes) {
+		float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+		if (length > 0.0f) plane = plane / length;
+	}
+
+	constants.cameraPosition = glm::inverse(ubo.model) * glm::vec4(ubo.camPos, 1.0f);
+	constants.clusterCount = clusterCount;
+	constants.coneCulling = coneCulling ? 1u : 0u;
+	return constants;
+}
+
+void SpellClusterCuller::dispatch(VkCommandBuffer commandBuffer, VkDescriptorSet set, VkDescriptorSet occlusionSet,
+	const SpellModel& model, uint32_t frameIndex, const ClusterCullPushConstants& constants) {
+	VkBuffer countBuffer = model.getDrawCountBuffer(frameIndex);
+	vkCmdFillBuffer(commandBuffer, countBuffer, 0, SpellModel::DRAW_COUNTERS * sizeof(uint32_t), 0);
+
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+	const std::array<VkDescriptorSet, 2> sets = { set, occlusionSet };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_,
+		0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(ClusterCullPushConstants), &constants);
+	vkCmdDispatch(commandBuffer, (constants.clusterCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	// Draw list -> indirect command read; counter -> host read for the stats after the fence
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void SpellClusterCuller::draw(VkCommandBuffer commandBuffer, const SpellModel& model, uint32_t frameIndex) {
+	VkBuffer drawBuffer = model.getDrawCommandBuffer(frameIndex);
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (drawIndirectCount_ && model.getClusterCount() <= maxDrawsPerCall_) {
+		// Only the visible front of the list is read; [0] of the count buffer is the visible count
+		vkCmdDrawIndexedIndirectCount(commandBuffer, drawBuffer, 0, model.getDrawCountBuffer(frameIndex), 0,
+			model.getClusterCount(), stride);
+		return;
+	}
+	for (uint32_t first = 0; first < model.getClusterCount(); first += maxDrawsPerCall_) {
+		uint32_t count = std::min(maxDrawsPerCall_, model.getClusterCount() - first);
+		vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, static_cast<VkDeviceSize>(first) * stride, count, stride);
+	}
+}
+
+} // namespace Spell
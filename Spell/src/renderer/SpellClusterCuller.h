@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/SpellDevice.h"
+#include "renderer/SpellTypes.h"
+
+#include <string>
+
+namespace Spell {
+
+class SpellModel;
+
+// Push constants of cluster_cull.comp (128 bytes, the guaranteed minimum).
+// Planes and camera are in the space of UniformBufferObject::model, so the shader only
+// has to apply the per-instance transform.
+struct ClusterCullPushConstants {
+	glm::vec4 frustumPlanes[6]; // xyz normal pointing inwards, w distance
+	glm::vec4 cameraPosition;
+	uint32_t clusterCount = 0;
+	uint32_t coneCulling = 0;   // 0 when the pipeline draws back faces (wireframe / points)
+	uint32_t padding[2]{};
+};
+static_assert(sizeof(ClusterCullPushConstants) == 128, "cluster cull push constants must fit in 128 bytes");
+
+// GPU cluster culling: a compute pass tests every (meshlet, instance) cluster of a SpellModel
+// against the selected LOD level, the view frustum and its normal cone and writes a compacted
+// indirect draw list.
+//
+// Visible clusters are appended at the front of the list, culled ones are written from the
+// back with instanceCount = 0, so every slot is rewritten each frame and no clear is needed.
+// With drawIndirectCount the visible count drives a single vkCmdDrawIndexedIndirectCount.
+//
+// Set 1 is the occlusion set of SpellDepthPyramid (previous frame's HiZ pyramid).
+class SpellClusterCuller {
+public:
+	SpellClusterCuller(SpellDevice& device, const std::string& compFilepath, VkDescriptorSetLayout occlusionSetLayout);
+	~SpellClusterCuller();
+
+	SpellClusterCuller(const SpellClusterCuller&) = delete;
+	SpellClusterCuller& operator=(const SpellClusterCuller&) = delete;
+
+	// Bindings of the cull descriptor set, all storage buffers: meshlets, instances, clusters,
+	// draw list, draw counts, LOD selection
+	static constexpr uint32_t STORAGE_BUFFERS_PER_SET = 6;
+
+	// Indirect draws address instances through firstInstance, which needs drawIndirectFirstInstance
+	static bool isSupported(SpellDevice& device);
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout_; }
+	// Points `set` at the model's cluster buffers for one frame in flight
+	void writeDescriptorSet(VkDescriptorSet set, const SpellModel& model, uint32_t frameIndex) const;
+
+	static ClusterCullPushConstants makePushConstants(const UniformBufferObject& ubo, uint32_t clusterCount,
+		bool coneCulling);
+
+	// Records the cull dispatch; must be outside a render pass
+	void dispatch(VkCommandBuffer commandBuffer, VkDescriptorSet set, VkDescriptorSet occlusionSet,
+		const SpellModel& model, uint32_t frameIndex, const ClusterCullPushConstants& constants);
+	// Draws the frame's indirect list; the model's vertex/index buffers must be bound
+	void draw(VkCommandBuffer commandBuffer, const SpellModel& model, uint32_t frameIndex);
+
+private:
+	void createDescriptorSetLayout();
+	void createPipeline(const std::string& compFilepath, VkDescriptorSetLayout occlusionSetLayout);
+
+	SpellDevice& device_;
+	VkDescriptorSetLayout descriptorSetLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline pipeline_ = VK_NULL_HANDLE;
+	uint32_t maxDrawsPerCall_ = 1; // 1 without multiDrawIndirect
+	bool drawIndirectCount_ = false;
+};
+
+} // namespace Spell
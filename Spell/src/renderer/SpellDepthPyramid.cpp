@@ -0,0 +1,422 @@
+#include "SpellDepthPyramid.h"
+#include "SpellPipeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Spell {
+
+namespace {
+
+constexpr uint32_t BUILD_GROUP_SIZE = 8; // local_size_x/y in hiz_build.comp
+constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+static_assert(sizeof(OcclusionUniforms) == 80, "OcclusionUniforms must match the std140 block in cluster_cull.comp");
+
+VkShaderModule createShaderModule(SpellDevice& device, const std::string& filepath) {
+	auto code = SpellPipeline::readFile(filepath);
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device.device(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create depth pyramid shader module");
+	}
+	return shaderModule;
+}
+
+} // namespace
+
+SpellDepthPyramid::SpellDepthPyramid(SpellDevice& device, const std::string& buildShaderPath,
+	const std::string& buildMultisampledShaderPath)
+	: device_(device) {
+	createSampler();
+	createDescriptorSetLayouts();
+	createPipelines(buildShaderPath, buildMultisampledShaderPath);
+	createDescriptorSets();
+	createUniformBuffers();
+	// The cull pass always binds set 1, so it needs an image before the first resize()
+	createPyramid({ 1, 1 });
+	writeCullSets();
+}
+
+SpellDepthPyramid::~SpellDepthPyramid() {
+	destroyPyramid();
+	for (auto& frame : uniforms_) {
+		if (frame.mapped) vkUnmapMemory(device_.device(), frame.memory);
+		vkDestroyBuffer(device_.device(), frame.buffer, nullptr);
+		vkFreeMemory(device_.device(), frame.memory, nullptr);
+	}
+	vkDestroyDescriptorPool(device_.device(), descriptorPool_, nullptr);
+	vkDestroyPipeline(device_.device(), reducePipeline_, nullptr);
+	vkDestroyPipeline(device_.device(), multisampledPipeline_, nullptr);
+	vkDestroyPipelineLayout(device_.device(), pipelineLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_.device(), buildSetLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_.device(), cullSetLayout_, nullptr);
+	vkDestroySampler(device_.device(), sampler_, nullptr);
+}
+
+void SpellDepthPyramid::createSampler() {
+	// Only texelFetch reads through it
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(device_.device(), &samplerInfo, nullptr, &sampler_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create depth pyramid sampler");
+	}
+}
+
+void SpellDepthPyramid::createDescriptorSetLayouts() {
+	// Build: 0 source (depth or previous level), 1 destination level
+	std::array<VkDescriptorSetLayoutBinding, 2> buildBindings{};
+	buildBindings[0].binding = 0;
+	buildBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	buildBindings[0].descriptorCount = 1;
+	buildBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	buildBindings[1].binding = 1;
+	buildBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	buildBindings[1].descriptorCount = 1;
+	buildBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	// Cull: 0 pyramid, 1 OcclusionUniforms
+	std::array<VkDescriptorSetLayoutBinding, 2> cullBindings{};
+	cullBindings[0].binding = 0;
+	cullBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	cullBindings[0].descriptorCount = 1;
+	cullBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	cullBindings[1].binding = 1;
+	cullBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	cullBindings[1].descriptorCount = 1;
+	cullBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(buildBindings.size());
+	layoutInfo.pBindings = buildBindings.data();
+	if (vkCreateDescriptorSetLayout(device_.device(), &layoutInfo, nullptr, &buildSetLayout_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create depth pyramid descriptor set layout");
+	}
+
+	layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+	layoutInfo.pBindings = cullBindings.data();
+	if (vkCreateDescriptorSetLayout(device_.device(), &layoutInfo, nullptr, &cullSetLayout_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create occlusion descriptor set layout");
+	}
+}
+
+void SpellDepthPyramid::createPipelines(const std::string& buildShaderPath,
+	const std::string& buildMultisampledShaderPath) {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(DepthPyramidPushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &buildSetLayout_;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device_.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create depth pyramid pipeline layout");
+	}
+
+	auto createPipeline = [this](const std::string& filepath, VkPipeline& pipeline) {
+		VkShaderModule shaderModule = createShaderModule(device_, filepath);
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout_;
+
+		VkResult result = vkCreateComputePipelines(device_.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+		vkDestroyShaderModule(device_.device(), shaderModule, nullptr);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("[Spell] Failed to create depth pyramid pipeline");
+		}
+	};
+
+	createPipeline(buildShaderPath, reducePipeline_);
+	if (device_.msaaSamples() != VK_SAMPLE_COUNT_1_BIT) {
+		createPipeline(buildMultisampledShaderPath, multisampledPipeline_);
+	}
+}
+
+void SpellDepthPyramid::createDescriptorSets() {
+	const uint32_t frameCount = SpellSwapChain::MAX_FRAMES_IN_FLIGHT;
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_LEVELS + frameCount };
+	poolSizes[1] = { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_LEVELS };
+	poolSizes[2] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount };
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = MAX_LEVELS + frameCount;
+
+	if (vkCreateDescriptorPool(device_.device(), &poolInfo, nullptr, &descriptorPool_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create depth pyramid descriptor pool");
+	}
+
+	std::array<VkDescriptorSetLayout, MAX_LEVELS> buildLayouts;
+	buildLayouts.fill(buildSetLayout_);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool_;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(buildLayouts.size());
+	allocInfo.pSetLayouts = buildLayouts.data();
+	if (vkAllocateDescriptorSets(device_.device(), &allocInfo, buildSets_.data()) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to allocate depth pyramid descriptor sets");
+	}
+
+	std::array<VkDescriptorSetLayout, SpellSwapChain::MAX_FRAMES_IN_FLIGHT> cullLayouts;
+	cullLayouts.fill(cullSetLayout_);
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(cullLayouts.size());
+	allocInfo.pSetLayouts = cullLayouts.data();
+	if (vkAllocateDescriptorSets(device_.device(), &allocInfo, cullSets_.data()) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to allocate occlusion descriptor sets");
+	}
+}
+
+void SpellDepthPyramid::createUniformBuffers() {
+	for (auto& frame : uniforms_) {
+		device_.createBuffer(sizeof(OcclusionUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.buffer, frame.memory);
+		void* mapped;
+		vkMapMemory(device_.device(), frame.memory, 0, sizeof(OcclusionUniforms), 0, &mapped);
+		frame.mapped = static_cast<OcclusionUniforms*>(mapped);
+		*frame.mapped = OcclusionUniforms{};
+	}
+}
+
+void SpellDepthPyramid::createPyramid(VkExtent2D extent) {
+	// Every level halves the previous one (rounding up) down to 1x1
+	levelExtents_.clear();
+	levelExtents_.push_back(extent);
+	while ((extent.width > 1 || extent.height > 1) && levelExtents_.size() < MAX_LEVELS) {
+		extent.width = std::max(1u, (extent.width + 1) / 2);
+		extent.height = std::max(1u, (extent.height + 1) / 2);
+		levelExtents_.push_back(extent);
+	}
+	levelCount_ = static_cast<uint32_t>(levelExtents_.size());
+
+	device_.createImage(levelExtents_[0].width, levelExtents_[0].height, levelCount_, VK_SAMPLE_COUNT_1_BIT,
+		PYRAMID_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image_, imageMemory_);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image_;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = PYRAMID_FORMAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = levelCount_;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device_.device(), &viewInfo, nullptr, &view_) != VK_SUCCESS) {
+		throw std::runtime_error("[Spell] Failed to create depth pyramid image view");
+	}
+
+	levelViews_.resize(levelCount_);
+	viewInfo.subresourceRange.levelCount = 1;
+	for (uint32_t level = 0; level < levelCount_; level++) {
+		viewInfo.subresourceRange.baseMipLevel = level;
+		if (vkCreateImageView(device_.device(), &viewInfo, nullptr, &levelViews_[level]) != VK_SUCCESS) {
+			throw std::runtime_error("[Spell] Failed to create depth pyramid level view");
+		}
+	}
+
+	// The pyramid stays in GENERAL: written as storage image, read through samplers
+	VkCommandBuffer commandBuffer = device_.beginSingleTimeCommands();
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image_;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount_, 0, 1 };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+	device_.endSingleTimeCommands(commandBuffer);
+}
+
+void SpellDepthPyramid::destroyPyramid() {
+	for (VkImageView view : levelViews_) {
+		vkDestroyImageView(device_.device(), view, nullptr);
+	}
+	levelViews_.clear();
+	vkDestroyImageView(device_.device(), view_, nullptr);
+	vkDestroyImage(device_.device(), image_, nullptr);
+	vkFreeMemory(device_.device(), imageMemory_, nullptr);
+	view_ = VK_NULL_HANDLE;
+	image_ = VK_NULL_HANDLE;
+	imageMemory_ = VK_NULL_HANDLE;
+	levelCount_ = 0;
+}
+
+void SpellDepthPyramid::writeCullSets() {
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler_;
+	imageInfo.imageView = view_;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	for (uint32_t i = 0; i < cullSets_.size(); i++) {
+		VkDescriptorBufferInfo bufferInfo{};
+		bufferInfo.buffer = uniforms_[i].buffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = sizeof(OcclusionUniforms);
+
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = cullSets_[i];
+		writes[0].dstBinding = 0;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].descriptorCount = 1;
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = cullSets_[i];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writes[1].descriptorCount = 1;
+		writes[1].pBufferInfo = &bufferInfo;
+		vkUpdateDescriptorSets(device_.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void SpellDepthPyramid::resize(VkImageView depthView, VkFormat depthFormat, VkExtent2D extent) {
+	destroyPyramid();
+	createPyramid(extent);
+	writeCullSets();
+
+	depthAspects_ = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+		depthAspects_ |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+	depthSamples_ = static_cast<uint32_t>(device_.msaaSamples());
+
+	// Level 0 reads the depth buffer, every other level the one above it
+	for (uint32_t level = 0; level < levelCount_; level++) {
+		VkDescriptorImageInfo sourceInfo{};
+		sourceInfo.sampler = sampler_;
+		sourceInfo.imageView = level == 0 ? depthView : levelViews_[level - 1];
+		sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationInfo{};
+		destinationInfo.imageView = levelViews_[level];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = buildSets_[level];
+		writes[0].dstBinding = 0;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].descriptorCount = 1;
+		writes[0].pImageInfo = &sourceInfo;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = buildSets_[level];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writes[1].descriptorCount = 1;
+		writes[1].pImageInfo = &destinationInfo;
+		vkUpdateDescriptorSets(device_.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	hasDepthSource_ = true;
+	ready_ = false;
+}
+
+void SpellDepthPyramid::updateCullData(uint32_t frameIndex, bool occlusionCulling) {
+	OcclusionUniforms& uniforms = *uniforms_[frameIndex].mapped;
+	uniforms.viewProjection = viewProjection_;
+	uniforms.pyramidSize = glm::vec2(levelExtents_[0].width, levelExtents_[0].height);
+	uniforms.levelCount = levelCount_;
+	uniforms.enabled = occlusionCulling && ready_ ? 1u : 0u;
+}
+
+void SpellDepthPyramid::build(VkCommandBuffer commandBuffer, VkImage depthImage, const glm::mat4& viewProjection) {
+	if (!hasDepthSource_) return;
+
+	// Depth writes -> sampled; the previous cull pass must be done reading the pyramid
+	VkImageMemoryBarrier depthBarrier{};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	depthBarrier.image = depthImage;
+	depthBarrier.subresourceRange = { depthAspects_, 0, 1, 0, 1 };
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+	VkMemoryBarrier levelBarrier{};
+	levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	for (uint32_t level = 0; level < levelCount_; level++) {
+		DepthPyramidPushConstants constants{};
+		const VkExtent2D source = level == 0 ? levelExtents_[0] : levelExtents_[level - 1];
+		constants.sourceSize = glm::ivec2(source.width, source.height);
+		constants.destinationSize = glm::ivec2(levelExtents_[level].width, levelExtents_[level].height);
+		constants.sampleCount = level == 0 ? static_cast<int32_t>(depthSamples_) : 1;
+		constants.scale = level == 0 ? 1 : 2;
+
+		VkPipeline pipeline = level == 0 && multisampledPipeline_ != VK_NULL_HANDLE ? multisampledPipeline_ : reducePipeline_;
+		if (pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+			boundPipeline = pipeline;
+		}
+		if (level > 0) {
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout_,
+			0, 1, &buildSets_[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT,
+			0, sizeof(DepthPyramidPushConstants), &constants);
+		vkCmdDispatch(commandBuffer,
+			(levelExtents_[level].width + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE,
+			(levelExtents_[level].height + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE, 1);
+	}
+
+	// Pyramid -> next frame's cull pass; depth back to an attachment, so the next render pass
+	// only clears it after the reads above
+	depthBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthBarrier.srcAccessMask = 0;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0, 1, &levelBarrier, 0, nullptr, 1, &depthBarrier);
+
+	viewProjection_ = viewProjection;
+	ready_ = true;
+}
+
+} // namespace Spell
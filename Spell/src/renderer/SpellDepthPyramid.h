@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core/SpellDevice.h"
+#include "core/SpellSwapChain.h"
+#include "renderer/SpellTypes.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace Spell {
+
+// Push constants of hiz_build.comp
+struct DepthPyramidPushConstants {
+	glm::ivec2 sourceSize;
+	glm::ivec2 destinationSize;
+	int32_t sampleCount = 1; // MSAA depth samples (multisampled variant only)
+	int32_t scale = 1;       // source texels per destination texel and axis: 1 from depth, 2 between levels
+};
+
+// Set 1 binding 1 of cluster_cull.comp (std140)
+struct OcclusionUniforms {
+	glm::mat4 viewProjection; // proj * view * model of the frame the pyramid was built from
+	glm::vec2 pyramidSize;    // level 0 size in pixels
+	uint32_t levelCount = 0;
+	uint32_t enabled = 0;     // 0 when there is no pyramid from the previous frame
+};
+
+// Hierarchical depth (HiZ) pyramid for occlusion culling in the cluster cull pass.
+//
+// build() runs after the scene pass: level 0 is the scene depth at full resolution (the
+// farthest MSAA sample per pixel), every further level keeps the farthest of the 2x2 texels
+// below it. The next frame's cull pass reprojects cluster bounds with the matrix the pyramid
+// was built with, so occluders are one frame old; a cluster that just became visible shows
+// up one frame late at worst.
+//
+// Only texelFetch and imageStore are used, so no min/max sampler reduction is needed.
+class SpellDepthPyramid {
+public:
+	SpellDepthPyramid(SpellDevice& device, const std::string& buildShaderPath,
+		const std::string& buildMultisampledShaderPath);
+	~SpellDepthPyramid();
+
+	SpellDepthPyramid(const SpellDepthPyramid&) = delete;
+	SpellDepthPyramid& operator=(const SpellDepthPyramid&) = delete;
+
+	// 2^(MAX_LEVELS - 1) pixels, far above any swap chain extent
+	static constexpr uint32_t MAX_LEVELS = 16;
+
+	// Set 1 of the cull pass: pyramid (combined image sampler) and OcclusionUniforms
+	VkDescriptorSetLayout getCullSetLayout() const { return cullSetLayout_; }
+	VkDescriptorSet getCullSet(uint32_t frameIndex) const { return cullSets_[frameIndex]; }
+
+	// Recreates the pyramid for a new depth buffer; the device must be idle
+	void resize(VkImageView depthView, VkFormat depthFormat, VkExtent2D extent);
+	// Writes this frame's OcclusionUniforms; occlusion stays off without a pyramid from the previous frame
+	void updateCullData(uint32_t frameIndex, bool occlusionCulling);
+	// Records the pyramid build from the depth the frame just rendered; must be outside a render
+	// pass. The depth image is returned to DEPTH_STENCIL_ATTACHMENT_OPTIMAL.
+	void build(VkCommandBuffer commandBuffer, VkImage depthImage, const glm::mat4& viewProjection);
+	// The pyramid no longer matches the scene (model swap, occlusion turned off)
+	void invalidate() { ready_ = false; }
+
+	bool isReady() const { return ready_; }
+	uint32_t getLevelCount() const { return levelCount_; }
+
+private:
+	void createSampler();
+	void createDescriptorSetLayouts();
+	void createPipelines(const std::string& buildShaderPath, const std::string& buildMultisampledShaderPath);
+	void createDescriptorSets();
+	void createUniformBuffers();
+	void createPyramid(VkExtent2D extent);
+	void destroyPyramid();
+	void writeCullSets();
+
+	SpellDevice& device_;
+	VkSampler sampler_ = VK_NULL_HANDLE;
+	VkDescriptorSetLayout buildSetLayout_ = VK_NULL_HANDLE;
+	VkDescriptorSetLayout cullSetLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline reducePipeline_ = VK_NULL_HANDLE;      // sampler2D source: single-sample depth and levels
+	VkPipeline multisampledPipeline_ = VK_NULL_HANDLE; // sampler2DMS source: MSAA depth
+	VkDescriptorPool descriptorPool_ = VK_NULL_HANDLE;
+	std::array<VkDescriptorSet, MAX_LEVELS> buildSets_{};
+	std::array<VkDescriptorSet, SpellSwapChain::MAX_FRAMES_IN_FLIGHT> cullSets_{};
+
+	struct UniformFrame {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		OcclusionUniforms* mapped = nullptr;
+	};
+	std::array<UniformFrame, SpellSwapChain::MAX_FRAMES_IN_FLIGHT> uniforms_{};
+
+	// R32_SFLOAT, GENERAL layout; a 1x1 placeholder until the first resize()
+	VkImage image_ = VK_NULL_HANDLE;
+	VkDeviceMemory imageMemory_ = VK_NULL_HANDLE;
+	VkImageView view_ = VK_NULL_HANDLE;       // all levels, read by the cull pass
+	std::vector<VkImageView> levelViews_;     // one per level, written by the build
+	std::vector<VkExtent2D> levelExtents_;
+	uint32_t levelCount_ = 0;
+
+	VkImageAspectFlags depthAspects_ = VK_IMAGE_ASPECT_DEPTH_BIT;
+	uint32_t depthSamples_ = 1;
+	bool hasDepthSource_ = false; // false until resize() points level 0 at a depth buffer
+	glm::mat4 viewProjection_{ 1.0f };
+	bool ready_ = false;
+};
+
+} // namespace Spell
@@ -1,5 +1,6 @@
 #include "SpellPipeline.h"
 #include "resources/SpellModel.h"
+#include "resources/VertexStreams.h"
 
 #include <fstream>
 #include <stdexcept>
@@ -62,15 +63,16 @@ void SpellPipeline::createGraphicsPipeline(
 	shaderStages[1].module = fragShaderModule_;
 	shaderStages[1].pName = "main";
 
-	auto bindingDesc = Vertex::getBindingDescription();
-	auto attributeDesc = Vertex::getAttributeDescriptions();
+	// Vertex streams of the model layout plus binding 1: per-instance model matrix + dequantization
+	VertexInputDescription vertexInput = getVertexInputDescription(
+		configInfo.vertexFormat, configInfo.vertexLayout, configInfo.positionOnly);
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDesc.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDesc.data();
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInput.bindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInput.attributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/SpellDevice.h"
+#include "resources/SpellModel.h"
 #include <string>
 #include <vector>
 
@@ -23,6 +24,9 @@ struct PipelineConfigInfo {
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkRenderPass renderPass = nullptr;
 	uint32_t subpass = 0;
+	VertexFormat vertexFormat = VertexFormat::Full; // see VertexStreams for the bindings
+	VertexLayout vertexLayout = VertexLayout::Interleaved;
+	bool positionOnly = false; // declare only the position attribute (for shaders that read nothing else)
 };
 
 class SpellPipeline {
@@ -41,8 +45,10 @@ public:
 
 	static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo, VkSampleCountFlagBits msaaSamples);
 
-private:
+	// Reads a whole SPIR-V file, throws std::runtime_error if it cannot be opened
 	static std::vector<char> readFile(const std::string& filepath);
+
+private:
 	void createGraphicsPipeline(
 		const std::string& vertFilepath,
 		const std::string& fragFilepath,
@@ -42,7 +42,7 @@ void SpellRenderer::recreateSwapChain() {
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(device_.device());
+	device_.waitIdle();
 
 	if (swapChain_ == nullptr) {
 		swapChain_ = std::make_unique<SpellSwapChain>(device_, extent);
@@ -50,6 +50,7 @@ void SpellRenderer::recreateSwapChain() {
 		std::shared_ptr<SpellSwapChain> oldSwapChain = std::move(swapChain_);
 		swapChain_ = std::make_unique<SpellSwapChain>(device_, extent, oldSwapChain);
 	}
+	swapChainGeneration_++;
 }
 
 VkCommandBuffer SpellRenderer::beginFrame() {
@@ -23,6 +23,12 @@ public:
 	VkExtent2D getSwapChainExtent() const { return swapChain_->getSwapChainExtent(); }
 	bool isFrameInProgress() const { return isFrameStarted_; }
 	size_t getSwapChainImageCount() const { return swapChain_->imageCount(); }
+	VkImage getDepthImage() const { return swapChain_->getDepthImage(); }
+	VkImageView getDepthImageView() const { return swapChain_->getDepthImageView(); }
+	VkFormat getDepthFormat() const { return swapChain_->getDepthFormat(); }
+	bool isDepthSampleable() const { return swapChain_->isDepthSampleable(); }
+	// Incremented every time the swap chain (and its depth image) is recreated
+	uint32_t getSwapChainGeneration() const { return swapChainGeneration_; }
 
 	VkCommandBuffer getCurrentCommandBuffer() const {
 		assert(isFrameStarted_ && "Cannot get command buffer when frame not in progress");
@@ -52,6 +58,7 @@ private:
 	uint32_t currentImageIndex_ = 0;
 	int currentFrameIndex_ = 0;
 	bool isFrameStarted_ = false;
+	uint32_t swapChainGeneration_ = 0;
 };
 
 } // namespace Spell
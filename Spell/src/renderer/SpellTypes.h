@@ -29,7 +29,15 @@ struct RenderStats {
 	uint32_t vertices = 0;
 	uint32_t indices = 0;
 	uint32_t triangles = 0;
-	uint32_t textureCount = 0;
+	uint32_t instances = 0;
+	uint32_t meshlets = 0;
+	uint32_t clusters = 0;         // meshlet x instance pairs
+	uint32_t visibleClusters = 0;  // clusters drawn after GPU culling (previous frame in this slot)
+	bool clusterCulling = false;
+	uint32_t occludedClusters = 0; // clusters rejected by the depth pyramid (same frame as visibleClusters)
+	bool occlusionCulling = false;
+	uint32_t textureCount = 0;        // bindless textures (shared fallbacks + distinct images)
+	uint32_t textureSlotCount = 0;    // material texture slots pointing at them
 	uint32_t materialCount = 0;
 	float frameTimeMs = 0.0f;
 	float fps = 0.0f;
@@ -46,6 +54,60 @@ struct RenderStats {
 	float textureLoadTimeMs = 0.0f;
 	float totalLoadTimeMs = 0.0f;
 	float decodeOverlapMs = 0.0f;  // Time saved by parallel model+texture loading
+	bool modelCacheHit = false;    // Model loaded from the .spellmesh cache
+	uint32_t textureCacheHits = 0; // Material textures loaded from the .ktx2 texture cache
+	uint32_t textureCacheMisses = 0;
+	uint32_t compressedTextures = 0; // Material textures in a BC format
+
+	// Post-load mesh optimization (FIFO vertex cache simulation, see MeshOptimizer)
+	bool meshOptimized = false;
+	float acmrBefore = 0.0f;
+	float acmrAfter = 0.0f;
+	float atvrBefore = 0.0f;
+	float atvrAfter = 0.0f;
+	float meshOptimizeTimeMs = 0.0f; // 0 when the optimized mesh came from the cache
+
+	// Level of detail (see MeshSimplifier, SpellModel::selectLods)
+	uint32_t lodLevels = 1;          // including full detail; 1 until the LOD build has finished
+	uint32_t activeLodMin = 0;       // finest / coarsest level drawn this frame
+	uint32_t activeLodMax = 0;
+	uint64_t trianglesSaved = 0;     // full-detail triangles minus the triangles of the selected levels
+	float lodBuildTimeMs = 0.0f;
+
+	// Vertex input (see VertexQuantization)
+	bool packedVertices = false;
+	bool splitVertexStreams = false;
+	uint32_t vertexStride = 0;       // bytes per vertex over all streams
+	uint64_t vertexBufferBytes = 0;
+	float gpuSceneMs = 0.0f;         // cull pass + scene draws from GPU timestamps; 0 if unsupported
+	bool vertexBenchmarkActive = false;
+
+	// Index buffer (see SubmeshSplitter)
+	bool index16 = false;
+	uint32_t submeshCount = 0;
+	uint64_t indexBufferBytes = 0;
+
+	// Draw order of the direct draws (see SpellModel::orderDraws)
+	bool drawsSorted = false;
+	uint32_t materialSwitches = 0;   // adjacent draws with different materials
+
+	// CPU triangle BVH (see MeshBvh)
+	uint32_t bvhNodes = 0;
+	uint64_t bvhBytes = 0;
+	float bvhBuildTimeMs = 0.0f;
+	bool bvhCulling = false;         // frustum query on the direct draws
+	uint32_t bvhCulledDraws = 0;
+	float bvhQueryMs = 0.0f;
+
+	// Last pick (left click in the viewport)
+	bool pickValid = false;          // a pick was made; pickHit tells whether it hit
+	bool pickHit = false;
+	glm::vec3 pickPosition{ 0.0f };  // world space
+	float pickDistance = 0.0f;       // from the camera
+	uint32_t pickTriangle = 0;
+	uint32_t pickInstance = 0;
+	int32_t pickMaterial = -1;
+	float pickTimeUs = 0.0f;
 };
 
 } // namespace Spell
@@ -0,0 +1,755 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SPELL_BC_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic as is; GCC and Clang need the instruction set per function
+#if defined(SPELL_BC_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SPELL_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SPELL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SPELL_TARGET_SSE41
+#define SPELL_TARGET_AVX2
+#endif
+
+namespace Spell {
+
+namespace {
+
+// The 16 texels of a block as floats 0..255, one array per channel (R, G, B, A)
+struct PixelBlock {
+	alignas(32) float c[4][16];
+};
+
+// For every texel, the nearest of `levels` evenly spaced points from e0 to e1 over the first
+// `channels` channels: writes its position 0..levels-1 and returns the summed squared error.
+// This is the hot loop of every encoder; the kernels below give bit-identical results.
+using FitFn = float (*)(const PixelBlock& block, int channels, const float* e0, const float* e1, int levels,
+	uint8_t* indices);
+
+struct FitSetup {
+	float d[4] = {};
+	float scale = 0.0f; // projection onto the segment, in steps
+	float step = 0.0f;  // segment fraction per step
+	float maxLevel = 0.0f;
+};
+
+FitSetup makeFitSetup(int channels, const float* e0, const float* e1, int levels) {
+	FitSetup s;
+	float dd = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		s.d[c] = e1[c] - e0[c];
+		dd += s.d[c] * s.d[c];
+	}
+	s.maxLevel = static_cast<float>(levels - 1);
+	s.scale = dd > 0.0f ? s.maxLevel / dd : 0.0f;
+	s.step = 1.0f / s.maxLevel;
+	return s;
+}
+
+// Summed in one fixed order so every kernel picks the same candidate on near ties
+float sumErrors(const float* errors) {
+	float error = 0.0f;
+	for (int i = 0; i < 16; i++) error += errors[i];
+	return error;
+}
+
+float fitScalar(const PixelBlock& block, int channels, const float* e0, const float* e1, int levels,
+	uint8_t* indices) {
+	const FitSetup s = makeFitSetup(channels, e0, e1, levels);
+	alignas(32) float errors[16];
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++) {
+			t = t + (block.c[c][i] - e0[c]) * s.d[c];
+		}
+		const float q = std::min(std::max(std::floor(t * s.scale + 0.5f), 0.0f), s.maxLevel);
+		indices[i] = static_cast<uint8_t>(q);
+		const float w = q * s.step;
+		float error = 0.0f;
+		for (int c = 0; c < channels; c++) {
+			const float diff = block.c[c][i] - (e0[c] + s.d[c] * w);
+			error = error + diff * diff;
+		}
+		errors[i] = error;
+	}
+	return sumErrors(errors);
+}
+
+#ifdef SPELL_BC_X86
+
+SPELL_TARGET_SSE41
+float fitSse41(const PixelBlock& block, int channels, const float* e0, const float* e1, int levels,
+	uint8_t* indices) {
+	const FitSetup s = makeFitSetup(channels, e0, e1, levels);
+	const __m128 scale = _mm_set1_ps(s.scale);
+	const __m128 step = _mm_set1_ps(s.step);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 maxLevel = _mm_set1_ps(s.maxLevel);
+	alignas(32) float errors[16];
+	for (int g = 0; g < 16; g += 4) {
+		__m128 t = _mm_setzero_ps();
+		for (int c = 0; c < channels; c++) {
+			const __m128 p = _mm_load_ps(&block.c[c][g]);
+			t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(p, _mm_set1_ps(e0[c])), _mm_set1_ps(s.d[c])));
+		}
+		const __m128 q = _mm_min_ps(_mm_max_ps(_mm_floor_ps(_mm_add_ps(_mm_mul_ps(t, scale), half)), zero), maxLevel);
+		const __m128i q16 = _mm_packus_epi32(_mm_cvttps_epi32(q), _mm_setzero_si128());
+		const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(q16, q16));
+		std::memcpy(indices + g, &packed, 4);
+
+		const __m128 w = _mm_mul_ps(q, step);
+		__m128 groupError = _mm_setzero_ps();
+		for (int c = 0; c < channels; c++) {
+			const __m128 p = _mm_load_ps(&block.c[c][g]);
+			const __m128 diff = _mm_sub_ps(p, _mm_add_ps(_mm_set1_ps(e0[c]), _mm_mul_ps(_mm_set1_ps(s.d[c]), w)));
+			groupError = _mm_add_ps(groupError, _mm_mul_ps(diff, diff));
+		}
+		_mm_store_ps(errors + g, groupError);
+	}
+	return sumErrors(errors);
+}
+
+SPELL_TARGET_AVX2
+float fitAvx2(const PixelBlock& block, int channels, const float* e0, const float* e1, int levels,
+	uint8_t* indices) {
+	const FitSetup s = makeFitSetup(channels, e0, e1, levels);
+	const __m256 scale = _mm256_set1_ps(s.scale);
+	const __m256 step = _mm256_set1_ps(s.step);
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 maxLevel = _mm256_set1_ps(s.maxLevel);
+	alignas(32) float errors[16];
+	for (int g = 0; g < 16; g += 8) {
+		__m256 t = _mm256_setzero_ps();
+		for (int c = 0; c < channels; c++) {
+			const __m256 p = _mm256_load_ps(&block.c[c][g]);
+			t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_sub_ps(p, _mm256_set1_ps(e0[c])), _mm256_set1_ps(s.d[c])));
+		}
+		const __m256 q = _mm256_min_ps(_mm256_max_ps(
+			_mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(t, scale), half)), zero), maxLevel);
+		const __m256i q32 = _mm256_cvttps_epi32(q);
+		const __m128i q16 = _mm_packus_epi32(_mm256_castsi256_si128(q32), _mm256_extracti128_si256(q32, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(indices + g), _mm_packus_epi16(q16, q16));
+
+		const __m256 w = _mm256_mul_ps(q, step);
+		__m256 groupError = _mm256_setzero_ps();
+		for (int c = 0; c < channels; c++) {
+			const __m256 p = _mm256_load_ps(&block.c[c][g]);
+			const __m256 diff = _mm256_sub_ps(p,
+				_mm256_add_ps(_mm256_set1_ps(e0[c]), _mm256_mul_ps(_mm256_set1_ps(s.d[c]), w)));
+			groupError = _mm256_add_ps(groupError, _mm256_mul_ps(diff, diff));
+		}
+		_mm256_store_ps(errors + g, groupError);
+	}
+	return sumErrors(errors);
+}
+
+#endif
+
+FitFn fitFor(BlockSimd simd) {
+	static const BlockSimd supported = detectBlockSimd();
+	if (simd == BlockSimd::Auto || simd > supported) simd = supported;
+#ifdef SPELL_BC_X86
+	if (simd == BlockSimd::AVX2) return fitAvx2;
+	if (simd == BlockSimd::SSE41) return fitSse41;
+#endif
+	return fitScalar;
+}
+
+// ========== Endpoint search ==========
+
+float clampUnorm(float v) {
+	return std::min(std::max(v, 0.0f), 255.0f);
+}
+
+// Segment through the texels along their principal axis (power iteration on the covariance),
+// spanning the extreme projections. Returns false for a single-colour block.
+bool principalEndpoints(const PixelBlock& block, int channels, float* e0, float* e1) {
+	float mean[4] = {};
+	for (int c = 0; c < channels; c++) {
+		for (int i = 0; i < 16; i++) mean[c] += block.c[c][i];
+		mean[c] /= 16.0f;
+	}
+
+	float cov[4][4] = {};
+	for (int i = 0; i < 16; i++) {
+		float d[4];
+		for (int c = 0; c < channels; c++) d[c] = block.c[c][i] - mean[c];
+		for (int a = 0; a < channels; a++) {
+			for (int b = a; b < channels; b++) cov[a][b] += d[a] * d[b];
+		}
+	}
+	for (int a = 0; a < channels; a++) {
+		for (int b = 0; b < a; b++) cov[a][b] = cov[b][a];
+	}
+
+	// Start from the row of the widest channel so the iteration does not begin orthogonal to the axis
+	int widest = 0;
+	for (int c = 1; c < channels; c++) {
+		if (cov[c][c] > cov[widest][widest]) widest = c;
+	}
+	if (cov[widest][widest] <= 0.0f) {
+		for (int c = 0; c < channels; c++) e0[c] = e1[c] = mean[c];
+		return false;
+	}
+	float axis[4] = {};
+	for (int c = 0; c < channels; c++) axis[c] = cov[widest][c];
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = {};
+		float length = 0.0f;
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++) next[a] += cov[a][b] * axis[b];
+			length = std::max(length, std::abs(next[a]));
+		}
+		if (length <= 0.0f) break;
+		for (int c = 0; c < channels; c++) axis[c] = next[c] / length;
+	}
+	float axisLength = 0.0f;
+	for (int c = 0; c < channels; c++) axisLength += axis[c] * axis[c];
+	axisLength = std::sqrt(axisLength);
+	for (int c = 0; c < channels; c++) axis[c] /= axisLength;
+
+	float tMin = std::numeric_limits<float>::max();
+	float tMax = -std::numeric_limits<float>::max();
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++) t += (block.c[c][i] - mean[c]) * axis[c];
+		tMin = std::min(tMin, t);
+		tMax = std::max(tMax, t);
+	}
+	for (int c = 0; c < channels; c++) {
+		e0[c] = clampUnorm(mean[c] + axis[c] * tMin);
+		e1[c] = clampUnorm(mean[c] + axis[c] * tMax);
+	}
+	return true;
+}
+
+// Endpoints that minimize the squared error for fixed indices. False if the indices do not
+// span the segment (all texels on one point).
+bool leastSquaresEndpoints(const PixelBlock& block, int channels, const uint8_t* indices, int levels,
+	float* e0, float* e1) {
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float x[4] = {}, y[4] = {};
+	const float step = 1.0f / static_cast<float>(levels - 1);
+	for (int i = 0; i < 16; i++) {
+		const float w = indices[i] * step;
+		const float v = 1.0f - w;
+		aa += v * v;
+		ab += v * w;
+		bb += w * w;
+		for (int c = 0; c < channels; c++) {
+			x[c] += v * block.c[c][i];
+			y[c] += w * block.c[c][i];
+		}
+	}
+	const float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1e-6f) return false;
+	for (int c = 0; c < channels; c++) {
+		e0[c] = clampUnorm((x[c] * bb - y[c] * ab) / det);
+		e1[c] = clampUnorm((y[c] * aa - x[c] * ab) / det);
+	}
+	return true;
+}
+
+// ========== Encoders ==========
+
+uint16_t pack565(const float* color) {
+	const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16_t packed, float* color) {
+	const uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+	color[3] = 255.0f;
+}
+
+void encodeBc1(const PixelBlock& block, FitFn fit, unsigned char* out) {
+	float e0[4], e1[4];
+	principalEndpoints(block, 3, e0, e1);
+
+	uint16_t best0 = pack565(e0), best1 = pack565(e1);
+	uint8_t bestIndices[16] = {};
+	float bestError = std::numeric_limits<float>::max();
+	for (int iteration = 0; iteration < 2; iteration++) {
+		const uint16_t c0 = pack565(e0), c1 = pack565(e1);
+		float q0[4], q1[4];
+		unpack565(c0, q0);
+		unpack565(c1, q1);
+		uint8_t indices[16];
+		const float error = fit(block, 3, q0, q1, 4, indices);
+		if (error < bestError) {
+			bestError = error;
+			best0 = c0;
+			best1 = c1;
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+		if (!leastSquaresEndpoints(block, 3, indices, 4, e0, e1)) break;
+	}
+
+	// Four-colour mode needs color0 > color1; equal endpoints decode every index 0 as color0
+	if (best0 < best1) {
+		std::swap(best0, best1);
+		for (uint8_t& index : bestIndices) index = static_cast<uint8_t>(3 - index);
+	} else if (best0 == best1) {
+		std::memset(bestIndices, 0, sizeof(bestIndices));
+	}
+	static const uint32_t code[4] = { 0, 2, 3, 1 }; // position on the segment -> BC1 palette index
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; i++) bits |= code[bestIndices[i]] << (2 * i);
+	std::memcpy(out, &best0, 2);
+	std::memcpy(out + 2, &best1, 2);
+	std::memcpy(out + 4, &bits, 4);
+}
+
+void encodeBc4(const PixelBlock& block, FitFn fit, unsigned char* out) {
+	// Only channel 0 is read: callers move the source channel there
+	float e0[4] = { 0.0f }, e1[4] = { 0.0f };
+	e0[0] = *std::max_element(block.c[0], block.c[0] + 16);
+	e1[0] = *std::min_element(block.c[0], block.c[0] + 16);
+
+	uint8_t best0 = 0, best1 = 0;
+	uint8_t bestIndices[16] = {};
+	float bestError = std::numeric_limits<float>::max();
+	for (int iteration = 0; iteration < 2; iteration++) {
+		float q0[4] = { std::floor(e0[0] + 0.5f) }, q1[4] = { std::floor(e1[0] + 0.5f) };
+		uint8_t indices[16];
+		const float error = fit(block, 1, q0, q1, 8, indices);
+		if (error < bestError) {
+			bestError = error;
+			best0 = static_cast<uint8_t>(q0[0]);
+			best1 = static_cast<uint8_t>(q1[0]);
+			std::memcpy(bestIndices, indices, sizeof(indices));
+		}
+		if (!leastSquaresEndpoints(block, 1, indices, 8, e0, e1)) break;
+	}
+
+	// Eight-value mode needs red0 > red1
+	if (best0 < best1) {
+		std::swap(best0, best1);
+		for (uint8_t& index : bestIndices) index = static_cast<uint8_t>(7 - index);
+	} else if (best0 == best1) {
+		std::memset(bestIndices, 0, sizeof(bestIndices));
+	}
+	static const uint64_t code[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; i++) bits |= code[bestIndices[i]] << (3 * i);
+	out[0] = best0;
+	out[1] = best1;
+	for (int i = 0; i < 6; i++) out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+}
+
+// Little-endian bit stream of one 128-bit BC7 block
+struct BitWriter {
+	unsigned char* out;
+	uint32_t position = 0;
+
+	void write(uint32_t value, uint32_t bits) {
+		for (uint32_t i = 0; i < bits; i++, position++) {
+			if ((value >> i) & 1) out[position >> 3] |= static_cast<unsigned char>(1u << (position & 7));
+		}
+	}
+};
+
+struct BitReader {
+	const unsigned char* in;
+	uint32_t position = 0;
+
+	uint32_t read(uint32_t bits) {
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < bits; i++, position++) {
+			value |= static_cast<uint32_t>((in[position >> 3] >> (position & 7)) & 1) << i;
+		}
+		return value;
+	}
+};
+
+// 7-bit endpoint with a shared p-bit as the LSB of the 8-bit value
+float quantizeBc7(float value, uint32_t pBit, uint32_t& quantized) {
+	const float q = std::floor((value - static_cast<float>(pBit)) * 0.5f + 0.5f);
+	quantized = static_cast<uint32_t>(std::min(std::max(q, 0.0f), 127.0f));
+	return static_cast<float>(quantized * 2 + pBit);
+}
+
+void encodeBc7(const PixelBlock& block, FitFn fit, unsigned char* out) {
+	float e0[4], e1[4];
+	principalEndpoints(block, 4, e0, e1);
+
+	uint32_t best0[4] = {}, best1[4] = {}, bestP0 = 0, bestP1 = 0;
+	uint8_t bestIndices[16] = {};
+	float bestError = std::numeric_limits<float>::max();
+	for (int iteration = 0; iteration < 2; iteration++) {
+		uint8_t iterationIndices[16] = {};
+		float iterationError = std::numeric_limits<float>::max();
+		for (uint32_t p = 0; p < 4; p++) {
+			const uint32_t p0 = p & 1, p1 = p >> 1;
+			uint32_t v0[4], v1[4];
+			float q0[4], q1[4];
+			for (int c = 0; c < 4; c++) {
+				q0[c] = quantizeBc7(e0[c], p0, v0[c]);
+				q1[c] = quantizeBc7(e1[c], p1, v1[c]);
+			}
+			uint8_t indices[16];
+			const float error = fit(block, 4, q0, q1, 16, indices);
+			if (error < iterationError) {
+				iterationError = error;
+				std::memcpy(iterationIndices, indices, sizeof(indices));
+			}
+			if (error < bestError) {
+				bestError = error;
+				std::memcpy(best0, v0, sizeof(v0));
+				std::memcpy(best1, v1, sizeof(v1));
+				bestP0 = p0;
+				bestP1 = p1;
+				std::memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+		if (!leastSquaresEndpoints(block, 4, iterationIndices, 16, e0, e1)) break;
+	}
+
+	// The anchor texel's index MSB is implicit 0
+	if (bestIndices[0] >= 8) {
+		std::swap(best0, best1);
+		std::swap(bestP0, bestP1);
+		for (uint8_t& index : bestIndices) index = static_cast<uint8_t>(15 - index);
+	}
+	std::memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.write(1u << 6, 7); // mode 6
+	for (int c = 0; c < 4; c++) {
+		writer.write(best0[c], 7);
+		writer.write(best1[c], 7);
+	}
+	writer.write(bestP0, 1);
+	writer.write(bestP1, 1);
+	writer.write(bestIndices[0], 3);
+	for (int i = 1; i < 16; i++) writer.write(bestIndices[i], 4);
+}
+
+// ========== Decoders ==========
+
+void decodeBc1(const unsigned char* in, unsigned char texels[16][4]) {
+	uint16_t c0, c1;
+	uint32_t bits;
+	std::memcpy(&c0, in, 2);
+	std::memcpy(&c1, in + 2, 2);
+	std::memcpy(&bits, in + 4, 4);
+	float f0[4], f1[4];
+	unpack565(c0, f0);
+	unpack565(c1, f1);
+	unsigned char palette[4][4];
+	for (int c = 0; c < 3; c++) {
+		const int a = static_cast<int>(f0[c]), b = static_cast<int>(f1[c]);
+		palette[0][c] = static_cast<unsigned char>(a);
+		palette[1][c] = static_cast<unsigned char>(b);
+		palette[2][c] = static_cast<unsigned char>(c0 > c1 ? (2 * a + b) / 3 : (a + b) / 2);
+		palette[3][c] = static_cast<unsigned char>(c0 > c1 ? (a + 2 * b) / 3 : 0);
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = c0 > c1 ? 255 : 0;
+	for (int i = 0; i < 16; i++) std::memcpy(texels[i], palette[(bits >> (2 * i)) & 3], 4);
+}
+
+void decodeBc4(const unsigned char* in, unsigned char values[16]) {
+	const int e0 = in[0], e1 = in[1];
+	int palette[8] = { e0, e1 };
+	if (e0 > e1) {
+		for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * e0 + (i - 1) * e1) / 7;
+	} else {
+		for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * e0 + (i - 1) * e1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++) bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+	for (int i = 0; i < 16; i++) values[i] = static_cast<unsigned char>(palette[(bits >> (3 * i)) & 7]);
+}
+
+// Mode 6 only; other modes decode as black (the encoder never writes them)
+void decodeBc7(const unsigned char* in, unsigned char texels[16][4]) {
+	static const uint32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	BitReader reader{ in };
+	if (reader.read(7) != (1u << 6)) {
+		std::memset(texels, 0, 16 * 4);
+		return;
+	}
+	uint32_t e0[4], e1[4];
+	for (int c = 0; c < 4; c++) {
+		e0[c] = reader.read(7) << 1;
+		e1[c] = reader.read(7) << 1;
+	}
+	const uint32_t p0 = reader.read(1), p1 = reader.read(1);
+	for (int c = 0; c < 4; c++) {
+		e0[c] |= p0;
+		e1[c] |= p1;
+	}
+	for (int i = 0; i < 16; i++) {
+		const uint32_t w = weights[reader.read(i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; c++) {
+			texels[i][c] = static_cast<unsigned char>(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+		}
+	}
+}
+
+// Texels of block (bx, by), clamped at the right and bottom edge
+void loadBlock(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, PixelBlock& block) {
+	for (uint32_t y = 0; y < 4; y++) {
+		const uint32_t sy = std::min(by * 4 + y, height - 1);
+		for (uint32_t x = 0; x < 4; x++) {
+			const uint32_t sx = std::min(bx * 4 + x, width - 1);
+			const unsigned char* texel = rgba + (static_cast<size_t>(sy) * width + sx) * 4;
+			for (int c = 0; c < 4; c++) block.c[c][y * 4 + x] = texel[c];
+		}
+	}
+}
+
+} // namespace
+
+// ========== Formats ==========
+
+const char* blockFormatName(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC4: return "BC4";
+	case BlockFormat::BC5: return "BC5";
+	case BlockFormat::BC7: return "BC7";
+	default: return "?";
+	}
+}
+
+const char* blockSimdName(BlockSimd simd) {
+	switch (simd) {
+	case BlockSimd::Scalar: return "scalar";
+	case BlockSimd::SSE41: return "SSE4.1";
+	case BlockSimd::AVX2: return "AVX2";
+	default: return "auto";
+	}
+}
+
+BlockSimd detectBlockSimd() {
+#ifdef SPELL_BC_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+	__cpuid(info, 1);
+	const bool sse41 = (info[2] & (1 << 19)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	const bool sse41 = __builtin_cpu_supports("sse4.1");
+	const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+	if (avx2) return BlockSimd::AVX2;
+	if (sse41) return BlockSimd::SSE41;
+#endif
+	return BlockSimd::Scalar;
+}
+
+uint32_t blockFormatBytes(BlockFormat format) {
+	return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+VkFormat blockFormatToVk(BlockFormat format, bool srgb) {
+	switch (format) {
+	case BlockFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BlockFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+	case BlockFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+	case BlockFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	default: return VK_FORMAT_UNDEFINED;
+	}
+}
+
+bool blockFormatFromVk(VkFormat vkFormat, BlockFormat& format) {
+	switch (vkFormat) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		format = BlockFormat::BC1;
+		return true;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		format = BlockFormat::BC4;
+		return true;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		format = BlockFormat::BC5;
+		return true;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		format = BlockFormat::BC7;
+		return true;
+	default:
+		return false;
+	}
+}
+
+BlockFormat blockFormatForChannels(TextureChannels channels, bool fastDiffuse) {
+	switch (channels) {
+	case TextureChannels::R: return BlockFormat::BC4;
+	case TextureChannels::Rg:
+	case TextureChannels::Bg: return BlockFormat::BC5;
+	default: return fastDiffuse ? BlockFormat::BC1 : BlockFormat::BC7;
+	}
+}
+
+// ========== Compression ==========
+
+void compressBlockRows(const unsigned char* rgba, uint32_t width, uint32_t height, BlockFormat format,
+	uint32_t firstRow, uint32_t rowCount, unsigned char* out, BlockSimd simd) {
+	const FitFn fit = fitFor(simd);
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blockBytes = blockFormatBytes(format);
+	PixelBlock block;
+	PixelBlock channel; // BC4 / BC5: the encoded channel moved to channel 0
+	for (uint32_t by = firstRow; by < firstRow + rowCount; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			loadBlock(rgba, width, height, bx, by, block);
+			unsigned char* dst = out + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+			switch (format) {
+			case BlockFormat::BC1:
+				encodeBc1(block, fit, dst);
+				break;
+			case BlockFormat::BC4:
+				encodeBc4(block, fit, dst);
+				break;
+			case BlockFormat::BC5:
+				encodeBc4(block, fit, dst);
+				std::memcpy(channel.c[0], block.c[1], sizeof(channel.c[0]));
+				encodeBc4(channel, fit, dst + 8);
+				break;
+			case BlockFormat::BC7:
+				encodeBc7(block, fit, dst);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+TextureMipChain compressMipChain(const TextureMipChain& rgba, BlockFormat format, bool srgb, BlockSimd simd,
+	uint32_t threadCount) {
+	TextureMipChain chain;
+	chain.format = blockFormatToVk(format, srgb);
+	chain.width = rgba.width;
+	chain.height = rgba.height;
+	chain.levels.resize(rgba.levelCount());
+
+	std::vector<size_t> offsets(rgba.levelCount());
+	size_t total = 0;
+	for (uint32_t i = 0; i < rgba.levelCount(); i++) {
+		TextureMipLevel& level = chain.levels[i];
+		level.width = rgba.levels[i].width;
+		level.height = rgba.levels[i].height;
+		level.size = textureLevelSize(chain.format, level.width, level.height);
+		offsets[i] = total;
+		total += level.size;
+	}
+	chain.storage.resize(total);
+	for (uint32_t i = 0; i < rgba.levelCount(); i++) {
+		chain.levels[i].data = chain.storage.data() + offsets[i];
+	}
+
+	// Runs of block rows across all levels, handed out in order
+	constexpr uint32_t ROWS_PER_TASK = 4;
+	struct RowTask {
+		uint32_t level;
+		uint32_t firstRow;
+		uint32_t rowCount;
+	};
+	std::vector<RowTask> tasks;
+	for (uint32_t i = 0; i < rgba.levelCount(); i++) {
+		const uint32_t blockRows = (rgba.levels[i].height + 3) / 4;
+		for (uint32_t row = 0; row < blockRows; row += ROWS_PER_TASK) {
+			tasks.push_back({ i, row, std::min(ROWS_PER_TASK, blockRows - row) });
+		}
+	}
+
+	std::atomic<size_t> nextTask{ 0 };
+	auto worker = [&]() {
+		for (size_t t = nextTask++; t < tasks.size(); t = nextTask++) {
+			const RowTask& task = tasks[t];
+			const TextureMipLevel& source = rgba.levels[task.level];
+			compressBlockRows(source.data, source.width, source.height, format, task.firstRow, task.rowCount,
+				chain.storage.data() + offsets[task.level], simd);
+		}
+	};
+
+	const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	const size_t workerCount = std::min<size_t>(threadCount > 0 ? threadCount : hardwareThreads, tasks.size());
+	std::vector<std::future<void>> workers;
+	for (size_t i = 1; i < workerCount; i++) {
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (auto& w : workers) w.get();
+	return chain;
+}
+
+void decompressBlocks(const unsigned char* blocks, uint32_t width, uint32_t height, BlockFormat format,
+	unsigned char* rgba) {
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const uint32_t blockBytes = blockFormatBytes(format);
+	unsigned char texels[16][4];
+	for (uint32_t by = 0; by < blocksY; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++) {
+			const unsigned char* in = blocks + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+			switch (format) {
+			case BlockFormat::BC1:
+				decodeBc1(in, texels);
+				break;
+			case BlockFormat::BC4:
+			case BlockFormat::BC5: {
+				unsigned char red[16], green[16] = {};
+				decodeBc4(in, red);
+				if (format == BlockFormat::BC5) decodeBc4(in + 8, green);
+				for (int i = 0; i < 16; i++) {
+					texels[i][0] = red[i];
+					texels[i][1] = green[i];
+					texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+				break;
+			}
+			case BlockFormat::BC7:
+				decodeBc7(in, texels);
+				break;
+			default:
+				std::memset(texels, 0, sizeof(texels));
+				break;
+			}
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+					std::memcpy(rgba + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
+
+} // namespace Spell
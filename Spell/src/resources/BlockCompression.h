@@ -0,0 +1,52 @@
+#pragma once
+
+#include "TextureCache.h"
+
+#include <cstdint>
+
+namespace Spell {
+
+// GPU block formats produced by the CPU encoders, 4x4 texels per block
+enum class BlockFormat : uint32_t {
+	BC1, // RGB, 8 bytes per block (opaque, alpha is dropped)
+	BC4, // R, 8 bytes
+	BC5, // RG, 16 bytes
+	BC7, // RGBA, 16 bytes (mode 6: one subset, 7.7.7.7 endpoints + p-bit, 4-bit indices)
+	Count
+};
+
+// Instruction set of the encoder kernels. Auto picks the best one the CPU supports; a level
+// the CPU lacks falls back to the best supported one.
+enum class BlockSimd : uint32_t { Scalar, SSE41, AVX2, Auto };
+
+const char* blockFormatName(BlockFormat format);
+const char* blockSimdName(BlockSimd simd);
+// SSE4.1 / AVX2 also need the OS to save the wider registers
+BlockSimd detectBlockSimd();
+
+uint32_t blockFormatBytes(BlockFormat format);
+// sRGB variants exist for BC1 and BC7; BC4 and BC5 are always UNORM
+VkFormat blockFormatToVk(BlockFormat format, bool srgb);
+bool blockFormatFromVk(VkFormat vkFormat, BlockFormat& format);
+
+// Rgba (diffuse): BC7, or BC1 when `fastDiffuse`. Rg / Bg (normal, packed metallic-roughness):
+// BC5. R (separate metallic / roughness): BC4.
+BlockFormat blockFormatForChannels(TextureChannels channels, bool fastDiffuse);
+
+// Encodes block rows [firstRow, firstRow + rowCount) of a tightly packed RGBA8 image into `out`,
+// which holds the whole level with its blocks in row-major order. Partial edge blocks repeat the
+// last texel row / column.
+void compressBlockRows(const unsigned char* rgba, uint32_t width, uint32_t height, BlockFormat format,
+	uint32_t firstRow, uint32_t rowCount, unsigned char* out, BlockSimd simd = BlockSimd::Auto);
+
+// Compresses every level of an RGBA8 chain (see buildMipChain). All levels are cut into runs of
+// block rows that worker threads pick up, so the small levels do not serialize behind level 0.
+// threadCount 0 uses every hardware thread.
+TextureMipChain compressMipChain(const TextureMipChain& rgba, BlockFormat format, bool srgb,
+	BlockSimd simd = BlockSimd::Auto, uint32_t threadCount = 0);
+
+// Decodes a level back to RGBA8 for quality checks (BC4: R,0,0,255; BC5: R,G,0,255)
+void decompressBlocks(const unsigned char* blocks, uint32_t width, uint32_t height, BlockFormat format,
+	unsigned char* rgba);
+
+} // namespace Spell
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Spell {
+
+// 64-bit content hash (XXH64 algorithm, seed 0), used to key on-disk caches
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Hashes a whole file through a read-only mapping. Returns false if the file cannot be opened.
+bool hashFile(const std::string& path, uint64_t& outHash);
+
+// 16-digit lowercase hex, for cache file names
+std::string hashToHex(uint64_t hash);
+
+} // namespace Spell
@@ -1,9 +1,19 @@
 #include <ufbx.h>
 
 #include "FbxModelLoader.h"
+#include "ContentHash.h"
+#include "MaterialRanges.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
 #include <stdexcept>
 #include <iostream>
 #include <filesystem>
+#include <thread>
+#include <unordered_map>
 
 namespace Spell {
 
@@ -32,166 +42,308 @@ static std::string ufbxStringToStd(ufbx_string s) {
 	return std::string(s.data, s.length);
 }
 
-ModelLoadResult FbxModelLoader::load(const std::string& filepath) {
-	ModelLoadResult result;
+uint64_t FbxModelLoader::outputSettingsHash() const {
+	if (weldTolerance_.isExact()) return 0;
+	const float values[3] = { weldTolerance_.position, weldTolerance_.normal, weldTolerance_.texCoord };
+	return hashBytes(values, sizeof(values));
+}
+
+namespace {
+
+// Worker threads behind ufbx's thread pool hooks. ufbx queues tasks by (group, index) and
+// runs each one through ufbx_thread_pool_run_task(); wait blocks until the group has drained.
+class UfbxThreadPool {
+public:
+	explicit UfbxThreadPool(size_t threadCount) {
+		for (size_t i = 0; i < threadCount; i++) {
+			workers_.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	~UfbxThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		taskReady_.notify_all();
+		for (auto& worker : workers_) worker.join();
+	}
 
-	ufbx_load_opts opts{};
-	// Convert to Y-up, right-handed (matching typical Vulkan/glTF convention)
-	opts.target_axes = ufbx_axes_right_handed_y_up;
-	opts.target_unit_meters = 1.0f;
-	opts.generate_missing_normals = true;
-
-	ufbx_error error;
-	ufbx_scene* scene = ufbx_load_file(filepath.c_str(), &opts, &error);
-	if (!scene) {
-		char errBuf[512];
-		ufbx_format_error(errBuf, sizeof(errBuf), &error);
-		throw std::runtime_error(std::string("[Spell] FBX: Failed to load: ") + errBuf);
-	}
-
-	std::string baseDir = std::filesystem::path(filepath).parent_path().string();
-	if (baseDir.empty()) baseDir = ".";
-
-	// Extract materials
-	for (size_t i = 0; i < scene->materials.count; i++) {
-		const ufbx_material* mat = scene->materials.data[i];
-		MaterialInfo info{};
-
-		// Try PBR properties first, fallback to FBX classic
-		auto getTexPath = [&](const ufbx_material_map& pbrMap, const ufbx_material_map& fbxMap) -> std::string {
-			if (pbrMap.texture && pbrMap.texture->type == UFBX_TEXTURE_FILE) {
-				std::string raw = ufbxStringToStd(pbrMap.texture->relative_filename);
-				if (raw.empty()) raw = ufbxStringToStd(pbrMap.texture->absolute_filename);
-				return resolveTexturePath(raw, baseDir);
+	UfbxThreadPool(const UfbxThreadPool&) = delete;
+	UfbxThreadPool& operator=(const UfbxThreadPool&) = delete;
+
+	ufbx_thread_pool hooks() {
+		ufbx_thread_pool pool{};
+		pool.run_fn = &UfbxThreadPool::run;
+		pool.wait_fn = &UfbxThreadPool::wait;
+		pool.user = this;
+		return pool;
+	}
+
+private:
+	struct Task {
+		ufbx_thread_pool_context ctx;
+		uint32_t group;
+		uint32_t index;
+	};
+
+	static void run(void* user, ufbx_thread_pool_context ctx, uint32_t group, uint32_t startIndex, uint32_t count) {
+		auto* pool = static_cast<UfbxThreadPool*>(user);
+		{
+			std::lock_guard<std::mutex> lock(pool->mutex_);
+			for (uint32_t i = 0; i < count; i++) {
+				pool->queue_.push_back({ ctx, group, startIndex + i });
 			}
-			if (fbxMap.texture && fbxMap.texture->type == UFBX_TEXTURE_FILE) {
-				std::string raw = ufbxStringToStd(fbxMap.texture->relative_filename);
-				if (raw.empty()) raw = ufbxStringToStd(fbxMap.texture->absolute_filename);
-				return resolveTexturePath(raw, baseDir);
+			pool->pending_[group] += count;
+		}
+		pool->taskReady_.notify_all();
+	}
+
+	// Waits for every queued task of the group, which covers all indices below maxIndex
+	static void wait(void* user, ufbx_thread_pool_context, uint32_t group, uint32_t) {
+		auto* pool = static_cast<UfbxThreadPool*>(user);
+		std::unique_lock<std::mutex> lock(pool->mutex_);
+		pool->taskDone_.wait(lock, [&]() { return pool->pending_[group] == 0; });
+	}
+
+	void workerLoop() {
+		for (;;) {
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				taskReady_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+				if (queue_.empty()) return;
+				task = queue_.front();
+				queue_.pop_front();
 			}
-			return "";
-		};
-
-		info.diffuseTexturePath = getTexPath(mat->pbr.base_color, mat->fbx.diffuse_color);
-		info.normalTexturePath = getTexPath(mat->pbr.normal_map, mat->fbx.normal_map);
-		info.metallicTexturePath = getTexPath(mat->pbr.metalness, mat->fbx.specular_color);
-		info.roughnessTexturePath = getTexPath(mat->pbr.roughness, mat->fbx.specular_exponent);
-
-		result.materials.push_back(info);
-	}
-
-	std::cout << "[Spell] FBX: Loaded " << result.materials.size() << " material(s) from " << filepath << std::endl;
-
-	// Process all meshes in the scene
-	for (size_t mi = 0; mi < scene->meshes.count; mi++) {
-		const ufbx_mesh* mesh = scene->meshes.data[mi];
-
-		// Triangulate the mesh
-		size_t maxTriIndices = mesh->max_face_triangles * 3;
-		std::vector<uint32_t> triIndices(maxTriIndices);
-
-		for (size_t fi = 0; fi < mesh->faces.count; fi++) {
-			ufbx_face face = mesh->faces.data[fi];
-			uint32_t numTris = ufbx_triangulate_face(triIndices.data(), maxTriIndices, mesh, face);
-
-			// Determine material for this face
-			int materialIndex = -1;
-			if (mesh->face_material.count > 0) {
-				uint32_t matIdx = mesh->face_material.data[fi];
-				if (mesh->materials.count > 0 && matIdx < mesh->materials.count) {
-					// Map mesh-local material to scene-global material index
-					const ufbx_material* faceMat = mesh->materials.data[matIdx];
-					for (size_t si = 0; si < scene->materials.count; si++) {
-						if (scene->materials.data[si] == faceMat) {
-							materialIndex = static_cast<int>(si);
-							break;
-						}
-					}
-				}
+
+			ufbx_thread_pool_run_task(task.ctx, task.index);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pending_[task.group]--;
+			}
+			taskDone_.notify_all();
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable taskReady_;
+	std::condition_variable taskDone_;
+	std::deque<Task> queue_;
+	std::unordered_map<uint32_t, uint32_t> pending_; // group -> queued or running tasks
+	std::vector<std::thread> workers_;
+	bool stopping_ = false;
+};
+
+} // namespace
+
+void FbxModelLoader::convertMesh(const ufbx_mesh* mesh, const VertexWeldTolerance& weldTolerance, ConvertedMesh& out) {
+	// Mesh-local material slot -> scene-global material index
+	std::vector<int> materialTable(mesh->materials.count, -1);
+	for (size_t i = 0; i < mesh->materials.count; i++) {
+		if (mesh->materials.data[i]) {
+			materialTable[i] = static_cast<int>(mesh->materials.data[i]->typed_id);
+		}
+	}
+
+	// Triangulate the mesh
+	size_t maxTriIndices = mesh->max_face_triangles * 3;
+	std::vector<uint32_t> triIndices(maxTriIndices);
+	std::vector<Vertex> corners;
+	corners.reserve(mesh->num_triangles * 3);
+
+	for (size_t fi = 0; fi < mesh->faces.count; fi++) {
+		ufbx_face face = mesh->faces.data[fi];
+		uint32_t numTris = ufbx_triangulate_face(triIndices.data(), maxTriIndices, mesh, face);
+
+		// Determine material for this face
+		int materialIndex = -1;
+		if (mesh->face_material.count > 0) {
+			uint32_t matIdx = mesh->face_material.data[fi];
+			if (matIdx < materialTable.size()) {
+				materialIndex = materialTable[matIdx];
 			}
+		}
 
-			uint32_t baseVertex = static_cast<uint32_t>(result.vertices.size());
+		for (uint32_t ti = 0; ti < numTris * 3; ti++) {
+			uint32_t meshIndex = triIndices[ti];
 
-			for (uint32_t ti = 0; ti < numTris * 3; ti++) {
-				uint32_t meshIndex = triIndices[ti];
+			Vertex vertex{};
 
-				Vertex vertex{};
+			ufbx_vec3 pos = ufbx_get_vertex_vec3(&mesh->vertex_position, meshIndex);
+			vertex.pos = { static_cast<float>(pos.x), static_cast<float>(pos.y), static_cast<float>(pos.z) };
 
-				ufbx_vec3 pos = ufbx_get_vertex_vec3(&mesh->vertex_position, meshIndex);
-				vertex.pos = { static_cast<float>(pos.x), static_cast<float>(pos.y), static_cast<float>(pos.z) };
+			if (mesh->vertex_normal.exists) {
+				ufbx_vec3 normal = ufbx_get_vertex_vec3(&mesh->vertex_normal, meshIndex);
+				vertex.normal = { static_cast<float>(normal.x), static_cast<float>(normal.y), static_cast<float>(normal.z) };
+			} else {
+				vertex.normal = { 0.0f, 0.0f, 1.0f };
+			}
 
-				if (mesh->vertex_normal.exists) {
-					ufbx_vec3 normal = ufbx_get_vertex_vec3(&mesh->vertex_normal, meshIndex);
-					vertex.normal = { static_cast<float>(normal.x), static_cast<float>(normal.y), static_cast<float>(normal.z) };
-				} else {
-					vertex.normal = { 0.0f, 0.0f, 1.0f };
-				}
+			if (mesh->vertex_uv.exists) {
+				ufbx_vec2 uv = ufbx_get_vertex_vec2(&mesh->vertex_uv, meshIndex);
+				vertex.texCoord = { static_cast<float>(uv.x), 1.0f - static_cast<float>(uv.y) };
+			}
+
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+			vertex.materialIndex = materialIndex;
 
-				if (mesh->vertex_uv.exists) {
-					ufbx_vec2 uv = ufbx_get_vertex_vec2(&mesh->vertex_uv, meshIndex);
-					vertex.texCoord = { static_cast<float>(uv.x), 1.0f - static_cast<float>(uv.y) };
+			corners.push_back(vertex);
+		}
+	}
+
+	// Corners are welded per mesh, so vertices are never shared across meshes
+	out.cornerCount = corners.size();
+	weldVertices(corners.data(), corners.size(), weldTolerance, out.vertices, out.indices);
+}
+
+// ufbx cannot stop after the material table, so the whole scene is parsed (on the
+// thread pool) when the session opens and meshes are converted from it in load().
+class FbxModelLoader::Session : public IModelLoadSession {
+public:
+	Session(FbxModelLoader& loader, const std::string& filepath)
+		: loader_(loader), filepath_(filepath) {
+		ufbx_load_opts opts{};
+		// Convert to Y-up, right-handed (matching typical Vulkan/glTF convention)
+		opts.target_axes = ufbx_axes_right_handed_y_up;
+		opts.target_unit_meters = 1.0f;
+		opts.generate_missing_normals = true;
+
+		// Let ufbx decompress and decode arrays on worker threads
+		UfbxThreadPool threadPool(std::max(1u, std::thread::hardware_concurrency()));
+		opts.thread_opts.pool = threadPool.hooks();
+
+		ufbx_error error;
+		scene_ = ufbx_load_file(filepath.c_str(), &opts, &error);
+		if (!scene_) {
+			char errBuf[512];
+			ufbx_format_error(errBuf, sizeof(errBuf), &error);
+			throw std::runtime_error(std::string("[Spell] FBX: Failed to load: ") + errBuf);
+		}
+
+		std::string baseDir = std::filesystem::path(filepath).parent_path().string();
+		if (baseDir.empty()) baseDir = ".";
+
+		// Extract materials
+		for (size_t i = 0; i < scene_->materials.count; i++) {
+			const ufbx_material* mat = scene_->materials.data[i];
+			MaterialInfo info{};
+
+			// Try PBR properties first, fallback to FBX classic
+			auto getTexPath = [&](const ufbx_material_map& pbrMap, const ufbx_material_map& fbxMap) -> std::string {
+				if (pbrMap.texture && pbrMap.texture->type == UFBX_TEXTURE_FILE) {
+					std::string raw = ufbxStringToStd(pbrMap.texture->relative_filename);
+					if (raw.empty()) raw = ufbxStringToStd(pbrMap.texture->absolute_filename);
+					return loader_.resolveTexturePath(raw, baseDir);
+				}
+				if (fbxMap.texture && fbxMap.texture->type == UFBX_TEXTURE_FILE) {
+					std::string raw = ufbxStringToStd(fbxMap.texture->relative_filename);
+					if (raw.empty()) raw = ufbxStringToStd(fbxMap.texture->absolute_filename);
+					return loader_.resolveTexturePath(raw, baseDir);
 				}
+				return "";
+			};
 
-				vertex.color = { 1.0f, 1.0f, 1.0f };
-				vertex.materialIndex = materialIndex;
+			info.diffuseTexturePath = getTexPath(mat->pbr.base_color, mat->fbx.diffuse_color);
+			info.normalTexturePath = getTexPath(mat->pbr.normal_map, mat->fbx.normal_map);
+			info.metallicTexturePath = getTexPath(mat->pbr.metalness, mat->fbx.specular_color);
+			info.roughnessTexturePath = getTexPath(mat->pbr.roughness, mat->fbx.specular_exponent);
 
-				result.vertices.push_back(vertex);
-				result.indices.push_back(baseVertex + ti);
-			}
+			materials_.push_back(info);
 		}
+
+		std::cout << "[Spell] FBX: Loaded " << materials_.size() << " material(s) from " << filepath << std::endl;
 	}
 
-	ufbx_free_scene(scene);
+	~Session() override {
+		if (scene_) ufbx_free_scene(scene_);
+	}
 
-	std::cout << "[Spell] FBX: " << result.vertices.size() << " vertices, "
-		<< result.indices.size() << " indices" << std::endl;
+	const std::vector<MaterialInfo>& materials() const override { return materials_; }
+	ModelLoadResult load() override;
 
-	return result;
+private:
+	FbxModelLoader& loader_;
+	std::string filepath_;
+	ufbx_scene* scene_ = nullptr;
+	std::vector<MaterialInfo> materials_;
+};
+
+std::unique_ptr<IModelLoadSession> FbxModelLoader::open(const std::string& filepath) {
+	return std::make_unique<Session>(*this, filepath);
 }
 
-std::vector<MaterialInfo> FbxModelLoader::preParseTexturePaths(const std::string& filepath) {
-	ufbx_load_opts opts{};
-	opts.ignore_geometry = true;
-	opts.ignore_animation = true;
-	opts.ignore_embedded = true;
-
-	ufbx_error error;
-	ufbx_scene* scene = ufbx_load_file(filepath.c_str(), &opts, &error);
-	if (!scene) return {};
-
-	std::string baseDir = std::filesystem::path(filepath).parent_path().string();
-	if (baseDir.empty()) baseDir = ".";
-
-	std::vector<MaterialInfo> result;
-	for (size_t i = 0; i < scene->materials.count; i++) {
-		const ufbx_material* mat = scene->materials.data[i];
-		MaterialInfo info{};
-
-		auto getTexPath = [&](const ufbx_material_map& pbrMap, const ufbx_material_map& fbxMap) -> std::string {
-			if (pbrMap.texture && pbrMap.texture->type == UFBX_TEXTURE_FILE) {
-				std::string raw = ufbxStringToStd(pbrMap.texture->relative_filename);
-				if (raw.empty()) raw = ufbxStringToStd(pbrMap.texture->absolute_filename);
-				return resolveTexturePath(raw, baseDir);
-			}
-			if (fbxMap.texture && fbxMap.texture->type == UFBX_TEXTURE_FILE) {
-				std::string raw = ufbxStringToStd(fbxMap.texture->relative_filename);
-				if (raw.empty()) raw = ufbxStringToStd(fbxMap.texture->absolute_filename);
-				return resolveTexturePath(raw, baseDir);
-			}
-			return "";
-		};
+ModelLoadResult FbxModelLoader::Session::load() {
+	if (!scene_) {
+		throw std::runtime_error("[Spell] FBX: Session already loaded: " + filepath_);
+	}
 
-		info.diffuseTexturePath = getTexPath(mat->pbr.base_color, mat->fbx.diffuse_color);
-		info.normalTexturePath = getTexPath(mat->pbr.normal_map, mat->fbx.normal_map);
-		info.metallicTexturePath = getTexPath(mat->pbr.metalness, mat->fbx.specular_color);
-		info.roughnessTexturePath = getTexPath(mat->pbr.roughness, mat->fbx.specular_exponent);
+	const ufbx_scene* scene = scene_;
+	const VertexWeldTolerance& weldTolerance = loader_.weldTolerance_;
+	ModelLoadResult result;
+	result.materials = materials_;
+
+	// Convert meshes in parallel into per-mesh buffers, then concatenate them in scene order
+	std::vector<ConvertedMesh> converted(scene->meshes.count);
+	const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+	const size_t workers = std::clamp<size_t>(scene->meshes.count, 1, hw);
+	{
+		std::atomic<size_t> nextMesh{ 0 };
+		std::vector<std::future<void>> tasks;
+		for (size_t w = 0; w < workers; w++) {
+			tasks.push_back(std::async(std::launch::async, [&]() {
+				for (size_t mi = nextMesh++; mi < converted.size(); mi = nextMesh++) {
+					convertMesh(scene->meshes.data[mi], weldTolerance, converted[mi]);
+				}
+			}));
+		}
+		for (auto& t : tasks) t.get();
+	}
 
-		result.push_back(info);
+	size_t cornerTotal = 0;
+	std::vector<size_t> vertexOffsets(converted.size() + 1, 0);
+	std::vector<size_t> indexOffsets(converted.size() + 1, 0);
+	for (size_t mi = 0; mi < converted.size(); mi++) {
+		cornerTotal += converted[mi].cornerCount;
+		vertexOffsets[mi + 1] = vertexOffsets[mi] + converted[mi].vertices.size();
+		indexOffsets[mi + 1] = indexOffsets[mi] + converted[mi].indices.size();
+	}
+	result.vertices.resize(vertexOffsets.back());
+	result.indices.resize(indexOffsets.back());
+	{
+		std::atomic<size_t> nextMesh{ 0 };
+		std::vector<std::future<void>> tasks;
+		for (size_t w = 0; w < workers; w++) {
+			tasks.push_back(std::async(std::launch::async, [&]() {
+				for (size_t mi = nextMesh++; mi < converted.size(); mi = nextMesh++) {
+					ConvertedMesh& mesh = converted[mi];
+					std::copy(mesh.vertices.begin(), mesh.vertices.end(), result.vertices.begin() + vertexOffsets[mi]);
+					const uint32_t baseVertex = static_cast<uint32_t>(vertexOffsets[mi]);
+					uint32_t* dst = result.indices.data() + indexOffsets[mi];
+					for (size_t i = 0; i < mesh.indices.size(); i++) {
+						dst[i] = baseVertex + mesh.indices[i];
+					}
+					mesh = ConvertedMesh{};
+				}
+			}));
+		}
+		for (auto& t : tasks) t.get();
 	}
 
-	ufbx_free_scene(scene);
+	ufbx_free_scene(scene_);
+	scene_ = nullptr;
+	groupByMaterial(result);
+
+	std::cout << "[Spell] FBX: Welded " << cornerTotal << " -> " << result.vertices.size() << " vertices";
+	if (!weldTolerance.isExact()) {
+		std::cout << " (tolerance pos " << weldTolerance.position << ", normal " << weldTolerance.normal
+			<< ", uv " << weldTolerance.texCoord << ")";
+	}
+	std::cout << std::endl;
+	std::cout << "[Spell] FBX: " << result.vertices.size() << " vertices, "
+		<< result.indices.size() << " indices" << std::endl;
 
-	std::cout << "[Spell] FBX: Pre-parsed " << result.size() << " material(s) for texture paths" << std::endl;
 	return result;
 }
 
@@ -1,19 +1,39 @@
 #pragma once
 
 #include "IModelLoader.h"
+#include "VertexDedup.h"
+
+struct ufbx_mesh;
 
 namespace Spell {
 
 class FbxModelLoader : public IModelLoader {
 public:
-	ModelLoadResult load(const std::string& filepath) override;
-	std::vector<MaterialInfo> preParseTexturePaths(const std::string& filepath) override;
+	// Triangle corners are welded per mesh into an indexed vertex buffer. The default
+	// tolerance only merges bit-identical vertices (see ModelLoaderSettings).
+	explicit FbxModelLoader(VertexWeldTolerance weldTolerance = {}) : weldTolerance_(weldTolerance) {}
+
+	std::unique_ptr<IModelLoadSession> open(const std::string& filepath) override;
 	std::vector<std::string> supportedExtensions() const override {
 		return { ".fbx" };
 	}
+	uint32_t outputVersion() const override { return 2; }
+	uint64_t outputSettingsHash() const override;
 
 private:
+	class Session;
+
+	// One mesh triangulated and welded on its own, indices relative to its own vertices
+	struct ConvertedMesh {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		size_t cornerCount = 0;
+	};
+
 	std::string resolveTexturePath(const std::string& rawPath, const std::string& baseDir);
+	static void convertMesh(const ufbx_mesh* mesh, const VertexWeldTolerance& weldTolerance, ConvertedMesh& out);
+
+	VertexWeldTolerance weldTolerance_;
 };
 
 } // namespace Spell
@@ -2,112 +2,353 @@
 #include <cgltf.h>
 
 #include "GltfModelLoader.h"
+#include "MaterialRanges.h"
+#include <glm/gtc/type_ptr.hpp>
 #include "robin_hood.h"
 #include <stdexcept>
 #include <iostream>
 #include <filesystem>
 #include <cstring>
+#include <algorithm>
 
 namespace Spell {
 
-static glm::vec3 toVec3(const float* p) { return { p[0], p[1], p[2] }; }
-static glm::vec2 toVec2(const float* p) { return { p[0], p[1] }; }
-
 static const float* accessorReadFloat(const cgltf_accessor* acc, cgltf_size index, float* out, cgltf_size count) {
 	if (!acc || index >= acc->count) return nullptr;
 	if (cgltf_accessor_read_float(acc, index, out, count)) return out;
 	return nullptr;
 }
 
-std::string GltfModelLoader::resolveTextureUri(const cgltf_texture* texture, const std::string& baseDir) {
+// Start of the accessor's first element, or nullptr if the data is not resident
+static const uint8_t* accessorData(const cgltf_accessor* acc) {
+	const cgltf_buffer_view* view = acc->buffer_view;
+	if (!view) return nullptr;
+	if (view->data) return static_cast<const uint8_t*>(view->data) + acc->offset;
+	if (!view->buffer || !view->buffer->data) return nullptr;
+	return static_cast<const uint8_t*>(view->buffer->data) + view->offset + acc->offset;
+}
+
+// Unpacks the first `count` elements of a float attribute into `components` floats each.
+// Tightly packed float32 streams are copied with one memcpy; normalized, sparse or
+// strided data goes through cgltf_accessor_unpack_floats. Returns false if the accessor
+// cannot be read in bulk (caller falls back to per-element reads).
+static bool unpackFloatStream(const cgltf_accessor* acc, cgltf_size count, cgltf_size components,
+	std::vector<float>& out) {
+	cgltf_size accComponents = cgltf_num_components(acc->type);
+	if (accComponents != components || count > acc->count) return false;
+
+	out.resize(count * components);
+	const uint8_t* src = accessorData(acc);
+	if (src && !acc->is_sparse && !acc->normalized && acc->component_type == cgltf_component_type_r_32f
+		&& acc->stride == components * sizeof(float)) {
+		std::memcpy(out.data(), src, count * components * sizeof(float));
+		return true;
+	}
+
+	if (count == acc->count) {
+		return cgltf_accessor_unpack_floats(acc, out.data(), out.size()) == out.size();
+	}
+	std::vector<float> all(acc->count * components);
+	if (cgltf_accessor_unpack_floats(acc, all.data(), all.size()) != all.size()) return false;
+	std::memcpy(out.data(), all.data(), out.size() * sizeof(float));
+	return true;
+}
+
+// Writes the accessor's indices offset by baseVertex. uint32 streams are copied directly,
+// uint8/uint16 are widened in a flat loop, anything else uses cgltf_accessor_read_index.
+static void unpackIndices(const cgltf_accessor* acc, uint32_t baseVertex, uint32_t* out) {
+	const cgltf_size count = acc->count;
+	const uint8_t* src = accessorData(acc);
+
+	if (src && !acc->is_sparse) {
+		if (acc->component_type == cgltf_component_type_r_32u && acc->stride == sizeof(uint32_t)) {
+			std::memcpy(out, src, count * sizeof(uint32_t));
+			if (baseVertex != 0) {
+				for (cgltf_size i = 0; i < count; i++) out[i] += baseVertex;
+			}
+			return;
+		}
+		if (acc->component_type == cgltf_component_type_r_16u && acc->stride == sizeof(uint16_t)) {
+			const uint16_t* src16 = reinterpret_cast<const uint16_t*>(src);
+			for (cgltf_size i = 0; i < count; i++) out[i] = baseVertex + src16[i];
+			return;
+		}
+		if (acc->component_type == cgltf_component_type_r_8u && acc->stride == sizeof(uint8_t)) {
+			for (cgltf_size i = 0; i < count; i++) out[i] = baseVertex + src[i];
+			return;
+		}
+	}
+
+	for (cgltf_size i = 0; i < count; i++) {
+		out[i] = baseVertex + static_cast<uint32_t>(cgltf_accessor_read_index(acc, i));
+	}
+}
+
+// Decodes standard base64 (padding optional). Returns false on characters outside the alphabet.
+static bool decodeBase64(const char* text, size_t length, std::vector<unsigned char>& out) {
+	auto value = [](char c) -> int {
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+' || c == '-') return 62;
+		if (c == '/' || c == '_') return 63;
+		return -1;
+	};
+
+	while (length > 0 && text[length - 1] == '=') length--;
+	out.clear();
+	out.reserve(length * 3 / 4);
+
+	uint32_t bits = 0;
+	int bitCount = 0;
+	for (size_t i = 0; i < length; i++) {
+		int v = value(text[i]);
+		if (v < 0) return false;
+		bits = (bits << 6) | static_cast<uint32_t>(v);
+		bitCount += 6;
+		if (bitCount >= 8) {
+			bitCount -= 8;
+			out.push_back(static_cast<unsigned char>(bits >> bitCount));
+		}
+	}
+	return true;
+}
+
+std::string GltfModelLoader::resolveTextureUri(const cgltf_data* data, const cgltf_texture* texture,
+	const std::string& filepath, const std::string& baseDir) {
 	if (!texture || !texture->image) return "";
-	if (texture->image->uri) {
-		std::string uri = texture->image->uri;
-		if (uri.find("://") != std::string::npos || uri.substr(0, 5) == "data:") {
+	const cgltf_image* image = texture->image;
+	if (image->uri && std::strncmp(image->uri, "data:", 5) != 0) {
+		std::string uri = image->uri;
+		if (uri.find("://") != std::string::npos) {
 			return "";
 		}
 		return baseDir + "/" + uri;
 	}
+	// Stored in a buffer view (.glb) or inline as a data: URI
+	if (image->buffer_view || image->uri) {
+		return makeEmbeddedImagePath(filepath, static_cast<size_t>(image - data->images));
+	}
 	return "";
 }
 
-ModelLoadResult GltfModelLoader::load(const std::string& filepath) {
-	ModelLoadResult result;
-
-	cgltf_options options{};
-	cgltf_data* data = nullptr;
+// The JSON document is parsed once when the session opens; buffers are only loaded
+// when geometry is requested, so texture decoding can start in between.
+class GltfModelLoader::Session : public IModelLoadSession {
+public:
+	Session(GltfModelLoader& loader, const std::string& filepath)
+		: loader_(loader), filepath_(filepath) {
+		cgltf_result parseResult = cgltf_parse_file(&options_, filepath.c_str(), &data_);
+		if (parseResult != cgltf_result_success) {
+			throw std::runtime_error("[Spell] glTF: Failed to parse file: " + filepath);
+		}
 
-	cgltf_result parseResult = cgltf_parse_file(&options, filepath.c_str(), &data);
-	if (parseResult != cgltf_result_success) {
-		throw std::runtime_error("[Spell] glTF: Failed to parse file: " + filepath);
-	}
+		baseDir_ = std::filesystem::path(filepath).parent_path().string();
+		if (baseDir_.empty()) baseDir_ = ".";
 
-	cgltf_result loadResult = cgltf_load_buffers(&options, data, filepath.c_str());
-	if (loadResult != cgltf_result_success) {
-		cgltf_free(data);
-		throw std::runtime_error("[Spell] glTF: Failed to load buffers: " + filepath);
-	}
+		// Extract materials
+		for (cgltf_size i = 0; i < data_->materials_count; i++) {
+			const cgltf_material& mat = data_->materials[i];
+			MaterialInfo info{};
 
-	std::string baseDir = std::filesystem::path(filepath).parent_path().string();
-	if (baseDir.empty()) baseDir = ".";
+			if (mat.has_pbr_metallic_roughness) {
+				const auto& pbr = mat.pbr_metallic_roughness;
+				if (pbr.base_color_texture.texture) {
+					info.diffuseTexturePath = loader_.resolveTextureUri(data_, pbr.base_color_texture.texture, filepath_, baseDir_);
+				}
+				if (pbr.metallic_roughness_texture.texture) {
+					std::string mrPath = loader_.resolveTextureUri(data_, pbr.metallic_roughness_texture.texture, filepath_, baseDir_);
+					info.metallicTexturePath = mrPath;
+					info.roughnessTexturePath = mrPath;
+					info.packedMetallicRoughness = true;
+				}
+			}
+			if (mat.normal_texture.texture) {
+				info.normalTexturePath = loader_.resolveTextureUri(data_, mat.normal_texture.texture, filepath_, baseDir_);
+			}
 
-	// Extract materials
-	for (cgltf_size i = 0; i < data->materials_count; i++) {
-		const cgltf_material& mat = data->materials[i];
-		MaterialInfo info{};
+			materials_.push_back(info);
+		}
 
-		if (mat.has_pbr_metallic_roughness) {
-			const auto& pbr = mat.pbr_metallic_roughness;
-			if (pbr.base_color_texture.texture) {
-				info.diffuseTexturePath = resolveTextureUri(pbr.base_color_texture.texture, baseDir);
-			}
-			if (pbr.metallic_roughness_texture.texture) {
-				std::string mrPath = resolveTextureUri(pbr.metallic_roughness_texture.texture, baseDir);
-				info.metallicTexturePath = mrPath;
-				info.roughnessTexturePath = mrPath;
+		// Images in buffer views are read in place, so the buffers have to be resident before
+		// texture decoding starts. For a .glb this just points buffer 0 at the BIN chunk that
+		// cgltf_parse_file already holds in memory.
+		for (cgltf_size i = 0; i < data_->images_count; i++) {
+			if (data_->images[i].buffer_view) {
+				loadBuffers();
+				break;
 			}
 		}
-		if (mat.normal_texture.texture) {
-			info.normalTexturePath = resolveTextureUri(mat.normal_texture.texture, baseDir);
+
+		std::cout << "[Spell] glTF: Loaded " << materials_.size() << " material(s) from " << filepath << std::endl;
+	}
+
+	~Session() override {
+		if (data_) cgltf_free(data_);
+	}
+
+	const std::vector<MaterialInfo>& materials() const override { return materials_; }
+	ModelLoadResult load() override;
+	bool readEmbeddedImage(const std::string& path, std::vector<unsigned char>& scratch,
+		EmbeddedImage& out) const override;
+
+private:
+	void loadBuffers() {
+		if (buffersLoaded_) return;
+		cgltf_result loadResult = cgltf_load_buffers(&options_, data_, filepath_.c_str());
+		if (loadResult != cgltf_result_success) {
+			throw std::runtime_error("[Spell] glTF: Failed to load buffers: " + filepath_);
 		}
+		buffersLoaded_ = true;
+	}
 
-		result.materials.push_back(info);
+	GltfModelLoader& loader_;
+	std::string filepath_;
+	std::string baseDir_;
+	cgltf_options options_{};
+	cgltf_data* data_ = nullptr;
+	bool buffersLoaded_ = false;
+	bool geometryLoaded_ = false;
+	std::vector<MaterialInfo> materials_;
+};
+
+std::unique_ptr<IModelLoadSession> GltfModelLoader::open(const std::string& filepath) {
+	return std::make_unique<Session>(*this, filepath);
+}
+
+ModelLoadResult GltfModelLoader::Session::load() {
+	if (geometryLoaded_) {
+		throw std::runtime_error("[Spell] glTF: Session already loaded: " + filepath_);
 	}
+	geometryLoaded_ = true;
+	loadBuffers();
 
-	std::cout << "[Spell] glTF: Loaded " << result.materials.size() << " material(s) from " << filepath << std::endl;
+	const cgltf_data* data = data_;
+	const std::string& baseDir = baseDir_;
+	ModelLoadResult result;
+	result.materials = materials_;
+
+	// Reserve the final buffer sizes up front. Every mesh is stored at most once,
+	// so the sum over all meshes is an upper bound.
+	{
+		size_t vertexCount = 0, indexCount = 0;
+		for (cgltf_size m = 0; m < data->meshes_count; m++) {
+			const cgltf_mesh& mesh = data->meshes[m];
+			for (cgltf_size p = 0; p < mesh.primitives_count; p++) {
+				const cgltf_primitive& prim = mesh.primitives[p];
+				if (prim.type != cgltf_primitive_type_triangles) continue;
+				for (cgltf_size a = 0; a < prim.attributes_count; a++) {
+					if (prim.attributes[a].type == cgltf_attribute_type_position) {
+						vertexCount += prim.attributes[a].data->count;
+						indexCount += prim.indices ? prim.indices->count : prim.attributes[a].data->count;
+						break;
+					}
+				}
+			}
+		}
+		result.vertices.reserve(vertexCount);
+		result.indices.reserve(indexCount);
+	}
 
-	// Process scene nodes
+	// Process scene nodes: unique meshes are emitted on first use, every node
+	// referencing a mesh becomes an instance with its world transform
+	std::vector<int> meshIndexMap(data->meshes_count, -1);
+	const glm::mat4 identity(1.0f);
 	if (data->scene) {
 		for (cgltf_size i = 0; i < data->scene->nodes_count; i++) {
-			processNode(data, data->scene->nodes[i], result, baseDir);
+			loader_.processNode(data, data->scene->nodes[i], identity, meshIndexMap, result, baseDir);
 		}
 	} else if (data->scenes_count > 0) {
 		for (cgltf_size i = 0; i < data->scenes[0].nodes_count; i++) {
-			processNode(data, data->scenes[0].nodes[i], result, baseDir);
+			loader_.processNode(data, data->scenes[0].nodes[i], identity, meshIndexMap, result, baseDir);
 		}
 	} else {
-		// No scene, process all meshes directly
+		// No scene, place every mesh once at the origin
 		for (cgltf_size i = 0; i < data->meshes_count; i++) {
-			processMesh(data, &data->meshes[i], result, baseDir);
+			uint32_t meshIndex = loader_.emitMesh(data, &data->meshes[i], meshIndexMap, result, baseDir);
+			result.instances.push_back({ meshIndex, identity });
 		}
 	}
 
-	cgltf_free(data);
+	// The document stays alive with the session: embedded images are decoded straight
+	// out of its buffers, possibly while this geometry is being uploaded
+	groupByMaterial(result);
 
 	std::cout << "[Spell] glTF: " << result.vertices.size() << " vertices, "
-		<< result.indices.size() << " indices" << std::endl;
+		<< result.indices.size() << " indices, " << result.meshes.size() << " unique mesh(es), "
+		<< result.instances.size() << " instance(s)" << std::endl;
 
 	return result;
 }
 
-void GltfModelLoader::processNode(const cgltf_data* data, const cgltf_node* node,
-	ModelLoadResult& result, const std::string& baseDir) {
+bool GltfModelLoader::Session::readEmbeddedImage(const std::string& path, std::vector<unsigned char>& scratch,
+	EmbeddedImage& out) const {
+	const std::string prefix = makeEmbeddedImagePath(filepath_, 0);
+	const size_t indexPos = prefix.size() - 1;
+	if (path.size() <= indexPos || path.compare(0, indexPos, prefix, 0, indexPos) != 0) return false;
+
+	size_t imageIndex = 0;
+	try {
+		imageIndex = static_cast<size_t>(std::stoull(path.substr(indexPos)));
+	} catch (const std::exception&) {
+		return false;
+	}
+	if (imageIndex >= data_->images_count) return false;
+	const cgltf_image& image = data_->images[imageIndex];
+
+	if (image.buffer_view) {
+		const cgltf_buffer_view* view = image.buffer_view;
+		const uint8_t* bytes = view->data ? static_cast<const uint8_t*>(view->data)
+			: view->buffer && view->buffer->data ? static_cast<const uint8_t*>(view->buffer->data) + view->offset
+			: nullptr;
+		if (!bytes) return false;
+		out.data = bytes;
+		out.size = view->size;
+		return true;
+	}
+
+	if (image.uri) {
+		const char* comma = std::strstr(image.uri, ";base64,");
+		if (std::strncmp(image.uri, "data:", 5) != 0 || !comma) return false;
+		const char* payload = comma + 8;
+		if (!decodeBase64(payload, std::strlen(payload), scratch)) return false;
+		out.data = scratch.data();
+		out.size = scratch.size();
+		return true;
+	}
+	return false;
+}
+
+void GltfModelLoader::processNode(const cgltf_data* data, const cgltf_node* node, const glm::mat4& parentWorld,
+	std::vector<int>& meshIndexMap, ModelLoadResult& result, const std::string& baseDir) {
+	float local[16];
+	cgltf_node_transform_local(node, local);
+	glm::mat4 world = parentWorld * glm::make_mat4(local);
+
 	if (node->mesh) {
-		processMesh(data, node->mesh, result, baseDir);
+		uint32_t meshIndex = emitMesh(data, node->mesh, meshIndexMap, result, baseDir);
+		result.instances.push_back({ meshIndex, world });
 	}
 	for (cgltf_size i = 0; i < node->children_count; i++) {
-		processNode(data, node->children[i], result, baseDir);
+		processNode(data, node->children[i], world, meshIndexMap, result, baseDir);
+	}
+}
+
+uint32_t GltfModelLoader::emitMesh(const cgltf_data* data, const cgltf_mesh* mesh,
+	std::vector<int>& meshIndexMap, ModelLoadResult& result, const std::string& baseDir) {
+	size_t gltfIndex = static_cast<size_t>(mesh - data->meshes);
+	if (meshIndexMap[gltfIndex] >= 0) {
+		return static_cast<uint32_t>(meshIndexMap[gltfIndex]);
 	}
+
+	MeshRange range;
+	range.firstIndex = static_cast<uint32_t>(result.indices.size());
+	processMesh(data, mesh, result, baseDir);
+	range.indexCount = static_cast<uint32_t>(result.indices.size()) - range.firstIndex;
+
+	meshIndexMap[gltfIndex] = static_cast<int>(result.meshes.size());
+	result.meshes.push_back(range);
+	return static_cast<uint32_t>(result.meshes.size() - 1);
 }
 
 void GltfModelLoader::processMesh(const cgltf_data* data, const cgltf_mesh* mesh,
@@ -118,16 +359,7 @@ void GltfModelLoader::processMesh(const cgltf_data* data, const cgltf_mesh* mesh
 
 		if (prim.type != cgltf_primitive_type_triangles) continue;
 
-		// Find material index
-		int materialIndex = -1;
-		if (prim.material) {
-			for (cgltf_size mi = 0; mi < data->materials_count; mi++) {
-				if (&data->materials[mi] == prim.material) {
-					materialIndex = static_cast<int>(mi);
-					break;
-				}
-			}
-		}
+		int materialIndex = prim.material ? static_cast<int>(prim.material - data->materials) : -1;
 
 		// Find accessors
 		const cgltf_accessor* posAcc = nullptr;
@@ -146,86 +378,76 @@ void GltfModelLoader::processMesh(const cgltf_data* data, const cgltf_mesh* mesh
 
 		if (!posAcc) continue;
 
-		uint32_t baseVertex = static_cast<uint32_t>(result.vertices.size());
+		const size_t vertexCount = posAcc->count;
+		const uint32_t baseVertex = static_cast<uint32_t>(result.vertices.size());
 
-		// Read vertices
-		for (cgltf_size vi = 0; vi < posAcc->count; vi++) {
-			Vertex vertex{};
-			float buf[3];
+		// Unpack whole attribute streams. Missing or short normal/uv streams keep their
+		// defaults for the remaining vertices, matching the old per-vertex reads.
+		std::vector<float> positions, normals(vertexCount * 3), texCoords(vertexCount * 2, 0.0f);
+		for (size_t vi = 0; vi < vertexCount; vi++) {
+			normals[vi * 3 + 0] = 0.0f;
+			normals[vi * 3 + 1] = 0.0f;
+			normals[vi * 3 + 2] = 1.0f;
+		}
 
-			if (accessorReadFloat(posAcc, vi, buf, 3)) {
-				vertex.pos = toVec3(buf);
-			}
-			if (accessorReadFloat(normalAcc, vi, buf, 3)) {
-				vertex.normal = toVec3(buf);
+		if (!unpackFloatStream(posAcc, vertexCount, 3, positions)) {
+			positions.assign(vertexCount * 3, 0.0f);
+			for (size_t vi = 0; vi < vertexCount; vi++) accessorReadFloat(posAcc, vi, &positions[vi * 3], 3);
+		}
+		if (normalAcc) {
+			size_t n = std::min<size_t>(vertexCount, normalAcc->count);
+			std::vector<float> stream;
+			if (unpackFloatStream(normalAcc, n, 3, stream)) {
+				std::memcpy(normals.data(), stream.data(), stream.size() * sizeof(float));
 			} else {
-				vertex.normal = { 0.0f, 0.0f, 1.0f };
+				for (size_t vi = 0; vi < n; vi++) {
+					float buf[3];
+					if (accessorReadFloat(normalAcc, vi, buf, 3)) std::memcpy(&normals[vi * 3], buf, sizeof(buf));
+				}
 			}
-			float uv[2] = { 0.0f, 0.0f };
-			if (accessorReadFloat(texCoordAcc, vi, uv, 2)) {
-				vertex.texCoord = toVec2(uv);
+		}
+		if (texCoordAcc) {
+			size_t n = std::min<size_t>(vertexCount, texCoordAcc->count);
+			std::vector<float> stream;
+			if (unpackFloatStream(texCoordAcc, n, 2, stream)) {
+				std::memcpy(texCoords.data(), stream.data(), stream.size() * sizeof(float));
+			} else {
+				for (size_t vi = 0; vi < n; vi++) {
+					float uv[2];
+					if (accessorReadFloat(texCoordAcc, vi, uv, 2)) std::memcpy(&texCoords[vi * 2], uv, sizeof(uv));
+				}
 			}
+		}
 
-			vertex.color = { 1.0f, 1.0f, 1.0f };
-			vertex.materialIndex = materialIndex;
-
-			result.vertices.push_back(vertex);
+		// Branch-free assembly from flat streams
+		result.vertices.resize(baseVertex + vertexCount);
+		Vertex* dst = result.vertices.data() + baseVertex;
+		const float* pos = positions.data();
+		const float* nrm = normals.data();
+		const float* uv = texCoords.data();
+		for (size_t vi = 0; vi < vertexCount; vi++) {
+			Vertex& v = dst[vi];
+			v.pos = { pos[vi * 3 + 0], pos[vi * 3 + 1], pos[vi * 3 + 2] };
+			v.color = { 1.0f, 1.0f, 1.0f };
+			v.texCoord = { uv[vi * 2 + 0], uv[vi * 2 + 1] };
+			v.normal = { nrm[vi * 3 + 0], nrm[vi * 3 + 1], nrm[vi * 3 + 2] };
+			v.materialIndex = materialIndex;
 		}
 
 		// Read indices
+		size_t indexBase = result.indices.size();
 		if (prim.indices) {
-			for (cgltf_size ii = 0; ii < prim.indices->count; ii++) {
-				uint32_t idx = static_cast<uint32_t>(cgltf_accessor_read_index(prim.indices, ii));
-				result.indices.push_back(baseVertex + idx);
-			}
+			result.indices.resize(indexBase + prim.indices->count);
+			unpackIndices(prim.indices, baseVertex, result.indices.data() + indexBase);
 		} else {
 			// Non-indexed: generate sequential indices
-			for (cgltf_size vi = 0; vi < posAcc->count; vi++) {
-				result.indices.push_back(baseVertex + static_cast<uint32_t>(vi));
-			}
-		}
-	}
-}
-
-std::vector<MaterialInfo> GltfModelLoader::preParseTexturePaths(const std::string& filepath) {
-	cgltf_options options{};
-	cgltf_data* data = nullptr;
-
-	cgltf_result parseResult = cgltf_parse_file(&options, filepath.c_str(), &data);
-	if (parseResult != cgltf_result_success) {
-		return {};
-	}
-
-	std::string baseDir = std::filesystem::path(filepath).parent_path().string();
-	if (baseDir.empty()) baseDir = ".";
-
-	std::vector<MaterialInfo> result;
-	for (cgltf_size i = 0; i < data->materials_count; i++) {
-		const cgltf_material& mat = data->materials[i];
-		MaterialInfo info{};
-
-		if (mat.has_pbr_metallic_roughness) {
-			const auto& pbr = mat.pbr_metallic_roughness;
-			if (pbr.base_color_texture.texture) {
-				info.diffuseTexturePath = resolveTextureUri(pbr.base_color_texture.texture, baseDir);
-			}
-			if (pbr.metallic_roughness_texture.texture) {
-				std::string mrPath = resolveTextureUri(pbr.metallic_roughness_texture.texture, baseDir);
-				info.metallicTexturePath = mrPath;
-				info.roughnessTexturePath = mrPath;
+			result.indices.resize(indexBase + vertexCount);
+			uint32_t* out = result.indices.data() + indexBase;
+			for (size_t vi = 0; vi < vertexCount; vi++) {
+				out[vi] = baseVertex + static_cast<uint32_t>(vi);
 			}
 		}
-		if (mat.normal_texture.texture) {
-			info.normalTexturePath = resolveTextureUri(mat.normal_texture.texture, baseDir);
-		}
-
-		result.push_back(info);
 	}
-
-	cgltf_free(data);
-
-	std::cout << "[Spell] glTF: Pre-parsed " << result.size() << " material(s) for texture paths" << std::endl;
-	return result;
 }
 
 } // namespace Spell
@@ -6,18 +6,25 @@ namespace Spell {
 
 class GltfModelLoader : public IModelLoader {
 public:
-	ModelLoadResult load(const std::string& filepath) override;
-	std::vector<MaterialInfo> preParseTexturePaths(const std::string& filepath) override;
+	std::unique_ptr<IModelLoadSession> open(const std::string& filepath) override;
 	std::vector<std::string> supportedExtensions() const override {
 		return { ".gltf", ".glb" };
 	}
+	uint32_t outputVersion() const override { return 1; }
 
 private:
-	void processNode(const struct cgltf_data* data, const struct cgltf_node* node,
-		ModelLoadResult& result, const std::string& baseDir);
+	class Session;
+
+	void processNode(const struct cgltf_data* data, const struct cgltf_node* node, const glm::mat4& parentWorld,
+		std::vector<int>& meshIndexMap, ModelLoadResult& result, const std::string& baseDir);
+	// Appends the mesh geometry once and returns its index in result.meshes
+	uint32_t emitMesh(const struct cgltf_data* data, const struct cgltf_mesh* mesh,
+		std::vector<int>& meshIndexMap, ModelLoadResult& result, const std::string& baseDir);
 	void processMesh(const struct cgltf_data* data, const struct cgltf_mesh* mesh,
 		ModelLoadResult& result, const std::string& baseDir);
-	std::string resolveTextureUri(const struct cgltf_texture* texture, const std::string& baseDir);
+	// File path for external images, an embedded image path for buffer views and data: URIs
+	std::string resolveTextureUri(const struct cgltf_data* data, const struct cgltf_texture* texture,
+		const std::string& filepath, const std::string& baseDir);
 };
 
 } // namespace Spell
@@ -11,19 +11,89 @@ struct ModelLoadResult {
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 	std::vector<MaterialInfo> materials;
+
+	// Optional scene instancing: unique meshes stored once, placed by instances.
+	// Left empty by loaders that flatten everything into world space.
+	std::vector<MeshRange> meshes;
+	std::vector<MeshInstance> instances;
+
+	// Triangles grouped by material inside every mesh (see MaterialRanges)
+	std::vector<MaterialRange> materialRanges;
+
+	ModelGeometryView view() const {
+		ModelGeometryView v;
+		v.vertices = vertices.data();
+		v.vertexCount = static_cast<uint32_t>(vertices.size());
+		v.indices = indices.data();
+		v.indexCount = static_cast<uint32_t>(indices.size());
+		v.meshes = meshes.data();
+		v.meshCount = static_cast<uint32_t>(meshes.size());
+		v.instances = instances.data();
+		v.instanceCount = static_cast<uint32_t>(instances.size());
+		v.materialRanges = materialRanges.data();
+		v.materialRangeCount = static_cast<uint32_t>(materialRanges.size());
+		return v;
+	}
+};
+
+// Encoded image bytes (PNG, JPEG, ...) stored inside a model file
+struct EmbeddedImage {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
+
+// Texture paths for images that are not separate files: "<model path>#image:<index>".
+// They show up in MaterialInfo like any other path and are read through the session.
+inline std::string makeEmbeddedImagePath(const std::string& modelPath, size_t imageIndex) {
+	return modelPath + "#image:" + std::to_string(imageIndex);
+}
+
+inline bool isEmbeddedImagePath(const std::string& path) {
+	return path.find("#image:") != std::string::npos;
+}
+
+// A model file opened for loading. The document and its material table are parsed once:
+// materials() is available as soon as the session is open, so texture decoding can start,
+// and load() then extracts geometry from the same in-memory document.
+class IModelLoadSession {
+public:
+	virtual ~IModelLoadSession() = default;
+
+	virtual const std::vector<MaterialInfo>& materials() const = 0;
+
+	// Extracts the geometry. Call at most once.
+	virtual ModelLoadResult load() = 0;
+
+	// Resolves an embedded image path from materials(). Bytes that sit in the file's buffers are
+	// returned in place; base64 data: URIs are decoded into `scratch`. Thread-safe, and the
+	// returned memory stays valid until the session is destroyed.
+	virtual bool readEmbeddedImage(const std::string& /*path*/, std::vector<unsigned char>& /*scratch*/,
+		EmbeddedImage& /*out*/) const {
+		return false;
+	}
 };
 
 class IModelLoader {
 public:
 	virtual ~IModelLoader() = default;
 
-	virtual ModelLoadResult load(const std::string& filepath) = 0;
+	// Throws std::runtime_error if the file cannot be opened or parsed
+	virtual std::unique_ptr<IModelLoadSession> open(const std::string& filepath) = 0;
 
-	virtual std::vector<MaterialInfo> preParseTexturePaths(const std::string& filepath) {
-		return {};
+	// Opens the file and extracts geometry in one go
+	ModelLoadResult load(const std::string& filepath) {
+		return open(filepath)->load();
 	}
 
 	virtual std::vector<std::string> supportedExtensions() const = 0;
+
+	// Version of this loader's output, stored in mesh cache entries. Bump it whenever the loader
+	// produces different data for the same source file, so entries written by older code are rebuilt.
+	virtual uint32_t outputVersion() const = 0;
+
+	// Hash of the loader settings that change its output (0 when there are none). Cache entries
+	// written with different settings are rebuilt.
+	virtual uint64_t outputSettingsHash() const { return 0; }
 };
 
 } // namespace Spell
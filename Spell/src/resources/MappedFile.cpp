@@ -0,0 +1,123 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+#include <utility>
+
+namespace Spell {
+
+MappedFile::MappedFile(const std::string& path) {
+	open(path);
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		data_ = std::exchange(other.data_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+		opened_ = std::exchange(other.opened_, false);
+#ifdef _WIN32
+		fileHandle_ = std::exchange(other.fileHandle_, nullptr);
+		mappingHandle_ = std::exchange(other.mappingHandle_, nullptr);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+#ifdef _WIN32
+	std::wstring widePath = std::filesystem::u8path(path).wstring();
+	HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle_ = file;
+	size_ = static_cast<size_t>(fileSize.QuadPart);
+	opened_ = true;
+	if (size_ == 0) return true; // Empty files cannot be mapped, but are valid
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		close();
+		return false;
+	}
+	mappingHandle_ = mapping;
+
+	data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data_) {
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st{};
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	size_ = static_cast<size_t>(st.st_size);
+	opened_ = true;
+	if (size_ > 0) {
+		void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			::close(fd);
+			close();
+			return false;
+		}
+		madvise(mapped, size_, MADV_SEQUENTIAL);
+		data_ = mapped;
+	}
+	::close(fd);
+#endif
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (data_) UnmapViewOfFile(data_);
+	if (mappingHandle_) CloseHandle(static_cast<HANDLE>(mappingHandle_));
+	if (fileHandle_) CloseHandle(static_cast<HANDLE>(fileHandle_));
+	mappingHandle_ = nullptr;
+	fileHandle_ = nullptr;
+#else
+	if (data_) munmap(data_, size_);
+#endif
+	data_ = nullptr;
+	size_ = 0;
+	opened_ = false;
+}
+
+} // namespace Spell
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Spell {
+
+// Read-only memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+// The view stays valid until the object is destroyed or moved from.
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return opened_; }
+	const char* data() const { return static_cast<const char*>(data_); }
+	size_t size() const { return size_; }
+
+private:
+	void* data_ = nullptr;
+	size_t size_ = 0;
+	bool opened_ = false;
+#ifdef _WIN32
+	void* fileHandle_ = nullptr;
+	void* mappingHandle_ = nullptr;
+#endif
+};
+
+} // namespace Spell
@@ -0,0 +1,76 @@
+#include "MaterialRanges.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Spell {
+
+void groupByMaterial(ModelLoadResult& result) {
+	result.materialRanges.clear();
+	std::vector<MeshRange> ranges = result.meshes;
+	if (ranges.empty()) {
+		ranges.push_back({ 0, static_cast<uint32_t>(result.indices.size()) });
+	}
+
+	// Counting sort per range; bucket 0 holds triangles without a material (-1)
+	std::vector<uint32_t> sorted;
+	std::vector<uint32_t> bucketStart;
+	for (const MeshRange& range : ranges) {
+		const uint32_t triangleCount = range.indexCount / 3;
+		uint32_t* triangles = result.indices.data() + range.firstIndex;
+		auto bucketOf = [&](uint32_t t) {
+			return static_cast<uint32_t>(std::max(result.vertices[triangles[t * 3]].materialIndex, -1) + 1);
+		};
+
+		uint32_t bucketCount = 0;
+		bool grouped = true;
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			const uint32_t bucket = bucketOf(t);
+			bucketCount = std::max(bucketCount, bucket + 1);
+			grouped &= t == 0 || bucket >= bucketOf(t - 1);
+		}
+
+		if (!grouped) {
+			bucketStart.assign(bucketCount + 1, 0);
+			for (uint32_t t = 0; t < triangleCount; t++) bucketStart[bucketOf(t) + 1]++;
+			for (uint32_t b = 0; b < bucketCount; b++) bucketStart[b + 1] += bucketStart[b];
+
+			sorted.resize(static_cast<size_t>(triangleCount) * 3);
+			for (uint32_t t = 0; t < triangleCount; t++) {
+				const uint32_t dst = bucketStart[bucketOf(t)]++ * 3;
+				sorted[dst + 0] = triangles[t * 3 + 0];
+				sorted[dst + 1] = triangles[t * 3 + 1];
+				sorted[dst + 2] = triangles[t * 3 + 2];
+			}
+			std::copy(sorted.begin(), sorted.end(), triangles);
+		}
+
+		collectMaterialRanges(result.vertices.data(), result.indices.data(), range.firstIndex,
+			triangleCount * 3, result.materialRanges);
+	}
+}
+
+void collectMaterialRanges(const Vertex* vertices, const uint32_t* indices, uint32_t firstIndex,
+	uint32_t indexCount, std::vector<MaterialRange>& out) {
+	const uint32_t end = firstIndex + indexCount - indexCount % 3;
+	for (uint32_t i = firstIndex; i < end; i += 3) {
+		const int32_t material = vertices[indices[i]].materialIndex;
+		if (i == firstIndex || material != out.back().materialIndex) {
+			MaterialRange range;
+			range.firstIndex = i;
+			range.materialIndex = material;
+			range.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+			range.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+			out.push_back(range);
+		}
+
+		MaterialRange& range = out.back();
+		range.indexCount += 3;
+		for (uint32_t c = 0; c < 3; c++) {
+			range.boundsMin = glm::min(range.boundsMin, vertices[indices[i + c]].pos);
+			range.boundsMax = glm::max(range.boundsMax, vertices[indices[i + c]].pos);
+		}
+	}
+}
+
+} // namespace Spell
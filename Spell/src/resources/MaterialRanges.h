@@ -0,0 +1,21 @@
+#pragma once
+
+#include "IModelLoader.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Sorts the triangles inside every MeshRange (or the whole buffer for flat models) by material,
+// keeping their order within a material, and fills result.materialRanges with one range per
+// (mesh, material). Loaders call this last, so meshes, instances and vertices are unchanged.
+void groupByMaterial(ModelLoadResult& result);
+
+// Appends one MaterialRange per run of same-material triangles in indices[firstIndex,
+// firstIndex + indexCount), bounded by the vertices of that run. A triangle's material is the
+// one of its first vertex.
+void collectMaterialRanges(const Vertex* vertices, const uint32_t* indices, uint32_t firstIndex,
+	uint32_t indexCount, std::vector<MaterialRange>& out);
+
+} // namespace Spell
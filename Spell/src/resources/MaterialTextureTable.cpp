@@ -0,0 +1,37 @@
+#include "MaterialTextureTable.h"
+
+#include <cstring>
+
+namespace Spell {
+
+MaterialTextureTable::MaterialTextureTable(SpellDevice& device, const std::vector<uint32_t>& entries)
+	: device_{ device }, entries_{ entries } {
+	// A storage buffer binding cannot be empty
+	if (entries_.empty()) entries_.assign(4, 0);
+	size_ = sizeof(uint32_t) * entries_.size();
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	device_.createBuffer(size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(device_.device(), stagingBufferMemory, 0, size_, 0, &mapped);
+	memcpy(mapped, entries_.data(), static_cast<size_t>(size_));
+	vkUnmapMemory(device_.device(), stagingBufferMemory);
+
+	device_.createBuffer(size_, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer_, memory_);
+	device_.copyBuffer(stagingBuffer, buffer_, size_);
+
+	vkDestroyBuffer(device_.device(), stagingBuffer, nullptr);
+	vkFreeMemory(device_.device(), stagingBufferMemory, nullptr);
+}
+
+MaterialTextureTable::~MaterialTextureTable() {
+	vkDestroyBuffer(device_.device(), buffer_, nullptr);
+	vkFreeMemory(device_.device(), memory_, nullptr);
+}
+
+} // namespace Spell
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/SpellDevice.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Storage buffer that maps material texture slots to the bindless texture array: entry
+// (materialIndex + 1) * 4 + role holds the texture index of that slot (role: diffuse, normal,
+// metallic, roughness; entries 0..3 serve geometry without a material). shader.frag reads it
+// at binding 1, so slots without an image can all point at the shared fallback textures.
+class MaterialTextureTable {
+public:
+	MaterialTextureTable(SpellDevice& device, const std::vector<uint32_t>& entries);
+	~MaterialTextureTable();
+
+	MaterialTextureTable(const MaterialTextureTable&) = delete;
+	MaterialTextureTable& operator=(const MaterialTextureTable&) = delete;
+
+	VkBuffer getBuffer() const { return buffer_; }
+	VkDeviceSize getSize() const { return size_; }
+	const std::vector<uint32_t>& getEntries() const { return entries_; }
+
+private:
+	SpellDevice& device_;
+	std::vector<uint32_t> entries_;
+	VkBuffer buffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory memory_ = VK_NULL_HANDLE;
+	VkDeviceSize size_ = 0;
+};
+
+} // namespace Spell
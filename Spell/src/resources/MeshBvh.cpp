@@ -0,0 +1,543 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPELL_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace Spell {
+
+namespace {
+
+constexpr uint32_t SAH_BINS = 16;
+constexpr uint32_t PARALLEL_MIN_TRIANGLES = 16384; // smaller subtrees are built on the spawning thread
+constexpr uint32_t SAH_MAX_DEPTH = 64;             // deeper nodes split at the median, bounding the depth
+constexpr uint32_t STACK_SIZE = 128;               // SAH_MAX_DEPTH + 32 median levels, with room to spare
+
+struct Aabb {
+	glm::vec3 min{ std::numeric_limits<float>::max() };
+	glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+	void grow(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+	void grow(const Aabb& b) {
+		min = glm::min(min, b.min);
+		max = glm::max(max, b.max);
+	}
+	float halfArea() const {
+		const glm::vec3 d = max - min;
+		return d.x < 0.0f ? 0.0f : d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+};
+
+// Triangle bounds during the build; `ref` indexes the gathered triangles
+struct BuildPrim {
+	Aabb bounds;
+	uint32_t ref;
+
+	glm::vec3 centroid() const { return (bounds.min + bounds.max) * 0.5f; }
+};
+
+class Builder {
+public:
+	explicit Builder(std::vector<BuildPrim>& prims) : prims_(prims) {}
+
+	// Appends the subtree over prims_[begin, end) to `out`. Leaf offsets are prim indices until
+	// the blocks are assigned; inner offsets are indices into `out`.
+	void build(uint32_t begin, uint32_t end, uint32_t depth, uint32_t taskDepth, std::vector<BvhNode>& out) {
+		const uint32_t index = static_cast<uint32_t>(out.size());
+		out.push_back({});
+
+		Aabb bounds, centroids;
+		for (uint32_t i = begin; i < end; i++) {
+			bounds.grow(prims_[i].bounds);
+			centroids.grow(prims_[i].centroid());
+		}
+		out[index].boundsMin = bounds.min;
+		out[index].boundsMax = bounds.max;
+
+		const uint32_t count = end - begin;
+		if (count <= MeshBvh::LEAF_SIZE) {
+			out[index].offset = begin;
+			out[index].count = count;
+			return;
+		}
+
+		const uint32_t mid = depth < SAH_MAX_DEPTH ? splitSah(begin, end, centroids) : splitMedian(begin, end, centroids);
+		if (taskDepth > 0 && count >= PARALLEL_MIN_TRIANGLES) {
+			// The right half goes to a worker; its nodes are spliced in after the left half
+			std::vector<BvhNode> right;
+			auto task = std::async(std::launch::async, [&]() { build(mid, end, depth + 1, taskDepth - 1, right); });
+			build(begin, mid, depth + 1, taskDepth - 1, out);
+			task.get();
+
+			const uint32_t base = static_cast<uint32_t>(out.size());
+			for (BvhNode node : right) {
+				if (node.count == 0) node.offset += base;
+				out.push_back(node);
+			}
+			out[index].offset = base;
+		} else {
+			build(begin, mid, depth + 1, 0, out);
+			out[index].offset = static_cast<uint32_t>(out.size());
+			build(mid, end, depth + 1, 0, out);
+		}
+	}
+
+private:
+	// Binned SAH over all three axes; returns the partition point (never empty on either side)
+	uint32_t splitSah(uint32_t begin, uint32_t end, const Aabb& centroids) {
+		const glm::vec3 extent = centroids.max - centroids.min;
+		if (extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f) {
+			return begin + (end - begin) / 2; // all centroids coincide, any split is as good
+		}
+
+		struct Bin {
+			Aabb bounds;
+			uint32_t count = 0;
+		};
+		std::array<std::array<Bin, SAH_BINS>, 3> bins{};
+		glm::vec3 scale;
+		for (int a = 0; a < 3; a++) {
+			scale[a] = extent[a] > 0.0f ? static_cast<float>(SAH_BINS) / extent[a] : 0.0f;
+		}
+		auto binOf = [&](const glm::vec3& c, int a) {
+			return std::min(SAH_BINS - 1, static_cast<uint32_t>((c[a] - centroids.min[a]) * scale[a]));
+		};
+
+		for (uint32_t i = begin; i < end; i++) {
+			const glm::vec3 c = prims_[i].centroid();
+			for (int a = 0; a < 3; a++) {
+				Bin& bin = bins[a][binOf(c, a)];
+				bin.bounds.grow(prims_[i].bounds);
+				bin.count++;
+			}
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		int bestAxis = -1;
+		uint32_t bestBin = 0;
+		for (int a = 0; a < 3; a++) {
+			if (extent[a] <= 0.0f) continue;
+
+			// rightCost[b]: cost of bins (b, SAH_BINS) on the right side
+			std::array<float, SAH_BINS> rightCost{};
+			Aabb right;
+			uint32_t rightCount = 0;
+			for (uint32_t b = SAH_BINS - 1; b > 0; b--) {
+				right.grow(bins[a][b].bounds);
+				rightCount += bins[a][b].count;
+				rightCost[b - 1] = rightCount > 0 ? right.halfArea() * rightCount : -1.0f;
+			}
+
+			Aabb left;
+			uint32_t leftCount = 0;
+			for (uint32_t b = 0; b < SAH_BINS - 1; b++) {
+				left.grow(bins[a][b].bounds);
+				leftCount += bins[a][b].count;
+				if (leftCount == 0 || rightCost[b] < 0.0f) continue;
+				const float cost = left.halfArea() * leftCount + rightCost[b];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = a;
+					bestBin = b;
+				}
+			}
+		}
+		if (bestAxis < 0) return splitMedian(begin, end, centroids);
+
+		auto it = std::partition(prims_.begin() + begin, prims_.begin() + end,
+			[&](const BuildPrim& p) { return binOf(p.centroid(), bestAxis) <= bestBin; });
+		return static_cast<uint32_t>(it - prims_.begin());
+	}
+
+	// Object median along the longest centroid axis
+	uint32_t splitMedian(uint32_t begin, uint32_t end, const Aabb& centroids) {
+		const glm::vec3 extent = centroids.max - centroids.min;
+		const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		const uint32_t mid = begin + (end - begin) / 2;
+		std::nth_element(prims_.begin() + begin, prims_.begin() + mid, prims_.begin() + end,
+			[axis](const BuildPrim& a, const BuildPrim& b) { return a.centroid()[axis] < b.centroid()[axis]; });
+		return mid;
+	}
+
+	std::vector<BuildPrim>& prims_;
+};
+
+template<typename Fn>
+void parallelRanges(size_t count, size_t minPerWorker, const Fn& fn) {
+	const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+	const size_t workers = std::clamp<size_t>(count / std::max<size_t>(minPerWorker, 1), 1, hw);
+	std::vector<std::future<void>> tasks;
+	for (size_t w = 1; w < workers; w++) {
+		tasks.push_back(std::async(std::launch::async, [&fn, count, workers, w]() {
+			fn(count * w / workers, count * (w + 1) / workers);
+		}));
+	}
+	fn(0, count / workers);
+	for (auto& t : tasks) t.get();
+}
+
+} // namespace
+
+MeshBvh::MeshBvh(const ModelGeometryView& geometry, const std::vector<MaterialRange>& ranges) {
+	auto start = std::chrono::high_resolution_clock::now();
+	rangeCount_ = static_cast<uint32_t>(ranges.size());
+
+	// ========== Triangles of every mesh and their material range ==========
+	// Flat models are one mesh over the whole index buffer, placed once with an identity transform
+	const bool instanced = geometry.instanceCount > 0 && geometry.meshCount > 0;
+	const uint32_t meshCount = instanced ? geometry.meshCount : 1;
+
+	std::vector<uint32_t> rangeOrder(ranges.size());
+	for (uint32_t r = 0; r < rangeOrder.size(); r++) rangeOrder[r] = r;
+	std::sort(rangeOrder.begin(), rangeOrder.end(),
+		[&](uint32_t a, uint32_t b) { return ranges[a].firstIndex < ranges[b].firstIndex; });
+	auto rangeOf = [&](uint32_t index) {
+		auto it = std::upper_bound(rangeOrder.begin(), rangeOrder.end(), index,
+			[&](uint32_t i, uint32_t r) { return i < ranges[r].firstIndex; });
+		if (it == rangeOrder.begin()) return MIXED_RANGES;
+		const MaterialRange& range = ranges[*(it - 1)];
+		return index + 3 <= range.firstIndex + range.indexCount ? *(it - 1) : MIXED_RANGES;
+	};
+
+	struct MeshTriangle {
+		uint32_t triangle;
+		uint32_t range;
+	};
+	std::vector<MeshTriangle> meshTriangles;
+	std::vector<uint32_t> firstMeshTriangle(meshCount + 1, 0);
+	for (uint32_t m = 0; m < meshCount; m++) {
+		firstMeshTriangle[m] = static_cast<uint32_t>(meshTriangles.size());
+		const uint32_t first = instanced ? geometry.meshes[m].firstIndex : 0;
+		const uint32_t count = instanced ? geometry.meshes[m].indexCount : geometry.indexCount;
+		for (uint32_t i = first; i + 3 <= first + count; i += 3) {
+			const uint32_t range = rangeOf(i);
+			if (range != MIXED_RANGES) meshTriangles.push_back({ i / 3, range });
+		}
+	}
+	firstMeshTriangle[meshCount] = static_cast<uint32_t>(meshTriangles.size());
+
+	// ========== Placed triangles ==========
+	struct Placement {
+		uint32_t instance;
+		uint32_t mesh;
+		uint64_t firstTriangle; // into the placed triangles
+	};
+	std::vector<Placement> placements;
+	uint64_t placedCount = 0;
+	for (uint32_t i = 0; i < (instanced ? geometry.instanceCount : 1); i++) {
+		const uint32_t mesh = instanced ? geometry.instances[i].meshIndex : 0;
+		if (mesh >= meshCount || firstMeshTriangle[mesh] == firstMeshTriangle[mesh + 1]) continue;
+		placements.push_back({ i, mesh, placedCount });
+		placedCount += firstMeshTriangle[mesh + 1] - firstMeshTriangle[mesh];
+	}
+	if (placedCount == 0 || placedCount > std::numeric_limits<uint32_t>::max() / LEAF_SIZE) {
+		return;
+	}
+	triangleCount_ = placedCount;
+
+	auto transformOf = [&](uint32_t instance) {
+		return instanced ? geometry.instances[instance].transform : glm::mat4(1.0f);
+	};
+	auto corner = [&](const glm::mat4& transform, uint32_t triangle, uint32_t c) {
+		return glm::vec3(transform * glm::vec4(geometry.vertices[geometry.indices[triangle * 3 + c]].pos, 1.0f));
+	};
+
+	std::vector<TriangleRef> placed(placedCount);
+	std::vector<BuildPrim> prims(placedCount);
+	parallelRanges(placedCount, 1 << 15, [&](size_t begin, size_t end) {
+		auto it = std::upper_bound(placements.begin(), placements.end(), static_cast<uint64_t>(begin),
+			[](uint64_t t, const Placement& p) { return t < p.firstTriangle; }) - 1;
+		glm::mat4 transform = transformOf(it->instance);
+		for (size_t t = begin; t < end; t++) {
+			if (it + 1 != placements.end() && t >= (it + 1)->firstTriangle) {
+				++it;
+				transform = transformOf(it->instance);
+			}
+			const MeshTriangle& source = meshTriangles[firstMeshTriangle[it->mesh] + (t - it->firstTriangle)];
+			placed[t] = { source.triangle, it->instance, source.range };
+			prims[t].ref = static_cast<uint32_t>(t);
+			for (uint32_t c = 0; c < 3; c++) {
+				prims[t].bounds.grow(corner(transform, source.triangle, c));
+			}
+		}
+	});
+
+	// ========== SAH build ==========
+	// Two tasks per level until every hardware thread has a subtree
+	uint32_t taskDepth = 0;
+	while ((1u << taskDepth) < std::max(1u, std::thread::hardware_concurrency()) && taskDepth < 8) taskDepth++;
+	Builder(prims).build(0, static_cast<uint32_t>(placedCount), 0, taskDepth, nodes_);
+
+	// ========== Leaf blocks ==========
+	std::vector<uint32_t> leaves;
+	for (uint32_t n = 0; n < nodes_.size(); n++) {
+		if (nodes_[n].count > 0) leaves.push_back(n);
+	}
+	blocks_.resize(leaves.size());
+	refs_.resize(leaves.size() * LEAF_SIZE, { 0, 0, MIXED_RANGES });
+	parallelRanges(leaves.size(), 1 << 13, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			BvhNode& node = nodes_[leaves[b]];
+			TriangleBlock& block = blocks_[b];
+			std::memset(&block, 0, sizeof(block));
+			for (uint32_t lane = 0; lane < node.count; lane++) {
+				const TriangleRef& ref = placed[prims[node.offset + lane].ref];
+				const glm::mat4 transform = transformOf(ref.instance);
+				const glm::vec3 v0 = corner(transform, ref.triangle, 0);
+				const glm::vec3 e1 = corner(transform, ref.triangle, 1) - v0;
+				const glm::vec3 e2 = corner(transform, ref.triangle, 2) - v0;
+				for (int a = 0; a < 3; a++) {
+					block.v0[a][lane] = v0[a];
+					block.e1[a][lane] = e1[a];
+					block.e2[a][lane] = e2[a];
+				}
+				refs_[b * LEAF_SIZE + lane] = ref;
+			}
+			node.offset = static_cast<uint32_t>(b);
+		}
+	});
+
+	// Children come after their parent, so one backward pass sees them first
+	nodeRanges_.resize(nodes_.size());
+	for (uint32_t n = static_cast<uint32_t>(nodes_.size()); n-- > 0;) {
+		const BvhNode& node = nodes_[n];
+		if (node.count > 0) {
+			uint32_t range = refs_[node.offset * LEAF_SIZE].range;
+			for (uint32_t lane = 1; lane < node.count; lane++) {
+				if (refs_[node.offset * LEAF_SIZE + lane].range != range) range = MIXED_RANGES;
+			}
+			nodeRanges_[n] = range;
+		} else {
+			nodeRanges_[n] = nodeRanges_[n + 1] == nodeRanges_[node.offset] ? nodeRanges_[n + 1] : MIXED_RANGES;
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	buildTimeMs_ = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+uint64_t MeshBvh::getMemoryBytes() const {
+	return sizeof(BvhNode) * nodes_.size() + sizeof(uint32_t) * nodeRanges_.size()
+		+ sizeof(TriangleBlock) * blocks_.size() + sizeof(TriangleRef) * refs_.size();
+}
+
+uint32_t MeshBvh::queryFrustum(const glm::mat4& clip, std::vector<uint8_t>& visibleRanges) const {
+	visibleRanges.assign(rangeCount_, 0);
+	if (nodes_.empty()) return 0;
+
+	// Gribb-Hartmann planes, inside where dot(plane.xyz, p) + plane.w >= 0
+	std::array<glm::vec4, 6> planes;
+	const glm::vec4 row0(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+	const glm::vec4 row1(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+	const glm::vec4 row2(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+	const glm::vec4 row3(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+
+	uint32_t visibleCount = 0;
+	auto markVisible = [&](uint32_t range) {
+		if (range < rangeCount_ && !visibleRanges[range]) {
+			visibleRanges[range] = 1;
+			visibleCount++;
+		}
+	};
+
+	// Each entry carries the planes its box still straddles; a box fully inside a plane
+	// passes that plane for the whole subtree
+	struct Entry {
+		uint32_t node;
+		uint32_t planeMask;
+	};
+	std::array<Entry, STACK_SIZE> stack;
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0x3f };
+	while (stackSize > 0) {
+		const Entry entry = stack[--stackSize];
+		const BvhNode& node = nodes_[entry.node];
+		const uint32_t range = nodeRanges_[entry.node];
+		if (range != MIXED_RANGES && visibleRanges[range]) continue;
+
+		const glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+		const glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+		uint32_t planeMask = entry.planeMask;
+		bool outside = false;
+		for (uint32_t p = 0; p < 6 && !outside; p++) {
+			if (!(planeMask & (1u << p))) continue;
+			const glm::vec3 normal(planes[p]);
+			const float distance = glm::dot(normal, center) + planes[p].w;
+			const float radius = glm::dot(glm::abs(normal), extent);
+			if (distance + radius < 0.0f) outside = true;
+			else if (distance - radius >= 0.0f) planeMask &= ~(1u << p);
+		}
+		if (outside) continue;
+
+		if (range != MIXED_RANGES && planeMask == 0) {
+			markVisible(range);
+		} else if (node.count > 0) {
+			for (uint32_t lane = 0; lane < node.count; lane++) markVisible(refs_[node.offset * LEAF_SIZE + lane].range);
+		} else {
+			stack[stackSize++] = { node.offset, planeMask };
+			stack[stackSize++] = { entry.node + 1, planeMask };
+		}
+	}
+	return visibleCount;
+}
+
+namespace {
+
+// Entry distance of the ray into the box, or infinity if it misses or starts beyond `maxDistance`
+inline float intersectBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance) {
+	const glm::vec3 t0 = (node.boundsMin - origin) * invDirection;
+	const glm::vec3 t1 = (node.boundsMax - origin) * invDirection;
+	const glm::vec3 tMin = glm::min(t0, t1);
+	const glm::vec3 tMax = glm::max(t0, t1);
+	const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	const float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+} // namespace
+
+bool MeshBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, BvhHit& hit, float maxDistance) const {
+	if (nodes_.empty()) return false;
+
+	const glm::vec3 invDirection = 1.0f / direction;
+	float best = maxDistance;
+	uint32_t bestBlock = 0;
+	int bestLane = -1;
+
+#ifdef SPELL_BVH_SSE
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+#endif
+
+	// Moller-Trumbore against the four lanes of a leaf; empty lanes have det == 0
+	auto intersectBlock = [&](uint32_t b) {
+		const TriangleBlock& block = blocks_[b];
+#ifdef SPELL_BVH_SSE
+		const __m128 e1x = _mm_load_ps(block.e1[0]), e1y = _mm_load_ps(block.e1[1]), e1z = _mm_load_ps(block.e1[2]);
+		const __m128 e2x = _mm_load_ps(block.e2[0]), e2y = _mm_load_ps(block.e2[1]), e2z = _mm_load_ps(block.e2[2]);
+		const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+		const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+		const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+		const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		const __m128 invDet = _mm_div_ps(one, det);
+
+		const __m128 sx = _mm_sub_ps(ox, _mm_load_ps(block.v0[0]));
+		const __m128 sy = _mm_sub_ps(oy, _mm_load_ps(block.v0[1]));
+		const __m128 sz = _mm_sub_ps(oz, _mm_load_ps(block.v0[2]));
+		const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+		const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+		const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+		const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+		__m128 mask = _mm_cmpneq_ps(det, zero);
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+		mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+		mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+		mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(best)));
+		int lanes = _mm_movemask_ps(mask);
+		if (lanes == 0) return;
+
+		alignas(16) float distances[LEAF_SIZE];
+		_mm_store_ps(distances, t);
+		for (int lane = 0; lanes != 0; lane++, lanes >>= 1) {
+			if ((lanes & 1) && distances[lane] < best) {
+				best = distances[lane];
+				bestBlock = b;
+				bestLane = lane;
+			}
+		}
+#else
+		for (int lane = 0; lane < static_cast<int>(LEAF_SIZE); lane++) {
+			const glm::vec3 e1(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+			const glm::vec3 e2(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+			const glm::vec3 p = glm::cross(direction, e2);
+			const float det = glm::dot(e1, p);
+			if (det == 0.0f) continue;
+			const float invDet = 1.0f / det;
+			const glm::vec3 s = origin - glm::vec3(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+			const float u = glm::dot(s, p) * invDet;
+			const glm::vec3 q = glm::cross(s, e1);
+			const float v = glm::dot(direction, q) * invDet;
+			const float t = glm::dot(e2, q) * invDet;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < best) {
+				best = t;
+				bestBlock = b;
+				bestLane = lane;
+			}
+		}
+#endif
+	};
+
+	// Nearest child first; the far one is pushed with its entry distance and skipped on pop
+	// once a closer hit exists
+	struct Entry {
+		uint32_t node;
+		float distance;
+	};
+	std::array<Entry, STACK_SIZE> stack;
+	uint32_t stackSize = 0;
+	if (intersectBox(nodes_[0], origin, invDirection, best) != std::numeric_limits<float>::infinity()) {
+		stack[stackSize++] = { 0, 0.0f };
+	}
+	while (stackSize > 0) {
+		const Entry entry = stack[--stackSize];
+		if (entry.distance >= best) continue;
+
+		uint32_t n = entry.node;
+		while (true) {
+			const BvhNode& node = nodes_[n];
+			if (node.count > 0) {
+				intersectBlock(node.offset);
+				break;
+			}
+			const uint32_t left = n + 1, right = node.offset;
+			float leftDistance = intersectBox(nodes_[left], origin, invDirection, best);
+			float rightDistance = intersectBox(nodes_[right], origin, invDirection, best);
+			const bool hitLeft = leftDistance != std::numeric_limits<float>::infinity();
+			const bool hitRight = rightDistance != std::numeric_limits<float>::infinity();
+			if (hitLeft && hitRight) {
+				const bool leftFirst = leftDistance <= rightDistance;
+				stack[stackSize++] = leftFirst ? Entry{ right, rightDistance } : Entry{ left, leftDistance };
+				n = leftFirst ? left : right;
+			} else if (hitLeft || hitRight) {
+				n = hitLeft ? left : right;
+			} else {
+				break;
+			}
+		}
+	}
+
+	if (bestLane < 0) return false;
+	const TriangleRef& ref = refs_[bestBlock * LEAF_SIZE + bestLane];
+	hit.distance = best;
+	hit.position = origin + direction * best;
+	hit.triangle = ref.triangle;
+	hit.instance = ref.instance;
+	hit.range = ref.range;
+	return true;
+}
+
+} // namespace Spell
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "SpellModel.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Spell {
+
+// 32 bytes, two per cache line. The left child of an inner node is the next node, so only the
+// right one is stored; a subtree occupies a contiguous run of the array.
+struct BvhNode {
+	glm::vec3 boundsMin;
+	uint32_t offset; // inner: index of the right child; leaf: triangle block
+	glm::vec3 boundsMax;
+	uint32_t count;  // triangles of a leaf (1..MeshBvh::LEAF_SIZE), 0 for inner nodes
+};
+
+// Closest triangle along a ray
+struct BvhHit {
+	float distance = std::numeric_limits<float>::max(); // in units of the ray direction
+	glm::vec3 position{ 0.0f };
+	uint32_t triangle = 0; // first index / 3 in ModelGeometryView::indices
+	uint32_t instance = 0; // into ModelGeometryView::instances (0 for flat models)
+	uint32_t range = 0;    // into the material ranges the BVH was built with
+};
+
+// CPU bounding volume hierarchy over every drawn triangle of a model, in the space of
+// UniformBufferObject::model (instance transforms applied), for frustum queries and picking.
+//
+// Built with binned SAH on worker threads: the two halves of the upper splits are built as
+// separate tasks and spliced into one flat node array. Leaves hold at most LEAF_SIZE
+// triangles, stored as one structure-of-arrays block, so the ray kernel tests a whole leaf
+// with one 4-wide SSE Moller-Trumbore (scalar loop on other targets).
+//
+// Every triangle belongs to one of the material ranges passed in (SpellModel::getMaterialRanges,
+// the ranges Submesh::bounds refers to), so frustum queries answer per submesh range.
+class MeshBvh {
+public:
+	static constexpr uint32_t LEAF_SIZE = 4;
+	static constexpr uint32_t MIXED_RANGES = ~0u;
+
+	// `ranges` are disjoint index runs of the base geometry; triangles outside all of them are skipped
+	MeshBvh(const ModelGeometryView& geometry, const std::vector<MaterialRange>& ranges);
+
+	MeshBvh(const MeshBvh&) = delete;
+	MeshBvh& operator=(const MeshBvh&) = delete;
+
+	bool empty() const { return nodes_.empty(); }
+	uint32_t getNodeCount() const { return static_cast<uint32_t>(nodes_.size()); }
+	const BvhNode& getRoot() const { return nodes_.front(); } // bounds of the whole model; not for an empty BVH
+	uint32_t getLeafCount() const { return static_cast<uint32_t>(blocks_.size()); }
+	uint64_t getTriangleCount() const { return triangleCount_; }
+	uint32_t getRangeCount() const { return rangeCount_; }
+	uint64_t getMemoryBytes() const;
+	float getBuildTimeMs() const { return buildTimeMs_; }
+
+	// Marks visibleRanges[r] = 1 for every material range with a triangle box inside the frustum
+	// of `clip` (projection * view * model, OpenGL depth range) and returns how many are visible.
+	// Subtrees of a single range stop at the first hit.
+	uint32_t queryFrustum(const glm::mat4& clip, std::vector<uint8_t>& visibleRanges) const;
+
+	// Closest hit with 0 < distance < maxDistance; `direction` need not be normalized
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, BvhHit& hit,
+		float maxDistance = std::numeric_limits<float>::max()) const;
+
+private:
+	// Leaf triangles as v0 and the edges v1 - v0, v2 - v0; unused lanes are all zero
+	struct alignas(16) TriangleBlock {
+		float v0[3][LEAF_SIZE];
+		float e1[3][LEAF_SIZE];
+		float e2[3][LEAF_SIZE];
+	};
+
+	struct TriangleRef {
+		uint32_t triangle;
+		uint32_t instance;
+		uint32_t range;
+	};
+
+	std::vector<BvhNode> nodes_;
+	std::vector<uint32_t> nodeRanges_;  // material range of every triangle below a node, or MIXED_RANGES
+	std::vector<TriangleBlock> blocks_; // one per leaf
+	std::vector<TriangleRef> refs_;     // LEAF_SIZE per block
+	uint64_t triangleCount_ = 0;
+	uint32_t rangeCount_ = 0;
+	float buildTimeMs_ = 0.0f;
+};
+
+} // namespace Spell
@@ -0,0 +1,310 @@
+#include "MeshCache.h"
+#include "ContentHash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace Spell {
+
+namespace {
+
+constexpr char MAGIC[8] = { 'S', 'P', 'L', 'M', 'E', 'S', 'H', '\0' };
+constexpr const char* CACHE_DIR = "cache/meshes";
+
+struct MeshCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t vertexSize;
+	uint32_t loaderVersion;
+	uint32_t reserved;
+	uint64_t loaderSettings;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	int64_t sourceMtime;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint64_t materialCount;
+	uint64_t meshCount;
+	uint64_t instanceCount;
+	uint64_t materialRangeCount;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t meshOffset;
+	uint64_t instanceOffset;
+	uint64_t materialRangeOffset;
+	uint64_t materialOffset;
+	uint64_t fileSize;
+	// MeshOptimizeStats of the stored geometry
+	uint32_t optimized;
+	float acmrBefore;
+	float acmrAfter;
+	float atvrBefore;
+	float atvrAfter;
+	uint32_t padding;
+};
+
+// Smallest possible serialized material: four empty strings and the packed flag
+constexpr uint64_t MIN_MATERIAL_SIZE = 4 * sizeof(uint32_t) + 1;
+
+constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// True when count elements of elementSize bytes starting at offset fit in a file of fileSize bytes.
+// Written so that no corrupt count or offset can overflow the check.
+bool sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+	return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+bool sourceStat(const std::string& path, uint64_t& size, int64_t& mtime) {
+	std::error_code ec;
+	size = std::filesystem::file_size(path, ec);
+	if (ec) return false;
+	auto time = std::filesystem::last_write_time(path, ec);
+	if (ec) return false;
+	mtime = static_cast<int64_t>(time.time_since_epoch().count());
+	return true;
+}
+
+// Records the source's current size and mtime in an entry whose content hash still matched,
+// so later loads take the fast path again. The entry must not be mapped while this runs.
+bool refreshSourceStat(const std::string& cachePath, uint64_t sourceSize, int64_t sourceMtime) {
+	std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+	if (!file) return false;
+	file.seekp(offsetof(MeshCacheHeader, sourceSize));
+	file.write(reinterpret_cast<const char*>(&sourceSize), sizeof(sourceSize));
+	file.seekp(offsetof(MeshCacheHeader, sourceMtime));
+	file.write(reinterpret_cast<const char*>(&sourceMtime), sizeof(sourceMtime));
+	return static_cast<bool>(file);
+}
+
+void writeString(std::vector<char>& out, const std::string& s) {
+	uint32_t len = static_cast<uint32_t>(s.size());
+	out.insert(out.end(), reinterpret_cast<const char*>(&len), reinterpret_cast<const char*>(&len) + sizeof(len));
+	out.insert(out.end(), s.begin(), s.end());
+}
+
+bool readString(const char*& p, const char* end, std::string& s) {
+	uint32_t len;
+	if (static_cast<size_t>(end - p) < sizeof(len)) return false;
+	std::memcpy(&len, p, sizeof(len));
+	p += sizeof(len);
+	if (static_cast<size_t>(end - p) < len) return false;
+	s.assign(p, len);
+	p += len;
+	return true;
+}
+
+} // namespace
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath) {
+	std::error_code ec;
+	std::filesystem::path absolute = std::filesystem::weakly_canonical(sourcePath, ec);
+	std::string key = (ec ? std::filesystem::path(sourcePath) : absolute).generic_string();
+	std::string stem = std::filesystem::path(sourcePath).stem().string();
+	return std::string(CACHE_DIR) + "/" + stem + "_" + hashToHex(hashBytes(key.data(), key.size())) + ".spellmesh";
+}
+
+bool MeshCache::load(const std::string& sourcePath, const IModelLoader& loader, CachedMesh& out) {
+	std::string cachePath = cachePathFor(sourcePath);
+	if (!std::filesystem::exists(cachePath)) return false;
+
+	uint64_t sourceSize;
+	int64_t sourceMtime;
+	if (!sourceStat(sourcePath, sourceSize, sourceMtime)) return false;
+
+	MappedFile file;
+	if (!file.open(cachePath) || file.size() < sizeof(MeshCacheHeader)) return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+		|| header.vertexSize != sizeof(Vertex) || header.fileSize != file.size()
+		|| header.loaderVersion != loader.outputVersion() || header.loaderSettings != loader.outputSettingsHash()
+		|| header.sourceSize != sourceSize) {
+		return false;
+	}
+
+	const bool sourceTouched = header.sourceMtime != sourceMtime;
+	if (sourceTouched) {
+		uint64_t sourceHash;
+		if (!hashFile(sourcePath, sourceHash) || sourceHash != header.sourceHash) {
+			return false;
+		}
+	}
+
+	if (!sectionFits(header.vertexOffset, header.vertexCount, sizeof(Vertex), file.size())
+		|| !sectionFits(header.indexOffset, header.indexCount, sizeof(uint32_t), file.size())
+		|| !sectionFits(header.meshOffset, header.meshCount, sizeof(MeshRange), file.size())
+		|| !sectionFits(header.instanceOffset, header.instanceCount, sizeof(MeshInstance), file.size())
+		|| !sectionFits(header.materialRangeOffset, header.materialRangeCount, sizeof(MaterialRange), file.size())
+		|| !sectionFits(header.materialOffset, header.materialCount, MIN_MATERIAL_SIZE, file.size())
+		|| header.vertexCount > UINT32_MAX || header.indexCount > UINT32_MAX
+		|| header.meshCount > UINT32_MAX || header.instanceCount > UINT32_MAX
+		|| header.materialRangeCount > UINT32_MAX) {
+		return false;
+	}
+
+	// A corrupt entry must not reach the vertex upload or the BVH build
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(file.data() + header.indexOffset);
+	for (uint64_t i = 0; i < header.indexCount; i++) {
+		if (indices[i] >= header.vertexCount) {
+			std::cerr << "[Spell] Mesh cache: index out of range in " << cachePath << ", rebuilding" << std::endl;
+			return false;
+		}
+	}
+	const MeshRange* meshes = reinterpret_cast<const MeshRange*>(file.data() + header.meshOffset);
+	for (uint64_t i = 0; i < header.meshCount; i++) {
+		if (meshes[i].firstIndex > header.indexCount || meshes[i].indexCount > header.indexCount - meshes[i].firstIndex) {
+			std::cerr << "[Spell] Mesh cache: mesh range out of range in " << cachePath << ", rebuilding" << std::endl;
+			return false;
+		}
+	}
+	const MeshInstance* instances = reinterpret_cast<const MeshInstance*>(file.data() + header.instanceOffset);
+	for (uint64_t i = 0; i < header.instanceCount; i++) {
+		if (instances[i].meshIndex >= header.meshCount) {
+			std::cerr << "[Spell] Mesh cache: instance mesh out of range in " << cachePath << ", rebuilding" << std::endl;
+			return false;
+		}
+	}
+	// Material -1 is "no material" and draws with the fallback textures
+	const MaterialRange* materialRanges = reinterpret_cast<const MaterialRange*>(file.data() + header.materialRangeOffset);
+	for (uint64_t i = 0; i < header.materialRangeCount; i++) {
+		const MaterialRange& range = materialRanges[i];
+		if (range.firstIndex > header.indexCount || range.indexCount > header.indexCount - range.firstIndex
+			|| range.materialIndex < -1 || range.materialIndex >= static_cast<int64_t>(header.materialCount)) {
+			std::cerr << "[Spell] Mesh cache: material range out of range in " << cachePath << ", rebuilding" << std::endl;
+			return false;
+		}
+	}
+
+	std::vector<MaterialInfo> materials(header.materialCount);
+	const char* p = file.data() + header.materialOffset;
+	const char* end = file.data() + file.size();
+	for (auto& mat : materials) {
+		if (!readString(p, end, mat.diffuseTexturePath) || !readString(p, end, mat.normalTexturePath)
+			|| !readString(p, end, mat.metallicTexturePath) || !readString(p, end, mat.roughnessTexturePath)
+			|| p >= end) {
+			return false;
+		}
+		mat.packedMetallicRoughness = *p++ != 0;
+	}
+
+	if (sourceTouched) {
+		file.close();
+		if (!refreshSourceStat(cachePath, sourceSize, sourceMtime)) {
+			std::cerr << "[Spell] Mesh cache: cannot update the header of " << cachePath << std::endl;
+		}
+		if (!file.open(cachePath) || file.size() != header.fileSize) return false;
+	}
+
+	ModelGeometryView& geometry = out.geometry;
+	geometry.vertices = reinterpret_cast<const Vertex*>(file.data() + header.vertexOffset);
+	geometry.vertexCount = static_cast<uint32_t>(header.vertexCount);
+	geometry.indices = reinterpret_cast<const uint32_t*>(file.data() + header.indexOffset);
+	geometry.indexCount = static_cast<uint32_t>(header.indexCount);
+	geometry.meshes = reinterpret_cast<const MeshRange*>(file.data() + header.meshOffset);
+	geometry.meshCount = static_cast<uint32_t>(header.meshCount);
+	geometry.instances = reinterpret_cast<const MeshInstance*>(file.data() + header.instanceOffset);
+	geometry.instanceCount = static_cast<uint32_t>(header.instanceCount);
+	geometry.materialRanges = reinterpret_cast<const MaterialRange*>(file.data() + header.materialRangeOffset);
+	geometry.materialRangeCount = static_cast<uint32_t>(header.materialRangeCount);
+	out.materials = std::move(materials);
+	out.optimizeStats.optimized = header.optimized != 0;
+	out.optimizeStats.before = { header.acmrBefore, header.atvrBefore };
+	out.optimizeStats.after = { header.acmrAfter, header.atvrAfter };
+	out.optimizeStats.timeMs = 0.0f;
+	out.file = std::move(file);
+	return true;
+}
+
+bool MeshCache::store(const std::string& sourcePath, const IModelLoader& loader, uint64_t sourceHash,
+	const ModelLoadResult& result, const MeshOptimizeStats& optimizeStats) {
+	std::string cachePath = cachePathFor(sourcePath);
+
+	MeshCacheHeader header{};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.loaderVersion = loader.outputVersion();
+	header.loaderSettings = loader.outputSettingsHash();
+	header.sourceHash = sourceHash;
+	if (!sourceStat(sourcePath, header.sourceSize, header.sourceMtime)) return false;
+	header.optimized = optimizeStats.optimized ? 1 : 0;
+	header.acmrBefore = optimizeStats.before.acmr;
+	header.acmrAfter = optimizeStats.after.acmr;
+	header.atvrBefore = optimizeStats.before.atvr;
+	header.atvrAfter = optimizeStats.after.atvr;
+
+	std::vector<char> materialBlock;
+	for (const auto& mat : result.materials) {
+		writeString(materialBlock, mat.diffuseTexturePath);
+		writeString(materialBlock, mat.normalTexturePath);
+		writeString(materialBlock, mat.metallicTexturePath);
+		writeString(materialBlock, mat.roughnessTexturePath);
+		materialBlock.push_back(mat.packedMetallicRoughness ? 1 : 0);
+	}
+
+	header.vertexCount = result.vertices.size();
+	header.indexCount = result.indices.size();
+	header.materialCount = result.materials.size();
+	header.meshCount = result.meshes.size();
+	header.instanceCount = result.instances.size();
+	header.materialRangeCount = result.materialRanges.size();
+	header.vertexOffset = alignUp(sizeof(MeshCacheHeader), 16);
+	header.indexOffset = alignUp(header.vertexOffset + header.vertexCount * sizeof(Vertex), 16);
+	header.meshOffset = alignUp(header.indexOffset + header.indexCount * sizeof(uint32_t), 16);
+	header.instanceOffset = alignUp(header.meshOffset + header.meshCount * sizeof(MeshRange), 16);
+	header.materialRangeOffset = alignUp(header.instanceOffset + header.instanceCount * sizeof(MeshInstance), 16);
+	header.materialOffset = alignUp(header.materialRangeOffset + header.materialRangeCount * sizeof(MaterialRange), 16);
+	header.fileSize = header.materialOffset + materialBlock.size();
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_DIR, ec);
+
+	// Write to a temporary file first so a crash never leaves a truncated entry behind
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			std::cerr << "[Spell] Mesh cache: cannot write " << tempPath << std::endl;
+			return false;
+		}
+
+		const char padding[16] = {};
+		auto writeAt = [&](uint64_t offset, const void* data, size_t size) {
+			uint64_t pos = static_cast<uint64_t>(file.tellp());
+			file.write(padding, static_cast<std::streamsize>(offset - pos));
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		};
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.vertexOffset, result.vertices.data(), result.vertices.size() * sizeof(Vertex));
+		writeAt(header.indexOffset, result.indices.data(), result.indices.size() * sizeof(uint32_t));
+		writeAt(header.meshOffset, result.meshes.data(), result.meshes.size() * sizeof(MeshRange));
+		writeAt(header.instanceOffset, result.instances.data(), result.instances.size() * sizeof(MeshInstance));
+		writeAt(header.materialRangeOffset, result.materialRanges.data(),
+			result.materialRanges.size() * sizeof(MaterialRange));
+		writeAt(header.materialOffset, materialBlock.data(), materialBlock.size());
+
+		if (!file) {
+			std::cerr << "[Spell] Mesh cache: write failed for " << tempPath << std::endl;
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec) {
+		std::cerr << "[Spell] Mesh cache: cannot replace " << cachePath << ": " << ec.message() << std::endl;
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	std::cout << "[Spell] Mesh cache: wrote " << cachePath << " (" << header.fileSize / 1024 << " KB)" << std::endl;
+	return true;
+}
+
+} // namespace Spell
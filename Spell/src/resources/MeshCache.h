@@ -0,0 +1,43 @@
+#pragma once
+
+#include "IModelLoader.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+
+#include <string>
+#include <vector>
+
+namespace Spell {
+
+// A cache entry mapped into memory. The geometry view points straight into the mapping,
+// so it stays valid only while this object is alive.
+struct CachedMesh {
+	MappedFile file;
+	ModelGeometryView geometry;
+	std::vector<MaterialInfo> materials;
+	MeshOptimizeStats optimizeStats; // as recorded when the entry was stored (timeMs is 0)
+};
+
+// On-disk cache of final ModelLoadResult data (.spellmesh files under cache/meshes/).
+// An entry is valid when its header matches the source file and the loader: size + mtime as a fast
+// path, falling back to the content hash when the timestamp changed (e.g. after a checkout), after
+// which the header takes the new timestamp. The loader's outputVersion() and outputSettingsHash()
+// must match as well. Entries with a section past the end of the file, an index past the vertex
+// count or a mesh range / instance / material range pointing outside the entry are rejected.
+class MeshCache {
+public:
+	// Bump whenever the file layout or the Vertex layout changes. Loader output changes bump
+	// IModelLoader::outputVersion() instead.
+	static constexpr uint32_t VERSION = 5;
+
+	static std::string cachePathFor(const std::string& sourcePath);
+
+	// Returns true on a cache hit
+	static bool load(const std::string& sourcePath, const IModelLoader& loader, CachedMesh& out);
+
+	// sourceHash must be the hashFile() result of sourcePath. Failures are logged, not thrown.
+	static bool store(const std::string& sourcePath, const IModelLoader& loader, uint64_t sourceHash,
+		const ModelLoadResult& result, const MeshOptimizeStats& optimizeStats);
+};
+
+} // namespace Spell
@@ -0,0 +1,413 @@
+#include "MeshOptimizer.h"
+#include "robin_hood.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <thread>
+
+namespace Spell {
+
+namespace {
+
+constexpr uint32_t NONE = ~0u;
+
+// Forsyth's scoring: a simulated LRU cache of 32 entries, with a bonus for vertices that
+// have few triangles left so that isolated leftovers are picked up early.
+constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+// Overdraw clusters may cost at most this much ACMR over the cache-optimized order
+constexpr float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+constexpr uint32_t OVERDRAW_CACHE_SIZE = 16;
+
+// Triangles of one material inside one MeshRange
+struct OptimizeUnit {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+struct ForsythTables {
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_MAX_VALENCE + 1];
+
+	ForsythTables() {
+		for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+			cache[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE
+				: std::pow(1.0f - float(i - 3) / float(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+		}
+		valence[0] = 0.0f;
+		for (uint32_t i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+			valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(float(i), -FORSYTH_VALENCE_BOOST_POWER);
+		}
+	}
+
+	float score(uint32_t cachePosition, uint32_t remaining) const {
+		if (remaining == 0) return -1.0f; // nothing left to emit through this vertex
+		float s = cachePosition < FORSYTH_CACHE_SIZE ? cache[cachePosition] : 0.0f;
+		return s + valence[std::min(remaining, FORSYTH_MAX_VALENCE)];
+	}
+};
+
+const ForsythTables& forsythTables() {
+	static const ForsythTables tables;
+	return tables;
+}
+
+// Maps the corners of `triangles` to dense local vertex ids; returns the local vertex count
+uint32_t buildLocalCorners(const uint32_t* triangles, uint32_t triangleCount, std::vector<uint32_t>& localCorners) {
+	robin_hood::unordered_flat_map<uint32_t, uint32_t> localIds;
+	localIds.reserve(triangleCount);
+	localCorners.resize(static_cast<size_t>(triangleCount) * 3);
+	for (size_t c = 0; c < localCorners.size(); c++) {
+		auto [it, inserted] = localIds.try_emplace(triangles[c], static_cast<uint32_t>(localIds.size()));
+		localCorners[c] = it->second;
+	}
+	return static_cast<uint32_t>(localIds.size());
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation". Writes the new triangle order to `order`.
+void optimizeVertexCache(const std::vector<uint32_t>& corners, uint32_t vertexCount, std::vector<uint32_t>& order) {
+	const ForsythTables& tables = forsythTables();
+	const uint32_t triangleCount = static_cast<uint32_t>(corners.size() / 3);
+
+	// Vertex -> live triangles (CSR); emitted triangles are swapped out of each vertex's run
+	std::vector<uint32_t> adjacencyBegin(vertexCount + 1, 0);
+	for (uint32_t v : corners) adjacencyBegin[v + 1]++;
+	for (uint32_t v = 0; v < vertexCount; v++) adjacencyBegin[v + 1] += adjacencyBegin[v];
+	std::vector<uint32_t> remaining(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) remaining[v] = adjacencyBegin[v + 1] - adjacencyBegin[v];
+	std::vector<uint32_t> adjacency(corners.size());
+	{
+		std::vector<uint32_t> cursor(adjacencyBegin.begin(), adjacencyBegin.end() - 1);
+		for (size_t c = 0; c < corners.size(); c++) {
+			adjacency[cursor[corners[c]]++] = static_cast<uint32_t>(c / 3);
+		}
+	}
+
+	std::vector<uint32_t> cachePosition(vertexCount, NONE);
+	std::vector<float> vertexScore(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) vertexScore[v] = tables.score(NONE, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	uint32_t best = 0;
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		triangleScore[t] = vertexScore[corners[t * 3]] + vertexScore[corners[t * 3 + 1]] + vertexScore[corners[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[best]) best = t;
+	}
+
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t cacheCount = 0;
+	uint32_t nextCandidate = 0; // fallback when the cache holds no live triangle
+
+	order.clear();
+	order.reserve(triangleCount);
+	while (order.size() < triangleCount) {
+		if (best == NONE) {
+			while (emitted[nextCandidate]) nextCandidate++;
+			best = nextCandidate;
+		}
+
+		emitted[best] = 1;
+		order.push_back(best);
+
+		// Emitted triangle's vertices move to the front of the cache
+		uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+		uint32_t newCount = 0;
+		for (int k = 0; k < 3; k++) {
+			uint32_t v = corners[best * 3 + k];
+			const uint32_t begin = adjacencyBegin[v];
+			const uint32_t live = begin + remaining[v];
+			for (uint32_t a = begin; a < live; a++) {
+				if (adjacency[a] == best) {
+					std::swap(adjacency[a], adjacency[live - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+			if (std::find(newCache, newCache + newCount, v) == newCache + newCount) newCache[newCount++] = v;
+		}
+		for (uint32_t i = 0; i < cacheCount; i++) {
+			uint32_t v = cache[i];
+			if (std::find(newCache, newCache + newCount, v) == newCache + newCount) newCache[newCount++] = v;
+		}
+
+		// Rescore everything that moved or fell out, then pick the best live triangle among them
+		for (uint32_t i = 0; i < newCount; i++) {
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? i : NONE;
+			vertexScore[v] = tables.score(cachePosition[v], remaining[v]);
+		}
+		best = NONE;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCount; i++) {
+			uint32_t v = newCache[i];
+			for (uint32_t a = adjacencyBegin[v]; a < adjacencyBegin[v] + remaining[v]; a++) {
+				uint32_t t = adjacency[a];
+				triangleScore[t] = vertexScore[corners[t * 3]] + vertexScore[corners[t * 3 + 1]]
+					+ vertexScore[corners[t * 3 + 2]];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+}
+
+// Splits `order` into clusters that each keep the vertex cache warm, then sorts the clusters
+// so the ones facing away from the mesh centre are drawn first. Those tend to occlude the
+// rest from most viewpoints, so later triangles fail the depth test instead of shading.
+void optimizeOverdraw(const Vertex* vertices, const uint32_t* triangles, const std::vector<uint32_t>& corners,
+	uint32_t vertexCount, std::vector<uint32_t>& order) {
+	const uint32_t triangleCount = static_cast<uint32_t>(order.size());
+	if (triangleCount < 2) return;
+
+	// FIFO simulation on local ids; returns the misses of triangle order[i]
+	std::vector<uint32_t> timestamp(vertexCount, 0);
+	uint32_t time = OVERDRAW_CACHE_SIZE + 1;
+	auto resetCache = [&]() { time += OVERDRAW_CACHE_SIZE + 1; };
+	auto simulate = [&](uint32_t i) {
+		uint32_t misses = 0;
+		for (int k = 0; k < 3; k++) {
+			uint32_t v = corners[order[i] * 3 + k];
+			if (time - timestamp[v] > OVERDRAW_CACHE_SIZE) {
+				timestamp[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// Hard boundaries: triangles that miss on all three vertices start a new cache run
+	std::vector<uint32_t> hard;
+	for (uint32_t i = 0; i < triangleCount; i++) {
+		if (simulate(i) == 3) hard.push_back(i);
+	}
+	if (hard.empty() || hard[0] != 0) hard.insert(hard.begin(), 0);
+	hard.push_back(triangleCount);
+
+	// Soft boundaries: split a run once its ACMR so far is within the threshold of the run's
+	std::vector<uint32_t> clusterBegin;
+	for (size_t h = 0; h + 1 < hard.size(); h++) {
+		const uint32_t begin = hard[h];
+		const uint32_t end = hard[h + 1];
+
+		resetCache();
+		uint32_t runMisses = 0;
+		for (uint32_t i = begin; i < end; i++) runMisses += simulate(i);
+		const float target = float(runMisses) / float(end - begin) * OVERDRAW_ACMR_THRESHOLD;
+
+		resetCache();
+		clusterBegin.push_back(begin);
+		uint32_t misses = 0;
+		uint32_t count = 0;
+		for (uint32_t i = begin; i < end; i++) {
+			misses += simulate(i);
+			count++;
+			if (i + 1 < end && float(misses) <= target * float(count)) {
+				clusterBegin.push_back(i + 1);
+				resetCache();
+				misses = 0;
+				count = 0;
+			}
+		}
+	}
+	const size_t clusterCount = clusterBegin.size();
+	if (clusterCount < 2) return;
+	clusterBegin.push_back(triangleCount);
+
+	// Area-weighted centroid and summed normal per cluster
+	std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++) {
+		float clusterArea = 0.0f;
+		for (uint32_t i = clusterBegin[c]; i < clusterBegin[c + 1]; i++) {
+			const uint32_t* tri = &triangles[order[i] * 3];
+			const glm::vec3& a = vertices[tri[0]].pos;
+			const glm::vec3& b = vertices[tri[1]].pos;
+			const glm::vec3& p = vertices[tri[2]].pos;
+			glm::vec3 n = glm::cross(b - a, p - a);
+			float area = glm::length(n);
+			clusterCentroid[c] += (a + b + p) * (area / 3.0f);
+			clusterNormal[c] += n;
+			clusterArea += area;
+		}
+		meshCentroid += clusterCentroid[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f) clusterCentroid[c] /= clusterArea;
+	}
+	if (meshArea <= 0.0f) return;
+	meshCentroid /= meshArea;
+
+	std::vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		float length = glm::length(clusterNormal[c]);
+		sortKey[c] = length > 0.0f ? glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / length) : 0.0f;
+	}
+
+	std::vector<uint32_t> clusterOrder(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; c++) clusterOrder[c] = c;
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+		[&sortKey](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(triangleCount);
+	for (uint32_t c : clusterOrder) {
+		sorted.insert(sorted.end(), order.begin() + clusterBegin[c], order.begin() + clusterBegin[c + 1]);
+	}
+	order.swap(sorted);
+}
+
+void optimizeUnit(const Vertex* vertices, uint32_t* indices, const OptimizeUnit& unit) {
+	const uint32_t triangleCount = unit.indexCount / 3;
+	if (triangleCount < 2) return;
+	uint32_t* triangles = indices + unit.firstIndex;
+
+	std::vector<uint32_t> corners;
+	const uint32_t localCount = buildLocalCorners(triangles, triangleCount, corners);
+
+	std::vector<uint32_t> order;
+	optimizeVertexCache(corners, localCount, order);
+	optimizeOverdraw(vertices, triangles, corners, localCount, order);
+
+	std::vector<uint32_t> reordered(static_cast<size_t>(triangleCount) * 3);
+	for (size_t i = 0; i < order.size(); i++) {
+		reordered[i * 3 + 0] = triangles[order[i] * 3 + 0];
+		reordered[i * 3 + 1] = triangles[order[i] * 3 + 1];
+		reordered[i * 3 + 2] = triangles[order[i] * 3 + 2];
+	}
+	std::copy(reordered.begin(), reordered.end(), triangles);
+}
+
+// Splits every MeshRange (or the whole buffer) into runs of triangles with the same material;
+// the loader's material ranges already are those runs
+std::vector<OptimizeUnit> collectUnits(const ModelLoadResult& result) {
+	std::vector<OptimizeUnit> units;
+	for (const MaterialRange& range : result.materialRanges) {
+		units.push_back({ range.firstIndex, range.indexCount });
+	}
+
+	std::vector<MeshRange> ranges = result.meshes;
+	if (ranges.empty()) {
+		ranges.push_back({ 0, static_cast<uint32_t>(result.indices.size()) });
+	}
+	if (!units.empty()) ranges.clear();
+
+	for (const MeshRange& range : ranges) {
+		const uint32_t end = range.firstIndex + range.indexCount - range.indexCount % 3;
+		uint32_t begin = range.firstIndex;
+		for (uint32_t i = range.firstIndex; i < end; i += 3) {
+			const int material = result.vertices[result.indices[i]].materialIndex;
+			const int current = result.vertices[result.indices[begin]].materialIndex;
+			if (material != current) {
+				units.push_back({ begin, i - begin });
+				begin = i;
+			}
+		}
+		if (end > begin) units.push_back({ begin, end - begin });
+	}
+
+	// Largest first, so one big range does not end up last on a single worker
+	std::sort(units.begin(), units.end(),
+		[](const OptimizeUnit& a, const OptimizeUnit& b) { return a.indexCount > b.indexCount; });
+	return units;
+}
+
+// Renumbers vertices in the order the index buffer first references them.
+// Unreferenced vertices keep their relative order at the end.
+void optimizeVertexFetch(ModelLoadResult& result) {
+	const uint32_t vertexCount = static_cast<uint32_t>(result.vertices.size());
+	std::vector<uint32_t> remap(vertexCount, NONE);
+	uint32_t next = 0;
+	for (uint32_t& index : result.indices) {
+		if (remap[index] == NONE) remap[index] = next++;
+		index = remap[index];
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		if (remap[v] == NONE) remap[v] = next++;
+	}
+
+	std::vector<Vertex> vertices(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		vertices[remap[v]] = result.vertices[v];
+	}
+	result.vertices.swap(vertices);
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize) {
+	VertexCacheStats stats;
+	if (indexCount < 3 || vertexCount == 0) return stats;
+
+	// A vertex is cached while fewer than cacheSize misses happened since it was loaded
+	std::vector<uint32_t> timestamp(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	uint32_t unique = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		const uint32_t v = indices[i];
+		if (timestamp[v] == 0) unique++;
+		if (time - timestamp[v] > cacheSize) {
+			timestamp[v] = time++;
+			misses++;
+		}
+	}
+
+	stats.acmr = float(misses) / float(indexCount / 3);
+	stats.atvr = unique > 0 ? float(misses) / float(unique) : 0.0f;
+	return stats;
+}
+
+MeshOptimizeStats optimizeMesh(ModelLoadResult& result) {
+	MeshOptimizeStats stats;
+	if (result.indices.size() < 3 || result.vertices.empty()) return stats;
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const uint32_t vertexCount = static_cast<uint32_t>(result.vertices.size());
+	stats.before = analyzeVertexCache(result.indices.data(), result.indices.size(), vertexCount);
+
+	// ========== Triangle order, one worker per material range ==========
+	std::vector<OptimizeUnit> units = collectUnits(result);
+	{
+		std::atomic<size_t> nextUnit{ 0 };
+		auto worker = [&]() {
+			for (size_t u = nextUnit++; u < units.size(); u = nextUnit++) {
+				optimizeUnit(result.vertices.data(), result.indices.data(), units[u]);
+			}
+		};
+		const size_t workerCount = std::min<size_t>(units.size(),
+			std::max(1u, std::thread::hardware_concurrency()));
+		std::vector<std::future<void>> workers;
+		for (size_t i = 1; i < workerCount; i++) {
+			workers.push_back(std::async(std::launch::async, worker));
+		}
+		worker();
+		for (auto& w : workers) w.get();
+	}
+
+	// ========== Vertex order ==========
+	optimizeVertexFetch(result);
+
+	stats.after = analyzeVertexCache(result.indices.data(), result.indices.size(), vertexCount);
+	stats.optimized = true;
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.timeMs = std::chrono::duration<float, std::milli>(end - start).count();
+	return stats;
+}
+
+} // namespace Spell
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "IModelLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Spell {
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+	float acmr = 0.0f; // average cache miss ratio: vertex shader runs per triangle (0.5 ideal, 3 worst)
+	float atvr = 0.0f; // average transformed vertex ratio: vertex shader runs per unique vertex (1 ideal)
+};
+
+struct MeshOptimizeStats {
+	bool optimized = false;
+	VertexCacheStats before;
+	VertexCacheStats after;
+	float timeMs = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, uint32_t vertexCount,
+	uint32_t cacheSize = 16);
+
+// Reorders a loaded model for the GPU, between loader.load() and SpellModel construction:
+//  1. Triangles for post-transform cache reuse (Forsyth's linear-speed algorithm)
+//  2. Cache-friendly clusters of triangles, outward-facing first, to cut overdraw
+//     without depending on the view (Sander et al., "Fast Triangle Reordering")
+//  3. Vertices into first-use order for vertex fetch locality
+//
+// Steps 1 and 2 run in parallel over material ranges: the runs of triangles inside each
+// MeshRange that share a material. Triangles never leave their range, so meshes, instances
+// and material grouping (including result.materialRanges and their bounds) are unchanged.
+MeshOptimizeStats optimizeMesh(ModelLoadResult& result);
+
+} // namespace Spell
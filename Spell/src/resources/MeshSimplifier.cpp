@@ -0,0 +1,598 @@
+#include "MeshSimplifier.h"
+#include "robin_hood.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <thread>
+
+namespace Spell {
+
+namespace {
+
+constexpr uint32_t NONE = ~0u;
+
+enum VertexKind : uint8_t {
+	KIND_MANIFOLD, // interior vertex, single set of attributes
+	KIND_BORDER,   // on an open boundary
+	KIND_SEAM,     // on an attribute seam: two vertices share the position
+	KIND_LOCKED,   // anything more complex; never moves
+	KIND_COUNT
+};
+
+// Whether a vertex of kind [from] may collapse onto a vertex of kind [to]
+constexpr bool CAN_COLLAPSE[KIND_COUNT][KIND_COUNT] = {
+	{ true,  true,  true,  true  },
+	{ false, true,  false, false },
+	{ false, false, true,  false },
+	{ false, false, false, false },
+};
+
+// Whether an edge between the two kinds appears as two half-edges (i0->i1 and i1->i0)
+constexpr bool HAS_OPPOSITE[KIND_COUNT][KIND_COUNT] = {
+	{ true,  true,  true,  true  },
+	{ true,  false, true,  false },
+	{ true,  true,  true,  true  },
+	{ true,  false, true,  false },
+};
+
+// Border edges are kept in place much more firmly than the surface
+constexpr float BORDER_EDGE_WEIGHT = 10.0f;
+constexpr float SEAM_EDGE_WEIGHT = 1.0f;
+
+// Symmetric 4x4 plane quadric, weighted by area
+struct Quadric {
+	float a00 = 0, a11 = 0, a22 = 0;
+	float a10 = 0, a20 = 0, a21 = 0;
+	float b0 = 0, b1 = 0, b2 = 0;
+	float c = 0;
+	float w = 0;
+
+	void addPlane(const glm::vec3& n, float d, float weight) {
+		a00 += n.x * n.x * weight;
+		a11 += n.y * n.y * weight;
+		a22 += n.z * n.z * weight;
+		a10 += n.y * n.x * weight;
+		a20 += n.z * n.x * weight;
+		a21 += n.z * n.y * weight;
+		b0 += n.x * d * weight;
+		b1 += n.y * d * weight;
+		b2 += n.z * d * weight;
+		c += d * d * weight;
+		w += weight;
+	}
+
+	void add(const Quadric& q) {
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a10 += q.a10; a20 += q.a20; a21 += q.a21;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+	}
+
+	// Weighted mean squared distance of v to the accumulated planes
+	float error(const glm::vec3& v) const {
+		float rx = 2.0f * (b0 + a10 * v.y) + a00 * v.x;
+		float ry = 2.0f * (b1 + a21 * v.z) + a11 * v.y;
+		float rz = 2.0f * (b2 + a20 * v.x) + a22 * v.z;
+		float r = c + rx * v.x + ry * v.y + rz * v.z;
+		return w > 0.0f ? std::fabs(r) / w : 0.0f;
+	}
+};
+
+struct Collapse {
+	uint32_t v0;
+	uint32_t v1;
+	bool bidirectional;
+	float error;
+};
+
+// Triangle a, b, c flips when c moves to d
+bool hasTriangleFlip(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d) {
+	glm::vec3 eb = b - a;
+	glm::vec3 nbc = glm::cross(eb, c - a);
+	glm::vec3 nbd = glm::cross(eb, d - a);
+	return glm::dot(nbc, nbd) <= 0.0f;
+}
+
+// Half-edges per vertex: for every triangle corner v, the next and previous corner
+struct Adjacency {
+	std::vector<uint32_t> offsets; // vertexCount + 1
+	std::vector<uint32_t> next;
+	std::vector<uint32_t> prev;
+
+	// `remap` welds vertices that share a position; pass nullptr for attribute-level edges
+	void build(const std::vector<uint32_t>& indices, size_t vertexCount, const uint32_t* remap) {
+		offsets.assign(vertexCount + 1, 0);
+		for (uint32_t v : indices) offsets[(remap ? remap[v] : v) + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+		next.resize(indices.size());
+		prev.resize(indices.size());
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			uint32_t t[3];
+			for (int k = 0; k < 3; k++) t[k] = remap ? remap[indices[i + k]] : indices[i + k];
+			for (int k = 0; k < 3; k++) {
+				uint32_t slot = cursor[t[k]]++;
+				next[slot] = t[(k + 1) % 3];
+				prev[slot] = t[(k + 2) % 3];
+			}
+		}
+	}
+
+	bool hasEdge(uint32_t a, uint32_t b) const {
+		for (uint32_t e = offsets[a]; e < offsets[a + 1]; e++) {
+			if (next[e] == b) return true;
+		}
+		return false;
+	}
+};
+
+class Simplifier {
+public:
+	Simplifier(std::vector<glm::vec3> positions, std::vector<uint32_t> indices)
+		: positions_(std::move(positions)), indices_(std::move(indices)) {
+		vertexCount_ = positions_.size();
+		buildPositionRemap();
+		classifyVertices();
+		computeQuadrics();
+	}
+
+	// Returns the largest collapse error (squared, normalized space)
+	float run(size_t targetIndexCount, float errorLimit) {
+		float resultError = 0.0f;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> collapseRemap(vertexCount_);
+		std::vector<uint8_t> collapseLocked(vertexCount_);
+
+		while (indices_.size() > targetIndexCount) {
+			adjacency_.build(indices_, vertexCount_, remap_.data());
+
+			pickCollapses(collapses);
+			if (collapses.empty()) break;
+			rankCollapses(collapses);
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			for (uint32_t v = 0; v < vertexCount_; v++) collapseRemap[v] = v;
+			std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+			const size_t triangleGoal = (indices_.size() - targetIndexCount) / 3;
+			size_t applied = performCollapses(collapses, triangleGoal, errorLimit, collapseRemap,
+				collapseLocked, resultError);
+			if (applied == 0) break;
+
+			remapLoops(loop_, collapseRemap);
+			remapLoops(loopback_, collapseRemap);
+			remapIndices(collapseRemap);
+		}
+		return resultError;
+	}
+
+	const std::vector<uint32_t>& indices() const { return indices_; }
+
+private:
+	void buildPositionRemap() {
+		// Group vertices with bit-identical positions; the smallest index represents the group
+		std::vector<uint32_t> sorted(vertexCount_);
+		for (uint32_t v = 0; v < vertexCount_; v++) sorted[v] = v;
+		std::sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b) {
+			int cmp = std::memcmp(&positions_[a], &positions_[b], sizeof(glm::vec3));
+			return cmp != 0 ? cmp < 0 : a < b;
+		});
+
+		remap_.resize(vertexCount_);
+		wedge_.resize(vertexCount_);
+		for (size_t begin = 0; begin < sorted.size();) {
+			size_t end = begin + 1;
+			while (end < sorted.size()
+				&& std::memcmp(&positions_[sorted[begin]], &positions_[sorted[end]], sizeof(glm::vec3)) == 0) {
+				end++;
+			}
+			// Circular list of the vertices that share this position
+			for (size_t i = begin; i < end; i++) {
+				remap_[sorted[i]] = sorted[begin];
+				wedge_[sorted[i]] = sorted[i + 1 < end ? i + 1 : begin];
+			}
+			begin = end;
+		}
+	}
+
+	void classifyVertices() {
+		Adjacency attributeEdges;
+		attributeEdges.build(indices_, vertexCount_, nullptr);
+
+		// Open half-edges: i -> j without j -> i. A vertex with several open edges in the same
+		// direction is marked with its own index.
+		std::vector<uint32_t> openIn(vertexCount_, NONE);
+		std::vector<uint32_t> openOut(vertexCount_, NONE);
+		for (uint32_t i = 0; i < vertexCount_; i++) {
+			for (uint32_t e = attributeEdges.offsets[i]; e < attributeEdges.offsets[i + 1]; e++) {
+				uint32_t target = attributeEdges.next[e];
+				if (target == i || attributeEdges.hasEdge(target, i)) continue;
+				openIn[target] = openIn[target] == NONE ? i : target;
+				openOut[i] = openOut[i] == NONE ? target : i;
+			}
+		}
+
+		kind_.resize(vertexCount_);
+		for (uint32_t i = 0; i < vertexCount_; i++) {
+			if (remap_[i] != i) continue;
+			if (wedge_[i] == i) {
+				// Single vertex at this position
+				uint32_t in = openIn[i], out = openOut[i];
+				if (in == NONE && out == NONE) kind_[i] = KIND_MANIFOLD;
+				else if (in != i && out != i && in != NONE && out != NONE) kind_[i] = KIND_BORDER;
+				else kind_[i] = KIND_LOCKED;
+			} else if (wedge_[wedge_[i]] == i) {
+				// Two vertices: a seam if each has one open edge per direction and the edges line up
+				uint32_t w = wedge_[i];
+				uint32_t inV = openIn[i], outV = openOut[i];
+				uint32_t inW = openIn[w], outW = openOut[w];
+				if (inV != NONE && inV != i && outV != NONE && outV != i
+					&& inW != NONE && inW != w && outW != NONE && outW != w
+					&& remap_[inV] == remap_[outW] && remap_[outV] == remap_[inW] && remap_[inV] != remap_[outV]) {
+					kind_[i] = KIND_SEAM;
+				} else {
+					kind_[i] = KIND_LOCKED;
+				}
+			} else {
+				kind_[i] = KIND_LOCKED;
+			}
+		}
+		for (uint32_t i = 0; i < vertexCount_; i++) {
+			kind_[i] = kind_[remap_[i]];
+		}
+
+		loop_ = std::move(openOut);
+		loopback_ = std::move(openIn);
+	}
+
+	void computeQuadrics() {
+		quadrics_.assign(vertexCount_, Quadric{});
+		for (size_t i = 0; i < indices_.size(); i += 3) {
+			const uint32_t t[3] = { indices_[i], indices_[i + 1], indices_[i + 2] };
+			const glm::vec3& p0 = positions_[t[0]];
+			glm::vec3 n = glm::cross(positions_[t[1]] - p0, positions_[t[2]] - p0);
+			float area = glm::length(n);
+			if (area > 0.0f) {
+				n /= area;
+				Quadric q;
+				q.addPlane(n, -glm::dot(n, p0), area);
+				for (uint32_t v : t) quadrics_[remap_[v]].add(q);
+			}
+
+			// Planes through border and seam edges, perpendicular to the triangle
+			for (int e = 0; e < 3; e++) {
+				uint32_t i0 = t[e], i1 = t[(e + 1) % 3], i2 = t[(e + 2) % 3];
+				uint8_t k0 = kind_[i0], k1 = kind_[i1];
+				bool open0 = k0 == KIND_BORDER || k0 == KIND_SEAM;
+				bool open1 = k1 == KIND_BORDER || k1 == KIND_SEAM;
+				if (!open0 && !open1) continue;
+				if (open0 && loop_[i0] != i1) continue;
+				if (open1 && loopback_[i1] != i0) continue;
+				if (HAS_OPPOSITE[k0][k1] && remap_[i1] > remap_[i0]) continue;
+
+				glm::vec3 edge = positions_[i1] - positions_[i0];
+				float length = glm::length(edge);
+				if (length <= 0.0f) continue;
+				edge /= length;
+				glm::vec3 side = positions_[i2] - positions_[i0];
+				glm::vec3 perpendicular = side - edge * glm::dot(side, edge);
+				float perpendicularLength = glm::length(perpendicular);
+				if (perpendicularLength <= 0.0f) continue;
+				perpendicular /= perpendicularLength;
+
+				float weight = (k0 == KIND_BORDER || k1 == KIND_BORDER) ? BORDER_EDGE_WEIGHT : SEAM_EDGE_WEIGHT;
+				Quadric q;
+				q.addPlane(perpendicular, -glm::dot(perpendicular, positions_[i0]), length * length * weight);
+				quadrics_[remap_[i0]].add(q);
+				quadrics_[remap_[i1]].add(q);
+			}
+		}
+	}
+
+	void pickCollapses(std::vector<Collapse>& collapses) const {
+		collapses.clear();
+		for (size_t i = 0; i < indices_.size(); i += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t i0 = indices_[i + e];
+				uint32_t i1 = indices_[i + (e + 1) % 3];
+				if (remap_[i0] == remap_[i1]) continue;
+
+				uint8_t k0 = kind_[i0], k1 = kind_[i1];
+				bool forward = CAN_COLLAPSE[k0][k1];
+				bool backward = CAN_COLLAPSE[k1][k0];
+				if (!forward && !backward) continue;
+				// Interior edges show up twice; keep one of them
+				if (HAS_OPPOSITE[k0][k1] && remap_[i1] > remap_[i0]) continue;
+				// Two border (or seam) vertices without a border edge between them belong to
+				// different loops; collapsing them would pinch the surface
+				if (k0 == k1 && (k0 == KIND_BORDER || k0 == KIND_SEAM) && loop_[i0] != i1) continue;
+
+				if (forward && backward) collapses.push_back({ i0, i1, true, 0.0f });
+				else if (forward) collapses.push_back({ i0, i1, false, 0.0f });
+				else collapses.push_back({ i1, i0, false, 0.0f });
+			}
+		}
+	}
+
+	float collapseError(uint32_t from, uint32_t to) const {
+		Quadric q = quadrics_[remap_[from]];
+		q.add(quadrics_[remap_[to]]);
+		return q.error(positions_[to]);
+	}
+
+	void rankCollapses(std::vector<Collapse>& collapses) const {
+		for (Collapse& c : collapses) {
+			float forwardError = collapseError(c.v0, c.v1);
+			if (c.bidirectional) {
+				float backwardError = collapseError(c.v1, c.v0);
+				if (backwardError < forwardError) {
+					std::swap(c.v0, c.v1);
+					forwardError = backwardError;
+				}
+			}
+			c.error = forwardError;
+		}
+	}
+
+	bool hasTriangleFlips(const std::vector<uint32_t>& collapseRemap, uint32_t r0, uint32_t r1) const {
+		const glm::vec3& p0 = positions_[r0];
+		const glm::vec3& p1 = positions_[r1];
+		for (uint32_t e = adjacency_.offsets[r0]; e < adjacency_.offsets[r0 + 1]; e++) {
+			uint32_t a = remap_[collapseRemap[adjacency_.next[e]]];
+			uint32_t b = remap_[collapseRemap[adjacency_.prev[e]]];
+			// Triangles that contain the edge disappear; already collapsed ones are skipped
+			if (a == r1 || b == r1 || a == b) continue;
+			if (hasTriangleFlip(positions_[a], positions_[b], p0, p1)) return true;
+		}
+		return false;
+	}
+
+	// Link condition: the endpoints may only share the neighbours opposite the collapsed edge,
+	// otherwise the collapse folds the surface onto itself (non-manifold edges, seam cracks)
+	bool breaksLink(const std::vector<uint32_t>& collapseRemap, uint32_t r0, uint32_t r1) const {
+		uint32_t opposite[2];
+		uint32_t oppositeCount = 0;
+		for (uint32_t e = adjacency_.offsets[r0]; e < adjacency_.offsets[r0 + 1]; e++) {
+			uint32_t a = remap_[collapseRemap[adjacency_.next[e]]];
+			uint32_t b = remap_[collapseRemap[adjacency_.prev[e]]];
+			uint32_t other = a == r1 ? b : (b == r1 ? a : NONE);
+			if (other == NONE) continue;
+			if (oppositeCount == 2) return true;
+			opposite[oppositeCount++] = other;
+		}
+
+		for (uint32_t e0 = adjacency_.offsets[r0]; e0 < adjacency_.offsets[r0 + 1]; e0++) {
+			uint32_t n = remap_[collapseRemap[adjacency_.next[e0]]];
+			if (n == r1 || (oppositeCount > 0 && n == opposite[0]) || (oppositeCount > 1 && n == opposite[1])) continue;
+			for (uint32_t e1 = adjacency_.offsets[r1]; e1 < adjacency_.offsets[r1 + 1]; e1++) {
+				uint32_t a = remap_[collapseRemap[adjacency_.next[e1]]];
+				uint32_t b = remap_[collapseRemap[adjacency_.prev[e1]]];
+				if (a == n || b == n) return true;
+			}
+		}
+		return false;
+	}
+
+	size_t performCollapses(const std::vector<Collapse>& collapses, size_t triangleGoal, float errorLimit,
+		std::vector<uint32_t>& collapseRemap, std::vector<uint8_t>& collapseLocked, float& resultError) {
+		// Most collapses remove two triangles. Vertices touched by a collapse are locked for the
+		// rest of the pass, so allow some headroom over the error of the ideal last collapse.
+		size_t edgeGoal = triangleGoal / 2;
+		size_t triangles = 0;
+		size_t applied = 0;
+
+		for (size_t i = 0; i < collapses.size(); i++) {
+			const Collapse& c = collapses[i];
+			if (c.error > errorLimit || triangles >= triangleGoal) break;
+			float errorGoal = edgeGoal < collapses.size() ? 1.5f * collapses[edgeGoal].error
+				: std::numeric_limits<float>::max();
+			if (c.error > errorGoal && triangles > triangleGoal / 6) break;
+
+			uint32_t i0 = c.v0, i1 = c.v1;
+			uint32_t r0 = remap_[i0], r1 = remap_[i1];
+			if (collapseLocked[r0] || collapseLocked[r1]) continue;
+			if (hasTriangleFlips(collapseRemap, r0, r1) || breaksLink(collapseRemap, r0, r1)) {
+				edgeGoal++;
+				continue;
+			}
+
+			quadrics_[r1].add(quadrics_[r0]);
+			if (kind_[i0] == KIND_SEAM) {
+				// Move both sides of the seam onto the matching sides of the target
+				uint32_t s0 = wedge_[i0];
+				uint32_t s1 = loop_[i0] == i1 ? loopback_[s0] : loop_[s0];
+				collapseRemap[i0] = i1;
+				collapseRemap[s0] = s1;
+			} else {
+				collapseRemap[i0] = i1;
+			}
+			collapseLocked[r0] = 1;
+			collapseLocked[r1] = 1;
+
+			triangles += kind_[i0] == KIND_BORDER ? 1 : 2;
+			applied++;
+			resultError = std::max(resultError, c.error);
+		}
+		return applied;
+	}
+
+	static void remapLoops(std::vector<uint32_t>& loop, const std::vector<uint32_t>& collapseRemap) {
+		for (size_t i = 0; i < loop.size(); i++) {
+			if (loop[i] == NONE || loop[i] >= loop.size()) continue;
+			uint32_t l = loop[i];
+			uint32_t r = collapseRemap[l];
+			// i == r: the seam edge collapsed against the loop direction
+			loop[i] = (i == r) ? loop[l] : r;
+		}
+	}
+
+	void remapIndices(const std::vector<uint32_t>& collapseRemap) {
+		size_t write = 0;
+		for (size_t i = 0; i < indices_.size(); i += 3) {
+			uint32_t a = collapseRemap[indices_[i]];
+			uint32_t b = collapseRemap[indices_[i + 1]];
+			uint32_t c = collapseRemap[indices_[i + 2]];
+			if (remap_[a] == remap_[b] || remap_[a] == remap_[c] || remap_[b] == remap_[c]) continue;
+			indices_[write++] = a;
+			indices_[write++] = b;
+			indices_[write++] = c;
+		}
+		indices_.resize(write);
+	}
+
+	std::vector<glm::vec3> positions_;
+	std::vector<uint32_t> indices_;
+	size_t vertexCount_ = 0;
+
+	std::vector<uint32_t> remap_;    // vertex -> representative vertex with the same position
+	std::vector<uint32_t> wedge_;    // circular list of vertices with the same position
+	std::vector<uint8_t> kind_;
+	std::vector<uint32_t> loop_;     // next vertex along the border/seam
+	std::vector<uint32_t> loopback_; // previous vertex along the border/seam
+	std::vector<Quadric> quadrics_;  // per representative
+	Adjacency adjacency_;            // position-level, rebuilt every pass
+};
+
+// Levels stop once a pass removes less than this share of the triangles
+constexpr float MIN_LOD_REDUCTION = 0.85f;
+constexpr uint32_t MIN_LOD_TRIANGLES = 256;
+// Relative error cap per level; screen-space selection decides which level is good enough
+constexpr float MAX_LOD_ERROR = 0.1f;
+
+void buildMeshLods(const ModelGeometryView& geometry, const MeshRange& range, std::vector<uint32_t>& lodIndices,
+	std::vector<MeshLod>& lods, const std::atomic<bool>& cancel) {
+	const uint32_t* source = geometry.indices + range.firstIndex;
+	std::vector<uint32_t> current(source, source + range.indexCount - range.indexCount % 3);
+	float accumulatedError = 0.0f;
+
+	for (uint32_t level = 1; level < MAX_LOD_LEVELS; level++) {
+		if (cancel || current.size() / 3 < MIN_LOD_TRIANGLES) break;
+
+		std::vector<uint32_t> simplified;
+		float error = simplifyMesh(geometry.vertices, current.data(), current.size(), current.size() / 2,
+			MAX_LOD_ERROR, simplified);
+		if (simplified.empty() || simplified.size() > current.size() * MIN_LOD_REDUCTION) break;
+
+		// Each level is simplified from the previous one, so errors add up
+		accumulatedError += error;
+		MeshLod lod;
+		lod.firstIndex = static_cast<uint32_t>(lodIndices.size());
+		lod.indexCount = static_cast<uint32_t>(simplified.size());
+		lod.error = accumulatedError;
+		lods.push_back(lod);
+		lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+		current.swap(simplified);
+	}
+}
+
+} // namespace
+
+float simplifyMesh(const Vertex* vertices, const uint32_t* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, std::vector<uint32_t>& out) {
+	out.clear();
+	indexCount -= indexCount % 3;
+	if (indexCount == 0) return 0.0f;
+
+	// Compact to the vertices this range uses and normalize them into the unit cube
+	robin_hood::unordered_flat_map<uint32_t, uint32_t> localIds;
+	localIds.reserve(indexCount / 3);
+	std::vector<uint32_t> globalIds;
+	std::vector<uint32_t> localIndices(indexCount);
+	for (size_t i = 0; i < indexCount; i++) {
+		auto [it, inserted] = localIds.try_emplace(indices[i], static_cast<uint32_t>(globalIds.size()));
+		if (inserted) globalIds.push_back(indices[i]);
+		localIndices[i] = it->second;
+	}
+
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (uint32_t v : globalIds) {
+		minPos = glm::min(minPos, vertices[v].pos);
+		maxPos = glm::max(maxPos, vertices[v].pos);
+	}
+	glm::vec3 extent = maxPos - minPos;
+	float scale = std::max(extent.x, std::max(extent.y, extent.z));
+	if (!(scale > 0.0f)) {
+		out.assign(indices, indices + indexCount);
+		return 0.0f;
+	}
+
+	std::vector<glm::vec3> positions(globalIds.size());
+	for (size_t v = 0; v < globalIds.size(); v++) {
+		positions[v] = (vertices[globalIds[v]].pos - minPos) / scale;
+	}
+
+	Simplifier simplifier(std::move(positions), std::move(localIndices));
+	float error = std::sqrt(simplifier.run(targetIndexCount, maxError * maxError));
+
+	const std::vector<uint32_t>& result = simplifier.indices();
+	out.resize(result.size());
+	for (size_t i = 0; i < result.size(); i++) {
+		out[i] = globalIds[result[i]];
+	}
+	return error * scale;
+}
+
+LodChain buildLodChain(const ModelGeometryView& geometry, LodBuildProgress& progress) {
+	LodChain chain;
+
+	// Same ranges SpellModel draws: instanced meshes, or the whole buffer for flat models
+	std::vector<MeshRange> ranges;
+	std::vector<bool> used;
+	if (geometry.instanceCount == 0 || geometry.meshCount == 0) {
+		ranges.push_back({ 0, geometry.indexCount });
+		used.push_back(true);
+	} else {
+		ranges.assign(geometry.meshes, geometry.meshes + geometry.meshCount);
+		used.assign(geometry.meshCount, false);
+		for (uint32_t i = 0; i < geometry.instanceCount; i++) {
+			if (geometry.instances[i].meshIndex < geometry.meshCount) used[geometry.instances[i].meshIndex] = true;
+		}
+	}
+
+	std::vector<std::vector<uint32_t>> meshIndices(ranges.size());
+	chain.meshLods.resize(ranges.size());
+	progress.meshesDone = 0;
+	progress.meshCount = static_cast<uint32_t>(ranges.size());
+
+	// Largest meshes first so the longest simplification starts early
+	std::vector<uint32_t> order(ranges.size());
+	for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(),
+		[&ranges](uint32_t a, uint32_t b) { return ranges[a].indexCount > ranges[b].indexCount; });
+
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < order.size(); i = next++) {
+			uint32_t m = order[i];
+			if (used[m] && !progress.cancel) {
+				buildMeshLods(geometry, ranges[m], meshIndices[m], chain.meshLods[m], progress.cancel);
+			}
+			progress.meshesDone++;
+		}
+	};
+	const size_t workerCount = std::min<size_t>(order.size(), std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::future<void>> workers;
+	for (size_t i = 1; i < workerCount; i++) {
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (auto& w : workers) w.get();
+
+	if (progress.cancel) return LodChain{};
+
+	// Concatenate; MeshLod::firstIndex becomes relative to the chain
+	for (size_t m = 0; m < ranges.size(); m++) {
+		const uint32_t base = static_cast<uint32_t>(chain.indices.size());
+		for (MeshLod& lod : chain.meshLods[m]) lod.firstIndex += base;
+		chain.indices.insert(chain.indices.end(), meshIndices[m].begin(), meshIndices[m].end());
+	}
+	return chain;
+}
+
+} // namespace Spell
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "SpellModel.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Quadric error metric simplification (Garland & Heckbert). Edges only collapse onto existing
+// vertices, so the result indexes the same vertex buffer as the input. UV/normal seams and open
+// borders are kept intact: their vertices only slide along the seam or border.
+//
+// Writes at least `targetIndexCount` indices to `out` unless the error would exceed `maxError`
+// (relative to the extent of the input). Returns the achieved error in model units.
+float simplifyMesh(const Vertex* vertices, const uint32_t* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, std::vector<uint32_t>& out);
+
+// Base level + up to 5 simplified levels, each about half the triangles of the previous one
+static constexpr uint32_t MAX_LOD_LEVELS = 6;
+
+// One simplified version of a MeshRange
+struct MeshLod {
+	uint32_t firstIndex = 0; // into LodChain::indices
+	uint32_t indexCount = 0;
+	float error = 0.0f;      // geometric error in model units, used for screen-space selection
+};
+
+struct LodChain {
+	std::vector<uint32_t> indices;
+	// Levels 1.. per MeshRange (a single entry for models without meshes); may be empty for a
+	// mesh that is too small or does not simplify
+	std::vector<std::vector<MeshLod>> meshLods;
+};
+
+// Shared with the thread that waits for buildLodChain
+struct LodBuildProgress {
+	std::atomic<bool> cancel{ false };
+	std::atomic<uint32_t> meshesDone{ 0 };
+	std::atomic<uint32_t> meshCount{ 0 };
+};
+
+// Simplifies every instanced mesh of `geometry` in parallel. Returns an empty chain when
+// cancelled.
+LodChain buildLodChain(const ModelGeometryView& geometry, LodBuildProgress& progress);
+
+} // namespace Spell
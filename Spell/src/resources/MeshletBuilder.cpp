@@ -0,0 +1,200 @@
+#include "MeshletBuilder.h"
+#include "robin_hood.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Spell {
+
+namespace {
+
+// Bounding sphere and normal cone of the triangles order[begin, end)
+Meshlet computeMeshletBounds(const Vertex* vertices, const uint32_t* triangles,
+	const std::vector<uint32_t>& order, size_t begin, size_t end) {
+	Meshlet meshlet;
+
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (size_t i = begin; i < end; i++) {
+		for (int k = 0; k < 3; k++) {
+			const glm::vec3& p = vertices[triangles[order[i] * 3 + k]].pos;
+			minPos = glm::min(minPos, p);
+			maxPos = glm::max(maxPos, p);
+		}
+	}
+	meshlet.center = (minPos + maxPos) * 0.5f;
+
+	float radiusSq = 0.0f;
+	glm::vec3 normalSum(0.0f);
+	for (size_t i = begin; i < end; i++) {
+		const uint32_t* tri = &triangles[order[i] * 3];
+		const glm::vec3& a = vertices[tri[0]].pos;
+		const glm::vec3& b = vertices[tri[1]].pos;
+		const glm::vec3& c = vertices[tri[2]].pos;
+		for (const glm::vec3* p : { &a, &b, &c }) {
+			glm::vec3 d = *p - meshlet.center;
+			radiusSq = std::max(radiusSq, glm::dot(d, d));
+		}
+
+		glm::vec3 n = glm::cross(b - a, c - a);
+		float length = glm::length(n);
+		if (length > 0.0f) normalSum += n / length;
+	}
+	meshlet.radius = std::sqrt(radiusSq);
+
+	// Cone of triangle normals. Counter-clockwise triangles face along cross(b - a, c - a),
+	// matching VK_FRONT_FACE_COUNTER_CLOCKWISE in the graphics pipelines.
+	float axisLength = glm::length(normalSum);
+	if (axisLength <= 0.0f) return meshlet;
+	meshlet.coneAxis = normalSum / axisLength;
+
+	float minDot = 1.0f;
+	for (size_t i = begin; i < end; i++) {
+		const uint32_t* tri = &triangles[order[i] * 3];
+		const glm::vec3& a = vertices[tri[0]].pos;
+		glm::vec3 n = glm::cross(vertices[tri[1]].pos - a, vertices[tri[2]].pos - a);
+		float length = glm::length(n);
+		if (length > 0.0f) minDot = std::min(minDot, glm::dot(n / length, meshlet.coneAxis));
+	}
+	// A spread of 90 degrees or more always has a triangle facing the camera
+	meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+	return meshlet;
+}
+
+} // namespace
+
+void buildMeshlets(const Vertex* vertices, uint32_t* indices, uint32_t firstIndex, uint32_t indexCount,
+	std::vector<Meshlet>& out, const MeshletLimits& limits) {
+	const uint32_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return;
+	uint32_t* triangles = indices + firstIndex;
+
+	// ========== Vertex -> triangle adjacency (CSR, local vertex ids) ==========
+	robin_hood::unordered_flat_map<uint32_t, uint32_t> localIds;
+	localIds.reserve(triangleCount);
+	std::vector<uint32_t> localCorners(static_cast<size_t>(triangleCount) * 3);
+	for (size_t c = 0; c < localCorners.size(); c++) {
+		auto [it, inserted] = localIds.try_emplace(triangles[c], static_cast<uint32_t>(localIds.size()));
+		localCorners[c] = it->second;
+	}
+	const uint32_t localCount = static_cast<uint32_t>(localIds.size());
+
+	std::vector<uint32_t> adjacencyBegin(localCount + 1, 0);
+	for (uint32_t v : localCorners) adjacencyBegin[v + 1]++;
+	for (uint32_t v = 0; v < localCount; v++) adjacencyBegin[v + 1] += adjacencyBegin[v];
+	std::vector<uint32_t> adjacency(localCorners.size());
+	{
+		std::vector<uint32_t> cursor(adjacencyBegin.begin(), adjacencyBegin.end() - 1);
+		for (size_t c = 0; c < localCorners.size(); c++) {
+			adjacency[cursor[localCorners[c]]++] = static_cast<uint32_t>(c / 3);
+		}
+	}
+
+	// ========== Greedy growth ==========
+	constexpr uint32_t NONE = ~0u;
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> vertexMeshlet(localCount, NONE);    // last meshlet that used the vertex
+	std::vector<uint32_t> candidateMeshlet(triangleCount, NONE); // dedups the candidate list
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> order;
+	order.reserve(triangleCount);
+
+	uint32_t meshletId = 0;
+	uint32_t meshletVertices = 0;
+	uint32_t meshletTriangles = 0;
+	size_t meshletBegin = 0;
+	uint32_t nextSeed = 0;
+
+	auto newVertexCount = [&](uint32_t t) {
+		uint32_t count = 0;
+		for (int k = 0; k < 3; k++) {
+			if (vertexMeshlet[localCorners[t * 3 + k]] != meshletId) count++;
+		}
+		return count;
+	};
+	auto fits = [&](uint32_t t) {
+		return meshletTriangles < limits.maxTriangles && meshletVertices + newVertexCount(t) <= limits.maxVertices;
+	};
+	auto emit = [&](uint32_t t) {
+		emitted[t] = 1;
+		order.push_back(t);
+		meshletTriangles++;
+		for (int k = 0; k < 3; k++) {
+			uint32_t v = localCorners[t * 3 + k];
+			if (vertexMeshlet[v] == meshletId) continue;
+			vertexMeshlet[v] = meshletId;
+			meshletVertices++;
+			for (uint32_t a = adjacencyBegin[v]; a < adjacencyBegin[v + 1]; a++) {
+				uint32_t neighbor = adjacency[a];
+				if (!emitted[neighbor] && candidateMeshlet[neighbor] != meshletId) {
+					candidateMeshlet[neighbor] = meshletId;
+					candidates.push_back(neighbor);
+				}
+			}
+		}
+	};
+	auto finishMeshlet = [&]() {
+		// Growth order says nothing about the vertex cache; keep the incoming order inside the
+		// meshlet so a cache-optimized index buffer stays (mostly) optimized
+		std::sort(order.begin() + meshletBegin, order.end());
+		Meshlet meshlet = computeMeshletBounds(vertices, triangles, order, meshletBegin, order.size());
+		meshlet.firstIndex = firstIndex + static_cast<uint32_t>(meshletBegin * 3);
+		meshlet.indexCount = static_cast<uint32_t>((order.size() - meshletBegin) * 3);
+		out.push_back(meshlet);
+
+		meshletId++;
+		meshletVertices = 0;
+		meshletTriangles = 0;
+		meshletBegin = order.size();
+	};
+
+	while (order.size() < triangleCount) {
+		// Connected candidate that adds the fewest vertices
+		uint32_t best = NONE;
+		uint32_t bestNew = 4;
+		size_t live = 0;
+		for (uint32_t t : candidates) {
+			if (emitted[t]) continue;
+			live++;
+			uint32_t added = newVertexCount(t);
+			if (added < bestNew) {
+				best = t;
+				bestNew = added;
+				if (added == 0) break;
+			}
+		}
+
+		if (best != NONE && fits(best)) {
+			emit(best);
+		} else {
+			// Full or disconnected: continue next to this meshlet if possible, else in index order
+			uint32_t seed = best;
+			if (seed == NONE) {
+				while (emitted[nextSeed]) nextSeed++;
+				seed = nextSeed;
+			}
+			if (best != NONE || !fits(seed)) {
+				finishMeshlet();
+				candidates.clear();
+			}
+			emit(seed);
+		}
+
+		if (candidates.size() > 1024 && live * 2 < candidates.size()) {
+			candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+				[&](uint32_t t) { return emitted[t] != 0; }), candidates.end());
+		}
+	}
+	finishMeshlet();
+
+	// ========== Write triangles back in meshlet order ==========
+	std::vector<uint32_t> reordered(static_cast<size_t>(triangleCount) * 3);
+	for (size_t i = 0; i < order.size(); i++) {
+		std::memcpy(&reordered[i * 3], &triangles[order[i] * 3], 3 * sizeof(uint32_t));
+	}
+	std::memcpy(triangles, reordered.data(), reordered.size() * sizeof(uint32_t));
+}
+
+} // namespace Spell
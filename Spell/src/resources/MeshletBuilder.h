@@ -0,0 +1,41 @@
+#pragma once
+
+#include "SpellModel.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// A small cluster of triangles that is culled as a unit. The triangles are a contiguous run
+// of the index buffer. Layout matches the std430 Meshlet struct in cluster_cull.comp.
+struct Meshlet {
+	glm::vec3 center{ 0.0f };   // bounding sphere, model space
+	float radius = 0.0f;
+	glm::vec3 coneAxis{ 0.0f }; // average facing direction of the triangles
+	float coneCutoff = 1.0f;    // sin of the normal cone spread; 1 = cone test disabled
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t range = 0;         // SpellModel draw range, set by the model
+	uint32_t lod = 0;           // LOD level within that range; 0 = full detail
+	int32_t vertexOffset = 0;   // base vertex of the submesh holding this meshlet (see SubmeshSplitter)
+	uint32_t padding[3]{};
+};
+static_assert(sizeof(Meshlet) == 64, "Meshlet must match the std430 layout in cluster_cull.comp");
+
+struct MeshletLimits {
+	uint32_t maxVertices = 64;
+	uint32_t maxTriangles = 124;
+};
+
+// Splits the triangles in indices[firstIndex, firstIndex + indexCount) into meshlets and appends
+// them to `out`. Triangles are reordered inside that range so each meshlet is contiguous; the
+// range itself, and therefore every MeshRange that covers it, stays valid.
+//
+// Meshlets grow greedily across shared vertices, preferring triangles that add no new vertex.
+// When a meshlet has no connected candidate left, the next unused triangle in index order is
+// taken, so disconnected geometry still fills meshlets instead of producing tiny ones.
+void buildMeshlets(const Vertex* vertices, uint32_t* indices, uint32_t firstIndex, uint32_t indexCount,
+	std::vector<Meshlet>& out, const MeshletLimits& limits = {});
+
+} // namespace Spell
@@ -8,7 +8,8 @@
 
 namespace Spell {
 
-std::unique_ptr<IModelLoader> ModelLoaderFactory::createLoader(const std::string& filepath) {
+std::unique_ptr<IModelLoader> ModelLoaderFactory::createLoader(const std::string& filepath,
+	const ModelLoaderSettings& settings) {
 	std::string ext = std::filesystem::path(filepath).extension().string();
 	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
 
@@ -19,7 +20,7 @@ std::unique_ptr<IModelLoader> ModelLoaderFactory::createLoader(const std::string
 		return std::make_unique<GltfModelLoader>();
 	}
 	if (ext == ".fbx") {
-		return std::make_unique<FbxModelLoader>();
+		return std::make_unique<FbxModelLoader>(settings.fbxWeldTolerance);
 	}
 
 	throw std::runtime_error("[Spell] Unsupported model format: " + ext);
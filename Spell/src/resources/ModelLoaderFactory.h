@@ -1,15 +1,22 @@
 #pragma once
 
 #include "IModelLoader.h"
+#include "VertexDedup.h"
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace Spell {
 
+// Options forwarded to the loader createLoader picks; each loader ignores the ones it does not use
+struct ModelLoaderSettings {
+	VertexWeldTolerance fbxWeldTolerance;
+};
+
 class ModelLoaderFactory {
 public:
-	static std::unique_ptr<IModelLoader> createLoader(const std::string& filepath);
+	static std::unique_ptr<IModelLoader> createLoader(const std::string& filepath,
+		const ModelLoaderSettings& settings = {});
 	static std::vector<std::string> allSupportedExtensions();
 };
 
@@ -2,45 +2,109 @@
 #include <tiny_obj_loader.h>
 
 #include "ObjModelLoader.h"
-#include "robin_hood.h"
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "VertexDedup.h"
+#include "MaterialRanges.h"
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
 #include <filesystem>
 
 namespace Spell {
 
-ModelLoadResult ObjModelLoader::load(const std::string& filepath) {
-	ModelLoadResult result;
+// Converts tinyobj texture names into paths relative to the .mtl directory
+static MaterialInfo toMaterialInfo(const tinyobj::material_t& mat, const std::string& mtlBaseDir) {
+	MaterialInfo info{};
+	if (!mat.diffuse_texname.empty()) {
+		info.diffuseTexturePath = mtlBaseDir + mat.diffuse_texname;
+	}
+	if (!mat.bump_texname.empty()) {
+		info.normalTexturePath = mtlBaseDir + mat.bump_texname;
+	}
+	if (!mat.metallic_texname.empty()) {
+		info.metallicTexturePath = mtlBaseDir + mat.metallic_texname;
+	}
+	if (!mat.roughness_texname.empty()) {
+		info.roughnessTexturePath = mtlBaseDir + mat.roughness_texname;
+	}
+	return info;
+}
+
+// The OBJ file is mapped once. Opening the session loads the .mtl files named in the file
+// header; load() parses the geometry from the same mapping and reuses those materials.
+class ObjModelLoader::Session : public IModelLoadSession {
+public:
+	Session(ObjModelLoader& loader, const std::string& filepath)
+		: loader_(loader), filepath_(filepath) {
+		if (!file_.open(filepath)) {
+			throw std::runtime_error("[Spell] OBJ: Cannot open file: " + filepath);
+		}
+
+		mtlBaseDir_ = std::filesystem::path(filepath).parent_path().string();
+		if (mtlBaseDir_.empty()) mtlBaseDir_ = ".";
+		mtlBaseDir_ += "/";
+
+		ObjParser::loadHeaderMaterials(file_.data(), file_.size(), mtlBaseDir_, library_);
+		for (const auto& mat : library_.materials) {
+			materials_.push_back(toMaterialInfo(mat, mtlBaseDir_));
+		}
+	}
+
+	const std::vector<MaterialInfo>& materials() const override { return materials_; }
+	ModelLoadResult load() override;
+
+private:
+	void parseGeometry(ObjGeometry& geometry);
+
+	ObjModelLoader& loader_;
+	std::string filepath_;
+	std::string mtlBaseDir_;
+	MappedFile file_;
+	ObjMaterialLibrary library_;
+	std::vector<MaterialInfo> materials_;
+};
+
+std::unique_ptr<IModelLoadSession> ObjModelLoader::open(const std::string& filepath) {
+	return std::make_unique<Session>(*this, filepath);
+}
+
+void ObjModelLoader::Session::parseGeometry(ObjGeometry& geometry) {
+	if (loader_.parser_ == Parser::Native
+		&& ObjParser::parse(file_.data(), file_.size(), mtlBaseDir_, geometry, &library_)) {
+		return;
+	}
+	if (loader_.parser_ == Parser::Native) {
+		std::cout << "[Spell] OBJ: File has polygons with more than 4 corners, falling back to tinyobj" << std::endl;
+	}
 
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
 	std::vector<tinyobj::material_t> materials;
 	std::string warn, err;
 
-	std::string mtlBaseDir = std::filesystem::path(filepath).parent_path().string();
-	if (mtlBaseDir.empty()) mtlBaseDir = ".";
-	mtlBaseDir += "/";
-
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str(), mtlBaseDir.c_str())) {
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath_.c_str(), mtlBaseDir_.c_str())) {
 		throw std::runtime_error(warn + err);
 	}
 
-	for (const auto& mat : materials) {
-		MaterialInfo info{};
-		if (!mat.diffuse_texname.empty()) {
-			info.diffuseTexturePath = mtlBaseDir + mat.diffuse_texname;
-		}
-		if (!mat.bump_texname.empty()) {
-			info.normalTexturePath = mtlBaseDir + mat.bump_texname;
-		}
-		if (!mat.metallic_texname.empty()) {
-			info.metallicTexturePath = mtlBaseDir + mat.metallic_texname;
-		}
-		if (!mat.roughness_texname.empty()) {
-			info.roughnessTexturePath = mtlBaseDir + mat.roughness_texname;
-		}
-		result.materials.push_back(info);
+	ObjParser::fromTinyObj(attrib, shapes, std::move(materials), geometry);
+}
+
+ModelLoadResult ObjModelLoader::Session::load() {
+	if (!file_.isOpen()) {
+		throw std::runtime_error("[Spell] OBJ: Session already loaded: " + filepath_);
+	}
+
+	ModelLoadResult result;
+	const std::string& filepath = filepath_;
+	const std::string& mtlBaseDir = mtlBaseDir_;
+
+	ObjGeometry geometry;
+	parseGeometry(geometry);
+	file_.close();
+
+	// Later mtllib directives may have added materials after the header
+	for (const auto& mat : geometry.materials) {
+		result.materials.push_back(toMaterialInfo(mat, mtlBaseDir));
 	}
 
 	std::cout << "[Spell] OBJ: Loaded " << result.materials.size() << " material(s) from " << filepath << std::endl;
@@ -55,35 +119,66 @@ ModelLoadResult ObjModelLoader::load(const std::string& filepath) {
 			<< (result.materials[i].roughnessTexturePath.empty() ? "(none)" : result.materials[i].roughnessTexturePath) << std::endl;
 	}
 
-	bool hasNormals = !attrib.normals.empty();
-
-	size_t totalIndices = 0;
-	for (const auto& shape : shapes) {
-		totalIndices += shape.mesh.indices.size();
+	// Flatten the parser chunks so every corner has a global index
+	std::vector<ObjCorner> corners;
+	std::vector<int> materialIds;
+	if (geometry.chunks.size() == 1) {
+		corners = std::move(geometry.chunks[0].corners);
+		materialIds = std::move(geometry.chunks[0].materialIds);
+	} else {
+		size_t totalCorners = 0;
+		for (const auto& chunk : geometry.chunks) {
+			totalCorners += chunk.corners.size();
+		}
+		corners.reserve(totalCorners);
+		materialIds.reserve(totalCorners / 3);
+		for (auto& chunk : geometry.chunks) {
+			corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+			materialIds.insert(materialIds.end(), chunk.materialIds.begin(), chunk.materialIds.end());
+			std::vector<ObjCorner>().swap(chunk.corners);
+		}
 	}
-	result.vertices.reserve(totalIndices / 3);
-	result.indices.reserve(totalIndices);
-
-	robin_hood::unordered_map<Vertex, uint32_t, std::hash<Vertex>> uniqueVertices{};
-	uniqueVertices.reserve(totalIndices);
-	for (const auto& shape : shapes) {
-		size_t indexOffset = 0;
-		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-			int faceVerts = shape.mesh.num_face_vertices[f];
-			int matId = -1;
-			if (f < shape.mesh.material_ids.size()) {
-				matId = shape.mesh.material_ids[f];
-			}
-			int materialIndex = (matId >= 0 && matId < static_cast<int>(result.materials.size())) ? matId : -1;
 
+	const std::vector<float>& positions = geometry.positions;
+	const std::vector<float>& texcoords = geometry.texcoords;
+	const std::vector<float>& normals = geometry.normals;
+	const bool hasNormals = !normals.empty();
+	const int materialCount = static_cast<int>(result.materials.size());
+
+	auto makeVertex = [&](size_t cornerIndex) {
+		const ObjCorner* face = &corners[cornerIndex - cornerIndex % 3];
+		const ObjCorner& index = corners[cornerIndex];
+		int matId = materialIds[cornerIndex / 3];
+
+		Vertex vertex{};
+
+		vertex.pos = {
+			positions[3 * index.v + 0],
+			positions[3 * index.v + 1],
+			positions[3 * index.v + 2]
+		};
+
+		if (index.vt >= 0) {
+			vertex.texCoord = {
+				texcoords[2 * index.vt + 0],
+				1.0f - texcoords[2 * index.vt + 1]
+			};
+		}
+
+		vertex.color = { 1.0f, 1.0f, 1.0f };
+
+		if (hasNormals && index.vn >= 0) {
+			vertex.normal = {
+				normals[3 * index.vn + 0],
+				normals[3 * index.vn + 1],
+				normals[3 * index.vn + 2]
+			};
+		} else {
 			glm::vec3 faceNormal{0.0f, 0.0f, 1.0f};
-			if (!hasNormals && faceVerts >= 3) {
-				const auto& i0 = shape.mesh.indices[indexOffset + 0];
-				const auto& i1 = shape.mesh.indices[indexOffset + 1];
-				const auto& i2 = shape.mesh.indices[indexOffset + 2];
-				glm::vec3 p0 = {attrib.vertices[3*i0.vertex_index+0], attrib.vertices[3*i0.vertex_index+1], attrib.vertices[3*i0.vertex_index+2]};
-				glm::vec3 p1 = {attrib.vertices[3*i1.vertex_index+0], attrib.vertices[3*i1.vertex_index+1], attrib.vertices[3*i1.vertex_index+2]};
-				glm::vec3 p2 = {attrib.vertices[3*i2.vertex_index+0], attrib.vertices[3*i2.vertex_index+1], attrib.vertices[3*i2.vertex_index+2]};
+			if (!hasNormals) {
+				glm::vec3 p0 = {positions[3*face[0].v+0], positions[3*face[0].v+1], positions[3*face[0].v+2]};
+				glm::vec3 p1 = {positions[3*face[1].v+0], positions[3*face[1].v+1], positions[3*face[1].v+2]};
+				glm::vec3 p2 = {positions[3*face[2].v+0], positions[3*face[2].v+1], positions[3*face[2].v+2]};
 				glm::vec3 edge1 = p1 - p0;
 				glm::vec3 edge2 = p2 - p0;
 				glm::vec3 n = glm::cross(edge1, edge2);
@@ -92,47 +187,15 @@ ModelLoadResult ObjModelLoader::load(const std::string& filepath) {
 					faceNormal = n / len;
 				}
 			}
+			vertex.normal = faceNormal;
+		}
 
-			for (int v = 0; v < faceVerts; v++) {
-				const auto& index = shape.mesh.indices[indexOffset + v];
-				Vertex vertex{};
-
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
-
-				if (index.texcoord_index >= 0) {
-					vertex.texCoord = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-					};
-				}
-
-				vertex.color = { 1.0f, 1.0f, 1.0f };
-
-				if (hasNormals && index.normal_index >= 0) {
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2]
-					};
-				} else {
-					vertex.normal = faceNormal;
-				}
-
-				vertex.materialIndex = materialIndex;
+		vertex.materialIndex = (matId >= 0 && matId < materialCount) ? matId : -1;
+		return vertex;
+	};
 
-				auto [it, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(result.vertices.size()));
-				if (inserted) {
-					result.vertices.push_back(vertex);
-				}
-				result.indices.push_back(it->second);
-			}
-			indexOffset += faceVerts;
-		}
-	}
+	deduplicateVertices(corners.size(), makeVertex, result.vertices, result.indices);
+	groupByMaterial(result);
 
 	if (!hasNormals) {
 		std::cout << "[Spell] OBJ: Model had no normals, computed flat face normals" << std::endl;
@@ -141,73 +204,4 @@ ModelLoadResult ObjModelLoader::load(const std::string& filepath) {
 	return result;
 }
 
-std::vector<MaterialInfo> ObjModelLoader::preParseTexturePaths(const std::string& filepath) {
-	std::string mtlBaseDir = std::filesystem::path(filepath).parent_path().string();
-	if (mtlBaseDir.empty()) mtlBaseDir = ".";
-	mtlBaseDir += "/";
-
-	std::vector<std::string> mtlFiles;
-	{
-		std::ifstream objFile(filepath);
-		if (objFile.is_open()) {
-			std::string line;
-			while (std::getline(objFile, line)) {
-				if (line.size() > 7 && line.substr(0, 7) == "mtllib ") {
-					std::string mtlName = line.substr(7);
-					while (!mtlName.empty() && (mtlName.back() == '\r' || mtlName.back() == '\n' || mtlName.back() == ' '))
-						mtlName.pop_back();
-					if (!mtlName.empty())
-						mtlFiles.push_back(mtlBaseDir + mtlName);
-				}
-				if (!line.empty() && line[0] == 'v' && (line.size() == 1 || line[1] == ' ' || line[1] == 't' || line[1] == 'n'))
-					break;
-			}
-		}
-	}
-
-	std::vector<MaterialInfo> result;
-	for (const auto& mtlPath : mtlFiles) {
-		std::ifstream mtlFile(mtlPath);
-		if (!mtlFile.is_open()) continue;
-
-		MaterialInfo* current = nullptr;
-		std::string line;
-		while (std::getline(mtlFile, line)) {
-			while (!line.empty() && (line.back() == '\r' || line.back() == '\n' || line.back() == ' '))
-				line.pop_back();
-
-			if (line.size() > 7 && line.substr(0, 7) == "newmtl ") {
-				result.push_back({});
-				current = &result.back();
-			} else if (current) {
-				auto extractFilename = [](const std::string& value) -> std::string {
-					auto pos = value.rfind(' ');
-					if (pos != std::string::npos && pos + 1 < value.size())
-						return value.substr(pos + 1);
-					return value;
-				};
-
-				if (line.size() > 7 && line.substr(0, 7) == "map_Kd ") {
-					current->diffuseTexturePath = mtlBaseDir + extractFilename(line.substr(7));
-				}
-				else if (line.size() > 9 && (line.substr(0, 9) == "map_Bump " || line.substr(0, 9) == "map_bump ")) {
-					current->normalTexturePath = mtlBaseDir + extractFilename(line.substr(9));
-				}
-				else if (line.size() > 5 && line.substr(0, 5) == "bump ") {
-					current->normalTexturePath = mtlBaseDir + extractFilename(line.substr(5));
-				}
-				else if (line.size() > 7 && line.substr(0, 7) == "map_Pm ") {
-					current->metallicTexturePath = mtlBaseDir + extractFilename(line.substr(7));
-				}
-				else if (line.size() > 7 && line.substr(0, 7) == "map_Pr ") {
-					current->roughnessTexturePath = mtlBaseDir + extractFilename(line.substr(7));
-				}
-			}
-		}
-	}
-
-	std::cout << "[Spell] OBJ: Pre-parsed " << result.size() << " material(s) from .mtl for texture paths" << std::endl;
-	return result;
-}
-
 } // namespace Spell
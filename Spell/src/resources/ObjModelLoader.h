@@ -6,11 +6,22 @@ namespace Spell {
 
 class ObjModelLoader : public IModelLoader {
 public:
-	ModelLoadResult load(const std::string& filepath) override;
-	std::vector<MaterialInfo> preParseTexturePaths(const std::string& filepath) override;
+	// Native = chunked multithreaded parser (ObjParser), TinyObj = tinyobj::LoadObj.
+	// The native path falls back to tinyobj for files it cannot reproduce exactly.
+	enum class Parser { Native, TinyObj };
+
+	explicit ObjModelLoader(Parser parser = Parser::Native) : parser_(parser) {}
+
+	std::unique_ptr<IModelLoadSession> open(const std::string& filepath) override;
 	std::vector<std::string> supportedExtensions() const override {
 		return { ".obj" };
 	}
+	uint32_t outputVersion() const override { return 1; }
+
+private:
+	class Session;
+
+	Parser parser_;
 };
 
 } // namespace Spell
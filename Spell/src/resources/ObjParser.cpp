@@ -0,0 +1,616 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace Spell {
+
+namespace {
+
+constexpr size_t MIN_CHUNK_BYTES = 1u << 20;
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+inline const char* skipSpaces(const char* p, const char* end) {
+	while (p < end && isSpace(*p)) ++p;
+	return p;
+}
+
+// First position in [p, end) holding one of the given delimiters (strcspn equivalent)
+inline const char* findDelimiter(const char* p, const char* end, const char* delimiters) {
+	while (p < end && !std::strchr(delimiters, *p)) ++p;
+	return p;
+}
+
+// Port of tinyobj's tryParseDouble, so positions round to exactly the same floats
+bool tryParseDouble(const char* s, const char* sEnd, double* result) {
+	if (s >= sEnd) return false;
+
+	double mantissa = 0.0;
+	int exponent = 0;
+	char sign = '+';
+	char expSign = '+';
+	const char* curr = s;
+	int read = 0;
+	bool endNotReached = false;
+	bool leadingDecimalDots = false;
+
+	if (*curr == '+' || *curr == '-') {
+		sign = *curr;
+		curr++;
+		if (curr != sEnd && *curr == '.') leadingDecimalDots = true;
+	} else if (*curr >= '0' && *curr <= '9') {
+	} else if (*curr == '.') {
+		leadingDecimalDots = true;
+	} else {
+		return false;
+	}
+
+	endNotReached = (curr != sEnd);
+	if (!leadingDecimalDots) {
+		while (endNotReached && *curr >= '0' && *curr <= '9') {
+			mantissa *= 10;
+			mantissa += static_cast<int>(*curr - '0');
+			curr++;
+			read++;
+			endNotReached = (curr != sEnd);
+		}
+		if (read == 0) return false;
+	}
+
+	if (!endNotReached) goto assemble;
+
+	if (*curr == '.') {
+		curr++;
+		read = 1;
+		endNotReached = (curr != sEnd);
+		while (endNotReached && *curr >= '0' && *curr <= '9') {
+			static const double powLut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+			const int lutEntries = sizeof(powLut) / sizeof(powLut[0]);
+			mantissa += static_cast<int>(*curr - '0') * (read < lutEntries ? powLut[read] : std::pow(10.0, -read));
+			read++;
+			curr++;
+			endNotReached = (curr != sEnd);
+		}
+	} else if (*curr == 'e' || *curr == 'E') {
+	} else {
+		goto assemble;
+	}
+
+	if (!endNotReached) goto assemble;
+
+	if (*curr == 'e' || *curr == 'E') {
+		curr++;
+		endNotReached = (curr != sEnd);
+		if (endNotReached && (*curr == '+' || *curr == '-')) {
+			expSign = *curr;
+			curr++;
+		} else if (endNotReached && *curr >= '0' && *curr <= '9') {
+		} else {
+			return false;
+		}
+
+		read = 0;
+		endNotReached = (curr != sEnd);
+		while (endNotReached && *curr >= '0' && *curr <= '9') {
+			if (exponent > (2147483647 / 10)) return false;
+			exponent *= 10;
+			exponent += static_cast<int>(*curr - '0');
+			curr++;
+			read++;
+			endNotReached = (curr != sEnd);
+		}
+		exponent *= (expSign == '+' ? 1 : -1);
+		if (read == 0) return false;
+	}
+
+assemble:
+	*result = (sign == '+' ? 1 : -1) *
+		(exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+	return true;
+}
+
+inline float parseReal(const char*& p, const char* end) {
+	p = skipSpaces(p, end);
+	const char* tokenEnd = findDelimiter(p, end, " \t\r");
+	double value = 0.0;
+	tryParseDouble(p, tokenEnd, &value);
+	p = tokenEnd;
+	return static_cast<float>(value);
+}
+
+// Bounded atoi (leading whitespace, optional sign, digits)
+inline int parseInt(const char* p, const char* end) {
+	while (p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r'))) ++p;
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-')) {
+		negative = (*p == '-');
+		++p;
+	}
+	long long value = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		++p;
+	}
+	return static_cast<int>(negative ? -value : value);
+}
+
+// Same split rules as tinyobj's SplitString (used for `mtllib` arguments)
+std::vector<std::string> splitString(const std::string& s, char delim, char escape) {
+	std::vector<std::string> elems;
+	std::string token;
+	bool escaping = false;
+	for (char ch : s) {
+		if (escaping) {
+			escaping = false;
+		} else if (ch == escape) {
+			escaping = true;
+			continue;
+		} else if (ch == delim) {
+			if (!token.empty()) elems.push_back(token);
+			token.clear();
+			continue;
+		}
+		token += ch;
+	}
+	elems.push_back(token);
+	return elems;
+}
+
+enum RelativeFlag : uint8_t {
+	RelativeV = 1 << 0,
+	RelativeVt = 1 << 1,
+	RelativeVn = 1 << 2,
+};
+
+struct Directive {
+	enum Kind { UseMtl, MtlLib } kind;
+	uint32_t faceIndex; // number of faces in the chunk before this directive
+	std::string value;
+};
+
+// Per-chunk parse output. Negative (relative) indices cannot be resolved until the attribute
+// counts of all previous chunks are known, so they are stored chunk-relative and flagged.
+struct RawChunk {
+	std::vector<float> positions;
+	std::vector<float> texcoords;
+	std::vector<float> normals;
+	std::vector<ObjCorner> corners;
+	std::vector<uint8_t> relativeFlags; // parallel to corners, allocated on first negative index
+	std::vector<uint8_t> faceSizes;     // 3 or 4
+	std::vector<Directive> directives;
+	bool hasPolygon = false;
+	std::string error;
+};
+
+// fixIndex() from tinyobj, but relative indices are kept relative to the chunk start
+inline bool fixIndex(int idx, int localCount, int& out, bool& relative) {
+	if (idx > 0) {
+		out = idx - 1;
+		relative = false;
+		return true;
+	}
+	if (idx < 0) {
+		out = localCount + idx;
+		relative = true;
+		return true;
+	}
+	return false; // zero is not allowed by the spec
+}
+
+bool parseFace(const char* p, const char* end, RawChunk& chunk) {
+	const int vCount = static_cast<int>(chunk.positions.size() / 3);
+	const int vtCount = static_cast<int>(chunk.texcoords.size() / 2);
+	const int vnCount = static_cast<int>(chunk.normals.size() / 3);
+	const size_t firstCorner = chunk.corners.size();
+
+	p = skipSpaces(p, end);
+	while (p < end && *p != '\r') {
+		ObjCorner corner;
+		uint8_t flags = 0;
+		bool relative = false;
+
+		if (!fixIndex(parseInt(p, end), vCount, corner.v, relative)) return false;
+		if (relative) flags |= RelativeV;
+		p = findDelimiter(p, end, "/ \t\r");
+
+		if (p < end && *p == '/') {
+			++p;
+			if (p < end && *p == '/') {
+				// i//k
+				++p;
+				if (!fixIndex(parseInt(p, end), vnCount, corner.vn, relative)) return false;
+				if (relative) flags |= RelativeVn;
+				p = findDelimiter(p, end, "/ \t\r");
+			} else {
+				// i/j or i/j/k
+				if (!fixIndex(parseInt(p, end), vtCount, corner.vt, relative)) return false;
+				if (relative) flags |= RelativeVt;
+				p = findDelimiter(p, end, "/ \t\r");
+				if (p < end && *p == '/') {
+					++p;
+					if (!fixIndex(parseInt(p, end), vnCount, corner.vn, relative)) return false;
+					if (relative) flags |= RelativeVn;
+					p = findDelimiter(p, end, "/ \t\r");
+				}
+			}
+		}
+
+		if (flags && chunk.relativeFlags.size() < chunk.corners.size()) {
+			chunk.relativeFlags.resize(chunk.corners.size(), 0);
+		}
+		chunk.corners.push_back(corner);
+		if (flags || !chunk.relativeFlags.empty()) {
+			chunk.relativeFlags.push_back(flags);
+		}
+
+		while (p < end && (isSpace(*p) || *p == '\r')) ++p;
+	}
+
+	size_t cornerCount = chunk.corners.size() - firstCorner;
+	if (cornerCount < 3) {
+		// Degenerate face: tinyobj drops it
+		chunk.corners.resize(firstCorner);
+		if (!chunk.relativeFlags.empty()) chunk.relativeFlags.resize(firstCorner);
+	} else if (cornerCount > 4) {
+		chunk.hasPolygon = true;
+	} else {
+		chunk.faceSizes.push_back(static_cast<uint8_t>(cornerCount));
+	}
+	return true;
+}
+
+void parseLine(const char* p, const char* end, RawChunk& chunk) {
+	p = skipSpaces(p, end);
+	if (p == end || *p == '#') return;
+
+	const size_t len = static_cast<size_t>(end - p);
+	const char c1 = len > 1 ? p[1] : '\0';
+	const char c2 = len > 2 ? p[2] : '\0';
+
+	if (p[0] == 'v') {
+		if (isSpace(c1)) {
+			p += 2;
+			float x = parseReal(p, end);
+			float y = parseReal(p, end);
+			float z = parseReal(p, end);
+			chunk.positions.push_back(x);
+			chunk.positions.push_back(y);
+			chunk.positions.push_back(z);
+		} else if (c1 == 'n' && isSpace(c2)) {
+			p += 3;
+			float x = parseReal(p, end);
+			float y = parseReal(p, end);
+			float z = parseReal(p, end);
+			chunk.normals.push_back(x);
+			chunk.normals.push_back(y);
+			chunk.normals.push_back(z);
+		} else if (c1 == 't' && isSpace(c2)) {
+			p += 3;
+			float u = parseReal(p, end);
+			float v = parseReal(p, end);
+			chunk.texcoords.push_back(u);
+			chunk.texcoords.push_back(v);
+		}
+		return;
+	}
+
+	if (p[0] == 'f' && isSpace(c1)) {
+		if (!parseFace(p + 2, end, chunk)) {
+			chunk.error = "Failed parse `f' line (e.g. zero value for face index)";
+		}
+		return;
+	}
+
+	if (len >= 6 && std::strncmp(p, "usemtl", 6) == 0) {
+		const char* name = skipSpaces(p + 6, end);
+		const char* nameEnd = findDelimiter(name, end, " \t\r");
+		chunk.directives.push_back({ Directive::UseMtl,
+			static_cast<uint32_t>(chunk.faceSizes.size()), std::string(name, nameEnd) });
+		return;
+	}
+
+	if (len > 6 && std::strncmp(p, "mtllib", 6) == 0 && isSpace(p[6])) {
+		chunk.directives.push_back({ Directive::MtlLib,
+			static_cast<uint32_t>(chunk.faceSizes.size()), std::string(p + 7, end) });
+	}
+}
+
+void parseChunk(const char* begin, const char* end, RawChunk& chunk) {
+	// Rough reservation: typical OBJ lines are 25-40 bytes
+	size_t estimatedLines = static_cast<size_t>(end - begin) / 32;
+	chunk.positions.reserve(estimatedLines);
+	chunk.corners.reserve(estimatedLines);
+	chunk.faceSizes.reserve(estimatedLines / 2);
+
+	const char* p = begin;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+		if (!lineEnd) lineEnd = end;
+
+		// Honour lone '\r' line breaks the same way tinyobj's safeGetline does
+		const char* cr = static_cast<const char*>(std::memchr(p, '\r', static_cast<size_t>(lineEnd - p)));
+		if (cr) lineEnd = cr;
+
+		parseLine(p, lineEnd, chunk);
+		if (!chunk.error.empty() || chunk.hasPolygon) return;
+
+		p = lineEnd + 1;
+	}
+}
+
+// Splits [data, data + size) into line-aligned chunks
+std::vector<std::pair<size_t, size_t>> splitChunks(const char* data, size_t size) {
+	size_t workers = std::max(1u, std::thread::hardware_concurrency());
+	size_t chunkCount = std::max<size_t>(1, std::min(workers * 4, size / MIN_CHUNK_BYTES));
+	size_t nominal = size / chunkCount;
+
+	std::vector<std::pair<size_t, size_t>> ranges;
+	size_t begin = 0;
+	for (size_t i = 1; i < chunkCount && begin < size; i++) {
+		size_t target = std::max(begin, i * nominal);
+		const void* nl = std::memchr(data + target, '\n', size - target);
+		size_t split = nl ? static_cast<size_t>(static_cast<const char*>(nl) - data) + 1 : size;
+		if (split > begin) {
+			ranges.emplace_back(begin, split);
+			begin = split;
+		}
+	}
+	if (begin < size || ranges.empty()) {
+		ranges.emplace_back(begin, size);
+	}
+	return ranges;
+}
+
+// Resolves one `mtllib` directive the way tinyobj does: the first name that loads wins,
+// files that were loaded before are skipped
+void loadMaterialLibrary(const std::string& value, tinyobj::MaterialFileReader& reader, ObjMaterialLibrary& library) {
+	for (const auto& name : splitString(value, ' ', '\\')) {
+		if (library.loadedFiles.count(name) > 0) continue;
+		std::string warn, err;
+		if (reader(name, &library.materials, &library.materialMap, &warn, &err)) {
+			library.loadedFiles.insert(name);
+			break;
+		}
+	}
+}
+
+} // namespace
+
+bool ObjParser::parse(const std::string& filepath, const std::string& mtlBaseDir, ObjGeometry& out) {
+	MappedFile file;
+	if (!file.open(filepath)) {
+		throw std::runtime_error("[Spell] OBJ: Cannot open file: " + filepath);
+	}
+	return parse(file.data(), file.size(), mtlBaseDir, out);
+}
+
+void ObjParser::loadHeaderMaterials(const char* data, size_t size, const std::string& mtlBaseDir,
+	ObjMaterialLibrary& out) {
+	out = ObjMaterialLibrary{};
+	tinyobj::MaterialFileReader reader(mtlBaseDir);
+
+	RawChunk header;
+	const char* p = data;
+	const char* end = data + size;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+		if (!lineEnd) lineEnd = end;
+		const char* cr = static_cast<const char*>(std::memchr(p, '\r', static_cast<size_t>(lineEnd - p)));
+		if (cr) lineEnd = cr;
+
+		parseLine(p, lineEnd, header);
+		if (!header.positions.empty() || !header.texcoords.empty() || !header.normals.empty()
+			|| !header.faceSizes.empty() || header.hasPolygon || !header.error.empty()) {
+			break;
+		}
+		for (const auto& d : header.directives) {
+			if (d.kind == Directive::MtlLib) {
+				loadMaterialLibrary(d.value, reader, out);
+				out.resolvedDirectives++;
+			}
+		}
+		header.directives.clear();
+
+		p = lineEnd + 1;
+	}
+}
+
+bool ObjParser::parse(const char* data, size_t size, const std::string& mtlBaseDir, ObjGeometry& out,
+	const ObjMaterialLibrary* materials) {
+	out = ObjGeometry{};
+
+	// ========== Phase 1: Parse chunks in parallel ==========
+	auto ranges = splitChunks(data, size);
+	std::vector<RawChunk> chunks(ranges.size());
+	{
+		std::vector<std::future<void>> tasks;
+		tasks.reserve(ranges.size());
+		for (size_t i = 0; i < ranges.size(); i++) {
+			tasks.push_back(std::async(std::launch::async, [&, i]() {
+				parseChunk(data + ranges[i].first, data + ranges[i].second, chunks[i]);
+			}));
+		}
+		for (auto& t : tasks) t.get();
+	}
+
+	for (const auto& chunk : chunks) {
+		if (!chunk.error.empty()) {
+			throw std::runtime_error("[Spell] OBJ: " + chunk.error);
+		}
+		if (chunk.hasPolygon) {
+			return false;
+		}
+	}
+
+	// ========== Phase 2: Attribute offsets and parallel merge ==========
+	struct ChunkOffsets { size_t v, vt, vn; };
+	std::vector<ChunkOffsets> offsets(chunks.size());
+	size_t totalV = 0, totalVt = 0, totalVn = 0;
+	for (size_t i = 0; i < chunks.size(); i++) {
+		offsets[i] = { totalV, totalVt, totalVn };
+		totalV += chunks[i].positions.size() / 3;
+		totalVt += chunks[i].texcoords.size() / 2;
+		totalVn += chunks[i].normals.size() / 3;
+	}
+
+	out.positions.resize(totalV * 3);
+	out.texcoords.resize(totalVt * 2);
+	out.normals.resize(totalVn * 3);
+	{
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i < chunks.size(); i++) {
+			tasks.push_back(std::async(std::launch::async, [&, i]() {
+				auto& c = chunks[i];
+				std::copy(c.positions.begin(), c.positions.end(), out.positions.begin() + offsets[i].v * 3);
+				std::copy(c.texcoords.begin(), c.texcoords.end(), out.texcoords.begin() + offsets[i].vt * 2);
+				std::copy(c.normals.begin(), c.normals.end(), out.normals.begin() + offsets[i].vn * 3);
+				std::vector<float>().swap(c.positions);
+				std::vector<float>().swap(c.texcoords);
+				std::vector<float>().swap(c.normals);
+			}));
+		}
+		for (auto& t : tasks) t.get();
+	}
+
+	// ========== Phase 3: Resolve mtllib/usemtl in file order ==========
+	// Material runs per chunk: (first face index, tinyobj material id)
+	std::vector<std::vector<std::pair<uint32_t, int>>> materialRuns(chunks.size());
+	{
+		tinyobj::MaterialFileReader reader(mtlBaseDir);
+		ObjMaterialLibrary library;
+		size_t skipDirectives = 0;
+		if (materials) {
+			library = *materials;
+			skipDirectives = materials->resolvedDirectives;
+		}
+		int material = -1;
+
+		for (size_t i = 0; i < chunks.size(); i++) {
+			materialRuns[i].push_back({ 0u, material });
+			for (const auto& d : chunks[i].directives) {
+				if (d.kind == Directive::MtlLib) {
+					if (skipDirectives > 0) {
+						skipDirectives--;
+						continue;
+					}
+					loadMaterialLibrary(d.value, reader, library);
+				} else {
+					auto it = library.materialMap.find(d.value);
+					material = (it != library.materialMap.end()) ? it->second : -1;
+					materialRuns[i].push_back({ d.faceIndex, material });
+				}
+			}
+		}
+		out.materials = std::move(library.materials);
+	}
+
+	// ========== Phase 4: Resolve indices and triangulate per chunk in parallel ==========
+	out.chunks.resize(chunks.size());
+	{
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i < chunks.size(); i++) {
+			tasks.push_back(std::async(std::launch::async, [&, i]() {
+				RawChunk& raw = chunks[i];
+				ObjGeometry::Chunk& dst = out.chunks[i];
+				const auto& runs = materialRuns[i];
+				const size_t vSize = out.positions.size();
+
+				if (!raw.relativeFlags.empty()) {
+					for (size_t c = 0; c < raw.corners.size(); c++) {
+						uint8_t flags = raw.relativeFlags[c];
+						if (flags & RelativeV) raw.corners[c].v += static_cast<int>(offsets[i].v);
+						if (flags & RelativeVt) raw.corners[c].vt += static_cast<int>(offsets[i].vt);
+						if (flags & RelativeVn) raw.corners[c].vn += static_cast<int>(offsets[i].vn);
+					}
+				}
+
+				dst.corners.reserve(raw.corners.size() + raw.corners.size() / 2);
+				dst.materialIds.reserve(raw.faceSizes.size() * 2);
+
+				size_t run = 0;
+				size_t corner = 0;
+				for (size_t f = 0; f < raw.faceSizes.size(); f++) {
+					while (run + 1 < runs.size() && runs[run + 1].first <= f) run++;
+					const int materialId = runs[run].second;
+					const ObjCorner* c = &raw.corners[corner];
+					corner += raw.faceSizes[f];
+
+					if (raw.faceSizes[f] == 3) {
+						dst.corners.insert(dst.corners.end(), c, c + 3);
+						dst.materialIds.push_back(materialId);
+						continue;
+					}
+
+					// Quad: split along the shorter diagonal, exactly like tinyobj
+					size_t vi0 = static_cast<size_t>(c[0].v), vi1 = static_cast<size_t>(c[1].v);
+					size_t vi2 = static_cast<size_t>(c[2].v), vi3 = static_cast<size_t>(c[3].v);
+					if (3 * vi0 + 2 >= vSize || 3 * vi1 + 2 >= vSize ||
+						3 * vi2 + 2 >= vSize || 3 * vi3 + 2 >= vSize) {
+						continue; // invalid quad, skipped by tinyobj as well
+					}
+					const float* v = out.positions.data();
+					float e02x = v[vi2 * 3 + 0] - v[vi0 * 3 + 0];
+					float e02y = v[vi2 * 3 + 1] - v[vi0 * 3 + 1];
+					float e02z = v[vi2 * 3 + 2] - v[vi0 * 3 + 2];
+					float e13x = v[vi3 * 3 + 0] - v[vi1 * 3 + 0];
+					float e13y = v[vi3 * 3 + 1] - v[vi1 * 3 + 1];
+					float e13z = v[vi3 * 3 + 2] - v[vi1 * 3 + 2];
+					float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+					float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+					if (sqr02 < sqr13) {
+						dst.corners.insert(dst.corners.end(), { c[0], c[1], c[2], c[0], c[2], c[3] });
+					} else {
+						dst.corners.insert(dst.corners.end(), { c[0], c[1], c[3], c[1], c[2], c[3] });
+					}
+					dst.materialIds.push_back(materialId);
+					dst.materialIds.push_back(materialId);
+				}
+
+				std::vector<ObjCorner>().swap(raw.corners);
+			}));
+		}
+		for (auto& t : tasks) t.get();
+	}
+
+	return true;
+}
+
+void ObjParser::fromTinyObj(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+	std::vector<tinyobj::material_t>&& materials, ObjGeometry& out) {
+	out = ObjGeometry{};
+	out.positions.assign(attrib.vertices.begin(), attrib.vertices.end());
+	out.texcoords.assign(attrib.texcoords.begin(), attrib.texcoords.end());
+	out.normals.assign(attrib.normals.begin(), attrib.normals.end());
+	out.materials = std::move(materials);
+
+	ObjGeometry::Chunk& chunk = out.chunks.emplace_back();
+	for (const auto& shape : shapes) {
+		size_t indexOffset = 0;
+		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+			size_t faceVerts = shape.mesh.num_face_vertices[f];
+			int matId = f < shape.mesh.material_ids.size() ? shape.mesh.material_ids[f] : -1;
+
+			// LoadObj triangulates, so anything else is a degenerate leftover
+			if (faceVerts == 3) {
+				for (size_t v = 0; v < 3; v++) {
+					const auto& idx = shape.mesh.indices[indexOffset + v];
+					chunk.corners.push_back({ idx.vertex_index, idx.texcoord_index, idx.normal_index });
+				}
+				chunk.materialIds.push_back(matId);
+			}
+			indexOffset += faceVerts;
+		}
+	}
+}
+
+} // namespace Spell
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <tiny_obj_loader.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace Spell {
+
+// Face corner reference into the flat attribute arrays (-1 = attribute not present)
+struct ObjCorner {
+	int v = -1;
+	int vt = -1;
+	int vn = -1;
+};
+
+// Triangulated OBJ geometry, shared by the native parser and the tinyobj reference path.
+// Triangles are kept in file order, grouped in chunks so assembly can work per chunk.
+struct ObjGeometry {
+	struct Chunk {
+		std::vector<ObjCorner> corners; // 3 per triangle
+		std::vector<int> materialIds;   // 1 per triangle (tinyobj material id, -1 = none)
+	};
+
+	std::vector<float> positions; // xyz
+	std::vector<float> texcoords; // uv
+	std::vector<float> normals;   // xyz
+	std::vector<Chunk> chunks;
+	std::vector<tinyobj::material_t> materials;
+};
+
+// Materials from the .mtl files loaded so far, in tinyobj's load order
+struct ObjMaterialLibrary {
+	std::vector<tinyobj::material_t> materials;
+	std::map<std::string, int> materialMap; // name -> index into materials
+	std::set<std::string> loadedFiles;      // mtllib names that loaded successfully
+	size_t resolvedDirectives = 0;          // leading mtllib directives already applied
+};
+
+// Native multithreaded OBJ parser. The file is memory-mapped and split at line boundaries;
+// every chunk is parsed on its own worker and the partial results are merged in file order.
+// Parsing rules (number format, negative indices, usemtl/mtllib resolution, quad splitting)
+// follow tinyobjloader so both paths produce identical geometry.
+class ObjParser {
+public:
+	// Throws std::runtime_error on I/O or syntax errors. Returns false if the file contains
+	// polygons with more than four corners: tinyobj triangulates those with earcut, which is
+	// not reproduced here, so callers should fall back to tinyobj::LoadObj.
+	static bool parse(const std::string& filepath, const std::string& mtlBaseDir, ObjGeometry& out);
+
+	// Same as above, but on a file that is already in memory. If `materials` is given, the .mtl
+	// files it already holds are not read again; it must come from loadHeaderMaterials on the same data.
+	static bool parse(const char* data, size_t size, const std::string& mtlBaseDir, ObjGeometry& out,
+		const ObjMaterialLibrary* materials = nullptr);
+
+	// Loads the .mtl files named by `mtllib` lines before the first geometry line. These are
+	// the leading mtllib directives of the file, so the material ids match a full parse.
+	static void loadHeaderMaterials(const char* data, size_t size, const std::string& mtlBaseDir,
+		ObjMaterialLibrary& out);
+
+	// Converts tinyobj::LoadObj output into the same triangle layout
+	static void fromTinyObj(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+		std::vector<tinyobj::material_t>&& materials, ObjGeometry& out);
+};
+
+} // namespace Spell
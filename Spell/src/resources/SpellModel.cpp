@@ -1,65 +1,604 @@
 #include "SpellModel.h"
 #include "IModelLoader.h"
 #include "ModelLoaderFactory.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantization.h"
+#include "VertexStreams.h"
+#include "SubmeshSplitter.h"
+#include "MaterialRanges.h"
+#include "core/SpellSwapChain.h"
+#include "renderer/SpellTypes.h"
 #include <stdexcept>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <chrono>
+#include <future>
+#include <thread>
 
 namespace Spell {
 
-SpellModel::SpellModel(SpellDevice& device, ModelLoadResult&& data)
-	: device_(device) {
-	vertices_ = std::move(data.vertices);
-	indices_ = std::move(data.indices);
-	materials_ = std::move(data.materials);
-	createVertexBuffer();
-	createIndexBuffer();
+SpellModel::SpellModel(SpellDevice& device, ModelLoadResult&& data, VertexFormat format, VertexLayout layout)
+	: SpellModel(device, data.view(), std::move(data.materials), format, layout) {
 }
 
 SpellModel::SpellModel(SpellDevice& device, const std::string& modelPath)
-	: device_(device) {
-	auto loader = ModelLoaderFactory::createLoader(modelPath);
-	auto result = loader->load(modelPath);
-	vertices_ = std::move(result.vertices);
-	indices_ = std::move(result.indices);
-	materials_ = std::move(result.materials);
-	createVertexBuffer();
-	createIndexBuffer();
+	: SpellModel(device, ModelLoaderFactory::createLoader(modelPath)->load(modelPath)) {
+}
+
+SpellModel::SpellModel(SpellDevice& device, const ModelGeometryView& geometry, std::vector<MaterialInfo> materials,
+	VertexFormat format, VertexLayout layout, const LodChain* lods)
+	: device_(device), vertexCount_(geometry.vertexCount), vertexFormat_(format), vertexLayout_(layout),
+	indexCount_(geometry.indexCount),
+	materials_(std::move(materials)) {
+	std::vector<glm::vec4> meshDequant = createVertexBuffer(geometry);
+	createInstanceBuffer(geometry, meshDequant);
+
+	// Meshlet building reorders triangles inside each mesh, so upload from a copy
+	std::vector<uint32_t> indices(geometry.indices, geometry.indices + geometry.indexCount);
+	appendLods(lods, indices);
+	createMaterialRuns(geometry, indices);
+	std::vector<std::vector<Meshlet>> lodMeshlets;
+	buildLodMeshlets(geometry.vertices, indices, lodMeshlets);
+	createSubmeshes(indices, lodMeshlets);
+	createClusterBuffers(lodMeshlets, static_cast<uint32_t>(indices.size()));
+	createIndexBuffer(indices.data(), static_cast<uint32_t>(indices.size()));
+	orderDraws(UniformBufferObject{}, false);
 }
 
 SpellModel::~SpellModel() {
+	for (auto& frame : clusterFrames_) {
+		if (frame.mappedCount) vkUnmapMemory(device_.device(), frame.drawCountMemory);
+		vkDestroyBuffer(device_.device(), frame.drawCount, nullptr);
+		vkFreeMemory(device_.device(), frame.drawCountMemory, nullptr);
+		vkDestroyBuffer(device_.device(), frame.drawCommands, nullptr);
+		vkFreeMemory(device_.device(), frame.drawCommandsMemory, nullptr);
+		if (frame.mappedLods) vkUnmapMemory(device_.device(), frame.lodSelectionMemory);
+		vkDestroyBuffer(device_.device(), frame.lodSelection, nullptr);
+		vkFreeMemory(device_.device(), frame.lodSelectionMemory, nullptr);
+	}
+	vkDestroyBuffer(device_.device(), clusterBuffer_, nullptr);
+	vkFreeMemory(device_.device(), clusterBufferMemory_, nullptr);
+	vkDestroyBuffer(device_.device(), meshletBuffer_, nullptr);
+	vkFreeMemory(device_.device(), meshletBufferMemory_, nullptr);
+	vkDestroyBuffer(device_.device(), instanceBuffer_, nullptr);
+	vkFreeMemory(device_.device(), instanceBufferMemory_, nullptr);
 	vkDestroyBuffer(device_.device(), indexBuffer_, nullptr);
 	vkFreeMemory(device_.device(), indexBufferMemory_, nullptr);
+	vkDestroyBuffer(device_.device(), materialBuffer_, nullptr);
+	vkFreeMemory(device_.device(), materialBufferMemory_, nullptr);
+	vkDestroyBuffer(device_.device(), shadingBuffer_, nullptr);
+	vkFreeMemory(device_.device(), shadingBufferMemory_, nullptr);
 	vkDestroyBuffer(device_.device(), vertexBuffer_, nullptr);
 	vkFreeMemory(device_.device(), vertexBufferMemory_, nullptr);
 }
 
-void SpellModel::createVertexBuffer() {
-	VkDeviceSize bufferSize = sizeof(vertices_[0]) * vertices_.size();
+std::vector<glm::vec4> SpellModel::createVertexBuffer(const ModelGeometryView& geometry) {
+	std::vector<glm::vec4> meshDequant;
+	vertexBufferSize_ = static_cast<VkDeviceSize>(vertexSize(vertexFormat_, vertexLayout_)) * vertexCount_;
+	const bool split = vertexLayout_ == VertexLayout::Split;
+	if (vertexFormat_ == VertexFormat::Packed) {
+		std::vector<PackedVertex> packed;
+		packVertices(geometry, packed, meshDequant);
+		if (split) {
+			std::vector<PackedPosition> positions;
+			std::vector<PackedShadingAttributes> shading;
+			splitPackedVertices(packed, positions, shading);
+			createDeviceLocalBuffer(positions.data(), sizeof(PackedPosition) * positions.size(),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer_, vertexBufferMemory_);
+			createDeviceLocalBuffer(shading.data(), sizeof(PackedShadingAttributes) * shading.size(),
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, shadingBuffer_, shadingBufferMemory_);
+		} else {
+			createDeviceLocalBuffer(packed.data(), vertexBufferSize_,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer_, vertexBufferMemory_);
+		}
+	} else if (split) {
+		std::vector<glm::vec3> positions;
+		std::vector<ShadingAttributes> shading;
+		std::vector<int32_t> materials;
+		splitVertices(geometry.vertices, geometry.vertexCount, positions, shading, materials);
+		createDeviceLocalBuffer(positions.data(), sizeof(glm::vec3) * positions.size(),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer_, vertexBufferMemory_);
+		createDeviceLocalBuffer(shading.data(), sizeof(ShadingAttributes) * shading.size(),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, shadingBuffer_, shadingBufferMemory_);
+		createDeviceLocalBuffer(materials.data(), sizeof(int32_t) * materials.size(),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, materialBuffer_, materialBufferMemory_);
+	} else {
+		createDeviceLocalBuffer(geometry.vertices, vertexBufferSize_,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer_, vertexBufferMemory_);
+	}
+	return meshDequant;
+}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	device_.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingBufferMemory);
+void SpellModel::createIndexBuffer(const uint32_t* indices, uint32_t indexCount) {
+	if (indexType_ == VK_INDEX_TYPE_UINT16) {
+		std::vector<uint16_t> indices16;
+		rebaseIndices16(indices, indexCount, submeshes_, indices16);
+		indexBufferSize_ = sizeof(uint16_t) * indexCount;
+		createDeviceLocalBuffer(indices16.data(), indexBufferSize_,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer_, indexBufferMemory_);
+	} else {
+		indexBufferSize_ = sizeof(uint32_t) * indexCount;
+		createDeviceLocalBuffer(indices, indexBufferSize_,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer_, indexBufferMemory_);
+	}
+}
 
-	void* data;
-	vkMapMemory(device_.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices_.data(), static_cast<size_t>(bufferSize));
-	vkUnmapMemory(device_.device(), stagingBufferMemory);
+void SpellModel::createSubmeshes(const std::vector<uint32_t>& indices, std::vector<std::vector<Meshlet>>& lodMeshlets) {
+	// Each extra draw of a split run has to save at least this many triangles' worth of
+	// index bandwidth; a vertex order that scatters meshes over the whole buffer stays 32-bit
+	constexpr uint64_t MIN_TRIANGLES_PER_EXTRA_DRAW = 16384;
 
-	device_.createBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer_, vertexBufferMemory_);
+	submeshes_.clear();
+	firstSubmesh_.assign(1, 0);
+	bool fits16 = true;
+	uint64_t extraDraws = 0;
+	std::vector<Meshlet> runMeshlets;
+	for (size_t l = 0; l < lods_.size(); l++) {
+		// A level's meshlets are in run order, so each run takes the next contiguous block
+		std::vector<Meshlet> levelMeshlets;
+		size_t next = 0;
+		for (uint32_t r = firstRun_[l]; r < firstRun_[l + 1]; r++) {
+			const MaterialRun& run = materialRuns_[r];
+			runMeshlets.clear();
+			while (next < lodMeshlets[l].size() && lodMeshlets[l][next].firstIndex < run.firstIndex + run.indexCount) {
+				runMeshlets.push_back(lodMeshlets[l][next++]);
+			}
 
-	device_.copyBuffer(stagingBuffer, vertexBuffer_, bufferSize);
+			// A failed split leaves runMeshlets whole; the model then falls back to 32-bit below
+			const size_t before = submeshes_.size();
+			if (fits16) fits16 = splitSubmeshes(indices.data(), runMeshlets, submeshes_);
+			if (submeshes_.size() > before + 1) extraDraws += submeshes_.size() - before - 1;
+			for (size_t s = before; s < submeshes_.size(); s++) {
+				submeshes_[s].materialIndex = run.materialIndex;
+				submeshes_[s].bounds = run.bounds;
+			}
+			levelMeshlets.insert(levelMeshlets.end(), runMeshlets.begin(), runMeshlets.end());
+		}
+		lodMeshlets[l].swap(levelMeshlets);
+		firstSubmesh_.push_back(static_cast<uint32_t>(submeshes_.size()));
+	}
+	fits16 = fits16 && extraDraws * MIN_TRIANGLES_PER_EXTRA_DRAW * 3 <= indices.size();
 
-	vkDestroyBuffer(device_.device(), stagingBuffer, nullptr);
-	vkFreeMemory(device_.device(), stagingBufferMemory, nullptr);
+	if (fits16) {
+		indexType_ = VK_INDEX_TYPE_UINT16;
+	} else {
+		// One submesh per material run at base vertex 0
+		indexType_ = VK_INDEX_TYPE_UINT32;
+		submeshes_.clear();
+		firstSubmesh_.assign(1, 0);
+		for (size_t l = 0; l < lods_.size(); l++) {
+			for (uint32_t r = firstRun_[l]; r < firstRun_[l + 1]; r++) {
+				const MaterialRun& run = materialRuns_[r];
+				submeshes_.push_back({ run.firstIndex, run.indexCount, 0, run.materialIndex, run.bounds });
+			}
+			for (auto& meshlet : lodMeshlets[l]) meshlet.vertexOffset = 0;
+			firstSubmesh_.push_back(static_cast<uint32_t>(submeshes_.size()));
+		}
+	}
+
+	drawCount_ = 0;
+	for (const auto& range : drawRanges_) drawCount_ += firstSubmesh_[range.firstLod + 1] - firstSubmesh_[range.firstLod];
+	std::cout << "[Spell] Index buffer: " << (fits16 ? "16" : "32") << "-bit, "
+		<< submeshes_.size() << " submeshes over " << lods_.size() << " mesh levels, "
+		<< materialRanges_.size() << " material ranges" << std::endl;
+}
+
+void SpellModel::createInstanceBuffer(const ModelGeometryView& geometry, const std::vector<glm::vec4>& meshDequant) {
+	std::vector<InstanceData> instances;
+
+	if (geometry.instanceCount == 0 || geometry.meshCount == 0) {
+		// Flat model: one draw of the whole index buffer
+		instances.push_back({ glm::mat4(1.0f), meshDequant.empty() ? glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) : meshDequant[0] });
+		lods_.push_back({ 0, indexCount_, 0.0f });
+		drawRanges_.push_back({ 0, 0, 1, 0, 1, 0, glm::vec3(0.0f), 0.0f });
+	} else {
+		// Group instances by mesh so each unique mesh is one instanced draw
+		std::vector<uint32_t> counts(geometry.meshCount, 0);
+		for (uint32_t i = 0; i < geometry.instanceCount; i++) {
+			if (geometry.instances[i].meshIndex < geometry.meshCount) {
+				counts[geometry.instances[i].meshIndex]++;
+			}
+		}
+
+		std::vector<uint32_t> firstInstance(geometry.meshCount, 0);
+		uint32_t total = 0;
+		for (uint32_t m = 0; m < geometry.meshCount; m++) {
+			firstInstance[m] = total;
+			total += counts[m];
+			if (counts[m] > 0 && geometry.meshes[m].indexCount > 0) {
+				drawRanges_.push_back({ m, firstInstance[m], counts[m], static_cast<uint32_t>(lods_.size()), 1, 0,
+					glm::vec3(0.0f), 0.0f });
+				lods_.push_back({ geometry.meshes[m].firstIndex, geometry.meshes[m].indexCount, 0.0f });
+			}
+		}
+
+		instances.resize(total);
+		std::vector<uint32_t> cursor = firstInstance;
+		for (uint32_t i = 0; i < geometry.instanceCount; i++) {
+			const MeshInstance& inst = geometry.instances[i];
+			if (inst.meshIndex < geometry.meshCount) {
+				InstanceData& data = instances[cursor[inst.meshIndex]++];
+				data.model = inst.transform;
+				if (!meshDequant.empty()) data.dequant = meshDequant[inst.meshIndex];
+			}
+		}
+	}
+
+	instanceCount_ = static_cast<uint32_t>(instances.size());
+	baseTriangles_ = 0;
+	for (const auto& range : drawRanges_) {
+		baseTriangles_ += static_cast<uint64_t>(lods_[range.firstLod].indexCount / 3) * range.instanceCount;
+	}
+	renderedTriangles_ = baseTriangles_;
+
+	// ========== Bounds for LOD selection ==========
+	for (auto& range : drawRanges_) {
+		const MeshLod& base = lods_[range.firstLod];
+		glm::vec3 minPos(std::numeric_limits<float>::max());
+		glm::vec3 maxPos(-std::numeric_limits<float>::max());
+		for (uint32_t i = base.firstIndex; i < base.firstIndex + base.indexCount; i++) {
+			minPos = glm::min(minPos, geometry.vertices[geometry.indices[i]].pos);
+			maxPos = glm::max(maxPos, geometry.vertices[geometry.indices[i]].pos);
+		}
+		range.center = (minPos + maxPos) * 0.5f;
+		range.radius = 0.0f;
+		for (uint32_t i = base.firstIndex; i < base.firstIndex + base.indexCount; i++) {
+			range.radius = std::max(range.radius, glm::length(geometry.vertices[geometry.indices[i]].pos - range.center));
+		}
+	}
+
+	instanceBounds_.resize(instances.size());
+	for (const auto& range : drawRanges_) {
+		for (uint32_t i = range.firstInstance; i < range.firstInstance + range.instanceCount; i++) {
+			const glm::mat4& m = instances[i].model;
+			InstanceBounds& bounds = instanceBounds_[i];
+			bounds.scale = std::max(glm::length(glm::vec3(m[0])),
+				std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+			bounds.center = glm::vec3(m * glm::vec4(range.center, 1.0f));
+			bounds.radius = range.radius * bounds.scale;
+			bounds.transform = m;
+		}
+	}
+
+	// Also read by the cluster cull compute pass
+	createDeviceLocalBuffer(instances.data(), sizeof(InstanceData) * instances.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		instanceBuffer_, instanceBufferMemory_);
+}
+
+void SpellModel::appendLods(const LodChain* lods, std::vector<uint32_t>& indices) {
+	if (lods == nullptr || lods->indices.empty()) return;
+
+	// Draw ranges are laid out by mesh, so rebuild lods_ with each range's levels next to each other
+	const uint32_t chainBase = static_cast<uint32_t>(indices.size());
+	indices.insert(indices.end(), lods->indices.begin(), lods->indices.end());
+
+	std::vector<MeshLod> levels;
+	for (auto& range : drawRanges_) {
+		const uint32_t firstLod = static_cast<uint32_t>(levels.size());
+		levels.push_back(lods_[range.firstLod]);
+		if (range.meshIndex < lods->meshLods.size()) {
+			for (const MeshLod& lod : lods->meshLods[range.meshIndex]) {
+				if (levels.size() - firstLod >= MAX_LOD_LEVELS) break;
+				levels.push_back({ chainBase + lod.firstIndex, lod.indexCount, lod.error });
+			}
+		}
+		range.firstLod = firstLod;
+		range.lodCount = static_cast<uint32_t>(levels.size()) - firstLod;
+		lodLevelCount_ = std::max(lodLevelCount_, range.lodCount);
+	}
+	lods_ = std::move(levels);
+}
+
+void SpellModel::createMaterialRuns(const ModelGeometryView& geometry, const std::vector<uint32_t>& indices) {
+	// ========== Material ranges of every base level ==========
+	// Loader ranges are looked up by position; without them the base level is scanned
+	std::vector<MaterialRange> sorted(geometry.materialRanges, geometry.materialRanges + geometry.materialRangeCount);
+	std::sort(sorted.begin(), sorted.end(),
+		[](const MaterialRange& a, const MaterialRange& b) { return a.firstIndex < b.firstIndex; });
+
+	materialRanges_.clear();
+	for (auto& range : drawRanges_) {
+		const MeshLod& base = lods_[range.firstLod];
+		range.firstMaterial = static_cast<uint32_t>(materialRanges_.size());
+		auto it = std::lower_bound(sorted.begin(), sorted.end(), base.firstIndex,
+			[](const MaterialRange& r, uint32_t firstIndex) { return r.firstIndex < firstIndex; });
+		for (; it != sorted.end() && it->firstIndex < base.firstIndex + base.indexCount; ++it) {
+			materialRanges_.push_back(*it);
+		}
+		if (materialRanges_.size() == range.firstMaterial) {
+			collectMaterialRanges(geometry.vertices, indices.data(), base.firstIndex, base.indexCount, materialRanges_);
+		}
+		range.materialCount = static_cast<uint32_t>(materialRanges_.size()) - range.firstMaterial;
+	}
+
+	// ========== Material runs of every level ==========
+	// Simplification keeps the triangle order, so coarser levels stay grouped by material and
+	// only collapse onto existing vertices, so they fit the bounds of the base level's range
+	materialRuns_.clear();
+	firstRun_.assign(lods_.size() + 1, 0);
+	for (const auto& range : drawRanges_) {
+		for (uint32_t l = range.firstLod; l < range.firstLod + range.lodCount; l++) {
+			firstRun_[l] = static_cast<uint32_t>(materialRuns_.size());
+			const MeshLod& lod = lods_[l];
+			const uint32_t end = lod.firstIndex + lod.indexCount - lod.indexCount % 3;
+			for (uint32_t i = lod.firstIndex; i < end; i += 3) {
+				const int32_t material = geometry.vertices[indices[i]].materialIndex;
+				if (i > lod.firstIndex && material == materialRuns_.back().materialIndex) {
+					materialRuns_.back().indexCount += 3;
+					continue;
+				}
+				// Falls back to the first range if a level has a material the base level lacks
+				uint32_t bounds = range.firstMaterial;
+				for (uint32_t m = range.firstMaterial; m < range.firstMaterial + range.materialCount; m++) {
+					if (materialRanges_[m].materialIndex == material) {
+						bounds = m;
+						break;
+					}
+				}
+				materialRuns_.push_back({ i, 3, material, bounds });
+			}
+			firstRun_[l + 1] = static_cast<uint32_t>(materialRuns_.size());
+		}
+	}
+}
+
+void SpellModel::buildLodMeshlets(const Vertex* vertices, std::vector<uint32_t>& indices,
+	std::vector<std::vector<Meshlet>>& lodMeshlets) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Levels cover disjoint index runs, so each worker reorders only its own triangles.
+	// lods_ holds the levels of each range contiguously, so level l of range r is
+	// lods_[firstLod + l] and its meshlets are lodMeshlets[firstLod + l]. Meshlets never mix
+	// material runs and are appended in run order.
+	lodMeshlets.assign(lods_.size(), {});
+	{
+		std::atomic<size_t> nextLod{ 0 };
+		auto worker = [&]() {
+			for (size_t l = nextLod++; l < lods_.size(); l = nextLod++) {
+				for (uint32_t r = firstRun_[l]; r < firstRun_[l + 1]; r++) {
+					buildMeshlets(vertices, indices.data(), materialRuns_[r].firstIndex, materialRuns_[r].indexCount,
+						lodMeshlets[l]);
+				}
+			}
+		};
+		const size_t workerCount = std::min<size_t>(lods_.size(),
+			std::max(1u, std::thread::hardware_concurrency()));
+		std::vector<std::future<void>> workers;
+		for (size_t i = 1; i < workerCount; i++) {
+			workers.push_back(std::async(std::launch::async, worker));
+		}
+		worker();
+		for (auto& w : workers) w.get();
+	}
+
+	size_t meshletCount = 0;
+	for (const auto& meshlets : lodMeshlets) meshletCount += meshlets.size();
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "[Spell] Built " << meshletCount << " meshlets (avg "
+		<< (indices.size() / 3) / std::max<size_t>(1, meshletCount) << " triangles) in "
+		<< std::chrono::duration<float, std::milli>(end - start).count() << "ms" << std::endl;
+}
+
+void SpellModel::createClusterBuffers(const std::vector<std::vector<Meshlet>>& lodMeshlets, uint32_t indexCount) {
+	// (meshlet, instance) pairs beyond this are not worth an indirect slot each; such
+	// models keep the direct instanced draws
+	constexpr uint64_t MAX_CLUSTERS = 1u << 21;
+
+	// ========== Flatten meshlets, expand clusters per instance ==========
+	// Every level gets clusters; the cull pass drops those of levels that are not selected
+	std::vector<Meshlet> meshlets;
+	uint64_t clusterCount = 0;
+	for (const auto& range : drawRanges_) {
+		for (uint32_t l = range.firstLod; l < range.firstLod + range.lodCount; l++) {
+			clusterCount += static_cast<uint64_t>(lodMeshlets[l].size()) * range.instanceCount;
+		}
+	}
+	if (clusterCount == 0 || clusterCount > MAX_CLUSTERS) {
+		std::cout << "[Spell] Cluster culling disabled for this model (" << clusterCount << " clusters)" << std::endl;
+		return;
+	}
+
+	// Matches the uvec2 cluster entries in cluster_cull.comp
+	struct Cluster {
+		uint32_t meshlet;
+		uint32_t instance;
+	};
+	std::vector<Cluster> clusters;
+	clusters.reserve(static_cast<size_t>(clusterCount));
+	for (uint32_t r = 0; r < drawRanges_.size(); r++) {
+		const DrawRange& range = drawRanges_[r];
+		const uint32_t firstMeshlet = static_cast<uint32_t>(meshlets.size());
+		for (uint32_t level = 0; level < range.lodCount; level++) {
+			for (Meshlet meshlet : lodMeshlets[range.firstLod + level]) {
+				meshlet.range = r;
+				meshlet.lod = level;
+				meshlets.push_back(meshlet);
+			}
+		}
+		const uint32_t rangeMeshletCount = static_cast<uint32_t>(meshlets.size()) - firstMeshlet;
+		for (uint32_t i = 0; i < range.instanceCount; i++) {
+			for (uint32_t m = 0; m < rangeMeshletCount; m++) {
+				clusters.push_back({ firstMeshlet + m, range.firstInstance + i });
+			}
+		}
+	}
+	meshletCount_ = static_cast<uint32_t>(meshlets.size());
+	clusterCount_ = static_cast<uint32_t>(clusters.size());
+
+	createDeviceLocalBuffer(meshlets.data(), sizeof(Meshlet) * meshlets.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, meshletBuffer_, meshletBufferMemory_);
+	createDeviceLocalBuffer(clusters.data(), sizeof(Cluster) * clusters.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, clusterBuffer_, clusterBufferMemory_);
+
+	// ========== Per-frame indirect draw list and visible counter ==========
+	clusterFrames_.resize(SpellSwapChain::MAX_FRAMES_IN_FLIGHT);
+	for (auto& frame : clusterFrames_) {
+		device_.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * clusterCount_,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.drawCommands, frame.drawCommandsMemory);
+
+		// [0] visible clusters (front of the list), [1] culled clusters (back of the list),
+		// [2] occluded clusters (counted in [1] too); also the draw count of the indirect draw
+		const VkDeviceSize countSize = DRAW_COUNTERS * sizeof(uint32_t);
+		device_.createBuffer(countSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.drawCount, frame.drawCountMemory);
+		void* mapped;
+		vkMapMemory(device_.device(), frame.drawCountMemory, 0, countSize, 0, &mapped);
+		std::memset(mapped, 0, countSize);
+		frame.mappedCount = static_cast<const uint32_t*>(mapped);
+
+		// Selected level per draw range, rewritten by selectLods() before each dispatch
+		const VkDeviceSize lodSize = sizeof(uint32_t) * drawRanges_.size();
+		device_.createBuffer(lodSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.lodSelection, frame.lodSelectionMemory);
+		vkMapMemory(device_.device(), frame.lodSelectionMemory, 0, lodSize, 0, &mapped);
+		std::memset(mapped, 0, static_cast<size_t>(lodSize));
+		frame.mappedLods = static_cast<uint32_t*>(mapped);
+	}
+
+	std::cout << "[Spell] Cluster culling: " << meshletCount_ << " meshlets, " << clusterCount_ << " clusters, "
+		<< indexCount / 3 << " triangles" << std::endl;
+}
+
+void SpellModel::selectLods(const UniformBufferObject& ubo, float viewportHeight, float pixelError,
+	uint32_t frameIndex) {
+	// Pixels per model unit at distance 1: projected error = error * pixelScale / distance
+	const float pixelScale = std::fabs(ubo.proj[1][1]) * 0.5f * viewportHeight;
+	const glm::mat4& model = ubo.model;
+	const float modelScale = std::max(glm::length(glm::vec3(model[0])),
+		std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+	activeLodMin_ = std::numeric_limits<uint32_t>::max();
+	activeLodMax_ = 0;
+	renderedTriangles_ = 0;
+	drawCount_ = 0;
+	for (auto& range : drawRanges_) {
+		// Finest level any instance needs; pixelError <= 0 keeps full detail
+		uint32_t level = pixelError > 0.0f ? range.lodCount - 1 : 0;
+		for (uint32_t i = range.firstInstance; i < range.firstInstance + range.instanceCount && level > 0; i++) {
+			const InstanceBounds& bounds = instanceBounds_[i];
+			const glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center, 1.0f));
+			// Nearest point of the bounding sphere; inside it, nothing coarser than level 0 is safe
+			const float distance = glm::length(center - ubo.camPos) - bounds.radius * modelScale;
+			if (distance <= 0.0f) {
+				level = 0;
+				break;
+			}
+			const float scale = bounds.scale * modelScale * pixelScale / distance;
+			while (level > 0 && lods_[range.firstLod + level].error * scale > pixelError) level--;
+		}
+
+		range.activeLod = level;
+		activeLodMin_ = std::min(activeLodMin_, level);
+		activeLodMax_ = std::max(activeLodMax_, level);
+		renderedTriangles_ += static_cast<uint64_t>(lods_[range.firstLod + level].indexCount / 3) * range.instanceCount;
+		drawCount_ += firstSubmesh_[range.firstLod + level + 1] - firstSubmesh_[range.firstLod + level];
+	}
+	if (drawRanges_.empty()) activeLodMin_ = 0;
+
+	if (frameIndex < clusterFrames_.size()) {
+		for (size_t r = 0; r < drawRanges_.size(); r++) {
+			clusterFrames_[frameIndex].mappedLods[r] = drawRanges_[r].activeLod;
+		}
+	}
+}
+
+void SpellModel::orderDraws(const UniformBufferObject& ubo, bool sortDraws, const std::vector<uint8_t>* visibleRanges) {
+	drawList_.clear();
+	frustumCulledDraws_ = 0;
+	for (uint32_t r = 0; r < drawRanges_.size(); r++) {
+		const uint32_t lod = drawRanges_[r].firstLod + drawRanges_[r].activeLod;
+		for (uint32_t s = firstSubmesh_[lod]; s < firstSubmesh_[lod + 1]; s++) {
+			const uint32_t bounds = submeshes_[s].bounds;
+			if (visibleRanges && bounds < visibleRanges->size() && !(*visibleRanges)[bounds]) {
+				frustumCulledDraws_++;
+				continue;
+			}
+			drawList_.push_back({ s, r, 0.0f });
+		}
+	}
+
+	if (sortDraws) {
+		const glm::mat4& model = ubo.model;
+		const float modelScale = std::max(glm::length(glm::vec3(model[0])),
+			std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+		// Instances of a range share its draws, so the nearest instance places them
+		std::vector<uint32_t> nearestInstance(drawRanges_.size());
+		for (uint32_t r = 0; r < drawRanges_.size(); r++) {
+			const DrawRange& range = drawRanges_[r];
+			float nearest = std::numeric_limits<float>::max();
+			nearestInstance[r] = range.firstInstance;
+			for (uint32_t i = range.firstInstance; i < range.firstInstance + range.instanceCount; i++) {
+				const InstanceBounds& bounds = instanceBounds_[i];
+				const glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center, 1.0f));
+				const float distance = glm::length(center - ubo.camPos) - bounds.radius * modelScale;
+				if (distance < nearest) {
+					nearest = distance;
+					nearestInstance[r] = i;
+				}
+			}
+		}
+
+		// Bucket 0 is "no material" (-1)
+		std::vector<float> materialDistance(materials_.size() + 1, std::numeric_limits<float>::max());
+		auto bucketOf = [&](const DrawItem& item) {
+			return static_cast<size_t>(std::clamp<int32_t>(submeshes_[item.submesh].materialIndex + 1, 0,
+				static_cast<int32_t>(materials_.size())));
+		};
+		for (auto& item : drawList_) {
+			const MaterialRange& bounds = materialRanges_[submeshes_[item.submesh].bounds];
+			const InstanceBounds& instance = instanceBounds_[nearestInstance[item.range]];
+			const glm::vec3 center = glm::vec3(model * instance.transform
+				* glm::vec4((bounds.boundsMin + bounds.boundsMax) * 0.5f, 1.0f));
+			const float radius = glm::length(bounds.boundsMax - bounds.boundsMin) * 0.5f * instance.scale * modelScale;
+			item.distance = std::max(0.0f, glm::length(center - ubo.camPos) - radius);
+			float& nearest = materialDistance[bucketOf(item)];
+			nearest = std::min(nearest, item.distance);
+		}
+
+		std::sort(drawList_.begin(), drawList_.end(), [&](const DrawItem& a, const DrawItem& b) {
+			const size_t bucketA = bucketOf(a), bucketB = bucketOf(b);
+			if (bucketA != bucketB) {
+				if (materialDistance[bucketA] != materialDistance[bucketB]) {
+					return materialDistance[bucketA] < materialDistance[bucketB];
+				}
+				return bucketA < bucketB;
+			}
+			return a.distance < b.distance;
+		});
+	}
+
+	materialSwitches_ = 0;
+	for (size_t d = 1; d < drawList_.size(); d++) {
+		if (submeshes_[drawList_[d].submesh].materialIndex != submeshes_[drawList_[d - 1].submesh].materialIndex) {
+			materialSwitches_++;
+		}
+	}
+}
+
+uint32_t SpellModel::readVisibleClusterCount(uint32_t frameIndex) const {
+	if (frameIndex >= clusterFrames_.size()) return 0;
+	return std::min(clusterFrames_[frameIndex].mappedCount[0], clusterCount_);
+}
+
+uint32_t SpellModel::readOccludedClusterCount(uint32_t frameIndex) const {
+	if (frameIndex >= clusterFrames_.size()) return 0;
+	return std::min(clusterFrames_[frameIndex].mappedCount[2], clusterCount_);
 }
 
-void SpellModel::createIndexBuffer() {
-	VkDeviceSize bufferSize = sizeof(indices_[0]) * indices_.size();
+void SpellModel::createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+	VkBuffer& buffer, VkDeviceMemory& memory) {
+	VkDeviceSize bufferSize = size;
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -67,30 +606,38 @@ void SpellModel::createIndexBuffer() {
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 		stagingBuffer, stagingBufferMemory);
 
-	void* data;
-	vkMapMemory(device_.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices_.data(), static_cast<size_t>(bufferSize));
+	void* mapped;
+	vkMapMemory(device_.device(), stagingBufferMemory, 0, bufferSize, 0, &mapped);
+	memcpy(mapped, data, static_cast<size_t>(bufferSize));
 	vkUnmapMemory(device_.device(), stagingBufferMemory);
 
 	device_.createBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer_, indexBufferMemory_);
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
 
-	device_.copyBuffer(stagingBuffer, indexBuffer_, bufferSize);
+	device_.copyBuffer(stagingBuffer, buffer, bufferSize);
 
 	vkDestroyBuffer(device_.device(), stagingBuffer, nullptr);
 	vkFreeMemory(device_.device(), stagingBufferMemory, nullptr);
 }
 
 void SpellModel::bind(VkCommandBuffer commandBuffer) {
-	VkBuffer buffers[] = { vertexBuffer_ };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, indexBuffer_, 0, VK_INDEX_TYPE_UINT32);
+	// Split streams are all bound; each pipeline only declares (and fetches) the ones it reads
+	VkBuffer buffers[] = { vertexBuffer_, instanceBuffer_, shadingBuffer_, materialBuffer_ };
+	VkDeviceSize offsets[] = { 0, 0, 0, 0 };
+	uint32_t bindingCount = 2;
+	if (shadingBuffer_ != VK_NULL_HANDLE) bindingCount = materialBuffer_ != VK_NULL_HANDLE ? 4 : 3;
+	vkCmdBindVertexBuffers(commandBuffer, 0, bindingCount, buffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer_, 0, indexType_);
 }
 
 void SpellModel::draw(VkCommandBuffer commandBuffer) {
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices_.size()), 1, 0, 0, 0);
+	for (const auto& item : drawList_) {
+		const Submesh& submesh = submeshes_[item.submesh];
+		const DrawRange& range = drawRanges_[item.range];
+		vkCmdDrawIndexed(commandBuffer, submesh.indexCount, range.instanceCount,
+			submesh.firstIndex, submesh.vertexOffset, range.firstInstance);
+	}
 }
 
 } // namespace Spell
@@ -20,6 +20,8 @@ struct MaterialInfo {
 	std::string normalTexturePath;
 	std::string metallicTexturePath;
 	std::string roughnessTexturePath;
+	// glTF metallicRoughness: both paths name one image with metallic in B and roughness in G
+	bool packedMetallicRoughness = false;
 };
 
 struct Vertex {
@@ -37,32 +39,28 @@ struct Vertex {
 		return bindingDesc;
 	}
 
-	static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 5> attributeDesc{};
+	// The color is always white and is not fetched (location 1 is unused)
+	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 4> attributeDesc{};
 		attributeDesc[0].binding = 0;
 		attributeDesc[0].location = 0;
 		attributeDesc[0].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDesc[0].offset = offsetof(Vertex, pos);
 
 		attributeDesc[1].binding = 0;
-		attributeDesc[1].location = 1;
-		attributeDesc[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDesc[1].offset = offsetof(Vertex, color);
+		attributeDesc[1].location = 2;
+		attributeDesc[1].format = VK_FORMAT_R32G32_SFLOAT;
+		attributeDesc[1].offset = offsetof(Vertex, texCoord);
 
 		attributeDesc[2].binding = 0;
-		attributeDesc[2].location = 2;
-		attributeDesc[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDesc[2].offset = offsetof(Vertex, texCoord);
+		attributeDesc[2].location = 3;
+		attributeDesc[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDesc[2].offset = offsetof(Vertex, normal);
 
 		attributeDesc[3].binding = 0;
-		attributeDesc[3].location = 3;
-		attributeDesc[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDesc[3].offset = offsetof(Vertex, normal);
-
-		attributeDesc[4].binding = 0;
-		attributeDesc[4].location = 4;
-		attributeDesc[4].format = VK_FORMAT_R32_SINT;
-		attributeDesc[4].offset = offsetof(Vertex, materialIndex);
+		attributeDesc[3].location = 4;
+		attributeDesc[3].format = VK_FORMAT_R32_SINT;
+		attributeDesc[3].offset = offsetof(Vertex, materialIndex);
 
 		return attributeDesc;
 	}
@@ -73,6 +71,20 @@ struct Vertex {
 	}
 };
 
+// Vertex buffer layout chosen when a model is uploaded
+enum class VertexFormat : uint32_t {
+	Full,   // Vertex, 48 bytes
+	Packed, // PackedVertex (see VertexQuantization), 16 bytes
+	Count
+};
+
+// How the vertex attributes are spread over buffers (see VertexStreams)
+enum class VertexLayout : uint32_t {
+	Interleaved, // one buffer in binding 0
+	Split,       // position, shading attributes and material in separate bindings
+	Count
+};
+
 } // namespace Spell
 
 namespace std {
@@ -93,12 +105,100 @@ namespace std {
 
 namespace Spell {
 
+// A unique piece of geometry inside the model's shared index buffer
+struct MeshRange {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+// Triangles of one material inside a MeshRange (or the whole buffer for flat models) and their
+// bounds in mesh space. Loaders group triangles by material (see MaterialRanges).
+struct MaterialRange {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	int32_t materialIndex = -1;
+	glm::vec3 boundsMin{ 0.0f };
+	glm::vec3 boundsMax{ 0.0f };
+};
+
+// A run of the index buffer drawn with its own base vertex, so its indices fit in 16 bits
+// relative to vertexOffset (see SubmeshSplitter). Submeshes never span two materials.
+struct Submesh {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	int32_t vertexOffset = 0;
+	int32_t materialIndex = -1;
+	uint32_t bounds = 0;        // MaterialRange the triangles come from, for draw ordering
+};
+
+// One placement of a MeshRange in the scene (world matrix flattened from the node tree)
+struct MeshInstance {
+	uint32_t meshIndex = 0;
+	glm::mat4 transform{ 1.0f };
+};
+
+// Per-instance vertex input (binding 1): model matrix in locations 5..8, dequantization of the
+// instance's mesh in location 9 (offset xyz, scale w; only read by the packed vertex pipelines)
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec4 dequant{ 0.0f, 0.0f, 0.0f, 1.0f };
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDesc{};
+		bindingDesc.binding = 1;
+		bindingDesc.stride = sizeof(InstanceData);
+		bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+		return bindingDesc;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 5> attributeDesc{};
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDesc[column].binding = 1;
+			attributeDesc[column].location = 5 + column;
+			attributeDesc[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDesc[column].offset = static_cast<uint32_t>(sizeof(glm::vec4) * column);
+		}
+		attributeDesc[4].binding = 1;
+		attributeDesc[4].location = 9;
+		attributeDesc[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDesc[4].offset = offsetof(InstanceData, dequant);
+		return attributeDesc;
+	}
+};
+
+// Non-owning view of everything SpellModel uploads. meshes/instances may be empty,
+// in which case the whole index buffer is drawn once with an identity transform.
+struct ModelGeometryView {
+	const Vertex* vertices = nullptr;
+	uint32_t vertexCount = 0;
+	const uint32_t* indices = nullptr;
+	uint32_t indexCount = 0;
+	const MeshRange* meshes = nullptr;
+	uint32_t meshCount = 0;
+	const MeshInstance* instances = nullptr;
+	uint32_t instanceCount = 0;
+	const MaterialRange* materialRanges = nullptr; // may be empty; ranges are then found by scanning
+	uint32_t materialRangeCount = 0;
+};
+
 struct ModelLoadResult;
+struct LodChain;
+struct MeshLod;
+struct Meshlet;
+struct UniformBufferObject;
 
 class SpellModel {
 public:
-	SpellModel(SpellDevice& device, ModelLoadResult&& data);
+	SpellModel(SpellDevice& device, ModelLoadResult&& data, VertexFormat format = VertexFormat::Full,
+		VertexLayout layout = VertexLayout::Interleaved);
 	SpellModel(SpellDevice& device, const std::string& modelPath);
+	// Uploads from caller-owned memory (e.g. a mapped mesh cache file); nothing is kept on the CPU
+	// `lods` (see MeshSimplifier) is appended to the index buffer; selectLods() picks a level per draw.
+	// `format` and `layout` select the vertex buffers and thereby the pipelines that can draw the model.
+	SpellModel(SpellDevice& device, const ModelGeometryView& geometry, std::vector<MaterialInfo> materials,
+		VertexFormat format = VertexFormat::Full, VertexLayout layout = VertexLayout::Interleaved,
+		const LodChain* lods = nullptr);
 	~SpellModel();
 
 	SpellModel(const SpellModel&) = delete;
@@ -107,24 +207,185 @@ public:
 	void bind(VkCommandBuffer commandBuffer);
 	void draw(VkCommandBuffer commandBuffer);
 
-	uint32_t getVertexCount() const { return static_cast<uint32_t>(vertices_.size()); }
-	uint32_t getIndexCount() const { return static_cast<uint32_t>(indices_.size()); }
+	uint32_t getVertexCount() const { return vertexCount_; }
+	VertexFormat getVertexFormat() const { return vertexFormat_; }
+	VertexLayout getVertexLayout() const { return vertexLayout_; }
+	VkDeviceSize getVertexBufferSize() const { return vertexBufferSize_; }
+	uint32_t getIndexCount() const { return indexCount_; }
+	// 16-bit when every submesh (see SubmeshSplitter) fits the 16-bit range around its base vertex
+	VkIndexType getIndexType() const { return indexType_; }
+	VkDeviceSize getIndexBufferSize() const { return indexBufferSize_; }
+	uint32_t getSubmeshCount() const { return static_cast<uint32_t>(submeshes_.size()); }
+	// Material ranges of every base level (disjoint index runs of the geometry); Submesh::bounds
+	// and the ranges of a MeshBvh built from this list index it
+	const std::vector<MaterialRange>& getMaterialRanges() const { return materialRanges_; }
 	const std::vector<MaterialInfo>& getMaterials() const { return materials_; }
 
+	// Instanced draw statistics; a draw range takes one draw per submesh of its active level,
+	// so at least one per material
+	uint32_t getDrawCount() const { return drawCount_; }
+	uint32_t getInstanceCount() const { return instanceCount_; }
+	uint64_t getRenderedTriangleCount() const { return renderedTriangles_; }
+
+	// Level of detail. selectLods() picks, per draw, the coarsest level whose simplification
+	// error projects to at most `pixelError` pixels on screen. Instances of a mesh share one
+	// draw, so the nearest instance decides. Call once per frame before draw() or the cull
+	// dispatch; `frameIndex` selects the LOD buffer the cull pass of that frame reads.
+	bool hasLods() const { return lodLevelCount_ > 1; }
+	uint32_t getLodLevelCount() const { return lodLevelCount_; } // including the full-detail level
+	void selectLods(const UniformBufferObject& ubo, float viewportHeight, float pixelError, uint32_t frameIndex);
+	uint32_t getActiveLodMin() const { return activeLodMin_; }
+	uint32_t getActiveLodMax() const { return activeLodMax_; }
+	uint64_t getTrianglesSaved() const { return baseTriangles_ - renderedTriangles_; }
+
+	// Draw order of draw(). Call after selectLods(). With `sortDraws`, draws are grouped by
+	// material, materials ordered by their nearest draw and draws front to back within a
+	// material, so early depth testing rejects hidden fragments before the PBR shader runs.
+	// Without it, draws follow the index buffer. With `visibleRanges` (see MeshBvh::queryFrustum),
+	// submeshes of ranges marked 0 are left out.
+	void orderDraws(const UniformBufferObject& ubo, bool sortDraws, const std::vector<uint8_t>* visibleRanges = nullptr);
+	// Adjacent draws of the last order with different materials
+	uint32_t getMaterialSwitches() const { return materialSwitches_; }
+	// Draws of the active levels the last order left out as outside the frustum
+	uint32_t getFrustumCulledDraws() const { return frustumCulledDraws_; }
+
+	// GPU cluster culling input (see SpellClusterCuller). Each drawn mesh is split into meshlets
+	// at load; every (meshlet, instance) pair is one cluster with its own indirect draw slot.
+	bool hasClusters() const { return clusterCount_ > 0; }
+	uint32_t getMeshletCount() const { return meshletCount_; }
+	uint32_t getClusterCount() const { return clusterCount_; }
+	VkBuffer getMeshletBuffer() const { return meshletBuffer_; }
+	VkBuffer getClusterBuffer() const { return clusterBuffer_; }
+	VkBuffer getInstanceBuffer() const { return instanceBuffer_; }
+	// Per frame-in-flight outputs of the cull pass. The count buffer holds DRAW_COUNTERS uints:
+	// visible (the indirect draw count), culled, occluded, padding
+	static constexpr uint32_t DRAW_COUNTERS = 4;
+	VkBuffer getDrawCommandBuffer(uint32_t frameIndex) const { return clusterFrames_[frameIndex].drawCommands; }
+	VkBuffer getDrawCountBuffer(uint32_t frameIndex) const { return clusterFrames_[frameIndex].drawCount; }
+	// Selected LOD level per draw range, written by selectLods()
+	VkBuffer getLodSelectionBuffer(uint32_t frameIndex) const { return clusterFrames_[frameIndex].lodSelection; }
+	// Clusters that survived the last cull in this frame slot; only meaningful once that
+	// frame's fence has signalled (i.e. right after beginFrame returned the slot)
+	uint32_t readVisibleClusterCount(uint32_t frameIndex) const;
+	// Clusters of the same cull rejected by the depth pyramid; same rules as above
+	uint32_t readOccludedClusterCount(uint32_t frameIndex) const;
+
 private:
-	void createVertexBuffer();
-	void createIndexBuffer();
+	// One instanced draw: a mesh and its contiguous run in the instance buffer
+	struct DrawRange {
+		uint32_t meshIndex;     // into ModelGeometryView::meshes (0 for flat models)
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		uint32_t firstLod;      // into lods_; level 0 is the full-detail mesh
+		uint32_t lodCount;
+		uint32_t activeLod;
+		glm::vec3 center;       // bounding sphere, model space
+		float radius;
+		uint32_t firstMaterial; // into materialRanges_, ranges of the base level
+		uint32_t materialCount;
+	};
+
+	// Triangles of one material within one entry of lods_. Meshlets are built per run and
+	// submeshes never cross one, so every draw (direct or culled) has a single material.
+	struct MaterialRun {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t materialIndex;
+		uint32_t bounds;        // into materialRanges_
+	};
+
+	struct DrawItem {
+		uint32_t submesh;
+		uint32_t range;
+		float distance;         // nearest point of the submesh bounds, for sorting
+	};
+
+	// Instance bounds in the space of UniformBufferObject::model, for LOD selection
+	struct InstanceBounds {
+		glm::vec3 center;
+		float radius;
+		float scale;            // largest axis scale, applied to the LOD error
+		glm::mat4 transform;    // instance matrix, for draw ordering
+	};
+
+	// Cull pass outputs for one frame in flight; the count buffer stays mapped for the stats readback
+	struct ClusterFrame {
+		VkBuffer drawCommands = VK_NULL_HANDLE;
+		VkDeviceMemory drawCommandsMemory = VK_NULL_HANDLE;
+		VkBuffer drawCount = VK_NULL_HANDLE;
+		VkDeviceMemory drawCountMemory = VK_NULL_HANDLE;
+		const uint32_t* mappedCount = nullptr;
+		VkBuffer lodSelection = VK_NULL_HANDLE;
+		VkDeviceMemory lodSelectionMemory = VK_NULL_HANDLE;
+		uint32_t* mappedLods = nullptr;
+	};
+
+	// Packed formats also return the dequantization per MeshRange
+	std::vector<glm::vec4> createVertexBuffer(const ModelGeometryView& geometry);
+	void createIndexBuffer(const uint32_t* indices, uint32_t indexCount);
+	void createInstanceBuffer(const ModelGeometryView& geometry, const std::vector<glm::vec4>& meshDequant);
+	// Appends the LOD levels of every draw range to `indices` and lods_
+	void appendLods(const LodChain* lods, std::vector<uint32_t>& indices);
+	// Fills materialRanges_ (from the loader, or by scanning) and the material runs of every level
+	void createMaterialRuns(const ModelGeometryView& geometry, const std::vector<uint32_t>& indices);
+	// Builds meshlets per material run of every entry of lods_, reordering `indices` in place
+	void buildLodMeshlets(const Vertex* vertices, std::vector<uint32_t>& indices,
+		std::vector<std::vector<Meshlet>>& lodMeshlets);
+	// Picks the index type and splits every material run into 16-bit submeshes if the vertex
+	// ranges allow; sets the meshlets' base vertex accordingly
+	void createSubmeshes(const std::vector<uint32_t>& indices, std::vector<std::vector<Meshlet>>& lodMeshlets);
+	// Uploads the meshlets and (meshlet, instance) clusters for GPU culling
+	void createClusterBuffers(const std::vector<std::vector<Meshlet>>& lodMeshlets, uint32_t indexCount);
+	void createDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkBuffer& buffer, VkDeviceMemory& memory);
 
 	SpellDevice& device_;
 
-	std::vector<Vertex> vertices_;
-	std::vector<uint32_t> indices_;
+	uint32_t vertexCount_ = 0;
+	VertexFormat vertexFormat_;
+	VertexLayout vertexLayout_;
+	VkDeviceSize vertexBufferSize_ = 0;
+	uint32_t indexCount_ = 0;
+	VkIndexType indexType_ = VK_INDEX_TYPE_UINT32;
+	VkDeviceSize indexBufferSize_ = 0;
+	uint32_t instanceCount_ = 0;
+	uint32_t drawCount_ = 0;
+	uint64_t renderedTriangles_ = 0;
+	uint64_t baseTriangles_ = 0;
 	std::vector<MaterialInfo> materials_;
+	std::vector<DrawRange> drawRanges_;
+	std::vector<MeshLod> lods_;
+	std::vector<Submesh> submeshes_;
+	std::vector<uint32_t> firstSubmesh_; // submeshes of lods_[l] are [firstSubmesh_[l], firstSubmesh_[l + 1])
+	std::vector<MaterialRange> materialRanges_;
+	std::vector<MaterialRun> materialRuns_;
+	std::vector<uint32_t> firstRun_;     // runs of lods_[l] are [firstRun_[l], firstRun_[l + 1])
+	std::vector<DrawItem> drawList_;
+	uint32_t materialSwitches_ = 0;
+	uint32_t frustumCulledDraws_ = 0;
+	std::vector<InstanceBounds> instanceBounds_;
+	uint32_t lodLevelCount_ = 1;
+	uint32_t activeLodMin_ = 0;
+	uint32_t activeLodMax_ = 0;
 
-	VkBuffer vertexBuffer_;
+	VkBuffer vertexBuffer_;                // interleaved vertices, or positions when split
 	VkDeviceMemory vertexBufferMemory_;
+	VkBuffer shadingBuffer_ = VK_NULL_HANDLE;  // split layout only
+	VkDeviceMemory shadingBufferMemory_ = VK_NULL_HANDLE;
+	VkBuffer materialBuffer_ = VK_NULL_HANDLE; // split Full layout only
+	VkDeviceMemory materialBufferMemory_ = VK_NULL_HANDLE;
 	VkBuffer indexBuffer_;
 	VkDeviceMemory indexBufferMemory_;
+	VkBuffer instanceBuffer_;
+	VkDeviceMemory instanceBufferMemory_;
+
+	uint32_t meshletCount_ = 0;
+	uint32_t clusterCount_ = 0;
+	VkBuffer meshletBuffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory meshletBufferMemory_ = VK_NULL_HANDLE;
+	VkBuffer clusterBuffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory clusterBufferMemory_ = VK_NULL_HANDLE;
+	std::vector<ClusterFrame> clusterFrames_;
 };
 
 } // namespace Spell
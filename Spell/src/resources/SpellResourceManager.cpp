@@ -1,6 +1,11 @@
 #include "SpellResourceManager.h"
 #include "IModelLoader.h"
 #include "ModelLoaderFactory.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "BlockCompression.h"
+#include "ContentHash.h"
+#include "core/SpellSwapChain.h"
 
 #include <stb_image.h>
 #include <algorithm>
@@ -8,99 +13,362 @@
 #include <fstream>
 #include <filesystem>
 #include <future>
+#include <limits>
+#include <unordered_map>
 
 namespace Spell {
 
+namespace {
+
+// Identity of a decoded texture: the image, by canonical path or by the content hash of an
+// embedded image, and the format and channels it is decoded to
+std::string textureImageKey(const std::string& path, VkFormat format, TextureChannels channels,
+	const IModelLoadSession* imageSource) {
+	std::string image = path;
+	if (isEmbeddedImagePath(path)) {
+		std::vector<unsigned char> scratch;
+		EmbeddedImage embedded;
+		if (imageSource && imageSource->readEmbeddedImage(path, scratch, embedded)) {
+			image = "#" + hashToHex(hashBytes(embedded.data, embedded.size));
+		}
+	} else {
+		std::error_code ec;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+		if (!ec) image = canonical.generic_string();
+	}
+	return image + "|" + std::to_string(static_cast<uint32_t>(format))
+		+ "|" + std::to_string(static_cast<uint32_t>(channels));
+}
+
+} // namespace
+
+struct SpellResourceManager::LodSource {
+	CachedMesh cachedMesh;      // cache hit: the geometry points into its mapping
+	ModelLoadResult loadResult; // cache miss
+	ModelGeometryView geometry;
+	std::vector<MaterialInfo> materials;
+};
+
 SpellResourceManager::SpellResourceManager(SpellDevice& device)
 	: device_{ device } {
+	// Compressed material textures need every format blockFormatForChannels can pick
+	bcSupported_ = true;
+	for (uint32_t f = 0; f < static_cast<uint32_t>(BlockFormat::Count); f++) {
+		for (bool srgb : { false, true }) {
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(device_.physicalDevice(),
+				blockFormatToVk(static_cast<BlockFormat>(f), srgb), &properties);
+			if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+				bcSupported_ = false;
+			}
+		}
+	}
+	if (!bcSupported_) {
+		std::cout << "[Spell] BC texture formats not supported, material textures stay RGBA8" << std::endl;
+	}
+	createFallbackTextures();
 	scanAvailableFiles();
 }
 
+SpellResourceManager::~SpellResourceManager() {
+	// The reload thread uses the device; let it finish before anything is torn down
+	lodProgress_.cancel = true;
+	if (reloadFuture_.valid()) {
+		try {
+			reloadFuture_.get();
+		} catch (const std::exception&) {
+		}
+	}
+}
+
 // ============================================================
 // Shared parallel load pipeline: used by both loadInitial and reload
 // ============================================================
-void SpellResourceManager::loadWithLoader(IModelLoader& loader) {
+SpellResourceManager::ResourceSet SpellResourceManager::loadWithLoader(IModelLoader& loader,
+	const std::string& modelPath, const std::string& texturePath) {
 	auto totalStart = std::chrono::high_resolution_clock::now();
+	ResourceSet set;
+	auto setStage = [this](ReloadStage stage) { reloadStage_ = static_cast<uint32_t>(stage); };
+	setStage(ReloadStage::Opening);
+	texturesDecoded_ = 0;
+	texturesToDecode_ = 0;
+
+	// Step 0: Mesh cache lookup. A hit also provides the material list, so the
+	// source file is not opened at all.
+	CachedMesh cachedMesh;
+	set.modelCacheHit = MeshCache::load(modelPath, loader, cachedMesh);
+	const bool optimizeMeshes = optimizeMeshes_;
+	const bool keepLodSource = generateLods_;
+	const VertexFormat vertexFormat = vertexFormat_;
+	const VertexLayout vertexLayout = vertexLayout_;
+	if (set.modelCacheHit && cachedMesh.optimizeStats.optimized != optimizeMeshes) {
+		// Stored with the other optimization setting; parse again and overwrite it
+		cachedMesh = CachedMesh{};
+		set.modelCacheHit = false;
+	}
 
-	// Step 1: Pre-parse texture paths (fast, format-specific)
-	auto preParsedMaterials = loader.preParseTexturePaths(modelPath_);
+	// Hash the source alongside parsing so a miss can be written back to the cache
+	std::future<std::pair<bool, uint64_t>> sourceHashFuture;
+	if (!set.modelCacheHit) {
+		sourceHashFuture = std::async(std::launch::async, [path = modelPath]() {
+			uint64_t hash = 0;
+			bool ok = hashFile(path, hash);
+			return std::make_pair(ok, hash);
+		});
+	}
+
+	// Step 1: Open a loader session. The document is parsed once; its material table
+	// is available right away and geometry is extracted from it in step 3.
+	std::unique_ptr<IModelLoadSession> session;
+	if (!set.modelCacheHit) {
+		session = loader.open(modelPath);
+	}
+	auto preParsedMaterials = set.modelCacheHit ? cachedMesh.materials : session->materials();
+
+	// Embedded images are read through the session, so a cache hit still needs one open
+	// (parse only, geometry stays in the cache)
+	const bool usesEmbeddedImages = std::any_of(preParsedMaterials.begin(), preParsedMaterials.end(),
+		[](const MaterialInfo& mat) {
+			return isEmbeddedImagePath(mat.diffuseTexturePath) || isEmbeddedImagePath(mat.normalTexturePath)
+				|| isEmbeddedImagePath(mat.metallicTexturePath) || isEmbeddedImagePath(mat.roughnessTexturePath);
+		});
+	if (!session && usesEmbeddedImages) {
+		session = loader.open(modelPath);
+	}
 
 	// Step 2: Kick off async texture CPU decode BEFORE model loading
-	auto decodeImage = [](const std::string& path) -> DecodedImageData {
+	setStage(ReloadStage::DecodingTextures);
+	const IModelLoadSession* imageSource = session.get();
+	const bool useTextureCache = useTextureCache_;
+	const TextureCompression compression = textureCompression();
+	auto decodeImage = [this, imageSource, useTextureCache](const std::string& path, VkFormat format,
+		TextureChannels channels) -> DecodedImageData {
+		BlockFormat blockFormat;
+		const bool compressed = blockFormatFromVk(format, blockFormat);
 		DecodedImageData result;
+		result.decodeStart = std::chrono::high_resolution_clock::now();
 		result.sourcePath = path;
 		int texChannels;
-		result.pixels = stbi_load(path.c_str(), &result.width, &result.height, &texChannels, STBI_rgb_alpha);
-		if (result.pixels) {
-			result.imageSize = static_cast<VkDeviceSize>(result.width) * result.height * 4;
+		std::vector<unsigned char> scratch;
+		EmbeddedImage embedded;
+		MappedFile sourceFile;
+		const unsigned char* encoded = nullptr;
+		size_t encodedSize = 0;
+		if (isEmbeddedImagePath(path)) {
+			// Decoded straight from the model's buffers, no temp file and no extra copy
+			if (imageSource && imageSource->readEmbeddedImage(path, scratch, embedded)) {
+				encoded = embedded.data;
+				encodedSize = embedded.size;
+			}
+		} else if (isKtx2Path(path)) {
+			// Already in its GPU format with its own mips; bypasses the cache
+			auto chain = std::make_shared<TextureMipChain>();
+			if (readKtx2(path, *chain)) {
+				result.mipChain = std::move(chain);
+			}
+		} else if (useTextureCache || compressed) {
+			// The cache is keyed by the encoded bytes, which are hashed through the mapping.
+			// The block encoders decode from the same mapping.
+			if (sourceFile.open(path)) {
+				encoded = reinterpret_cast<const unsigned char*>(sourceFile.data());
+				encodedSize = sourceFile.size();
+			}
+		} else {
+			result.pixels = stbi_load(path.c_str(), &result.width, &result.height, &texChannels, STBI_rgb_alpha);
+		}
+		if (encoded && encodedSize <= static_cast<size_t>(std::numeric_limits<int>::max())) {
+			// Every texture already has its own decode thread, so the block encoders run on it alone
+			if (useTextureCache) {
+				result.mipChain = TextureCache::loadOrBuild(encoded, encodedSize, format, channels, result.cacheHit, 1);
+				result.cacheMiss = result.mipChain && !result.cacheHit;
+			} else if (compressed) {
+				result.mipChain = buildTextureChain(encoded, encodedSize, format, channels, 1);
+			} else {
+				result.pixels = stbi_load_from_memory(encoded, static_cast<int>(encodedSize),
+					&result.width, &result.height, &texChannels, STBI_rgb_alpha);
+			}
+		}
+		if (result.mipChain) {
+			result.width = static_cast<int>(result.mipChain->width);
+			result.height = static_cast<int>(result.mipChain->height);
+			result.imageSize = result.mipChain->stagingSize();
+			result.valid = true;
+		} else if (result.pixels) {
+			// Scalar and two-channel maps shrink to R8 / RG8 in place
+			const size_t pixelCount = static_cast<size_t>(result.width) * result.height;
+			selectTextureChannels(result.pixels, pixelCount, channels);
+			result.channels = textureChannelCount(channels);
+			result.imageSize = static_cast<VkDeviceSize>(pixelCount) * result.channels;
 			result.valid = true;
 		}
+		result.decodeEnd = std::chrono::high_resolution_clock::now();
+		texturesDecoded_++;
 		return result;
 	};
 
+	// One decode per distinct image and format; material slots that share it (glTF
+	// metallic-roughness, maps reused across materials) refer to the same task
 	struct TextureTask {
 		std::string path;
-		bool srgb;
-		bool hasFile;
+		VkFormat format;
+		TextureChannels channels;
 	};
 	std::vector<TextureTask> tasks;
 	std::vector<bool> srgbFlags;
-	std::vector<bool> hasFileFlags;
+	std::vector<int32_t> slotImages;
+	std::unordered_map<std::string, int32_t> taskByKey;
+	std::unordered_map<std::string, std::string> embeddedKeys; // path + format -> key, hashed once
 
 	for (const auto& mat : preParsedMaterials) {
-		auto addTask = [&](const std::string& path, bool srgb) {
-			bool has = !path.empty() && std::filesystem::exists(path);
-			tasks.push_back({ path, srgb, has });
-			srgbFlags.push_back(srgb);
-			hasFileFlags.push_back(has);
+		auto addSlot = [&](const std::string& path, bool srgb, TextureChannels channels) {
+			bool has = !path.empty()
+				&& (isEmbeddedImagePath(path) ? imageSource != nullptr : std::filesystem::exists(path));
+			if (!has) {
+				slotImages.push_back(-1);
+				return;
+			}
+			VkFormat format = textureFormatForChannels(textureChannelCount(channels), srgb);
+			if (compression != TextureCompression::None) {
+				format = blockFormatToVk(blockFormatForChannels(channels, compression == TextureCompression::Fast), srgb);
+			}
+			std::string key;
+			if (isEmbeddedImagePath(path)) {
+				std::string& embeddedKey = embeddedKeys[path + "|" + std::to_string(static_cast<uint32_t>(format))
+					+ "|" + std::to_string(static_cast<uint32_t>(channels))];
+				if (embeddedKey.empty()) embeddedKey = textureImageKey(path, format, channels, imageSource);
+				key = embeddedKey;
+			} else {
+				key = textureImageKey(path, format, channels, imageSource);
+			}
+			auto [it, inserted] = taskByKey.emplace(key, static_cast<int32_t>(tasks.size()));
+			if (inserted) {
+				tasks.push_back({ path, format, channels });
+				srgbFlags.push_back(srgb);
+			}
+			slotImages.push_back(it->second);
 		};
-		addTask(mat.diffuseTexturePath, true);
-		addTask(mat.normalTexturePath, false);
-		addTask(mat.metallicTexturePath, false);
-		addTask(mat.roughnessTexturePath, false);
+		// A packed glTF metallic-roughness image becomes one RG8 / BC5 texture for both slots
+		const TextureChannels scalarChannels = mat.packedMetallicRoughness ? TextureChannels::Bg : TextureChannels::R;
+		addSlot(mat.diffuseTexturePath, true, TextureChannels::Rgba);
+		addSlot(mat.normalTexturePath, false, TextureChannels::Rg);
+		addSlot(mat.metallicTexturePath, false, scalarChannels);
+		addSlot(mat.roughnessTexturePath, false, scalarChannels);
 	}
 
-	// Launch async decode for all textures that have files
+	// Start decoding every distinct image; decoded images wait within the budget for the upload
 	auto decodeStart = std::chrono::high_resolution_clock::now();
-	std::vector<std::future<DecodedImageData>> futures(tasks.size());
-	for (size_t i = 0; i < tasks.size(); i++) {
-		if (tasks[i].hasFile) {
-			futures[i] = std::async(std::launch::async, decodeImage, tasks[i].path);
-		}
-	}
+	texturesToDecode_ += static_cast<uint32_t>(tasks.size());
+	TextureDecodeQueue decodes(tasks.size(), textureDecodeBudget(), [&decodeImage, &tasks](size_t i) {
+		return decodeImage(tasks[i].path, tasks[i].format, tasks[i].channels);
+	});
 
 	// Step 3: Load model IN PARALLEL with texture decoding
 	auto modelStart = std::chrono::high_resolution_clock::now();
-	auto loadResult = loader.load(modelPath_);
-	model_ = std::make_unique<SpellModel>(device_, std::move(loadResult));
+	// Geometry the model was built from; the BVH build reads it while textures are uploaded
+	ModelLoadResult loadResult;
+	ModelGeometryView geometry;
+	if (set.modelCacheHit) {
+		// Upload straight from the mapped cache file
+		set.meshOptimizeStats = cachedMesh.optimizeStats;
+		if (keepLodSource) {
+			// The mapping stays open for the LOD build; moving it keeps the view valid
+			auto source = std::make_shared<LodSource>();
+			source->geometry = cachedMesh.geometry;
+			source->materials = cachedMesh.materials;
+			set.model = std::make_unique<SpellModel>(device_, cachedMesh.geometry, std::move(cachedMesh.materials),
+				vertexFormat, vertexLayout);
+			source->cachedMesh = std::move(cachedMesh);
+			set.lodSource = std::move(source);
+		} else {
+			set.model = std::make_unique<SpellModel>(device_, cachedMesh.geometry, std::move(cachedMesh.materials),
+				vertexFormat, vertexLayout);
+		}
+		// Either still mapped here or kept alive by the LOD source; the view stays valid
+		geometry = set.lodSource ? set.lodSource->geometry : cachedMesh.geometry;
+		std::cout << "[Spell] Mesh cache hit: " << MeshCache::cachePathFor(modelPath) << std::endl;
+	} else {
+		loadResult = session->load();
+		if (optimizeMeshes) {
+			set.meshOptimizeStats = optimizeMesh(loadResult);
+		}
+		auto [hashOk, sourceHash] = sourceHashFuture.get();
+		if (hashOk) {
+			MeshCache::store(modelPath, loader, sourceHash, loadResult, set.meshOptimizeStats);
+		}
+		setStage(ReloadStage::BuildingModel);
+		if (keepLodSource) {
+			auto source = std::make_shared<LodSource>();
+			source->loadResult = std::move(loadResult);
+			source->geometry = source->loadResult.view();
+			source->materials = source->loadResult.materials;
+			set.model = std::make_unique<SpellModel>(device_, source->geometry, source->materials, vertexFormat,
+				vertexLayout);
+			geometry = source->geometry;
+			set.lodSource = std::move(source);
+		} else {
+			set.model = std::make_unique<SpellModel>(device_, loadResult.view(), loadResult.materials, vertexFormat,
+				vertexLayout);
+			geometry = loadResult.view();
+		}
+	}
 	auto modelEnd = std::chrono::high_resolution_clock::now();
-	lastModelLoadTimeMs_ = std::chrono::duration<float, std::milli>(modelEnd - modelStart).count();
+	set.modelLoadTimeMs = std::chrono::duration<float, std::milli>(modelEnd - modelStart).count();
+
+	const MeshOptimizeStats& optimizeStats = set.meshOptimizeStats;
+	if (optimizeStats.optimized) {
+		std::cout << "[Spell] Mesh optimize: ACMR " << optimizeStats.before.acmr << " -> " << optimizeStats.after.acmr
+			<< ", ATVR " << optimizeStats.before.atvr << " -> " << optimizeStats.after.atvr;
+		if (set.modelCacheHit) std::cout << " (from mesh cache)" << std::endl;
+		else std::cout << " in " << optimizeStats.timeMs << "ms" << std::endl;
+	}
+
+	// Step 3b: BVH for frustum queries and picking, built on workers alongside the texture upload
+	auto bvhFuture = std::async(std::launch::async, [&geometry, &ranges = set.model->getMaterialRanges()]() {
+		return std::make_shared<const MeshBvh>(geometry, ranges);
+	});
 
-	// Step 4: Create fallback textures (fast)
+	// Step 4: Diffuse for geometry without a material (the fallbacks already exist)
+	setStage(ReloadStage::UploadingTextures);
 	auto texStart = std::chrono::high_resolution_clock::now();
-	createFallbackWhiteTexture();
+	const uint32_t selectedDiffuse = loadSelectedDiffuseTexture(set, texturePath);
 
-	// Step 5: Collect decoded results and create GPU resources
-	loadMaterialTexturesFromDecoded(preParsedMaterials, futures, hasFileFlags, srgbFlags);
+	// Step 5: Stream decoded images to the GPU as they finish
+	loadMaterialTexturesFromDecoded(set, preParsedMaterials, decodes, srgbFlags, slotImages, selectedDiffuse,
+		decodeStart);
+
+	// All decodes have been collected, nothing reads the session's buffers any more
+	session.reset();
 
 	auto decodeEnd = std::chrono::high_resolution_clock::now();
 	float totalDecodeMs = std::chrono::duration<float, std::milli>(decodeEnd - decodeStart).count();
 
-	// Step 6: Batched GPU upload
-	submitBatchedTextureUpload();
+	// Step 6: Upload of the selected diffuse
+	submitBatchedTextureUpload(set);
 	auto texEnd = std::chrono::high_resolution_clock::now();
-	lastTextureLoadTimeMs_ = std::chrono::duration<float, std::milli>(texEnd - texStart).count();
+	set.textureLoadTimeMs = std::chrono::duration<float, std::milli>(texEnd - texStart).count();
 
-	lastTotalLoadTimeMs_ = std::chrono::duration<float, std::milli>(texEnd - totalStart).count();
+	set.bvh = bvhFuture.get();
+	if (set.bvh->empty()) set.bvh.reset();
+	cachedMesh.file.close();
+	loadResult = ModelLoadResult{};
 
-	// Compute overlap savings
-	float overlapMs = std::min(lastModelLoadTimeMs_, totalDecodeMs);
-	lastDecodeOverlapMs_ = overlapMs;
+	set.totalLoadTimeMs = std::chrono::duration<float, std::milli>(texEnd - totalStart).count();
 
-	std::cout << "[Spell] Load times - Model: " << lastModelLoadTimeMs_
-		<< "ms, Textures: " << lastTextureLoadTimeMs_
-		<< "ms, Total: " << lastTotalLoadTimeMs_
-		<< "ms (parallel overlap saved ~" << lastDecodeOverlapMs_ << "ms)" << std::endl;
+	// Compute overlap savings
+	float overlapMs = std::min(set.modelLoadTimeMs, totalDecodeMs);
+	set.decodeOverlapMs = overlapMs;
+
+	std::cout << "[Spell] Load times - Model: " << set.modelLoadTimeMs
+		<< "ms (mesh cache " << (set.modelCacheHit ? "hit" : "miss") << ")"
+		<< ", Textures: " << set.textureLoadTimeMs
+		<< "ms, Total: " << set.totalLoadTimeMs
+		<< "ms (parallel overlap saved ~" << set.decodeOverlapMs << "ms)" << std::endl;
+	if (set.bvh) {
+		std::cout << "[Spell] BVH: " << set.bvh->getTriangleCount() << " triangles, " << set.bvh->getNodeCount()
+			<< " nodes (" << set.bvh->getMemoryBytes() / (1024 * 1024) << " MB) in " << set.bvh->getBuildTimeMs()
+			<< "ms" << std::endl;
+	}
+	return set;
 }
 
 // ============================================================
@@ -108,232 +376,375 @@ void SpellResourceManager::loadWithLoader(IModelLoader& loader) {
 // ============================================================
 
 void SpellResourceManager::loadInitialResources() {
-	auto loader = ModelLoaderFactory::createLoader(modelPath_);
-	loadWithLoader(*loader);
+	auto loader = ModelLoaderFactory::createLoader(modelPath_, loaderSettings_);
+	current_ = loadWithLoader(*loader, modelPath_, texturePath_);
+	reloadStage_ = static_cast<uint32_t>(ReloadStage::Done);
 }
 
-void SpellResourceManager::reloadResources() {
-	vkDeviceWaitIdle(device_.device());
+// ============================================================
+// Background reload: load off-thread, swap at a frame boundary,
+// retire the old set once its frames have completed
+// ============================================================
 
-	model_.reset();
-	textures_.clear();
+void SpellResourceManager::beginReload(ReloadPrepareFn prepare) {
+	if (reloadFuture_.valid()) return;
+
+	lodBuildActive_ = false;
+	reloadStage_ = static_cast<uint32_t>(ReloadStage::Opening);
+	reloadFuture_ = std::async(std::launch::async,
+		[this, modelPath = modelPath_, texturePath = texturePath_, settings = loaderSettings_,
+			prepare = std::move(prepare)]() {
+			// The worker's command pool must go before the thread does, also on failure
+			struct CommandPoolGuard {
+				SpellDevice& device;
+				~CommandPoolGuard() { device.releaseThreadCommandPool(); }
+			} poolGuard{ device_ };
+
+			auto loader = ModelLoaderFactory::createLoader(modelPath, settings);
+			ResourceSet set = loadWithLoader(*loader, modelPath, texturePath);
+
+			reloadStage_ = static_cast<uint32_t>(ReloadStage::Preparing);
+			if (prepare) prepare(*set.model, set.bindlessTextures, *set.textureTable);
+
+			reloadStage_ = static_cast<uint32_t>(ReloadStage::Done);
+			return set;
+		});
+}
 
-	auto loader = ModelLoaderFactory::createLoader(modelPath_);
-	loadWithLoader(*loader);
+void SpellResourceManager::beginLodBuild(ReloadPrepareFn prepare) {
+	if (reloadFuture_.valid() || !current_.lodSource) return;
+
+	// The source moves to the worker; if the build is cancelled it is simply dropped
+	std::shared_ptr<LodSource> source = std::move(current_.lodSource);
+	const VertexFormat vertexFormat = current_.model->getVertexFormat();
+	const VertexLayout vertexLayout = current_.model->getVertexLayout();
+	lodBuildActive_ = true;
+	lodProgress_.cancel = false;
+	lodProgress_.meshesDone = 0;
+	lodProgress_.meshCount = 0;
+	reloadStage_ = static_cast<uint32_t>(ReloadStage::BuildingLods);
+	reloadFuture_ = std::async(std::launch::async,
+		[this, source, vertexFormat, vertexLayout, prepare = std::move(prepare)]() {
+			struct CommandPoolGuard {
+				SpellDevice& device;
+				~CommandPoolGuard() { device.releaseThreadCommandPool(); }
+			} poolGuard{ device_ };
+
+			ResourceSet set;
+			auto start = std::chrono::high_resolution_clock::now();
+			LodChain chain = buildLodChain(source->geometry, lodProgress_);
+			if (lodProgress_.cancel) return set; // no model: applyPendingReload keeps the current set
+
+			size_t levels = 0;
+			for (const auto& meshLods : chain.meshLods) levels = std::max(levels, meshLods.size());
+			if (levels == 0) {
+				std::cout << "[Spell] LOD build: nothing to simplify" << std::endl;
+				return set;
+			}
 
-	std::cout << "[Spell] Reloaded model: " << modelPath_
-		<< ", total textures: " << textures_.size() << std::endl;
+			set.model = std::make_unique<SpellModel>(device_, source->geometry, source->materials, vertexFormat,
+				vertexLayout, &chain);
+			set.lodUpgrade = true;
+			auto end = std::chrono::high_resolution_clock::now();
+			set.lodBuildTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+			std::cout << "[Spell] Built " << levels << " LOD levels (" << chain.indices.size() / 3
+				<< " extra triangles) in " << set.lodBuildTimeMs << "ms" << std::endl;
+
+			// The textures are the current set's; they do not change while this future is pending
+			reloadStage_ = static_cast<uint32_t>(ReloadStage::Preparing);
+			if (prepare) prepare(*set.model, current_.bindlessTextures, *current_.textureTable);
+
+			reloadStage_ = static_cast<uint32_t>(ReloadStage::Done);
+			return set;
+		});
 }
 
-void SpellResourceManager::createFallbackWhiteTexture() {
-	// Slot 0: fallback diffuse (sRGB white)
+ReloadProgress SpellResourceManager::reloadProgress() const {
+	ReloadProgress progress;
+	if (!reloadFuture_.valid()) return progress;
+
+	static const char* stageNames[] = {
+		"Opening model", "Decoding textures", "Building model buffers",
+		"Uploading textures", "Building LODs", "Preparing descriptors", "Ready"
+	};
+	const uint32_t stage = std::min(reloadStage_.load(), static_cast<uint32_t>(ReloadStage::Done));
+	const uint32_t stageCount = static_cast<uint32_t>(ReloadStage::Count);
+
+	// Texture decoding overlaps the model load, so it advances within its stage
+	float within = 0.0f;
+	if (stage == static_cast<uint32_t>(ReloadStage::DecodingTextures) && texturesToDecode_ > 0) {
+		within = std::min(1.0f, static_cast<float>(texturesDecoded_) / static_cast<float>(texturesToDecode_));
+	} else if (stage == static_cast<uint32_t>(ReloadStage::BuildingLods) && lodProgress_.meshCount > 0) {
+		within = std::min(1.0f,
+			static_cast<float>(lodProgress_.meshesDone) / static_cast<float>(lodProgress_.meshCount));
+	}
+
+	progress.active = true;
+	progress.stage = stageNames[stage];
+	progress.fraction = (static_cast<float>(stage) + within) / static_cast<float>(stageCount - 1);
+	return progress;
+}
+
+bool SpellResourceManager::applyPendingReload(uint64_t frameNumber) {
+	if (!reloadFuture_.valid()
+		|| reloadFuture_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		return false;
+	}
+
+	ResourceSet loaded;
 	try {
-		textures_.push_back(std::make_unique<SpellTexture>(device_, texturePath_, true, true));
-		std::cout << "[Spell] Loaded fallback diffuse texture: " << texturePath_ << std::endl;
+		loaded = reloadFuture_.get();
 	} catch (const std::exception& e) {
-		std::cerr << "[Spell] Failed to load fallback texture '" << texturePath_
-			<< "', creating white 1x1: " << e.what() << std::endl;
-		textures_.push_back(std::make_unique<SpellTexture>(device_, true, true));
+		std::cerr << "[Spell] Reload failed, keeping current model: " << e.what() << std::endl;
+		return false;
+	}
+	if (!loaded.model) return false; // cancelled LOD build
+
+	if (loaded.lodUpgrade) {
+		// Same geometry and materials: keep the textures and the stats of the original load
+		loaded.textures = std::move(current_.textures);
+		loaded.bindlessTextures = std::move(current_.bindlessTextures);
+		loaded.textureTable = std::move(current_.textureTable);
+		loaded.modelLoadTimeMs = current_.modelLoadTimeMs;
+		loaded.textureLoadTimeMs = current_.textureLoadTimeMs;
+		loaded.totalLoadTimeMs = current_.totalLoadTimeMs;
+		loaded.decodeOverlapMs = current_.decodeOverlapMs;
+		loaded.uploadTimeline = std::move(current_.uploadTimeline);
+		loaded.modelCacheHit = current_.modelCacheHit;
+		loaded.textureCacheHits = current_.textureCacheHits;
+		loaded.textureCacheMisses = current_.textureCacheMisses;
+		loaded.compressedTextures = current_.compressedTextures;
+		loaded.meshOptimizeStats = current_.meshOptimizeStats;
+		loaded.bvh = current_.bvh;
+		retired_.push_back({ std::move(current_), frameNumber });
+		current_ = std::move(loaded);
+		std::cout << "[Spell] Swapped in LOD model: " << current_.model->getLodLevelCount() << " levels" << std::endl;
+		return true;
 	}
 
-	// Slot 1: fallback normal (UNORM, default up-facing normal)
-	textures_.push_back(std::make_unique<SpellTexture>(device_, false, true));
-	std::cout << "[Spell] Created fallback normal texture (128,128,255)" << std::endl;
-
-	// Slot 2: fallback metallic (UNORM, black = non-metallic)
-	textures_.push_back(std::make_unique<SpellTexture>(device_, false, true, 0, 0, 0, 255));
-	std::cout << "[Spell] Created fallback metallic texture (0,0,0) = non-metallic" << std::endl;
+	// Frames recorded before this point may still reference the old set on the GPU
+	retired_.push_back({ std::move(current_), frameNumber });
+	current_ = std::move(loaded);
 
-	// Slot 3: fallback roughness (UNORM, mid-gray = 0.5 roughness)
-	textures_.push_back(std::make_unique<SpellTexture>(device_, false, true, 128, 128, 128, 255));
-	std::cout << "[Spell] Created fallback roughness texture (128,128,128) = 0.5 roughness" << std::endl;
+	std::cout << "[Spell] Reloaded model: " << modelPath_
+		<< ", textures: " << current_.bindlessTextures.size() << " (" << textureSlotCount() << " slots)" << std::endl;
+	return true;
 }
 
-void SpellResourceManager::loadMaterialTextures() {
-	if (!model_) return;
-
-	const auto& materials = model_->getMaterials();
+void SpellResourceManager::collectRetired(uint64_t frameNumber) {
+	// beginFrame() of frame N waits on the fence of frame N - MAX_FRAMES_IN_FLIGHT, so once
+	// frame swapFrame + MAX_FRAMES_IN_FLIGHT has begun, all frames before the swap are done
+	retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [frameNumber](const RetiredSet& r) {
+		return frameNumber >= r.swapFrame + SpellSwapChain::MAX_FRAMES_IN_FLIGHT;
+	}), retired_.end());
+}
 
-	// ========== Phase 1: Collect all texture tasks ==========
-	struct TextureTask {
-		std::string path;
-		bool srgb;
-		bool hasFile;
-		enum Type { Diffuse, Normal, Metallic, Roughness } type;
-	};
+void SpellResourceManager::createFallbackTextures() {
+	// Slot 0: fallback diffuse (sRGB white)
+	fallbackTextures_[0] = std::make_unique<SpellTexture>(device_, true, true);
+	// Slot 1: fallback normal (UNORM, default up-facing normal)
+	fallbackTextures_[1] = std::make_unique<SpellTexture>(device_, false, true);
+	// Slot 2: fallback metallic (UNORM, black = non-metallic)
+	fallbackTextures_[2] = std::make_unique<SpellTexture>(device_, false, true, 0, 0, 0, 255);
+	// Slot 3: fallback roughness (UNORM, mid-gray = 0.5 roughness)
+	fallbackTextures_[3] = std::make_unique<SpellTexture>(device_, false, true, 128, 128, 128, 255);
 
-	std::vector<TextureTask> tasks;
-	for (const auto& mat : materials) {
-		tasks.push_back({ mat.diffuseTexturePath, true,
-			!mat.diffuseTexturePath.empty() && std::filesystem::exists(mat.diffuseTexturePath),
-			TextureTask::Diffuse });
-		tasks.push_back({ mat.normalTexturePath, false,
-			!mat.normalTexturePath.empty() && std::filesystem::exists(mat.normalTexturePath),
-			TextureTask::Normal });
-		tasks.push_back({ mat.metallicTexturePath, false,
-			!mat.metallicTexturePath.empty() && std::filesystem::exists(mat.metallicTexturePath),
-			TextureTask::Metallic });
-		tasks.push_back({ mat.roughnessTexturePath, false,
-			!mat.roughnessTexturePath.empty() && std::filesystem::exists(mat.roughnessTexturePath),
-			TextureTask::Roughness });
+	VkCommandBuffer cmd = device_.beginSingleTimeCommands();
+	for (auto& texture : fallbackTextures_) {
+		texture->recordUpload(cmd);
 	}
-
-	// ========== Phase 2: Parallel CPU decode ==========
-	auto decodeImage = [](const std::string& path) -> DecodedImageData {
-		DecodedImageData result;
-		result.sourcePath = path;
-		int texChannels;
-		result.pixels = stbi_load(path.c_str(), &result.width, &result.height, &texChannels, STBI_rgb_alpha);
-		if (result.pixels) {
-			result.imageSize = static_cast<VkDeviceSize>(result.width) * result.height * 4;
-			result.valid = true;
-		}
-		return result;
-	};
-
-	std::vector<std::future<DecodedImageData>> futures(tasks.size());
-	for (size_t i = 0; i < tasks.size(); i++) {
-		if (tasks[i].hasFile) {
-			futures[i] = std::async(std::launch::async, decodeImage, tasks[i].path);
-		}
+	device_.endSingleTimeCommands(cmd);
+	for (auto& texture : fallbackTextures_) {
+		texture->finalizeStagingCleanup();
 	}
+	std::cout << "[Spell] Created shared fallback textures: white diffuse, normal (128,128,255), "
+		<< "metallic (0,0,0), roughness (128,128,128)" << std::endl;
+}
 
-	// ========== Phase 3: Collect results ==========
-	std::vector<bool> srgbFlags;
-	std::vector<bool> hasFileFlags;
-	for (const auto& t : tasks) {
-		srgbFlags.push_back(t.srgb);
-		hasFileFlags.push_back(t.hasFile);
+uint32_t SpellResourceManager::loadSelectedDiffuseTexture(ResourceSet& set, const std::string& texturePath) {
+	for (const auto& fallback : fallbackTextures_) {
+		set.bindlessTextures.push_back(fallback.get());
 	}
 
-	loadMaterialTexturesFromDecoded(materials, futures, hasFileFlags, srgbFlags);
+	try {
+		set.textures.push_back(std::make_unique<SpellTexture>(device_, texturePath, true, true));
+		set.bindlessTextures.push_back(set.textures.back().get());
+		std::cout << "[Spell] Loaded fallback diffuse texture: " << texturePath << std::endl;
+		return static_cast<uint32_t>(set.bindlessTextures.size() - 1);
+	} catch (const std::exception& e) {
+		std::cerr << "[Spell] Failed to load fallback texture '" << texturePath
+			<< "', using white: " << e.what() << std::endl;
+		return 0;
+	}
 }
 
 void SpellResourceManager::loadMaterialTexturesFromDecoded(
+	ResourceSet& set,
 	const std::vector<MaterialInfo>& materials,
-	std::vector<std::future<DecodedImageData>>& futures,
-	const std::vector<bool>& hasFile,
-	const std::vector<bool>& srgbFlags) {
+	TextureDecodeQueue& decodes,
+	const std::vector<bool>& srgbFlags,
+	const std::vector<int32_t>& slotImages,
+	uint32_t selectedDiffuse,
+	std::chrono::high_resolution_clock::time_point decodeStart) {
 
 	enum TextureType { Diffuse, Normal, Metallic, Roughness };
+	static const char* typeNames[] = { "diffuse", "normal", "metallic", "roughness" };
 
-	// ========== Collect results, compute total staging size ==========
-	struct ResolvedTexture {
+	struct ResolvedImage {
 		DecodedImageData decoded;
 		bool srgb;
-		bool valid;
-		VkDeviceSize offset;
-		TextureType type;
-		size_t matIdx;
+		uint32_t bindlessIndex = 0; // 0: not created
+		uint32_t slotCount = 0;     // slots that have used the texture so far
 	};
 
-	std::vector<ResolvedTexture> resolved(futures.size());
-	VkDeviceSize totalStagingSize = 0;
+	// ========== Stream every image into the staging ring as its decode finishes ==========
+	// Decoded pixels are released as soon as they are staged and their bytes go back to the
+	// decode budget, so host memory holds the ring plus the decoded images within that budget,
+	// rather than every decoded image and one staging buffer sized for all of them. Full chunks
+	// are submitted right away and the GPU copies them while the remaining images decode.
+	TextureUploadRing ring(device_, decodes.budget(), decodeStart);
+	TextureUploadTimeline& timeline = ring.timeline();
 
-	for (size_t i = 0; i < futures.size(); i++) {
-		resolved[i].type = static_cast<TextureType>(i % TEXTURES_PER_MATERIAL);
-		resolved[i].matIdx = i / TEXTURES_PER_MATERIAL;
+	std::vector<ResolvedImage> resolved(srgbFlags.size());
+	for (size_t i = 0; i < srgbFlags.size(); i++) {
 		resolved[i].srgb = srgbFlags[i];
-		resolved[i].valid = false;
-
-		if (hasFile[i] && futures[i].valid()) {
-			resolved[i].decoded = futures[i].get();
-			if (resolved[i].decoded.valid) {
-				resolved[i].valid = true;
-				resolved[i].offset = totalStagingSize;
-				totalStagingSize += resolved[i].decoded.imageSize;
-			}
-		}
 	}
 
-	// ========== Create one shared staging buffer ==========
-	sharedStagingBuffer_ = VK_NULL_HANDLE;
-	sharedStagingMemory_ = VK_NULL_HANDLE;
-
-	if (totalStagingSize > 0) {
-		device_.createBuffer(totalStagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			sharedStagingBuffer_, sharedStagingMemory_);
-
-		// Map once, memcpy all textures
-		void* mapped;
-		vkMapMemory(device_.device(), sharedStagingMemory_, 0, totalStagingSize, 0, &mapped);
-
-		for (auto& r : resolved) {
-			if (r.valid) {
-				memcpy(static_cast<char*>(mapped) + r.offset,
-					r.decoded.pixels, static_cast<size_t>(r.decoded.imageSize));
-			}
+	size_t task;
+	DecodedImageData next;
+	for (;;) {
+		if (!decodes.tryNext(task, next)) {
+			// Nothing to stage: hand the GPU what is staged so far, then sleep until a decode finishes
+			ring.flush();
+			ring.poll();
+			if (!decodes.next(task, next)) break;
 		}
 
-		vkUnmapMemory(device_.device(), sharedStagingMemory_);
-	}
+		ResolvedImage& r = resolved[task];
+		r.decoded = std::move(next);
+		DecodedImageData& decoded = r.decoded;
+		const VkDeviceSize heldBytes = decoded.imageSize;
+		ring.recordDecode(decoded.decodeStart, decoded.decodeEnd);
 
-	// Free all decoded pixels
-	for (auto& r : resolved) {
-		if (r.decoded.pixels) {
-			stbi_image_free(r.decoded.pixels);
-			r.decoded.pixels = nullptr;
+		if (decoded.valid) {
+			BlockFormat blockFormat;
+			if (decoded.mipChain && blockFormatFromVk(decoded.mipChain->format, blockFormat)) {
+				set.compressedTextures++;
+			}
+			if (decoded.cacheHit) {
+				set.textureCacheHits++;
+			} else if (decoded.cacheMiss) {
+				set.textureCacheMisses++;
+			}
 		}
-	}
 
-	// ========== Create SpellTexture objects ==========
-	for (size_t i = 0; i < resolved.size(); i++) {
-		auto& r = resolved[i];
-
-		if (r.valid) {
+		if (decoded.valid && set.bindlessTextures.size() >= MAX_BINDLESS_TEXTURES) {
+			std::cerr << "[Spell] More than " << MAX_BINDLESS_TEXTURES << " textures, "
+				<< decoded.sourcePath << " uses the fallback" << std::endl;
+		} else if (decoded.valid) {
 			try {
-				textures_.push_back(std::make_unique<SpellTexture>(
-					device_, r.decoded, r.srgb, true,
-					sharedStagingBuffer_, r.offset));
-				std::cout << "[Spell] Loaded material[" << r.matIdx << "] "
-					<< (r.type == Diffuse ? "diffuse" :
-						r.type == Normal ? "normal" :
-						r.type == Metallic ? "metallic" : "roughness")
-					<< ": " << r.decoded.sourcePath << std::endl;
-				continue;
+				// Image only; the ring records its copies, mips and layout transitions
+				auto texture = std::make_unique<SpellTexture>(device_, decoded, r.srgb, true, VK_NULL_HANDLE, 0);
+				ring.upload(*texture, decoded);
+				set.textures.push_back(std::move(texture));
+				set.bindlessTextures.push_back(set.textures.back().get());
+				r.bindlessIndex = static_cast<uint32_t>(set.bindlessTextures.size() - 1);
 			} catch (const std::exception& e) {
 				std::cerr << "[Spell] Failed to create texture from decoded data: " << e.what() << std::endl;
 			}
 		}
 
-		// Fallback path
-		switch (r.type) {
+		if (decoded.pixels) {
+			stbi_image_free(decoded.pixels);
+			decoded.pixels = nullptr;
+		}
+		decoded.mipChain.reset();
+		decodes.release(heldBytes);
+		ring.poll();
+	}
+	timeline.decodeBudgetBytes = decodes.budget();
+	timeline.peakPendingBytes = decodes.peakHeldBytes();
+	ring.finish();
+	timeline.computeOverlap();
+	set.uploadTimeline = timeline;
+
+	// ========== Texture table: material slot -> bindless index ==========
+	// Entries 0..3 are for geometry without a material; slots without an image use the
+	// shared fallback of their role
+	std::vector<uint32_t> table = { selectedDiffuse, 1, 2, 3 };
+	table.reserve(TEXTURES_PER_MATERIAL + slotImages.size());
+	uint32_t sharedSlots = 0;
+	for (size_t i = 0; i < slotImages.size(); i++) {
+		const auto type = static_cast<TextureType>(i % TEXTURES_PER_MATERIAL);
+		const size_t matIdx = i / TEXTURES_PER_MATERIAL;
+
+		if (slotImages[i] >= 0 && resolved[slotImages[i]].bindlessIndex != 0) {
+			ResolvedImage& r = resolved[slotImages[i]];
+			table.push_back(r.bindlessIndex);
+			std::cout << "[Spell] Loaded material[" << matIdx << "] " << typeNames[type]
+				<< ": " << r.decoded.sourcePath << (r.decoded.cacheHit ? " (texture cache)" : "")
+				<< (r.slotCount > 0 ? " (shared)" : "") << std::endl;
+			if (r.slotCount++ > 0) sharedSlots++;
+			continue;
+		}
+
+		// Fallback path: the shared texture of the slot's role
+		table.push_back(static_cast<uint32_t>(type));
+		switch (type) {
 		case Diffuse:
-			std::cout << "[Spell] Material[" << r.matIdx << "] has no diffuse texture, using white fallback" << std::endl;
-			textures_.push_back(std::make_unique<SpellTexture>(device_, true, true));
+			std::cout << "[Spell] Material[" << matIdx << "] has no diffuse texture, using white fallback" << std::endl;
 			break;
 		case Normal:
-			std::cout << "[Spell] Material[" << r.matIdx << "] has no normal texture, using default normal" << std::endl;
-			textures_.push_back(std::make_unique<SpellTexture>(device_, false, true));
+			std::cout << "[Spell] Material[" << matIdx << "] has no normal texture, using default normal" << std::endl;
 			break;
 		case Metallic:
-			std::cout << "[Spell] Material[" << r.matIdx << "] has no metallic texture, using black fallback" << std::endl;
-			textures_.push_back(std::make_unique<SpellTexture>(device_, false, true, 0, 0, 0, 255));
+			std::cout << "[Spell] Material[" << matIdx << "] has no metallic texture, using black fallback" << std::endl;
 			break;
 		case Roughness:
-			std::cout << "[Spell] Material[" << r.matIdx << "] has no roughness texture, using mid-gray fallback" << std::endl;
-			textures_.push_back(std::make_unique<SpellTexture>(device_, false, true, 128, 128, 128, 255));
+			std::cout << "[Spell] Material[" << matIdx << "] has no roughness texture, using mid-gray fallback" << std::endl;
 			break;
 		}
 	}
+	set.textureTable = std::make_unique<MaterialTextureTable>(device_, table);
 
-	std::cout << "[Spell] Total texture slots: " << textures_.size()
-		<< " (" << TEXTURES_PER_MATERIAL << " fallback + " << materials.size() << " materials x " << TEXTURES_PER_MATERIAL << " slots)" << std::endl;
+	if (set.compressedTextures > 0) {
+		std::cout << "[Spell] Block-compressed textures: " << set.compressedTextures << std::endl;
+	}
+	if (set.textureCacheHits + set.textureCacheMisses > 0) {
+		std::cout << "[Spell] Texture cache: " << set.textureCacheHits << " hits, " << set.textureCacheMisses
+			<< " misses" << std::endl;
+	}
+	std::cout << "[Spell] Total texture slots: " << table.size()
+		<< " (" << TEXTURES_PER_MATERIAL << " fallback + " << materials.size() << " materials x " << TEXTURES_PER_MATERIAL << " slots), "
+		<< set.bindlessTextures.size() << " bindless textures (" << FALLBACK_TEXTURE_COUNT << " shared fallbacks), "
+		<< sharedSlots << " slots share an image" << std::endl;
+	if (!timeline.uploads.empty()) {
+		std::cout << "[Spell] Streamed texture upload: " << timeline.uploadedBytes / (1024 * 1024) << " MB in "
+			<< timeline.uploads.size() << " chunks through a " << timeline.stagingBytes / (1024 * 1024)
+			<< " MB staging ring, decode/upload overlap " << timeline.overlapMs << "ms, peak pending "
+			<< timeline.peakPendingBytes / (1024 * 1024) << " MB, " << timeline.stalls << " stalls ("
+			<< timeline.stallMs << "ms)" << std::endl;
+	}
 }
 
-void SpellResourceManager::submitBatchedTextureUpload() {
-	if (textures_.empty()) return;
+void SpellResourceManager::submitBatchedTextureUpload(ResourceSet& set) {
+	// Material textures were streamed through the staging ring already; what is left are
+	// textures with their own staging buffer (the selected diffuse)
+	uint32_t pendingCount = 0;
+	for (auto& tex : set.textures) {
+		if (tex->hasPendingUpload()) pendingCount++;
+	}
+	if (pendingCount == 0) return;
 
 	VkCommandBuffer cmd = device_.beginSingleTimeCommands();
 
 	// Phase 1: Record all uploads (transition + copy)
-	for (auto& tex : textures_) {
+	for (auto& tex : set.textures) {
 		tex->recordUpload(cmd);
 	}
 
 	// Phase 2: Record all mipmap generations
-	for (auto& tex : textures_) {
+	for (auto& tex : set.textures) {
 		if (tex->needsMipmaps()) {
 			tex->recordMipmaps(cmd);
 		}
@@ -342,22 +753,12 @@ void SpellResourceManager::submitBatchedTextureUpload() {
 	// Single submit + wait
 	device_.endSingleTimeCommands(cmd);
 
-	// Clean up all staging buffers (individual ones for fallback textures)
-	for (auto& tex : textures_) {
+	// Clean up all staging buffers
+	for (auto& tex : set.textures) {
 		tex->finalizeStagingCleanup();
 	}
 
-	// Destroy shared staging buffer
-	if (sharedStagingBuffer_ != VK_NULL_HANDLE) {
-		vkDestroyBuffer(device_.device(), sharedStagingBuffer_, nullptr);
-		sharedStagingBuffer_ = VK_NULL_HANDLE;
-	}
-	if (sharedStagingMemory_ != VK_NULL_HANDLE) {
-		vkFreeMemory(device_.device(), sharedStagingMemory_, nullptr);
-		sharedStagingMemory_ = VK_NULL_HANDLE;
-	}
-
-	std::cout << "[Spell] Batched texture upload: " << textures_.size() << " textures in 1 submit" << std::endl;
+	std::cout << "[Spell] Batched texture upload: " << pendingCount << " textures in 1 submit" << std::endl;
 }
 
 void SpellResourceManager::scanAvailableFiles() {
@@ -378,7 +779,7 @@ void SpellResourceManager::scanAvailableFiles() {
 			}
 			if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" ||
 				ext == ".gif" || ext == ".bmp" || ext == ".tga" ||
-				ext == ".PNG" || ext == ".JPG" || ext == ".JPEG") {
+				ext == ".PNG" || ext == ".JPG" || ext == ".JPEG" || extLower == ".ktx2") {
 				availableTextures_.push_back(entry.path().generic_string());
 			}
 		}
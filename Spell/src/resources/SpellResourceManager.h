@@ -2,11 +2,21 @@
 
 #include "SpellModel.h"
 #include "SpellTexture.h"
-
+#include "ModelLoaderFactory.h"
+#include "MaterialTextureTable.h"
+#include "TextureUploadRing.h"
+#include "TextureDecodeQueue.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshBvh.h"
+
+#include <array>
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <chrono>
+#include <functional>
 #include <future>
 
 namespace Spell {
@@ -15,9 +25,22 @@ static constexpr uint32_t MAX_BINDLESS_TEXTURES = 128;
 
 class IModelLoader;
 
+// Progress of a background reload, for display
+struct ReloadProgress {
+	bool active = false;
+	const char* stage = "";
+	float fraction = 0.0f; // 0..1
+};
+
 class SpellResourceManager {
 public:
+	// Runs on the reload thread after the new model and textures are uploaded, so descriptor
+	// sets that reference them can be built before the swap
+	using ReloadPrepareFn = std::function<void(const SpellModel& model,
+		const std::vector<SpellTexture*>& textures, const MaterialTextureTable& textureTable)>;
+
 	SpellResourceManager(SpellDevice& device);
+	~SpellResourceManager();
 
 	void scanAvailableFiles();
 
@@ -26,61 +49,202 @@ public:
 	void setModelPath(const std::string& path) { modelPath_ = path; }
 	void setTexturePath(const std::string& path) { texturePath_ = path; }
 
+	// FBX vertex weld tolerance, used from the next load/reload on
+	const VertexWeldTolerance& fbxWeldTolerance() const { return loaderSettings_.fbxWeldTolerance; }
+	void setFbxWeldTolerance(const VertexWeldTolerance& tolerance) { loaderSettings_.fbxWeldTolerance = tolerance; }
+
 	const std::vector<std::string>& availableModels() const { return availableModels_; }
 	const std::vector<std::string>& availableTextures() const { return availableTextures_; }
 
-	SpellModel* model() const { return model_.get(); }
+	SpellModel* model() const { return current_.model.get(); }
+	// Triangle BVH of the current model for frustum queries and picking; null for an empty model
+	const MeshBvh* bvh() const { return current_.bvh.get(); }
 
 	// Texture slots per material (diffuse + normal + metallic + roughness)
 	static constexpr uint32_t TEXTURES_PER_MATERIAL = 4;
 
-	// Bindless texture array: index 0,1 are fallback (diffuse, normal), then per-material slots
-	const std::vector<std::unique_ptr<SpellTexture>>& textures() const { return textures_; }
-	uint32_t textureCount() const { return static_cast<uint32_t>(textures_.size()); }
-
-	// Legacy single texture access (for inspector display)
-	SpellTexture* texture() const { return textures_.empty() ? nullptr : textures_[0].get(); }
-
+	// Bindless texture array: index 0..3 are the shared fallbacks (white diffuse, flat normal,
+	// black metallic, mid-gray roughness), then the textures of the current load, one per
+	// distinct image. Material slots reach them through textureTable().
+	static constexpr uint32_t FALLBACK_TEXTURE_COUNT = TEXTURES_PER_MATERIAL;
+	const std::vector<SpellTexture*>& textures() const { return current_.bindlessTextures; }
+	uint32_t textureCount() const { return static_cast<uint32_t>(current_.bindlessTextures.size()); }
+	const MaterialTextureTable& textureTable() const { return *current_.textureTable; }
+	// Material texture slots (table entries), including the ones on a fallback
+	uint32_t textureSlotCount() const {
+		return current_.textureTable ? static_cast<uint32_t>(current_.textureTable->getEntries().size()) : 0;
+	}
+
+	// Legacy single texture access (for inspector display): the diffuse of geometry without a material
+	SpellTexture* texture() const {
+		return current_.textureTable ? current_.bindlessTextures[current_.textureTable->getEntries()[0]] : nullptr;
+	}
+
+	// Reorder freshly parsed geometry for the vertex cache, overdraw and vertex fetch before it
+	// is cached and uploaded. Takes effect on the next load; a cache entry written with the
+	// other setting counts as a miss.
+	bool optimizeMeshes() const { return optimizeMeshes_; }
+	void setOptimizeMeshes(bool enabled) { optimizeMeshes_ = enabled; }
+
+	// Vertex buffer layout of the next load (the model keeps the one it was built with)
+	VertexFormat vertexFormat() const { return vertexFormat_; }
+	void setVertexFormat(VertexFormat format) { vertexFormat_ = format; }
+	VertexLayout vertexLayout() const { return vertexLayout_; }
+	void setVertexLayout(VertexLayout layout) { vertexLayout_ = layout; }
+
+	// Load material textures through the .ktx2 texture cache (decoded, mipmapped on the CPU and
+	// stored once; later loads copy every level straight into staging). Takes effect on the next load.
+	bool useTextureCache() const { return useTextureCache_; }
+	void setUseTextureCache(bool enabled) { useTextureCache_ = enabled; }
+
+	// Block-compress material textures on the CPU while they are decoded (stored compressed in
+	// the texture cache when it is on). Reads as None if the device cannot sample the BC formats.
+	// Takes effect on the next load.
+	TextureCompression textureCompression() const { return bcSupported_ ? textureCompression_.load() : TextureCompression::None; }
+	void setTextureCompression(TextureCompression compression) { textureCompression_ = compression; }
+	bool textureCompressionSupported() const { return bcSupported_; }
+
+	// Host memory for streaming material textures: half is the staging ring they are uploaded
+	// through, half holds decoded images waiting for it (decodes pause while it is full).
+	// Takes effect on the next load.
+	uint32_t textureStagingBudgetMb() const { return textureStagingBudgetMb_; }
+	void setTextureStagingBudgetMb(uint32_t megabytes) { textureStagingBudgetMb_ = megabytes; }
+
+	// Keep the CPU geometry of each load so an LOD chain can be built for it in the background
+	// (see beginLodBuild). Takes effect on the next load.
+	bool generateLods() const { return generateLods_; }
+	void setGenerateLods(bool enabled) { generateLods_ = enabled; }
+
+	// Blocking load on the calling thread (startup)
 	void loadInitialResources();
-	void reloadResources();
 
-	float lastModelLoadTimeMs() const { return lastModelLoadTimeMs_; }
-	float lastTextureLoadTimeMs() const { return lastTextureLoadTimeMs_; }
-	float lastTotalLoadTimeMs() const { return lastTotalLoadTimeMs_; }
-	float lastDecodeOverlapMs() const { return lastDecodeOverlapMs_; }
+	// Loads modelPath()/texturePath() on a background thread while the current resources
+	// keep rendering. Ignored while another reload is running.
+	void beginReload(ReloadPrepareFn prepare = {});
+	bool isReloading() const { return reloadFuture_.valid(); }
+	ReloadProgress reloadProgress() const;
+
+	// LODs are built after the model is already on screen: the current geometry is simplified
+	// on the reload thread, uploaded as a new model with the same textures and swapped in by
+	// applyPendingReload() like a reload. True while the current model still waits for that.
+	bool needsLods() const { return current_.lodSource != nullptr; }
+	void beginLodBuild(ReloadPrepareFn prepare = {});
+	bool isBuildingLods() const { return lodBuildActive_ && reloadFuture_.valid(); }
+	// Makes a running LOD build return early (e.g. when a different model was requested)
+	void cancelLodBuild() { lodProgress_.cancel = true; }
+
+	// Called by the render thread at a frame boundary (before recording frame `frameNumber`).
+	// If the background load has finished, swaps the new resources in and retires the old
+	// ones. Returns true if a swap happened.
+	bool applyPendingReload(uint64_t frameNumber);
+	// Destroys retired resources once every frame that could still use them has completed.
+	// Call after beginFrame() has waited on the in-flight fence of `frameNumber`.
+	void collectRetired(uint64_t frameNumber);
+
+	float lastModelLoadTimeMs() const { return current_.modelLoadTimeMs; }
+	float lastTextureLoadTimeMs() const { return current_.textureLoadTimeMs; }
+	float lastTotalLoadTimeMs() const { return current_.totalLoadTimeMs; }
+	float lastDecodeOverlapMs() const { return current_.decodeOverlapMs; }
+	const TextureUploadTimeline& lastUploadTimeline() const { return current_.uploadTimeline; }
+	bool lastModelCacheHit() const { return current_.modelCacheHit; }
+	uint32_t lastTextureCacheHits() const { return current_.textureCacheHits; }
+	uint32_t lastTextureCacheMisses() const { return current_.textureCacheMisses; }
+	uint32_t lastCompressedTextures() const { return current_.compressedTextures; }
+	const MeshOptimizeStats& lastMeshOptimizeStats() const { return current_.meshOptimizeStats; }
+	float lastLodBuildTimeMs() const { return current_.lodBuildTimeMs; }
+	float lastBvhBuildTimeMs() const { return current_.bvh ? current_.bvh->getBuildTimeMs() : 0.0f; }
 
 private:
-	void createFallbackWhiteTexture();
-	void loadMaterialTextures();
-	// Overload: accepts pre-decoded images from parallel decode
+	// CPU geometry the current model was built from, owned until its LODs exist
+	struct LodSource;
+
+	// Everything one load produces; swapped in and retired as a unit
+	struct ResourceSet {
+		std::unique_ptr<SpellModel> model;
+		std::vector<std::unique_ptr<SpellTexture>> textures; // one per distinct image, in upload order
+		std::vector<SpellTexture*> bindlessTextures;         // shared fallbacks, then `textures`
+		std::unique_ptr<MaterialTextureTable> textureTable;
+
+		float modelLoadTimeMs = 0.0f;
+		float textureLoadTimeMs = 0.0f;
+		float totalLoadTimeMs = 0.0f;
+		float decodeOverlapMs = 0.0f;  // Time saved by parallel decode
+		TextureUploadTimeline uploadTimeline; // decodes and staging ring chunks of the material textures
+		bool modelCacheHit = false;    // Model came from the .spellmesh cache
+		uint32_t textureCacheHits = 0; // Material textures from the .ktx2 texture cache
+		uint32_t textureCacheMisses = 0;
+		uint32_t compressedTextures = 0; // Material textures in a BC format
+		MeshOptimizeStats meshOptimizeStats;
+		float lodBuildTimeMs = 0.0f;
+		std::shared_ptr<const MeshBvh> bvh;   // shared with the LOD upgrade of the same geometry
+		std::shared_ptr<LodSource> lodSource; // set until the LOD chain has been built
+		bool lodUpgrade = false;              // same model with LODs; takes over the current textures
+	};
+
+	struct RetiredSet {
+		ResourceSet resources;
+		uint64_t swapFrame;
+	};
+
+	enum class ReloadStage : uint32_t {
+		Opening, DecodingTextures, BuildingModel, UploadingTextures, BuildingLods, Preparing, Done, Count
+	};
+
+	// Shared by every load; created once by the constructor
+	void createFallbackTextures();
+	// Starts the set's bindless array with the shared fallbacks and loads the diffuse of geometry
+	// without a material (texturePath). Returns its bindless index (the white fallback on failure).
+	uint32_t loadSelectedDiffuseTexture(ResourceSet& set, const std::string& texturePath);
+	// Creates the material textures from a running decode queue. The queue's tasks and `srgbFlags` have
+	// one entry per distinct image; slotImages maps every material slot to one of them (-1: fallback).
+	// Each image is streamed to the GPU through a staging ring as soon as its decode finishes
+	// (decodeStart: when the decodes were launched, time 0 of the upload timeline).
+	// Builds the set's texture table; the selected diffuse has to be loaded first.
 	void loadMaterialTexturesFromDecoded(
+		ResourceSet& set,
 		const std::vector<MaterialInfo>& materials,
-		std::vector<std::future<DecodedImageData>>& futures,
-		const std::vector<bool>& hasFile,
-		const std::vector<bool>& srgbFlags);
-	void submitBatchedTextureUpload();
+		TextureDecodeQueue& decodes,
+		const std::vector<bool>& srgbFlags,
+		const std::vector<int32_t>& slotImages,
+		uint32_t selectedDiffuse,
+		std::chrono::high_resolution_clock::time_point decodeStart);
+	// Half of the staging budget in bytes: what the decode queue may hold, and the ring's capacity
+	VkDeviceSize textureDecodeBudget() const {
+		return static_cast<VkDeviceSize>(textureStagingBudgetMb_) * 1024 * 1024 / 2;
+	}
+	// Uploads the textures that still hold their own staging buffer in one submit
+	void submitBatchedTextureUpload(ResourceSet& set);
 
 	// Internal helper: run parallel load pipeline with a given loader
-	void loadWithLoader(IModelLoader& loader);
+	ResourceSet loadWithLoader(IModelLoader& loader, const std::string& modelPath, const std::string& texturePath);
 
 	SpellDevice& device_;
+	std::array<std::unique_ptr<SpellTexture>, FALLBACK_TEXTURE_COUNT> fallbackTextures_;
 
 	std::string modelPath_{ "assets/viking_room/viking_room.obj" };
 	std::string texturePath_{ "assets/viking_room/viking_room.png" };
 	std::vector<std::string> availableModels_;
 	std::vector<std::string> availableTextures_;
-
-	std::unique_ptr<SpellModel> model_;
-	std::vector<std::unique_ptr<SpellTexture>> textures_; // [0] = fallback, [1..N] = material textures
-
-	// Shared staging buffer for batch texture upload (owned by ResourceManager)
-	VkBuffer sharedStagingBuffer_ = VK_NULL_HANDLE;
-	VkDeviceMemory sharedStagingMemory_ = VK_NULL_HANDLE;
-
-	float lastModelLoadTimeMs_ = 0.0f;
-	float lastTextureLoadTimeMs_ = 0.0f;
-	float lastTotalLoadTimeMs_ = 0.0f;
-	float lastDecodeOverlapMs_ = 0.0f;  // Time saved by parallel decode
+	ModelLoaderSettings loaderSettings_;
+	std::atomic<bool> optimizeMeshes_{ true };
+	std::atomic<bool> useTextureCache_{ true };
+	std::atomic<TextureCompression> textureCompression_{ TextureCompression::Quality };
+	bool bcSupported_ = false;
+	std::atomic<uint32_t> textureStagingBudgetMb_{ 64 };
+	std::atomic<bool> generateLods_{ true };
+	std::atomic<VertexFormat> vertexFormat_{ VertexFormat::Full };
+	std::atomic<VertexLayout> vertexLayout_{ VertexLayout::Interleaved };
+
+	ResourceSet current_;
+	std::vector<RetiredSet> retired_;
+
+	// Background reload. The stage and texture counters are written by the reload thread.
+	std::future<ResourceSet> reloadFuture_;
+	std::atomic<uint32_t> reloadStage_{ 0 };
+	std::atomic<uint32_t> texturesDecoded_{ 0 };
+	std::atomic<uint32_t> texturesToDecode_{ 0 };
+	LodBuildProgress lodProgress_;
+	bool lodBuildActive_ = false; // the running reload is an LOD build
 };
 
 } // namespace Spell
@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include <string>
 
 namespace Spell {
 
@@ -124,6 +125,15 @@ SpellTexture::~SpellTexture() {
 // ============================================================
 
 void SpellTexture::prepareTextureImage(const std::string& texturePath) {
+	if (isKtx2Path(texturePath)) {
+		TextureMipChain chain;
+		if (!readKtx2(texturePath, chain)) {
+			throw std::runtime_error("failed to load KTX2 texture: " + texturePath);
+		}
+		prepareFromMipChain(chain, true);
+		return;
+	}
+
 	int texChannels;
 	stbi_uc* pixels = stbi_load(texturePath.c_str(), &texWidth_, &texHeight_, &texChannels, STBI_rgb_alpha);
 	VkDeviceSize imageSize = texWidth_ * texHeight_ * 4;
@@ -154,8 +164,14 @@ void SpellTexture::prepareTextureImage(const std::string& texturePath) {
 }
 
 void SpellTexture::prepareFromDecodedData(const DecodedImageData& decoded) {
+	if (decoded.mipChain) {
+		prepareFromMipChain(*decoded.mipChain, true);
+		return;
+	}
+
 	texWidth_ = decoded.width;
 	texHeight_ = decoded.height;
+	if (decoded.channels != 4) format_ = textureFormatForChannels(decoded.channels, srgb_);
 
 	mipLevels_ = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth_, texHeight_)))) + 1;
 	needsMipmaps_ = (mipLevels_ > 1);
@@ -177,8 +193,14 @@ void SpellTexture::prepareFromDecodedData(const DecodedImageData& decoded) {
 }
 
 void SpellTexture::prepareImageOnly(const DecodedImageData& decoded) {
+	if (decoded.mipChain) {
+		prepareFromMipChain(*decoded.mipChain, false);
+		return;
+	}
+
 	texWidth_ = decoded.width;
 	texHeight_ = decoded.height;
+	if (decoded.channels != 4) format_ = textureFormatForChannels(decoded.channels, srgb_);
 
 	mipLevels_ = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth_, texHeight_)))) + 1;
 	needsMipmaps_ = (mipLevels_ > 1);
@@ -190,6 +212,50 @@ void SpellTexture::prepareImageOnly(const DecodedImageData& decoded) {
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage_, textureImageMemory_);
 }
 
+void SpellTexture::prepareFromMipChain(const TextureMipChain& chain, bool ownStaging) {
+	texWidth_ = static_cast<int32_t>(chain.width);
+	texHeight_ = static_cast<int32_t>(chain.height);
+	mipLevels_ = chain.levelCount();
+	needsMipmaps_ = false;
+	format_ = chain.format;
+
+	// Block-compressed formats from .ktx2 files need textureCompressionBC
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device_.physicalDevice(), format_, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+		throw std::runtime_error("texture format " + std::to_string(format_) + " is not supported by the device");
+	}
+
+	levelCopies_.resize(mipLevels_);
+	for (uint32_t i = 0; i < mipLevels_; i++) {
+		VkBufferImageCopy& region = levelCopies_[i];
+		region = {};
+		region.bufferOffset = chain.stagingOffset(i);
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = i;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { chain.levels[i].width, chain.levels[i].height, 1 };
+	}
+
+	if (ownStaging) {
+		VkDeviceSize imageSize = chain.stagingSize();
+		device_.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBuffer_, stagingBufferMemory_);
+
+		void* data;
+		vkMapMemory(device_.device(), stagingBufferMemory_, 0, imageSize, 0, &data);
+		chain.copyToStaging(static_cast<unsigned char*>(data));
+		vkUnmapMemory(device_.device(), stagingBufferMemory_);
+	}
+
+	device_.createImage(texWidth_, texHeight_, mipLevels_, VK_SAMPLE_COUNT_1_BIT, format_,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage_, textureImageMemory_);
+}
+
 void SpellTexture::prepareFallbackTextureImage() {
 	mipLevels_ = 1;
 	texWidth_ = 1;
@@ -252,12 +318,20 @@ void SpellTexture::recordUpload(VkCommandBuffer cmd) {
 	VkFormat format = getFormat();
 
 	// Transition UNDEFINED -> TRANSFER_DST_OPTIMAL
-	device_.cmdTransitionImageLayout(cmd, textureImage_, format,
-		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels_);
+	recordBeginUpload(cmd);
 
-	// Copy staging buffer to image
-	device_.cmdCopyBufferToImage(cmd, stagingBuffer_, textureImage_,
-		static_cast<uint32_t>(texWidth_), static_cast<uint32_t>(texHeight_), stagingBufferOffset_);
+	// Copy staging buffer to image: level 0 only, or every level of a precomputed mip chain
+	if (!levelCopies_.empty()) {
+		std::vector<VkBufferImageCopy> regions = levelCopies_;
+		for (auto& region : regions) {
+			region.bufferOffset += stagingBufferOffset_;
+		}
+		vkCmdCopyBufferToImage(cmd, stagingBuffer_, textureImage_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+	} else {
+		device_.cmdCopyBufferToImage(cmd, stagingBuffer_, textureImage_,
+			static_cast<uint32_t>(texWidth_), static_cast<uint32_t>(texHeight_), stagingBufferOffset_);
+	}
 
 	// If no mipmaps needed, transition directly to SHADER_READ_ONLY
 	if (!needsMipmaps_) {
@@ -267,6 +341,22 @@ void SpellTexture::recordUpload(VkCommandBuffer cmd) {
 	// If mipmaps needed, leave in TRANSFER_DST_OPTIMAL for recordMipmaps()
 }
 
+void SpellTexture::recordBeginUpload(VkCommandBuffer cmd) {
+	device_.cmdTransitionImageLayout(cmd, textureImage_, getFormat(),
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels_);
+}
+
+void SpellTexture::recordEndUpload(VkCommandBuffer cmd) {
+	if (needsMipmaps_) {
+		recordMipmaps(cmd);
+		// Done here, a later batched upload must not generate them again
+		needsMipmaps_ = false;
+	} else {
+		device_.cmdTransitionImageLayout(cmd, textureImage_, getFormat(),
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels_);
+	}
+}
+
 void SpellTexture::recordMipmaps(VkCommandBuffer cmd) {
 	if (!needsMipmaps_) return;
 
@@ -383,7 +473,14 @@ void SpellTexture::createFallbackTextureImage() {
 }
 
 void SpellTexture::createTextureImageView() {
-	textureImageView_ = device_.createImageView(textureImage_, getFormat(), VK_IMAGE_ASPECT_COLOR_BIT, mipLevels_);
+	// Single-channel maps read their value from any color channel, so shader.frag can take
+	// roughness from .g whether it is a separate R8 / BC4 map or packed next to metallic
+	VkComponentMapping components{};
+	const VkFormat format = getFormat();
+	if (format == VK_FORMAT_R8_UNORM || format == VK_FORMAT_BC4_UNORM_BLOCK) {
+		components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+	}
+	textureImageView_ = device_.createImageView(textureImage_, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels_, components);
 }
 
 void SpellTexture::createTextureSampler() {
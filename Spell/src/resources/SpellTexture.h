@@ -1,19 +1,42 @@
 #pragma once
 
 #include "core/SpellDevice.h"
+#include "TextureCache.h"
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace Spell {
 
+// GPU format of material textures loaded from PNG/JPG sources (see BlockCompression.h).
+// Normal maps become BC5 and metallic / roughness maps BC4 in both compressed modes.
+enum class TextureCompression : uint32_t {
+	None,    // RGBA8, mips generated on the GPU unless the texture cache is on
+	Fast,    // diffuse BC1 (no alpha, 4 bpp)
+	Quality, // diffuse BC7 (8 bpp)
+	Count
+};
+
 // Pre-decoded image data from CPU-side stbi_load (thread-safe, no Vulkan calls)
 struct DecodedImageData {
 	unsigned char* pixels = nullptr;
 	int width = 0;
 	int height = 0;
 	VkDeviceSize imageSize = 0;
+	uint32_t channels = 4; // of `pixels`, tightly packed: 1 (R8), 2 (RG8) or 4 (RGBA8)
 	bool valid = false;
 	std::string sourcePath;
+
+	// Complete mip chain from the texture cache or a .ktx2 file. When set, `pixels` is null,
+	// imageSize is mipChain->stagingSize() and no mips are generated on the GPU.
+	std::shared_ptr<const TextureMipChain> mipChain;
+	bool cacheHit = false;
+	bool cacheMiss = false; // built and written to the texture cache
+
+	// Taken on the decode thread, for the upload timeline
+	std::chrono::high_resolution_clock::time_point decodeStart;
+	std::chrono::high_resolution_clock::time_point decodeEnd;
 };
 
 class SpellTexture {
@@ -21,6 +44,7 @@ public:
 	// Deferred mode: prepares CPU-side data and GPU image, but does NOT submit GPU commands.
 	// Call recordUpload() and recordMipmaps() to record into a batched command buffer,
 	// then call finalizeStagingCleanup() after the batch is submitted and completed.
+	// `texturePath` may also name a .ktx2 file, whose mip chain is uploaded as stored.
 	SpellTexture(SpellDevice& device, const std::string& texturePath, bool srgb, bool deferred);
 	SpellTexture(SpellDevice& device, bool srgb, bool deferred);
 	SpellTexture(SpellDevice& device, bool srgb, bool deferred, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
@@ -30,7 +54,9 @@ public:
 	SpellTexture(SpellDevice& device, const DecodedImageData& decoded, bool srgb, bool deferred);
 
 	// Deferred mode: uses shared staging buffer (no individual staging allocation)
-	// The shared staging buffer is managed externally by the caller.
+	// The shared staging buffer is managed externally by the caller. With a mip chain the
+	// levels must be at bufferOffset + mipChain->stagingOffset(level) (see copyToStaging).
+	// With a null buffer only the image is created, for a streamed upload (TextureUploadRing).
 	SpellTexture(SpellDevice& device, const DecodedImageData& decoded, bool srgb, bool deferred,
 		VkBuffer sharedStagingBuffer, VkDeviceSize bufferOffset);
 
@@ -44,9 +70,14 @@ public:
 	SpellTexture(const SpellTexture&) = delete;
 	SpellTexture& operator=(const SpellTexture&) = delete;
 
+	VkImage getImage() const { return textureImage_; }
 	VkImageView getImageView() const { return textureImageView_; }
 	VkSampler getSampler() const { return textureSampler_; }
 	uint32_t getMipLevels() const { return mipLevels_; }
+	VkFormat getFormat() const {
+		if (format_ != VK_FORMAT_UNDEFINED) return format_;
+		return srgb_ ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
 
 	// Record GPU upload commands into an external command buffer (deferred mode)
 	void recordUpload(VkCommandBuffer cmd);
@@ -54,15 +85,25 @@ public:
 	// Record mipmap generation commands into an external command buffer (deferred mode)
 	void recordMipmaps(VkCommandBuffer cmd);
 
+	// Streamed upload: the copies are recorded by the caller, possibly spread over several
+	// command buffers submitted in order. Begin moves every level to TRANSFER_DST; end, recorded
+	// after the last copy, generates the mips or moves a complete chain to SHADER_READ_ONLY.
+	void recordBeginUpload(VkCommandBuffer cmd);
+	void recordEndUpload(VkCommandBuffer cmd);
+
 	// Clean up staging buffers after GPU work is complete
 	void finalizeStagingCleanup();
 
 	bool needsMipmaps() const { return needsMipmaps_; }
+	// Still holds data in a staging buffer that recordUpload() copies
+	bool hasPendingUpload() const { return stagingBuffer_ != VK_NULL_HANDLE; }
 
 private:
 	void prepareTextureImage(const std::string& texturePath);
 	void prepareFromDecodedData(const DecodedImageData& decoded);
 	void prepareImageOnly(const DecodedImageData& decoded);
+	// Image with every level of `chain`; copies the levels into an own staging buffer if requested
+	void prepareFromMipChain(const TextureMipChain& chain, bool ownStaging);
 	void prepareFallbackTextureImage();
 	void prepareCustomColorImage(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
 
@@ -72,12 +113,11 @@ private:
 	void createTextureSampler();
 	void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
-	VkFormat getFormat() const { return srgb_ ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM; }
-
 	SpellDevice& device_;
 	bool srgb_;
 
 	uint32_t mipLevels_ = 1;
+	VkFormat format_ = VK_FORMAT_UNDEFINED; // set by mip chains, which carry their own format
 	VkImage textureImage_ = VK_NULL_HANDLE;
 	VkDeviceMemory textureImageMemory_ = VK_NULL_HANDLE;
 	VkImageView textureImageView_ = VK_NULL_HANDLE;
@@ -92,6 +132,8 @@ private:
 	int32_t texHeight_ = 0;
 	bool needsMipmaps_ = false;
 	bool deferred_ = false;
+	// Precomputed mips: one copy per level, offsets relative to stagingBufferOffset_
+	std::vector<VkBufferImageCopy> levelCopies_;
 };
 
 } // namespace Spell
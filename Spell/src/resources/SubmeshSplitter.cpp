@@ -0,0 +1,95 @@
+#include "SubmeshSplitter.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Spell {
+
+namespace {
+
+constexpr uint32_t MAX_SPAN = MAX_SUBMESH_VERTICES - 1;
+
+// Cuts meshlets whose vertices span more than MAX_SPAN into runs that fit. The pieces keep
+// the parent's sphere and cone, which still bound them. False if a single triangle is too wide.
+bool cutWideMeshlets(const uint32_t* indices, std::vector<Meshlet>& meshlets) {
+	std::vector<Meshlet> pieces;
+	pieces.reserve(meshlets.size());
+	for (const Meshlet& meshlet : meshlets) {
+		Meshlet piece = meshlet;
+		piece.indexCount = 0;
+		uint32_t lo = std::numeric_limits<uint32_t>::max(), hi = 0;
+		for (uint32_t t = meshlet.firstIndex; t < meshlet.firstIndex + meshlet.indexCount; t += 3) {
+			const uint32_t triLo = std::min(indices[t], std::min(indices[t + 1], indices[t + 2]));
+			const uint32_t triHi = std::max(indices[t], std::max(indices[t + 1], indices[t + 2]));
+			if (triHi - triLo > MAX_SPAN) return false;
+			if (piece.indexCount > 0 && std::max(hi, triHi) - std::min(lo, triLo) > MAX_SPAN) {
+				pieces.push_back(piece);
+				piece.firstIndex = t;
+				piece.indexCount = 0;
+				lo = std::numeric_limits<uint32_t>::max();
+				hi = 0;
+			}
+			lo = std::min(lo, triLo);
+			hi = std::max(hi, triHi);
+			piece.indexCount += 3;
+		}
+		if (piece.indexCount > 0) pieces.push_back(piece);
+	}
+	meshlets = std::move(pieces);
+	return true;
+}
+
+} // namespace
+
+bool splitSubmeshes(const uint32_t* indices, std::vector<Meshlet>& meshlets, std::vector<Submesh>& out) {
+	if (!cutWideMeshlets(indices, meshlets)) return false;
+
+	Submesh current;
+	bool open = false;
+	uint32_t lo = 0, hi = 0;
+	size_t firstMeshlet = 0;
+	auto closeSubmesh = [&](size_t endMeshlet) {
+		current.vertexOffset = static_cast<int32_t>(lo);
+		for (size_t m = firstMeshlet; m < endMeshlet; m++) meshlets[m].vertexOffset = current.vertexOffset;
+		out.push_back(current);
+	};
+
+	for (size_t m = 0; m < meshlets.size(); m++) {
+		const Meshlet& meshlet = meshlets[m];
+		uint32_t meshletLo = std::numeric_limits<uint32_t>::max(), meshletHi = 0;
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++) {
+			meshletLo = std::min(meshletLo, indices[i]);
+			meshletHi = std::max(meshletHi, indices[i]);
+		}
+
+		const bool fits = open && std::max(hi, meshletHi) - std::min(lo, meshletLo) <= MAX_SPAN
+			&& meshlet.firstIndex == current.firstIndex + current.indexCount;
+		if (fits) {
+			lo = std::min(lo, meshletLo);
+			hi = std::max(hi, meshletHi);
+			current.indexCount += meshlet.indexCount;
+			continue;
+		}
+		if (open) closeSubmesh(m);
+		open = true;
+		firstMeshlet = m;
+		current = Submesh{ meshlet.firstIndex, meshlet.indexCount, 0 };
+		lo = meshletLo;
+		hi = meshletHi;
+	}
+	if (open) closeSubmesh(meshlets.size());
+	return true;
+}
+
+void rebaseIndices16(const uint32_t* indices, uint32_t indexCount, const std::vector<Submesh>& submeshes,
+	std::vector<uint16_t>& out) {
+	out.assign(indexCount, 0);
+	for (const Submesh& submesh : submeshes) {
+		const uint32_t offset = static_cast<uint32_t>(submesh.vertexOffset);
+		for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i++) {
+			out[i] = static_cast<uint16_t>(indices[i] - offset);
+		}
+	}
+}
+
+} // namespace Spell
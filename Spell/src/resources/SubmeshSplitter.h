@@ -0,0 +1,26 @@
+#pragma once
+
+#include "MeshletBuilder.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Indices of a submesh span at most this many vertices (the 16-bit index range)
+constexpr uint32_t MAX_SUBMESH_VERTICES = 1u << 16;
+
+// Groups consecutive meshlets of one index run into submeshes whose vertices span at most
+// MAX_SUBMESH_VERTICES, and sets each meshlet's vertexOffset to that of its submesh. Meshlets
+// must be in index order and cover the run, as buildMeshlets() emits them. A meshlet that
+// spans too much on its own (the builder can join distant leftover triangles) is cut into
+// several meshlets with the same bounds. Returns false if a single triangle spans too much;
+// `out` and `meshlets` are then incomplete.
+bool splitSubmeshes(const uint32_t* indices, std::vector<Meshlet>& meshlets, std::vector<Submesh>& out);
+
+// Writes every submesh's indices relative to its vertexOffset. `out` is resized to
+// `indexCount`; indices outside all submeshes (never drawn) are set to 0.
+void rebaseIndices16(const uint32_t* indices, uint32_t indexCount, const std::vector<Submesh>& submeshes,
+	std::vector<uint16_t>& out);
+
+} // namespace Spell
@@ -0,0 +1,597 @@
+#include "TextureCache.h"
+#include "BlockCompression.h"
+#include "ContentHash.h"
+
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+namespace Spell {
+
+namespace {
+
+constexpr unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+constexpr const char* CACHE_DIR = "cache/textures";
+constexpr const char* WRITER = "Spell Engine";
+
+struct Ktx2Header {
+	unsigned char identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+struct Ktx2LevelIndex {
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+// Khronos Data Format descriptor values (khr_df.h)
+constexpr uint8_t DF_MODEL_RGBSDA = 1;
+constexpr uint8_t DF_MODEL_BC1A = 128;
+constexpr uint8_t DF_MODEL_BC3 = 130;
+constexpr uint8_t DF_MODEL_BC4 = 131;
+constexpr uint8_t DF_MODEL_BC5 = 132;
+constexpr uint8_t DF_MODEL_BC7 = 134;
+constexpr uint8_t DF_PRIMARIES_BT709 = 1;
+constexpr uint8_t DF_TRANSFER_LINEAR = 1;
+constexpr uint8_t DF_TRANSFER_SRGB = 2;
+constexpr uint8_t DF_SAMPLE_LINEAR = 0x10; // qualifier: channel stays linear under an sRGB transfer
+constexpr uint8_t DF_CHANNEL_ALPHA = 15;
+
+struct DfdSample {
+	uint8_t channel;
+	uint16_t bitOffset;
+	uint16_t bitLength;
+};
+
+constexpr size_t alignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void appendU32(std::vector<unsigned char>& out, uint32_t value) {
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(&value);
+	out.insert(out.end(), p, p + sizeof(value));
+}
+
+// Basic data format descriptor of `format`, as required by KTX2 readers
+std::vector<unsigned char> buildDfd(VkFormat format) {
+	TextureFormatInfo info;
+	getTextureFormatInfo(format, info);
+
+	uint8_t model = DF_MODEL_RGBSDA;
+	std::vector<DfdSample> samples;
+	switch (format) {
+	case VK_FORMAT_R8_UNORM:
+		samples = { { 0, 0, 8 } };
+		break;
+	case VK_FORMAT_R8G8_UNORM:
+		samples = { { 0, 0, 8 }, { 1, 8, 8 } };
+		break;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		samples = { { 0, 0, 8 }, { 1, 8, 8 }, { 2, 16, 8 }, { DF_CHANNEL_ALPHA, 24, 8 } };
+		break;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		model = DF_MODEL_BC1A;
+		samples = { { 0, 0, 64 } };
+		break;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		model = DF_MODEL_BC1A;
+		samples = { { 1, 0, 64 } };
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		model = DF_MODEL_BC3;
+		samples = { { DF_CHANNEL_ALPHA, 0, 64 }, { 0, 64, 64 } };
+		break;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		model = DF_MODEL_BC4;
+		samples = { { 0, 0, 64 } };
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		model = DF_MODEL_BC5;
+		samples = { { 0, 0, 64 }, { 1, 64, 64 } };
+		break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		model = DF_MODEL_BC7;
+		samples = { { 0, 0, 128 } };
+		break;
+	default:
+		break;
+	}
+
+	const bool compressed = info.blockWidth > 1;
+	const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+	std::vector<unsigned char> dfd;
+	appendU32(dfd, 4 + blockSize); // dfdTotalSize
+	appendU32(dfd, 0);             // vendorId = Khronos, descriptorType = basic
+	appendU32(dfd, 2u | (blockSize << 16)); // versionNumber = 1.3
+	appendU32(dfd, model | (DF_PRIMARIES_BT709 << 8)
+		| ((info.srgb ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR) << 16));
+	appendU32(dfd, (info.blockWidth - 1) | ((info.blockHeight - 1) << 8));
+	appendU32(dfd, info.blockBytes); // bytesPlane0
+	appendU32(dfd, 0);
+	for (const DfdSample& s : samples) {
+		uint8_t channel = s.channel;
+		if (info.srgb && s.channel == DF_CHANNEL_ALPHA) channel |= DF_SAMPLE_LINEAR;
+		appendU32(dfd, s.bitOffset | (static_cast<uint32_t>(s.bitLength - 1) << 16)
+			| (static_cast<uint32_t>(channel) << 24));
+		appendU32(dfd, 0); // sample position
+		appendU32(dfd, 0); // lower
+		appendU32(dfd, compressed ? 0xFFFFFFFFu : (1u << s.bitLength) - 1); // upper
+	}
+	return dfd;
+}
+
+// sRGB <-> linear tables for mip filtering
+struct SrgbTables {
+	float toLinear[256];
+	unsigned char toSrgb[4096];
+
+	SrgbTables() {
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; i++) {
+			float l = i / 4095.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = static_cast<unsigned char>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+		}
+	}
+};
+
+const SrgbTables& srgbTables() {
+	static const SrgbTables tables;
+	return tables;
+}
+
+void downsample(const unsigned char* src, uint32_t srcWidth, uint32_t srcHeight,
+	unsigned char* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels, bool srgb) {
+	const SrgbTables& tables = srgbTables();
+	for (uint32_t y = 0; y < dstHeight; y++) {
+		const uint32_t y0 = std::min(2 * y, srcHeight - 1);
+		const uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+		for (uint32_t x = 0; x < dstWidth; x++) {
+			const uint32_t x0 = std::min(2 * x, srcWidth - 1);
+			const uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+			const unsigned char* p[4] = {
+				src + (static_cast<size_t>(y0) * srcWidth + x0) * channels, src + (static_cast<size_t>(y0) * srcWidth + x1) * channels,
+				src + (static_cast<size_t>(y1) * srcWidth + x0) * channels, src + (static_cast<size_t>(y1) * srcWidth + x1) * channels
+			};
+			unsigned char* out = dst + (static_cast<size_t>(y) * dstWidth + x) * channels;
+			for (uint32_t c = 0; c < channels; c++) {
+				// Only the color channels of sRGB images are encoded; alpha is always linear
+				if (srgb && c < 3) {
+					float sum = tables.toLinear[p[0][c]] + tables.toLinear[p[1][c]]
+						+ tables.toLinear[p[2][c]] + tables.toLinear[p[3][c]];
+					out[c] = tables.toSrgb[static_cast<int>(sum * (4095.0f / 4.0f) + 0.5f)];
+				} else {
+					out[c] = static_cast<unsigned char>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+
+// ========== TextureMipChain ==========
+
+size_t TextureMipChain::stagingOffset(uint32_t level) const {
+	size_t offset = 0;
+	for (uint32_t i = 0; i < level; i++) {
+		offset = alignUp(offset + levels[i].size, STAGING_ALIGNMENT);
+	}
+	return offset;
+}
+
+size_t TextureMipChain::stagingSize() const {
+	return alignUp(stagingOffset(levelCount()), STAGING_ALIGNMENT);
+}
+
+void TextureMipChain::copyToStaging(unsigned char* dst) const {
+	size_t offset = 0;
+	for (const TextureMipLevel& level : levels) {
+		std::memcpy(dst + offset, level.data, level.size);
+		offset = alignUp(offset + level.size, STAGING_ALIGNMENT);
+	}
+}
+
+// ========== Formats ==========
+
+uint32_t textureChannelCount(TextureChannels channels) {
+	switch (channels) {
+	case TextureChannels::R: return 1;
+	case TextureChannels::Rg:
+	case TextureChannels::Bg: return 2;
+	default: return 4;
+	}
+}
+
+VkFormat textureFormatForChannels(uint32_t channelCount, bool srgb) {
+	switch (channelCount) {
+	case 1: return VK_FORMAT_R8_UNORM;
+	case 2: return VK_FORMAT_R8G8_UNORM;
+	default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+void selectTextureChannels(unsigned char* rgba, size_t pixelCount, TextureChannels channels) {
+	// Every output texel is at or before its source texel, so the walk can run in place
+	switch (channels) {
+	case TextureChannels::R:
+		for (size_t i = 0; i < pixelCount; i++) {
+			rgba[i] = rgba[i * 4];
+		}
+		break;
+	case TextureChannels::Rg:
+		for (size_t i = 0; i < pixelCount; i++) {
+			rgba[i * 2] = rgba[i * 4];
+			rgba[i * 2 + 1] = rgba[i * 4 + 1];
+		}
+		break;
+	case TextureChannels::Bg:
+		for (size_t i = 0; i < pixelCount; i++) {
+			const unsigned char b = rgba[i * 4 + 2];
+			rgba[i * 2 + 1] = rgba[i * 4 + 1];
+			rgba[i * 2] = b;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+bool getTextureFormatInfo(VkFormat format, TextureFormatInfo& info) {
+	info = TextureFormatInfo{};
+	switch (format) {
+	case VK_FORMAT_R8_UNORM:
+		info.blockBytes = 1;
+		return true;
+	case VK_FORMAT_R8G8_UNORM:
+		info.blockBytes = 2;
+		return true;
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		info.srgb = true;
+		[[fallthrough]];
+	case VK_FORMAT_R8G8B8A8_UNORM:
+		info.blockBytes = 4;
+		return true;
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		info.srgb = true;
+		[[fallthrough]];
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		info.blockWidth = info.blockHeight = 4;
+		info.blockBytes = 8;
+		return true;
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		info.srgb = true;
+		[[fallthrough]];
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		info.blockWidth = info.blockHeight = 4;
+		info.blockBytes = 16;
+		return true;
+	default:
+		return false;
+	}
+}
+
+size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(format, info)) return 0;
+	const size_t blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+	const size_t blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+	return blocksX * blocksY * info.blockBytes;
+}
+
+uint32_t fullMipLevelCount(uint32_t width, uint32_t height) {
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+// ========== Mip generation ==========
+
+TextureMipChain buildMipChain(const unsigned char* rgba, uint32_t width, uint32_t height, bool srgb) {
+	return buildMipChain(rgba, width, height, textureFormatForChannels(4, srgb));
+}
+
+TextureMipChain buildMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, VkFormat format) {
+	TextureFormatInfo info;
+	getTextureFormatInfo(format, info);
+	const uint32_t channels = info.blockBytes;
+
+	TextureMipChain chain;
+	chain.format = format;
+	chain.width = width;
+	chain.height = height;
+
+	const uint32_t levelCount = fullMipLevelCount(width, height);
+	chain.levels.resize(levelCount);
+	size_t total = 0;
+	for (uint32_t i = 0; i < levelCount; i++) {
+		TextureMipLevel& level = chain.levels[i];
+		level.width = std::max(1u, width >> i);
+		level.height = std::max(1u, height >> i);
+		level.size = static_cast<size_t>(level.width) * level.height * channels;
+		total += level.size;
+	}
+
+	chain.storage.resize(total);
+	unsigned char* dst = chain.storage.data();
+	for (uint32_t i = 0; i < levelCount; i++) {
+		TextureMipLevel& level = chain.levels[i];
+		if (i == 0) {
+			std::memcpy(dst, pixels, level.size);
+		} else {
+			const TextureMipLevel& parent = chain.levels[i - 1];
+			downsample(parent.data, parent.width, parent.height, dst, level.width, level.height, channels, info.srgb);
+		}
+		level.data = dst;
+		dst += level.size;
+	}
+	return chain;
+}
+
+// ========== KTX2 ==========
+
+bool isKtx2Path(const std::string& path) {
+	std::string ext = std::filesystem::path(path).extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".ktx2";
+}
+
+bool readKtx2(const std::string& path, TextureMipChain& out) {
+	MappedFile file;
+	if (!file.open(path) || file.size() < sizeof(Ktx2Header)) return false;
+
+	Ktx2Header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return false;
+
+	const VkFormat format = static_cast<VkFormat>(header.vkFormat);
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(format, info)) {
+		std::cerr << "[Spell] KTX2: unsupported vkFormat " << header.vkFormat << " in " << path << std::endl;
+		return false;
+	}
+	if (header.supercompressionScheme != 0) {
+		std::cerr << "[Spell] KTX2: supercompressed files are not supported: " << path << std::endl;
+		return false;
+	}
+	if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1
+		|| header.layerCount > 1 || header.faceCount != 1) {
+		std::cerr << "[Spell] KTX2: only single 2D images are supported: " << path << std::endl;
+		return false;
+	}
+
+	const uint32_t levelCount = std::max(1u, header.levelCount);
+	if (levelCount > fullMipLevelCount(header.pixelWidth, header.pixelHeight)
+		|| sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex) > file.size()) {
+		return false;
+	}
+
+	std::vector<TextureMipLevel> levels(levelCount);
+	for (uint32_t i = 0; i < levelCount; i++) {
+		Ktx2LevelIndex index;
+		std::memcpy(&index, file.data() + sizeof(Ktx2Header) + i * sizeof(Ktx2LevelIndex), sizeof(index));
+
+		TextureMipLevel& level = levels[i];
+		level.width = std::max(1u, header.pixelWidth >> i);
+		level.height = std::max(1u, header.pixelHeight >> i);
+		level.size = textureLevelSize(format, level.width, level.height);
+		if (index.byteLength != level.size || index.byteOffset > file.size()
+			|| index.byteLength > file.size() - index.byteOffset) {
+			std::cerr << "[Spell] KTX2: bad level " << i << " in " << path << std::endl;
+			return false;
+		}
+		level.data = reinterpret_cast<const unsigned char*>(file.data() + index.byteOffset);
+	}
+
+	out.format = format;
+	out.width = header.pixelWidth;
+	out.height = header.pixelHeight;
+	out.levels = std::move(levels);
+	out.storage.clear();
+	out.file = std::move(file);
+	return true;
+}
+
+bool writeKtx2(const std::string& path, const TextureMipChain& chain) {
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(chain.format, info) || chain.levels.empty()) return false;
+
+	const uint32_t levelCount = chain.levelCount();
+	const std::vector<unsigned char> dfd = buildDfd(chain.format);
+
+	// Key/value data: only KTXwriter, a NUL-terminated string padded to 4 bytes
+	std::vector<unsigned char> kvd;
+	{
+		const std::string key = "KTXwriter";
+		const uint32_t length = static_cast<uint32_t>(key.size() + 1 + std::strlen(WRITER) + 1);
+		appendU32(kvd, length);
+		kvd.insert(kvd.end(), key.begin(), key.end());
+		kvd.push_back(0);
+		kvd.insert(kvd.end(), WRITER, WRITER + std::strlen(WRITER));
+		kvd.push_back(0);
+		kvd.resize(alignUp(kvd.size(), 4), 0);
+	}
+
+	Ktx2Header header{};
+	std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = static_cast<uint32_t>(chain.format);
+	header.typeSize = 1;
+	header.pixelWidth = chain.width;
+	header.pixelHeight = chain.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2LevelIndex));
+	header.dfdByteLength = static_cast<uint32_t>(dfd.size());
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+	// Level data follows, smallest level first, each aligned to lcm(block size, 4)
+	const size_t levelAlignment = info.blockBytes % 4 == 0 ? info.blockBytes : 4;
+	std::vector<Ktx2LevelIndex> index(levelCount);
+	size_t offset = header.kvdByteOffset + header.kvdByteLength;
+	for (uint32_t i = levelCount; i-- > 0;) {
+		offset = alignUp(offset, levelAlignment);
+		index[i].byteOffset = offset;
+		index[i].byteLength = chain.levels[i].size;
+		index[i].uncompressedByteLength = chain.levels[i].size;
+		offset += chain.levels[i].size;
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	const char padding[16] = {};
+	auto writeAt = [&](uint64_t at, const void* data, size_t size) {
+		uint64_t pos = static_cast<uint64_t>(file.tellp());
+		file.write(padding, static_cast<std::streamsize>(at - pos));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	};
+	writeAt(0, &header, sizeof(header));
+	writeAt(sizeof(header), index.data(), index.size() * sizeof(Ktx2LevelIndex));
+	writeAt(header.dfdByteOffset, dfd.data(), dfd.size());
+	writeAt(header.kvdByteOffset, kvd.data(), kvd.size());
+	for (uint32_t i = levelCount; i-- > 0;) {
+		writeAt(index[i].byteOffset, chain.levels[i].data, chain.levels[i].size);
+	}
+	return static_cast<bool>(file);
+}
+
+// ========== Cache ==========
+
+std::shared_ptr<TextureMipChain> buildTextureChain(const unsigned char* encoded, size_t size, VkFormat format,
+	TextureChannels channels, uint32_t threadCount) {
+	TextureFormatInfo info;
+	if (!encoded || size == 0 || size > static_cast<size_t>(std::numeric_limits<int>::max())
+		|| !getTextureFormatInfo(format, info)) {
+		return nullptr;
+	}
+
+	int width, height, sourceChannels;
+	stbi_uc* pixels = stbi_load_from_memory(encoded, static_cast<int>(size), &width, &height, &sourceChannels, STBI_rgb_alpha);
+	if (!pixels) return nullptr;
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	// The block encoders read RGBA8: BC4 takes R, BC5 takes R and G. Only the metallic-roughness
+	// swizzle has to move a channel for them; the rest of the texel is ignored.
+	BlockFormat blockFormat;
+	const bool compressed = blockFormatFromVk(format, blockFormat);
+	std::shared_ptr<TextureMipChain> chain;
+	if (compressed) {
+		if (channels == TextureChannels::Bg) {
+			for (size_t i = 0; i < pixelCount; i++) {
+				pixels[i * 4] = pixels[i * 4 + 2];
+			}
+		}
+		chain = std::make_shared<TextureMipChain>(
+			buildMipChain(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), info.srgb));
+	} else {
+		if (textureFormatForChannels(textureChannelCount(channels), info.srgb) != format) {
+			stbi_image_free(pixels);
+			return nullptr;
+		}
+		selectTextureChannels(pixels, pixelCount, channels);
+		chain = std::make_shared<TextureMipChain>(
+			buildMipChain(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), format));
+	}
+	stbi_image_free(pixels);
+
+	if (compressed) {
+		*chain = compressMipChain(*chain, blockFormat, info.srgb, BlockSimd::Auto, threadCount);
+	}
+	return chain;
+}
+
+std::string TextureCache::cachePathFor(uint64_t sourceHash, VkFormat format, TextureChannels channels) {
+	const uint64_t key[4] = { sourceHash, static_cast<uint64_t>(format), static_cast<uint64_t>(channels), VERSION };
+	return std::string(CACHE_DIR) + "/" + hashToHex(hashBytes(key, sizeof(key))) + ".ktx2";
+}
+
+bool TextureCache::load(uint64_t sourceHash, VkFormat format, TextureChannels channels, TextureMipChain& out) {
+	std::string cachePath = cachePathFor(sourceHash, format, channels);
+	if (!std::filesystem::exists(cachePath)) return false;
+
+	TextureMipChain chain;
+	if (!readKtx2(cachePath, chain) || chain.format != format) {
+		return false;
+	}
+	out = std::move(chain);
+	return true;
+}
+
+bool TextureCache::store(uint64_t sourceHash, TextureChannels channels, const TextureMipChain& chain) {
+	std::string cachePath = cachePathFor(sourceHash, chain.format, channels);
+
+	std::error_code ec;
+	std::filesystem::create_directories(CACHE_DIR, ec);
+
+	// Write to a temporary file first so a crash never leaves a truncated entry behind.
+	// Decode workers may store the same image at once, so the name is unique per thread.
+	std::string tempPath = cachePath + "." + hashToHex(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	if (!writeKtx2(tempPath, chain)) {
+		std::cerr << "[Spell] Texture cache: cannot write " << tempPath << std::endl;
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec) {
+		std::cerr << "[Spell] Texture cache: cannot replace " << cachePath << ": " << ec.message() << std::endl;
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	return true;
+}
+
+std::shared_ptr<const TextureMipChain> TextureCache::loadOrBuild(const unsigned char* encoded, size_t size,
+	VkFormat format, TextureChannels channels, bool& cacheHit, uint32_t threadCount) {
+	cacheHit = false;
+	if (!encoded || size == 0) return nullptr;
+
+	const uint64_t sourceHash = hashBytes(encoded, size);
+	auto cached = std::make_shared<TextureMipChain>();
+	if (load(sourceHash, format, channels, *cached)) {
+		cacheHit = true;
+		return cached;
+	}
+
+	auto chain = buildTextureChain(encoded, size, format, channels, threadCount);
+	if (chain) store(sourceHash, channels, *chain);
+	return chain;
+}
+
+} // namespace Spell
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Spell {
+
+// One level of a mip chain. `data` points into the owning chain's storage or mapping.
+struct TextureMipLevel {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Every mip level of one texture in its final GPU format, ready to be copied into a staging
+// buffer. Levels come either from a memory-mapped .ktx2 file or from storage built in memory;
+// both keep their addresses when the chain is moved.
+struct TextureMipChain {
+	// Levels are staged back to back, each at a multiple of this (covers every texel block size)
+	static constexpr size_t STAGING_ALIGNMENT = 16;
+
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<TextureMipLevel> levels; // level 0 first
+
+	MappedFile file;
+	std::vector<unsigned char> storage;
+
+	TextureMipChain() = default;
+	TextureMipChain(const TextureMipChain&) = delete;
+	TextureMipChain& operator=(const TextureMipChain&) = delete;
+	TextureMipChain(TextureMipChain&&) = default;
+	TextureMipChain& operator=(TextureMipChain&&) = default;
+
+	uint32_t levelCount() const { return static_cast<uint32_t>(levels.size()); }
+	size_t stagingOffset(uint32_t level) const;
+	size_t stagingSize() const;
+	// Writes every level at its stagingOffset(); dst must hold stagingSize() bytes
+	void copyToStaging(unsigned char* dst) const;
+};
+
+// Texel block layout of the formats textures may use
+struct TextureFormatInfo {
+	uint32_t blockWidth = 1;  // 4 for block-compressed formats
+	uint32_t blockHeight = 1;
+	uint32_t blockBytes = 0;
+	bool srgb = false;
+};
+
+// Channels a texture keeps from its decoded RGBA8 source. Scalar and two-channel material maps
+// are stored as R8 / RG8 (or BC4 / BC5) instead of being expanded to four channels.
+enum class TextureChannels : uint32_t {
+	Rgba, // diffuse
+	R,    // separate metallic or roughness map: its red channel
+	Rg,   // normal map: X and Y, the shader rebuilds Z
+	Bg,   // glTF metallicRoughness: metallic (blue) into R, roughness (green) into G
+};
+
+uint32_t textureChannelCount(TextureChannels channels);
+// R8_UNORM, R8G8_UNORM or R8G8B8A8 (sRGB or UNORM) for 1, 2 or 4 channels
+VkFormat textureFormatForChannels(uint32_t channelCount, bool srgb);
+// Rewrites `pixelCount` RGBA8 texels in place as tightly packed texels of `channels`;
+// Rgba leaves them untouched
+void selectTextureChannels(unsigned char* rgba, size_t pixelCount, TextureChannels channels);
+
+// False for formats the texture path does not handle
+bool getTextureFormatInfo(VkFormat format, TextureFormatInfo& info);
+size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height);
+// floor(log2(max(width, height))) + 1, the full chain down to 1x1
+uint32_t fullMipLevelCount(uint32_t width, uint32_t height);
+
+// Builds the full mip chain of an RGBA8 image on the calling thread with a 2x2 box filter.
+// sRGB images are filtered in linear space; alpha is always linear.
+TextureMipChain buildMipChain(const unsigned char* rgba, uint32_t width, uint32_t height, bool srgb);
+// Same for tightly packed R8, RG8 or RGBA8 texels of `format`
+TextureMipChain buildMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, VkFormat format);
+
+// KTX 2.0 files: 2D, one layer and face, no supercompression. The reader maps the file and
+// points the levels into it; a levelCount of 0 is read as a single level.
+bool isKtx2Path(const std::string& path);
+bool readKtx2(const std::string& path, TextureMipChain& out);
+bool writeKtx2(const std::string& path, const TextureMipChain& chain);
+
+// Mip chain of the `channels` of an encoded image (PNG, JPG, ...) in `format`: R8, RG8 or RGBA8
+// to match the channels, or one of the block formats of BlockCompression.h, which are compressed
+// from the RGBA8 chain on `threadCount` threads (0: every hardware thread). Returns null if the
+// image cannot be decoded.
+std::shared_ptr<TextureMipChain> buildTextureChain(const unsigned char* encoded, size_t size, VkFormat format,
+	TextureChannels channels, uint32_t threadCount = 0);
+
+// On-disk cache of final texture mip chains (.ktx2 files under cache/textures/), keyed by
+// the content hash of the encoded source image, the target format and the channels. A hit skips the image
+// decode, the block compression and the GPU mip generation: the levels are copied straight
+// into staging.
+class TextureCache {
+public:
+	// Bump whenever the stored chains change (filtering, encoders, channel layout)
+	static constexpr uint32_t VERSION = 3;
+
+	static std::string cachePathFor(uint64_t sourceHash, VkFormat format, TextureChannels channels);
+
+	// Returns true on a cache hit
+	static bool load(uint64_t sourceHash, VkFormat format, TextureChannels channels, TextureMipChain& out);
+
+	// Failures are logged, not thrown
+	static bool store(uint64_t sourceHash, TextureChannels channels, const TextureMipChain& chain);
+
+	// buildTextureChain through the cache: a hit maps the stored entry, a miss builds the chain
+	// and writes the entry
+	static std::shared_ptr<const TextureMipChain> loadOrBuild(const unsigned char* encoded, size_t size,
+		VkFormat format, TextureChannels channels, bool& cacheHit, uint32_t threadCount = 0);
+};
+
+} // namespace Spell
@@ -0,0 +1,95 @@
+#include "TextureDecodeQueue.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace Spell {
+
+TextureDecodeQueue::TextureDecodeQueue(size_t taskCount, VkDeviceSize budget, DecodeFn decode)
+	: taskCount_{ taskCount }, budget_{ budget }, decode_{ std::move(decode) } {
+	const size_t workerCount = std::min<size_t>(taskCount, std::max(1u, std::thread::hardware_concurrency()));
+	for (size_t i = 0; i < workerCount; i++) {
+		workers_.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+TextureDecodeQueue::~TextureDecodeQueue() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	budgetFreed_.notify_all();
+	for (auto& worker : workers_) worker.join();
+
+	for (Result& result : done_) {
+		if (result.decoded.pixels) stbi_image_free(result.decoded.pixels);
+	}
+}
+
+bool TextureDecodeQueue::next(size_t& task, DecodedImageData& decoded) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	imageReady_.wait(lock, [this]() { return !done_.empty() || handedOut_ == taskCount_; });
+	return takeLocked(task, decoded);
+}
+
+bool TextureDecodeQueue::tryNext(size_t& task, DecodedImageData& decoded) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return takeLocked(task, decoded);
+}
+
+void TextureDecodeQueue::release(VkDeviceSize bytes) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		heldBytes_ -= std::min(bytes, heldBytes_);
+	}
+	budgetFreed_.notify_all();
+}
+
+VkDeviceSize TextureDecodeQueue::peakHeldBytes() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return peakHeldBytes_;
+}
+
+bool TextureDecodeQueue::takeLocked(size_t& task, DecodedImageData& decoded) {
+	if (done_.empty()) return false;
+	task = done_.front().task;
+	decoded = std::move(done_.front().decoded);
+	done_.pop_front();
+	handedOut_++;
+	return true;
+}
+
+void TextureDecodeQueue::workerLoop() {
+	for (;;) {
+		size_t task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			budgetFreed_.wait(lock, [this]() {
+				return stopping_ || nextTask_ == taskCount_ || heldBytes_ == 0 || heldBytes_ < budget_;
+			});
+			if (stopping_ || nextTask_ == taskCount_) return;
+			task = nextTask_++;
+		}
+
+		DecodedImageData decoded;
+		try {
+			decoded = decode_(task);
+		} catch (const std::exception& e) {
+			// The slot falls back like an image that failed to load
+			std::cerr << "[Spell] Texture decode failed: " << e.what() << std::endl;
+			decoded = DecodedImageData{};
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			heldBytes_ += decoded.imageSize;
+			peakHeldBytes_ = std::max(peakHeldBytes_, heldBytes_);
+			done_.push_back({ task, std::move(decoded) });
+		}
+		imageReady_.notify_one();
+	}
+}
+
+} // namespace Spell
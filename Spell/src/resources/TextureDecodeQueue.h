@@ -0,0 +1,67 @@
+#pragma once
+
+#include "SpellTexture.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Spell {
+
+// Decodes the images of one texture load on a fixed set of worker threads and hands them out in
+// the order they finish. A decoded image counts against `budget` from the moment it is done until
+// release(); workers do not start another decode while the held images fill the budget, so host
+// memory stays at the budget plus at most one image per worker instead of every decoded image.
+// With nothing held a decode always starts, so an image larger than the budget still goes through.
+class TextureDecodeQueue {
+public:
+	using DecodeFn = std::function<DecodedImageData(size_t task)>;
+
+	// Starts decoding tasks 0..taskCount-1 right away; `decode` runs on the workers
+	TextureDecodeQueue(size_t taskCount, VkDeviceSize budget, DecodeFn decode);
+	// Stops the workers after their current decode and frees the images nobody took
+	~TextureDecodeQueue();
+
+	TextureDecodeQueue(const TextureDecodeQueue&) = delete;
+	TextureDecodeQueue& operator=(const TextureDecodeQueue&) = delete;
+
+	// Blocks until the next image is decoded; false once every task has been handed out
+	bool next(size_t& task, DecodedImageData& decoded);
+	// Like next(), but returns false right away when no image is ready
+	bool tryNext(size_t& task, DecodedImageData& decoded);
+	// Returns the bytes of a handed-out image to the budget once its pixels are freed
+	void release(VkDeviceSize bytes);
+
+	VkDeviceSize budget() const { return budget_; }
+	// Most decoded bytes held at once over the whole load
+	VkDeviceSize peakHeldBytes();
+
+private:
+	struct Result {
+		size_t task;
+		DecodedImageData decoded;
+	};
+
+	void workerLoop();
+	bool takeLocked(size_t& task, DecodedImageData& decoded);
+
+	const size_t taskCount_;
+	const VkDeviceSize budget_;
+	DecodeFn decode_;
+
+	std::mutex mutex_;
+	std::condition_variable imageReady_;
+	std::condition_variable budgetFreed_;
+	std::deque<Result> done_;
+	size_t nextTask_ = 0;
+	size_t handedOut_ = 0;
+	VkDeviceSize heldBytes_ = 0; // decoded, not released yet
+	VkDeviceSize peakHeldBytes_ = 0;
+	bool stopping_ = false;
+	std::vector<std::thread> workers_;
+};
+
+} // namespace Spell
@@ -0,0 +1,224 @@
+#include "TextureUploadRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace Spell {
+
+namespace {
+
+constexpr VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Sorted, disjoint intervals covering `spans`
+std::vector<TextureUploadTimeline::Span> mergeSpans(std::vector<TextureUploadTimeline::Span> spans) {
+	std::sort(spans.begin(), spans.end(),
+		[](const TextureUploadTimeline::Span& a, const TextureUploadTimeline::Span& b) { return a.startMs < b.startMs; });
+	std::vector<TextureUploadTimeline::Span> merged;
+	for (const auto& span : spans) {
+		if (!merged.empty() && span.startMs <= merged.back().endMs) {
+			merged.back().endMs = std::max(merged.back().endMs, span.endMs);
+		} else {
+			merged.push_back(span);
+		}
+	}
+	return merged;
+}
+
+} // namespace
+
+// ========== TextureUploadTimeline ==========
+
+float TextureUploadTimeline::endMs() const {
+	float end = 0.0f;
+	for (const Span& span : decodes) end = std::max(end, span.endMs);
+	for (const Span& span : uploads) end = std::max(end, span.endMs);
+	return end;
+}
+
+void TextureUploadTimeline::computeOverlap() {
+	const auto decoding = mergeSpans(decodes);
+	const auto uploading = mergeSpans(uploads);
+	overlapMs = 0.0f;
+	size_t d = 0, u = 0;
+	while (d < decoding.size() && u < uploading.size()) {
+		const float start = std::max(decoding[d].startMs, uploading[u].startMs);
+		const float end = std::min(decoding[d].endMs, uploading[u].endMs);
+		if (end > start) overlapMs += end - start;
+		if (decoding[d].endMs < uploading[u].endMs) d++;
+		else u++;
+	}
+}
+
+// ========== TextureUploadRing ==========
+
+TextureUploadRing::TextureUploadRing(SpellDevice& device, VkDeviceSize capacity, Clock::time_point origin)
+	: device_{ device }, origin_{ origin } {
+	chunkSize_ = std::max(alignUp(capacity / CHUNK_COUNT, TextureMipChain::STAGING_ALIGNMENT), MIN_CHUNK_SIZE);
+	device_.createBuffer(this->capacity(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		buffer_, memory_);
+
+	void* mapped;
+	vkMapMemory(device_.device(), memory_, 0, this->capacity(), 0, &mapped);
+	mapped_ = static_cast<unsigned char*>(mapped);
+
+	for (uint32_t i = 0; i < CHUNK_COUNT; i++) {
+		chunks_[i].offset = i * chunkSize_;
+	}
+	timeline_.stagingBytes = this->capacity();
+}
+
+TextureUploadRing::~TextureUploadRing() {
+	// Submits a partly recorded chunk too: its textures are owned by the caller and may
+	// already be referenced by descriptors
+	finish();
+	vkUnmapMemory(device_.device(), memory_);
+	vkDestroyBuffer(device_.device(), buffer_, nullptr);
+	vkFreeMemory(device_.device(), memory_, nullptr);
+}
+
+void TextureUploadRing::upload(SpellTexture& texture, const DecodedImageData& decoded) {
+	TextureFormatInfo info;
+	if (!getTextureFormatInfo(texture.getFormat(), info)) {
+		throw std::runtime_error("texture format " + std::to_string(texture.getFormat()) + " cannot be streamed");
+	}
+
+	std::vector<TextureMipLevel> levels;
+	if (decoded.mipChain) {
+		levels = decoded.mipChain->levels;
+	} else {
+		TextureMipLevel level;
+		level.data = decoded.pixels;
+		level.size = static_cast<size_t>(decoded.imageSize);
+		level.width = static_cast<uint32_t>(decoded.width);
+		level.height = static_cast<uint32_t>(decoded.height);
+		levels.push_back(level);
+	}
+
+	auto blockRowBytes = [&info](const TextureMipLevel& level) {
+		return static_cast<VkDeviceSize>((level.width + info.blockWidth - 1) / info.blockWidth) * info.blockBytes;
+	};
+	for (const TextureMipLevel& level : levels) {
+		if (blockRowBytes(level) > chunkSize_) {
+			throw std::runtime_error("texture rows of " + std::to_string(blockRowBytes(level))
+				+ " bytes do not fit a staging chunk of " + std::to_string(chunkSize_) + " bytes");
+		}
+	}
+
+	Chunk* chunk = nullptr;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(levels.size()); i++) {
+		const TextureMipLevel& level = levels[i];
+		const VkDeviceSize rowBytes = blockRowBytes(level);
+		const uint32_t rowCount = (level.height + info.blockHeight - 1) / info.blockHeight;
+
+		uint32_t row = 0;
+		while (row < rowCount) {
+			const bool first = chunk == nullptr;
+			chunk = &reserve(rowBytes);
+			if (first) texture.recordBeginUpload(chunk->cmd);
+
+			// As many block rows as fit into the rest of the chunk
+			const VkDeviceSize offset = alignUp(chunk->used, TextureMipChain::STAGING_ALIGNMENT);
+			const uint32_t rows = static_cast<uint32_t>(
+				std::min<VkDeviceSize>(rowCount - row, (chunkSize_ - offset) / rowBytes));
+			const VkDeviceSize bytes = rows * rowBytes;
+			std::memcpy(mapped_ + chunk->offset + offset, level.data + row * rowBytes, static_cast<size_t>(bytes));
+
+			VkBufferImageCopy region{};
+			region.bufferOffset = chunk->offset + offset;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = i;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, static_cast<int32_t>(row * info.blockHeight), 0 };
+			region.imageExtent = { level.width, std::min(rows * info.blockHeight, level.height - row * info.blockHeight), 1 };
+			vkCmdCopyBufferToImage(chunk->cmd, buffer_, texture.getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &region);
+
+			chunk->used = offset + bytes;
+			timeline_.uploadedBytes += bytes;
+			row += rows;
+		}
+	}
+
+	// The chunk of the last copy is still recording: reserve() only submits a chunk when the
+	// next copy needs the room
+	if (chunk) texture.recordEndUpload(chunk->cmd);
+}
+
+void TextureUploadRing::flush() {
+	Chunk& chunk = chunks_[current_];
+	if (chunk.cmd == VK_NULL_HANDLE || chunk.fence != VK_NULL_HANDLE) return;
+	submit(chunk);
+	current_ = (current_ + 1) % CHUNK_COUNT;
+}
+
+void TextureUploadRing::poll() {
+	for (Chunk& chunk : chunks_) {
+		if (chunk.fence != VK_NULL_HANDLE && vkGetFenceStatus(device_.device(), chunk.fence) == VK_SUCCESS) {
+			complete(chunk);
+		}
+	}
+}
+
+void TextureUploadRing::finish() {
+	flush();
+	// Oldest first, so the recorded end times stay in submission order
+	for (uint32_t i = 0; i < CHUNK_COUNT; i++) {
+		Chunk& chunk = chunks_[(current_ + i) % CHUNK_COUNT];
+		if (chunk.fence != VK_NULL_HANDLE) complete(chunk);
+	}
+}
+
+void TextureUploadRing::recordDecode(Clock::time_point start, Clock::time_point end) {
+	timeline_.decodes.push_back({ msSinceOrigin(start), msSinceOrigin(end) });
+}
+
+TextureUploadRing::Chunk& TextureUploadRing::reserve(VkDeviceSize bytes) {
+	Chunk* chunk = &chunks_[current_];
+	if (chunk->cmd != VK_NULL_HANDLE && chunk->fence == VK_NULL_HANDLE
+		&& alignUp(chunk->used, TextureMipChain::STAGING_ALIGNMENT) + bytes > chunkSize_) {
+		submit(*chunk);
+		current_ = (current_ + 1) % CHUNK_COUNT;
+		chunk = &chunks_[current_];
+	}
+
+	if (chunk->fence != VK_NULL_HANDLE) {
+		// Every chunk is in flight: the GPU is behind, wait for the oldest one
+		auto stallStart = Clock::now();
+		complete(*chunk);
+		timeline_.stalls++;
+		timeline_.stallMs += std::chrono::duration<float, std::milli>(Clock::now() - stallStart).count();
+	}
+
+	if (chunk->cmd == VK_NULL_HANDLE) {
+		chunk->cmd = device_.beginSingleTimeCommands();
+		chunk->used = 0;
+	}
+	return *chunk;
+}
+
+void TextureUploadRing::submit(Chunk& chunk) {
+	chunk.span = timeline_.uploads.size();
+	const float now = msSinceOrigin(Clock::now());
+	timeline_.uploads.push_back({ now, now });
+	chunk.fence = device_.submitSingleTimeCommands(chunk.cmd);
+}
+
+void TextureUploadRing::complete(Chunk& chunk) {
+	device_.waitSingleTimeCommands(chunk.cmd, chunk.fence);
+	timeline_.uploads[chunk.span].endMs = msSinceOrigin(Clock::now());
+	chunk.cmd = VK_NULL_HANDLE;
+	chunk.fence = VK_NULL_HANDLE;
+	chunk.used = 0;
+}
+
+float TextureUploadRing::msSinceOrigin(Clock::time_point time) const {
+	return std::chrono::duration<float, std::milli>(time - origin_).count();
+}
+
+} // namespace Spell
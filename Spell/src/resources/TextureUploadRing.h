@@ -0,0 +1,97 @@
+#pragma once
+
+#include "SpellTexture.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Decode / upload timeline of one texture load, in ms since the decodes were launched
+struct TextureUploadTimeline {
+	struct Span {
+		float startMs = 0.0f;
+		float endMs = 0.0f;
+	};
+
+	std::vector<Span> decodes; // one per decoded image, in the order they were picked up
+	std::vector<Span> uploads; // one per staging chunk: submit until its fence was seen signaled
+	float overlapMs = 0.0f;    // time in which images were being decoded and uploaded at once
+	VkDeviceSize stagingBytes = 0;     // ring capacity, the bound on staging memory
+	VkDeviceSize decodeBudgetBytes = 0; // decoded bytes the decode queue may hold before pausing
+	VkDeviceSize peakPendingBytes = 0;  // decoded bytes waiting for the ring at the same time
+	VkDeviceSize uploadedBytes = 0;
+	uint32_t stalls = 0;               // waits for a chunk that was still in flight
+	float stallMs = 0.0f;
+
+	float endMs() const;
+	// Length of the intersection of the decode and the upload spans
+	void computeOverlap();
+};
+
+// Fixed-size staging ring for streaming texture uploads. The host-visible buffer is split into
+// CHUNK_COUNT chunks; each records its copies into its own command buffer and is submitted with
+// its own fence as soon as the next copy does not fit (or on flush()), so the GPU copies one
+// chunk while the CPU fills the next. Images larger than a chunk are split by level and by
+// block row. Used by one thread, whose command pool records the chunks.
+class TextureUploadRing {
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	static constexpr uint32_t CHUNK_COUNT = 4;
+	static constexpr VkDeviceSize MIN_CHUNK_SIZE = 1024 * 1024;
+
+	// `capacity` is split into CHUNK_COUNT chunks of at least MIN_CHUNK_SIZE; `origin` is time 0
+	// of the timeline
+	TextureUploadRing(SpellDevice& device, VkDeviceSize capacity, Clock::time_point origin);
+	~TextureUploadRing();
+
+	TextureUploadRing(const TextureUploadRing&) = delete;
+	TextureUploadRing& operator=(const TextureUploadRing&) = delete;
+
+	// Copies `decoded` (level 0 of its pixels, or every level of its mip chain) into the ring and
+	// records the whole upload of `texture`, which was created without staging. Throws before
+	// recording anything if one block row does not fit into a chunk.
+	void upload(SpellTexture& texture, const DecodedImageData& decoded);
+	// Submits the chunk being filled so the GPU can start on it
+	void flush();
+	// Retires the chunks whose fences have signaled
+	void poll();
+	// Flushes and waits for every chunk
+	void finish();
+
+	void recordDecode(Clock::time_point start, Clock::time_point end);
+
+	VkDeviceSize capacity() const { return chunkSize_ * CHUNK_COUNT; }
+	TextureUploadTimeline& timeline() { return timeline_; }
+
+private:
+	struct Chunk {
+		VkDeviceSize offset = 0;
+		VkDeviceSize used = 0;
+		VkCommandBuffer cmd = VK_NULL_HANDLE; // recording, or in flight once `fence` is set
+		VkFence fence = VK_NULL_HANDLE;
+		size_t span = 0;                      // its timeline.uploads entry while in flight
+	};
+
+	// The chunk being filled, with room for `bytes` at its next aligned offset. A full chunk is
+	// submitted first; a chunk still in flight from the previous round is waited for.
+	Chunk& reserve(VkDeviceSize bytes);
+	void submit(Chunk& chunk);
+	void complete(Chunk& chunk);
+	float msSinceOrigin(Clock::time_point time) const;
+
+	SpellDevice& device_;
+	VkBuffer buffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory memory_ = VK_NULL_HANDLE;
+	unsigned char* mapped_ = nullptr;
+	VkDeviceSize chunkSize_ = 0;
+	std::array<Chunk, CHUNK_COUNT> chunks_;
+	uint32_t current_ = 0;
+	Clock::time_point origin_;
+	TextureUploadTimeline timeline_;
+};
+
+} // namespace Spell
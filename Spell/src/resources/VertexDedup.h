@@ -0,0 +1,280 @@
+#pragma once
+
+#include "SpellModel.h"
+#include "robin_hood.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace Spell {
+
+static_assert(sizeof(Vertex) == 48, "hashVertexBytes assumes a tightly packed 48-byte Vertex");
+
+// 64-bit hash of the raw vertex bytes. -0.0f is folded into +0.0f because Vertex::operator==
+// treats them as equal, so equal vertices always land in the same bucket.
+inline uint64_t hashVertexBytes(const Vertex& vertex) {
+	uint32_t words[12];
+	std::memcpy(words, &vertex, sizeof(words));
+	for (int i = 0; i < 11; i++) { // the last word is materialIndex, not a float
+		if ((words[i] & 0x7fffffffu) == 0) words[i] = 0;
+	}
+
+	uint64_t h = 0x9e3779b97f4a7c15ull;
+	for (int i = 0; i < 12; i += 2) {
+		uint64_t w = static_cast<uint64_t>(words[i]) | (static_cast<uint64_t>(words[i + 1]) << 32);
+		h = (h ^ w) * 0xbf58476d1ce4e5b9ull;
+		h ^= h >> 31;
+	}
+	h *= 0x94d049bb133111ebull;
+	return h ^ (h >> 29);
+}
+
+struct VertexByteHash {
+	size_t operator()(const Vertex& vertex) const { return static_cast<size_t>(hashVertexBytes(vertex)); }
+};
+
+// Parallel equivalent of the usual "try_emplace into a map, push on insert" dedup loop.
+// makeVertex(i) must return the vertex for corner i (0 <= i < cornerCount) and be thread-safe;
+// it is called twice per corner (hash pass and shard insert).
+//
+//   1. corners are hashed in parallel ranges and scattered into shards by hash (order kept)
+//   2. every shard dedups its corners on its own worker, recording the first equal corner
+//   3. a prefix sum over "is first occurrence" flags gives the compacted vertex indices
+//   4. every shard copies its unique vertices to their compacted slots
+//
+// Only the shard maps hold vertices, one per unique vertex, so peak memory stays close to the
+// single-threaded loop. Unique vertices end up ordered by first occurrence, so the output is
+// byte-identical to that loop.
+template<typename MakeVertex>
+void deduplicateVertices(size_t cornerCount, const MakeVertex& makeVertex,
+	std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices) {
+	outVertices.clear();
+	outIndices.resize(cornerCount);
+	if (cornerCount == 0) return;
+
+	constexpr size_t MIN_CORNERS_PER_WORKER = 1 << 16;
+	const size_t hw = std::max(1u, std::thread::hardware_concurrency());
+	const size_t workers = std::clamp<size_t>(cornerCount / MIN_CORNERS_PER_WORKER, 1, hw);
+	const size_t shardCount = std::min<size_t>(workers, 256); // shard ids are stored as uint8_t
+
+	auto rangeBegin = [&](size_t r) { return cornerCount * r / workers; };
+	auto shardOf = [&](uint64_t hash) { return static_cast<size_t>((hash >> 40) % shardCount); };
+
+	auto parallelFor = [](size_t count, const auto& fn) {
+		std::vector<std::future<void>> tasks;
+		tasks.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			tasks.push_back(std::async(std::launch::async, [&fn, i]() { fn(i); }));
+		}
+		for (auto& t : tasks) t.get();
+	};
+
+	// ========== 1. Hash and partition ==========
+	std::vector<uint8_t> cornerShard(cornerCount);
+	std::vector<size_t> shardCounts(workers * shardCount, 0); // [range][shard]
+	parallelFor(workers, [&](size_t r) {
+		size_t* counts = &shardCounts[r * shardCount];
+		for (size_t i = rangeBegin(r); i < rangeBegin(r + 1); i++) {
+			size_t shard = shardOf(hashVertexBytes(makeVertex(i)));
+			cornerShard[i] = static_cast<uint8_t>(shard);
+			counts[shard]++;
+		}
+	});
+
+	std::vector<size_t> shardBegin(shardCount + 1, 0);
+	std::vector<size_t> scatterOffsets(workers * shardCount);
+	{
+		size_t offset = 0;
+		for (size_t s = 0; s < shardCount; s++) {
+			shardBegin[s] = offset;
+			for (size_t r = 0; r < workers; r++) {
+				scatterOffsets[r * shardCount + s] = offset;
+				offset += shardCounts[r * shardCount + s];
+			}
+		}
+		shardBegin[shardCount] = offset;
+	}
+
+	std::vector<uint32_t> shardCorners(cornerCount);
+	parallelFor(workers, [&](size_t r) {
+		size_t* offsets = &scatterOffsets[r * shardCount];
+		for (size_t i = rangeBegin(r); i < rangeBegin(r + 1); i++) {
+			shardCorners[offsets[cornerShard[i]]++] = static_cast<uint32_t>(i);
+		}
+	});
+	std::vector<uint8_t>().swap(cornerShard);
+
+	// ========== 2. Per-shard dedup ==========
+	// firstCorner[i] = lowest corner index holding a vertex equal to corner i. The maps stay
+	// alive until step 4, which reads the unique vertices back out of them.
+	std::vector<uint32_t> firstCorner(cornerCount);
+	std::vector<robin_hood::unordered_map<Vertex, uint32_t, VertexByteHash>> shardUnique(shardCount);
+	parallelFor(shardCount, [&](size_t s) {
+		auto& unique = shardUnique[s];
+		unique.reserve(shardBegin[s + 1] - shardBegin[s]);
+		for (size_t k = shardBegin[s]; k < shardBegin[s + 1]; k++) {
+			uint32_t corner = shardCorners[k];
+			auto [it, inserted] = unique.try_emplace(makeVertex(corner), corner);
+			firstCorner[corner] = it->second;
+		}
+	});
+	std::vector<uint32_t>().swap(shardCorners);
+
+	// ========== 3. Prefix sum ==========
+	std::vector<size_t> uniqueBegin(workers + 1, 0);
+	parallelFor(workers, [&](size_t r) {
+		size_t count = 0;
+		for (size_t i = rangeBegin(r); i < rangeBegin(r + 1); i++) {
+			if (firstCorner[i] == i) count++;
+		}
+		uniqueBegin[r + 1] = count;
+	});
+	for (size_t r = 0; r < workers; r++) {
+		uniqueBegin[r + 1] += uniqueBegin[r];
+	}
+
+	// Unique corners get their compacted index in outIndices first; every other corner
+	// points at an earlier corner whose slot is filled in the second pass.
+	parallelFor(workers, [&](size_t r) {
+		size_t next = uniqueBegin[r];
+		for (size_t i = rangeBegin(r); i < rangeBegin(r + 1); i++) {
+			if (firstCorner[i] == i) outIndices[i] = static_cast<uint32_t>(next++);
+		}
+	});
+	parallelFor(workers, [&](size_t r) {
+		for (size_t i = rangeBegin(r); i < rangeBegin(r + 1); i++) {
+			if (firstCorner[i] != i) outIndices[i] = outIndices[firstCorner[i]];
+		}
+	});
+
+	// ========== 4. Compaction ==========
+	outVertices.resize(uniqueBegin[workers]);
+	parallelFor(shardCount, [&](size_t s) {
+		for (const auto& entry : shardUnique[s]) {
+			outVertices[outIndices[entry.second]] = entry.first;
+		}
+		decltype(shardUnique)::value_type().swap(shardUnique[s]);
+	});
+}
+
+// Per-attribute weld tolerances. Two vertices are welded when every position, texCoord and normal
+// component differs by at most the matching tolerance and their color and material are equal.
+// 0 means exact comparison, which is what deduplicateVertices does.
+struct VertexWeldTolerance {
+	float position = 0.0f;
+	float normal = 0.0f;
+	float texCoord = 0.0f;
+
+	bool isExact() const { return position <= 0.0f && normal <= 0.0f && texCoord <= 0.0f; }
+};
+
+// Welds vertices[0..count) and appends the unique ones to outVertices. outIndices receives one
+// index per input vertex, offset by the size outVertices had on entry.
+//
+// Kept vertices are bucketed on a position grid whose cell size is the position tolerance. Every
+// vertex is compared, with the real tolerances, against the kept vertices of its cell and the
+// neighbouring cells, and joins the earliest one in range. Kept vertices are never moved, so
+// geometry is not snapped to the grid; a vertex only joins a group when it is close to that
+// group's kept vertex, not merely to another member.
+inline void weldVertices(const Vertex* vertices, size_t count, const VertexWeldTolerance& tolerance,
+	std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices) {
+	const uint32_t baseVertex = static_cast<uint32_t>(outVertices.size());
+
+	if (tolerance.isExact()) {
+		std::vector<Vertex> unique;
+		std::vector<uint32_t> remap;
+		deduplicateVertices(count, [vertices](size_t i) { return vertices[i]; }, unique, remap);
+		outVertices.insert(outVertices.end(), unique.begin(), unique.end());
+		outIndices.reserve(outIndices.size() + remap.size());
+		for (uint32_t index : remap) outIndices.push_back(baseVertex + index);
+		return;
+	}
+
+	const float posTolerance = std::max(tolerance.position, 0.0f);
+	const float normalTolerance = std::max(tolerance.normal, 0.0f);
+	const float uvTolerance = std::max(tolerance.texCoord, 0.0f);
+
+	auto within = [](float a, float b, float tol) {
+		return a == b || std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= tol;
+	};
+	auto canWeld = [&](const Vertex& a, const Vertex& b) {
+		return a.materialIndex == b.materialIndex && a.color == b.color
+			&& within(a.pos.x, b.pos.x, posTolerance) && within(a.pos.y, b.pos.y, posTolerance)
+			&& within(a.pos.z, b.pos.z, posTolerance)
+			&& within(a.texCoord.x, b.texCoord.x, uvTolerance) && within(a.texCoord.y, b.texCoord.y, uvTolerance)
+			&& within(a.normal.x, b.normal.x, normalTolerance) && within(a.normal.y, b.normal.y, normalTolerance)
+			&& within(a.normal.z, b.normal.z, normalTolerance);
+	};
+
+	// Grid coordinate per axis. Without a position tolerance (or for values too large or not finite
+	// to put on the grid) the cell is the exact float, with -0.0f folded into +0.0f, and no
+	// neighbours are probed.
+	using Cell = std::array<int64_t, 3>;
+	struct CellHash {
+		size_t operator()(const Cell& cell) const {
+			uint64_t h = 0x9e3779b97f4a7c15ull;
+			for (int64_t c : cell) {
+				h = (h ^ static_cast<uint64_t>(c)) * 0xbf58476d1ce4e5b9ull;
+				h ^= h >> 31;
+			}
+			return static_cast<size_t>(h);
+		}
+	};
+	auto cellOf = [&](const Vertex& vertex, bool probe[3]) {
+		Cell cell;
+		for (int axis = 0; axis < 3; axis++) {
+			float value = vertex.pos[axis];
+			double scaled = posTolerance > 0.0f ? static_cast<double>(value) / posTolerance : 0.0;
+			probe[axis] = posTolerance > 0.0f && std::fabs(scaled) < 1.0e18;
+			if (probe[axis]) {
+				cell[axis] = static_cast<int64_t>(std::floor(scaled));
+			} else {
+				uint32_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				cell[axis] = (bits & 0x7fffffffu) == 0 ? 0 : bits;
+			}
+		}
+		return cell;
+	};
+
+	// Kept vertices of a cell form a linked list: cellHead -> nextInCell -> ... (local indices)
+	constexpr uint32_t NONE = UINT32_MAX;
+	robin_hood::unordered_map<Cell, uint32_t, CellHash> cellHead;
+	std::vector<uint32_t> nextInCell;
+	cellHead.reserve(count);
+	outIndices.reserve(outIndices.size() + count);
+	for (size_t i = 0; i < count; i++) {
+		const Vertex& vertex = vertices[i];
+		bool probe[3];
+		const Cell cell = cellOf(vertex, probe);
+
+		uint32_t match = NONE;
+		for (int dx = probe[0] ? -1 : 0; dx <= (probe[0] ? 1 : 0); dx++) {
+			for (int dy = probe[1] ? -1 : 0; dy <= (probe[1] ? 1 : 0); dy++) {
+				for (int dz = probe[2] ? -1 : 0; dz <= (probe[2] ? 1 : 0); dz++) {
+					auto it = cellHead.find(Cell{ cell[0] + dx, cell[1] + dy, cell[2] + dz });
+					if (it == cellHead.end()) continue;
+					for (uint32_t k = it->second; k != NONE; k = nextInCell[k]) {
+						if (k < match && canWeld(outVertices[baseVertex + k], vertex)) match = k;
+					}
+				}
+			}
+		}
+
+		if (match == NONE) {
+			match = static_cast<uint32_t>(nextInCell.size());
+			auto [it, inserted] = cellHead.try_emplace(cell, match);
+			nextInCell.push_back(inserted ? NONE : it->second);
+			it->second = match;
+			outVertices.push_back(vertex);
+		}
+		outIndices.push_back(baseVertex + match);
+	}
+}
+
+} // namespace Spell
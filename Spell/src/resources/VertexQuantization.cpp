@@ -0,0 +1,155 @@
+#include "VertexQuantization.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+
+namespace Spell {
+
+namespace {
+
+constexpr float QUANTIZE_MAX = 65535.0f;
+constexpr uint32_t NO_MESH = ~0u;
+constexpr uint32_t SHARED_VERTEX = ~0u - 1;
+
+// Octahedral normal encoding (Cigolle et al., "Survey of Efficient Representations for
+// Independent Unit Vectors"): the unit sphere folded onto [-1, 1]^2
+glm::vec2 octEncode(const glm::vec3& n) {
+	float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	if (l1 <= 0.0f) return glm::vec2(0.0f);
+	glm::vec2 p(n.x / l1, n.y / l1);
+	if (n.z < 0.0f) {
+		p = glm::vec2((1.0f - std::fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+	}
+	return p;
+}
+
+glm::vec3 octDecode(const glm::vec2& p) {
+	glm::vec3 n(p.x, p.y, 1.0f - std::fabs(p.x) - std::fabs(p.y));
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+int16_t toSnorm16(float v) {
+	return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+// Runs fn(begin, end) over [0, count) in chunks on all cores
+template<typename Fn>
+void parallelChunks(size_t count, Fn&& fn) {
+	constexpr size_t CHUNK = 1 << 16;
+	const size_t chunkCount = (count + CHUNK - 1) / CHUNK;
+	std::atomic<size_t> nextChunk{ 0 };
+	auto worker = [&]() {
+		for (size_t c = nextChunk++; c < chunkCount; c = nextChunk++) {
+			fn(c * CHUNK, std::min(count, (c + 1) * CHUNK));
+		}
+	};
+	const size_t workerCount = std::min<size_t>(chunkCount, std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::future<void>> workers;
+	for (size_t i = 1; i < workerCount; i++) {
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (auto& w : workers) w.get();
+}
+
+} // namespace
+
+uint32_t vertexStride(VertexFormat format) {
+	return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+glm::vec4 computeDequant(const glm::vec3& minPos, const glm::vec3& maxPos) {
+	glm::vec3 extent = maxPos - minPos;
+	float size = std::max(extent.x, std::max(extent.y, extent.z));
+	// Degenerate bounds still need a non-zero scale
+	return glm::vec4(minPos, size > 0.0f ? size / QUANTIZE_MAX : 1.0f);
+}
+
+PackedVertex packVertex(const Vertex& vertex, const glm::vec4& dequant) {
+	PackedVertex packed{};
+	const glm::vec3 offset(dequant);
+	for (int axis = 0; axis < 3; axis++) {
+		float q = (vertex.pos[axis] - offset[axis]) / dequant.w;
+		packed.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(q, 0.0f, QUANTIZE_MAX)));
+	}
+	packed.materialIndex = vertex.materialIndex >= 0 && vertex.materialIndex < PackedVertex::NO_MATERIAL
+		? static_cast<uint16_t>(vertex.materialIndex) : PackedVertex::NO_MATERIAL;
+
+	glm::vec2 oct = octEncode(vertex.normal);
+	packed.normal[0] = toSnorm16(oct.x);
+	packed.normal[1] = toSnorm16(oct.y);
+	packed.texCoord = glm::packHalf2x16(vertex.texCoord);
+	return packed;
+}
+
+Vertex unpackVertex(const PackedVertex& packed, const glm::vec4& dequant) {
+	Vertex vertex{};
+	vertex.pos = glm::vec3(packed.position[0], packed.position[1], packed.position[2]) * dequant.w
+		+ glm::vec3(dequant);
+	vertex.color = glm::vec3(1.0f);
+	vertex.texCoord = glm::unpackHalf2x16(packed.texCoord);
+	vertex.normal = octDecode(glm::vec2(packed.normal[0], packed.normal[1]) / 32767.0f);
+	vertex.materialIndex = packed.materialIndex == PackedVertex::NO_MATERIAL ? -1 : packed.materialIndex;
+	return vertex;
+}
+
+void packVertices(const ModelGeometryView& geometry, std::vector<PackedVertex>& out,
+	std::vector<glm::vec4>& meshDequant) {
+	const bool flat = geometry.instanceCount == 0 || geometry.meshCount == 0;
+	const uint32_t meshCount = flat ? 1 : geometry.meshCount;
+
+	// Which mesh owns each vertex
+	std::vector<uint32_t> owner(geometry.vertexCount, NO_MESH);
+	bool shared = false;
+	for (uint32_t m = 0; m < meshCount && !flat; m++) {
+		const MeshRange& range = geometry.meshes[m];
+		for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+			uint32_t& o = owner[geometry.indices[i]];
+			if (o == NO_MESH) o = m;
+			else if (o != m) o = SHARED_VERTEX;
+		}
+	}
+	for (uint32_t o : owner) shared |= o == SHARED_VERTEX;
+
+	std::vector<glm::vec3> minPos(meshCount, glm::vec3(std::numeric_limits<float>::max()));
+	std::vector<glm::vec3> maxPos(meshCount, glm::vec3(-std::numeric_limits<float>::max()));
+	glm::vec3 modelMin(std::numeric_limits<float>::max());
+	glm::vec3 modelMax(-std::numeric_limits<float>::max());
+	for (uint32_t v = 0; v < geometry.vertexCount; v++) {
+		const glm::vec3& p = geometry.vertices[v].pos;
+		modelMin = glm::min(modelMin, p);
+		modelMax = glm::max(modelMax, p);
+		uint32_t o = flat ? 0 : owner[v];
+		if (o < meshCount) {
+			minPos[o] = glm::min(minPos[o], p);
+			maxPos[o] = glm::max(maxPos[o], p);
+		}
+	}
+
+	const glm::vec4 modelDequant = computeDequant(modelMin, modelMax);
+	meshDequant.resize(meshCount);
+	for (uint32_t m = 0; m < meshCount; m++) {
+		bool used = minPos[m].x <= maxPos[m].x;
+		meshDequant[m] = shared || !used ? modelDequant : computeDequant(minPos[m], maxPos[m]);
+	}
+
+	out.resize(geometry.vertexCount);
+	parallelChunks(geometry.vertexCount, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			uint32_t o = flat ? 0 : owner[v];
+			out[v] = packVertex(geometry.vertices[v], o < meshCount ? meshDequant[o] : modelDequant);
+		}
+	});
+}
+
+} // namespace Spell
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "SpellModel.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Compact vertex (binding 0) for the shader_packed.vert pipelines:
+//   position  3 x uint16, quantized to the bounds of its mesh (see InstanceData::dequant)
+//   material  uint16 in the 4th lane of the position, 0xFFFF = no material
+//   normal    octahedral encoding, 2 x snorm16
+//   texCoord  2 x half float (11-bit mantissa: ~1/2048 steps in [0.5, 1], coarser for tiled UVs)
+// The constant white vertex color is dropped.
+struct PackedVertex {
+	uint16_t position[3];
+	uint16_t materialIndex;
+	int16_t normal[2];
+	uint32_t texCoord; // glm::packHalf2x16
+
+	static constexpr uint16_t NO_MATERIAL = 0xFFFF;
+
+	static VkVertexInputBindingDescription getBindingDescription() {
+		VkVertexInputBindingDescription bindingDesc{};
+		bindingDesc.binding = 0;
+		bindingDesc.stride = sizeof(PackedVertex);
+		bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDesc;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 3> attributeDesc{};
+		attributeDesc[0].binding = 0;
+		attributeDesc[0].location = 0;
+		attributeDesc[0].format = VK_FORMAT_R16G16B16A16_UINT;
+		attributeDesc[0].offset = offsetof(PackedVertex, position);
+
+		attributeDesc[1].binding = 0;
+		attributeDesc[1].location = 1;
+		attributeDesc[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDesc[1].offset = offsetof(PackedVertex, normal);
+
+		attributeDesc[2].binding = 0;
+		attributeDesc[2].location = 2;
+		attributeDesc[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDesc[2].offset = offsetof(PackedVertex, texCoord);
+
+		return attributeDesc;
+	}
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match shader_packed.vert");
+
+uint32_t vertexStride(VertexFormat format);
+
+// Quantization bounds: position = quantized * dequant.w + dequant.xyz. The scale is uniform so
+// the instance normal matrix stays valid.
+glm::vec4 computeDequant(const glm::vec3& minPos, const glm::vec3& maxPos);
+
+PackedVertex packVertex(const Vertex& vertex, const glm::vec4& dequant);
+// Inverse of packVertex (color is white), for precision checks
+Vertex unpackVertex(const PackedVertex& packed, const glm::vec4& dequant);
+
+// Packs every vertex against the bounds of the mesh that uses it. `meshDequant` gets one entry
+// per MeshRange (a single entry for flat models). If a vertex is shared between meshes, every
+// mesh uses the bounds of the whole model instead.
+void packVertices(const ModelGeometryView& geometry, std::vector<PackedVertex>& out,
+	std::vector<glm::vec4>& meshDequant);
+
+} // namespace Spell
@@ -0,0 +1,108 @@
+#include "VertexStreams.h"
+
+#include <cstring>
+
+namespace Spell {
+
+namespace {
+
+VkVertexInputBindingDescription makeBinding(uint32_t binding, uint32_t stride) {
+	VkVertexInputBindingDescription bindingDesc{};
+	bindingDesc.binding = binding;
+	bindingDesc.stride = stride;
+	bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDesc;
+}
+
+VkVertexInputAttributeDescription makeAttribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset) {
+	VkVertexInputAttributeDescription attributeDesc{};
+	attributeDesc.location = location;
+	attributeDesc.binding = binding;
+	attributeDesc.format = format;
+	attributeDesc.offset = offset;
+	return attributeDesc;
+}
+
+void describeInterleaved(VertexFormat format, bool positionOnly, VertexInputDescription& out) {
+	if (format == VertexFormat::Packed) {
+		out.bindings.push_back(PackedVertex::getBindingDescription());
+		for (const auto& attr : PackedVertex::getAttributeDescriptions()) out.attributes.push_back(attr);
+	} else {
+		out.bindings.push_back(Vertex::getBindingDescription());
+		for (const auto& attr : Vertex::getAttributeDescriptions()) out.attributes.push_back(attr);
+	}
+	if (positionOnly) out.attributes.resize(1); // location 0 comes first in both layouts
+}
+
+void describeSplit(VertexFormat format, bool positionOnly, VertexInputDescription& out) {
+	if (format == VertexFormat::Packed) {
+		out.bindings.push_back(makeBinding(VERTEX_BINDING_POSITION, sizeof(PackedPosition)));
+		out.attributes.push_back(makeAttribute(0, VERTEX_BINDING_POSITION, VK_FORMAT_R16G16B16A16_UINT, 0));
+		if (positionOnly) return;
+
+		out.bindings.push_back(makeBinding(VERTEX_BINDING_SHADING, sizeof(PackedShadingAttributes)));
+		out.attributes.push_back(makeAttribute(1, VERTEX_BINDING_SHADING, VK_FORMAT_R16G16_SNORM,
+			offsetof(PackedShadingAttributes, normal)));
+		out.attributes.push_back(makeAttribute(2, VERTEX_BINDING_SHADING, VK_FORMAT_R16G16_SFLOAT,
+			offsetof(PackedShadingAttributes, texCoord)));
+	} else {
+		out.bindings.push_back(makeBinding(VERTEX_BINDING_POSITION, sizeof(glm::vec3)));
+		out.attributes.push_back(makeAttribute(0, VERTEX_BINDING_POSITION, VK_FORMAT_R32G32B32_SFLOAT, 0));
+		if (positionOnly) return;
+
+		out.bindings.push_back(makeBinding(VERTEX_BINDING_SHADING, sizeof(ShadingAttributes)));
+		out.attributes.push_back(makeAttribute(2, VERTEX_BINDING_SHADING, VK_FORMAT_R32G32_SFLOAT,
+			offsetof(ShadingAttributes, texCoord)));
+		out.attributes.push_back(makeAttribute(3, VERTEX_BINDING_SHADING, VK_FORMAT_R32G32B32_SFLOAT,
+			offsetof(ShadingAttributes, normal)));
+
+		out.bindings.push_back(makeBinding(VERTEX_BINDING_MATERIAL, sizeof(int32_t)));
+		out.attributes.push_back(makeAttribute(4, VERTEX_BINDING_MATERIAL, VK_FORMAT_R32_SINT, 0));
+	}
+}
+
+} // namespace
+
+VertexInputDescription getVertexInputDescription(VertexFormat format, VertexLayout layout, bool positionOnly) {
+	VertexInputDescription desc;
+	if (layout == VertexLayout::Split) {
+		describeSplit(format, positionOnly, desc);
+	} else {
+		describeInterleaved(format, positionOnly, desc);
+	}
+
+	desc.bindings.push_back(InstanceData::getBindingDescription());
+	for (const auto& attr : InstanceData::getAttributeDescriptions()) desc.attributes.push_back(attr);
+	return desc;
+}
+
+uint32_t vertexSize(VertexFormat format, VertexLayout layout) {
+	if (layout == VertexLayout::Interleaved) return vertexStride(format);
+	if (format == VertexFormat::Packed) return sizeof(PackedPosition) + sizeof(PackedShadingAttributes);
+	return sizeof(glm::vec3) + sizeof(ShadingAttributes) + sizeof(int32_t);
+}
+
+void splitVertices(const Vertex* vertices, uint32_t vertexCount, std::vector<glm::vec3>& positions,
+	std::vector<ShadingAttributes>& shading, std::vector<int32_t>& materials) {
+	positions.resize(vertexCount);
+	shading.resize(vertexCount);
+	materials.resize(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		positions[v] = vertices[v].pos;
+		shading[v] = { vertices[v].texCoord, vertices[v].normal };
+		materials[v] = vertices[v].materialIndex;
+	}
+}
+
+void splitPackedVertices(const std::vector<PackedVertex>& vertices, std::vector<PackedPosition>& positions,
+	std::vector<PackedShadingAttributes>& shading) {
+	positions.resize(vertices.size());
+	shading.resize(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++) {
+		std::memcpy(&positions[v], &vertices[v], sizeof(PackedPosition));
+		std::memcpy(&shading[v], reinterpret_cast<const uint8_t*>(&vertices[v]) + sizeof(PackedPosition),
+			sizeof(PackedShadingAttributes));
+	}
+}
+
+} // namespace Spell
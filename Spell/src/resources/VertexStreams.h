@@ -0,0 +1,58 @@
+#pragma once
+
+#include "SpellModel.h"
+#include "VertexQuantization.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Spell {
+
+// Vertex buffer bindings. Binding 1 is always the per-instance InstanceData. Interleaved models
+// only use binding 0; split models keep positions in binding 0 so position-only pipelines
+// fetch nothing else.
+constexpr uint32_t VERTEX_BINDING_POSITION = 0;
+constexpr uint32_t VERTEX_BINDING_INSTANCE = 1;
+constexpr uint32_t VERTEX_BINDING_SHADING = 2;
+constexpr uint32_t VERTEX_BINDING_MATERIAL = 3;
+
+// Split streams of a Full model: 12 + 20 + 4 bytes (the constant vertex color is dropped)
+struct ShadingAttributes {
+	glm::vec2 texCoord;
+	glm::vec3 normal;
+};
+static_assert(sizeof(ShadingAttributes) == 20, "ShadingAttributes must be tightly packed");
+
+// Split streams of a Packed model: the two halves of PackedVertex, 8 + 8 bytes. The material
+// stays in the 4th lane of the position, which would otherwise be padding.
+struct PackedPosition {
+	uint16_t position[3];
+	uint16_t materialIndex;
+};
+
+struct PackedShadingAttributes {
+	int16_t normal[2];
+	uint32_t texCoord;
+};
+static_assert(sizeof(PackedPosition) + sizeof(PackedShadingAttributes) == sizeof(PackedVertex),
+	"split packed streams must cover PackedVertex");
+
+struct VertexInputDescription {
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+// Vertex input state for a pipeline, including the instance binding. `positionOnly` declares
+// only the position stream (locations 0 and the instance attributes); it is meant for split
+// models, where the other streams are then never fetched.
+VertexInputDescription getVertexInputDescription(VertexFormat format, VertexLayout layout, bool positionOnly);
+
+// Bytes per vertex summed over all streams
+uint32_t vertexSize(VertexFormat format, VertexLayout layout);
+
+void splitVertices(const Vertex* vertices, uint32_t vertexCount, std::vector<glm::vec3>& positions,
+	std::vector<ShadingAttributes>& shading, std::vector<int32_t>& materials);
+void splitPackedVertices(const std::vector<PackedVertex>& vertices, std::vector<PackedPosition>& positions,
+	std::vector<PackedShadingAttributes>& shading);
+
+} // namespace Spell
@@ -0,0 +1,438 @@
+#include "SpellBenchmark.h"
+#include "resources/ObjModelLoader.h"
+#include "resources/ModelLoaderFactory.h"
+#include "resources/VertexQuantization.h"
+#include "resources/MaterialRanges.h"
+#include "resources/MeshBvh.h"
+#include "resources/BlockCompression.h"
+
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <streambuf>
+#include <thread>
+
+namespace Spell {
+
+namespace {
+
+// Silences loader logging while timing
+class ScopedMuteCout {
+public:
+	ScopedMuteCout() : previous_(std::cout.rdbuf(&null_)) {}
+	~ScopedMuteCout() { std::cout.rdbuf(previous_); }
+
+private:
+	struct NullBuffer : std::streambuf {
+		int overflow(int c) override { return c; }
+	} null_;
+	std::streambuf* previous_;
+};
+
+template<typename Fn>
+double timeBestOfMs(int iterations, Fn&& fn) {
+	double best = 0.0;
+	for (int i = 0; i < iterations; i++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		fn();
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		if (i == 0 || ms < best) best = ms;
+	}
+	return best;
+}
+
+bool sameResult(const ModelLoadResult& a, const ModelLoadResult& b) {
+	if (a.vertices.size() != b.vertices.size() || a.indices.size() != b.indices.size()
+		|| a.materials.size() != b.materials.size() || a.materialRanges.size() != b.materialRanges.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.vertices.size(); i++) {
+		if (!(a.vertices[i] == b.vertices[i])) return false;
+	}
+	if (!a.indices.empty() && std::memcmp(a.indices.data(), b.indices.data(), a.indices.size() * sizeof(uint32_t)) != 0) {
+		return false;
+	}
+	for (size_t i = 0; i < a.materials.size(); i++) {
+		const auto& ma = a.materials[i];
+		const auto& mb = b.materials[i];
+		if (ma.diffuseTexturePath != mb.diffuseTexturePath || ma.normalTexturePath != mb.normalTexturePath
+			|| ma.metallicTexturePath != mb.metallicTexturePath || ma.roughnessTexturePath != mb.roughnessTexturePath
+			|| ma.packedMetallicRoughness != mb.packedMetallicRoughness) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+int SpellBenchmark::run(const std::vector<std::string>& args) {
+	if (args.empty()) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	try {
+		if (args[0] == "obj") return benchObj(args);
+		if (args[0] == "load") return benchLoad(args);
+		if (args[0] == "vertex") return benchVertex(args);
+		if (args[0] == "bvh") return benchBvh(args);
+		if (args[0] == "bc") return benchBc(args);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	printUsage();
+	return EXIT_FAILURE;
+}
+
+void SpellBenchmark::printUsage() {
+	std::cout << "Usage: Spell --bench <name> [args]\n"
+		<< "  obj <file.obj> [iterations]   native OBJ parser vs tinyobj::LoadObj\n"
+		<< "  load <model> [iterations]     IModelLoader::load for any supported format\n"
+		<< "  vertex <model> [iterations]   packed vs full vertex format: memory, pack time, precision\n"
+		<< "  bvh <model> [iterations]      triangle BVH build time and ray throughput\n"
+		<< "  bc <image> [iterations]       BC1/BC4/BC5/BC7 encoder throughput per SIMD level and PSNR" << std::endl;
+}
+
+int SpellBenchmark::benchObj(const std::vector<std::string>& args) {
+	if (args.size() < 2) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string& path = args[1];
+	int iterations = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 3;
+	double sizeMB = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+	ObjModelLoader nativeLoader(ObjModelLoader::Parser::Native);
+	ObjModelLoader tinyObjLoader(ObjModelLoader::Parser::TinyObj);
+	ModelLoadResult nativeResult, tinyObjResult;
+
+	double nativeMs, tinyObjMs;
+	{
+		ScopedMuteCout mute;
+		nativeMs = timeBestOfMs(iterations, [&]() { nativeResult = nativeLoader.load(path); });
+		tinyObjMs = timeBestOfMs(iterations, [&]() { tinyObjResult = tinyObjLoader.load(path); });
+	}
+
+	bool identical = sameResult(nativeResult, tinyObjResult);
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "[Spell] Bench OBJ: " << path << " (" << sizeMB << " MB, best of " << iterations << ")\n"
+		<< "  native : " << nativeMs << " ms, " << (sizeMB * 1000.0 / nativeMs) << " MB/s\n"
+		<< "  tinyobj: " << tinyObjMs << " ms, " << (sizeMB * 1000.0 / tinyObjMs) << " MB/s\n"
+		<< "  speedup: " << (tinyObjMs / nativeMs) << "x\n"
+		<< "  output : " << nativeResult.vertices.size() << " vertices, " << nativeResult.indices.size() << " indices, "
+		<< (identical ? "identical" : "MISMATCH") << std::endl;
+
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int SpellBenchmark::benchLoad(const std::vector<std::string>& args) {
+	if (args.size() < 2) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string& path = args[1];
+	int iterations = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 3;
+	double sizeMB = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+
+	auto loader = ModelLoaderFactory::createLoader(path);
+	ModelLoadResult result;
+	double ms;
+	{
+		ScopedMuteCout mute;
+		ms = timeBestOfMs(iterations, [&]() { result = loader->load(path); });
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "[Spell] Bench load: " << path << " (" << sizeMB << " MB, best of " << iterations << ")\n"
+		<< "  time  : " << ms << " ms, " << (sizeMB * 1000.0 / ms) << " MB/s\n"
+		<< "  output: " << result.vertices.size() << " vertices, " << result.indices.size() << " indices, "
+		<< result.materials.size() << " materials" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+int SpellBenchmark::benchVertex(const std::vector<std::string>& args) {
+	if (args.size() < 2) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string& path = args[1];
+	int iterations = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 3;
+
+	auto loader = ModelLoaderFactory::createLoader(path);
+	ModelLoadResult result;
+	{
+		ScopedMuteCout mute;
+		result = loader->load(path);
+	}
+	const ModelGeometryView geometry = result.view();
+
+	std::vector<PackedVertex> packed;
+	std::vector<glm::vec4> meshDequant;
+	double packMs = timeBestOfMs(iterations, [&]() { packVertices(geometry, packed, meshDequant); });
+
+	// Round-trip error of every vertex against the bounds it was packed with
+	std::vector<glm::vec4> vertexDequant(geometry.vertexCount, meshDequant[0]);
+	if (geometry.instanceCount > 0) {
+		for (uint32_t m = 0; m < geometry.meshCount; m++) {
+			const MeshRange& range = geometry.meshes[m];
+			for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+				vertexDequant[geometry.indices[i]] = meshDequant[m];
+			}
+		}
+	}
+	double maxPosError = 0.0, maxNormalDegrees = 0.0, maxUvError = 0.0;
+	bool materialsMatch = true;
+	for (uint32_t v = 0; v < geometry.vertexCount; v++) {
+		const Vertex& original = geometry.vertices[v];
+		Vertex restored = unpackVertex(packed[v], vertexDequant[v]);
+		glm::vec3 posDelta = glm::abs(restored.pos - original.pos);
+		maxPosError = std::max(maxPosError, static_cast<double>(std::max(posDelta.x, std::max(posDelta.y, posDelta.z))));
+		float normalLength = glm::length(original.normal);
+		if (normalLength > 0.0f) {
+			float cosAngle = std::clamp(glm::dot(original.normal / normalLength, restored.normal), -1.0f, 1.0f);
+			maxNormalDegrees = std::max(maxNormalDegrees, std::acos(static_cast<double>(cosAngle)) * 180.0 / 3.14159265358979);
+		}
+		glm::vec2 uvDelta = glm::abs(restored.texCoord - original.texCoord);
+		maxUvError = std::max(maxUvError, static_cast<double>(std::max(uvDelta.x, uvDelta.y)));
+		materialsMatch &= restored.materialIndex == original.materialIndex;
+	}
+
+	double fullMB = static_cast<double>(geometry.vertexCount) * sizeof(Vertex) / (1024.0 * 1024.0);
+	double packedMB = static_cast<double>(geometry.vertexCount) * sizeof(PackedVertex) / (1024.0 * 1024.0);
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "[Spell] Bench vertex: " << path << " (" << geometry.vertexCount << " vertices, "
+		<< meshDequant.size() << " quantization bounds, best of " << iterations << ")\n"
+		<< "  full  : " << sizeof(Vertex) << " B/vertex, " << fullMB << " MB\n"
+		<< "  packed: " << sizeof(PackedVertex) << " B/vertex, " << packedMB << " MB ("
+		<< (fullMB > 0.0 ? 100.0 * packedMB / fullMB : 0.0) << "%), packed in " << packMs << " ms\n"
+		<< std::setprecision(6)
+		<< "  error : position " << maxPosError << ", normal " << maxNormalDegrees << " deg, uv " << maxUvError
+		<< ", materials " << (materialsMatch ? "identical" : "MISMATCH") << std::endl;
+	return materialsMatch ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int SpellBenchmark::benchBvh(const std::vector<std::string>& args) {
+	if (args.size() < 2) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string& path = args[1];
+	int iterations = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 3;
+
+	auto loader = ModelLoaderFactory::createLoader(path);
+	ModelLoadResult result;
+	{
+		ScopedMuteCout mute;
+		result = loader->load(path);
+	}
+	const ModelGeometryView geometry = result.view();
+
+	// The loader's material ranges, or one scan per mesh like SpellModel does without them
+	std::vector<MaterialRange> ranges = result.materialRanges;
+	if (ranges.empty()) {
+		if (result.meshes.empty()) {
+			collectMaterialRanges(geometry.vertices, geometry.indices, 0, geometry.indexCount, ranges);
+		}
+		for (const MeshRange& mesh : result.meshes) {
+			collectMaterialRanges(geometry.vertices, geometry.indices, mesh.firstIndex, mesh.indexCount, ranges);
+		}
+	}
+
+	std::unique_ptr<MeshBvh> bvh;
+	double buildMs = timeBestOfMs(iterations, [&]() { bvh = std::make_unique<MeshBvh>(geometry, ranges); });
+	if (bvh->empty()) {
+		std::cerr << "[Spell] Bench BVH: no triangles in " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Rays from a sphere around the model towards random points inside its bounds
+	const BvhNode& root = bvh->getRoot();
+	const glm::vec3 center = (root.boundsMin + root.boundsMax) * 0.5f;
+	const glm::vec3 halfExtent = (root.boundsMax - root.boundsMin) * 0.5f;
+	const float radius = std::max(glm::length(halfExtent), 1e-6f) * 2.0f;
+	constexpr size_t RAY_COUNT = 1 << 20;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> origins(RAY_COUNT), directions(RAY_COUNT);
+	for (size_t r = 0; r < RAY_COUNT; r++) {
+		glm::vec3 onSphere(unit(random), unit(random), unit(random));
+		while (glm::length(onSphere) < 1e-3f) onSphere = glm::vec3(unit(random), unit(random), unit(random));
+		origins[r] = center + glm::normalize(onSphere) * radius;
+		const glm::vec3 target = center + halfExtent * glm::vec3(unit(random), unit(random), unit(random));
+		directions[r] = target - origins[r];
+	}
+
+	size_t hits = 0;
+	double rayMs = timeBestOfMs(iterations, [&]() {
+		hits = 0;
+		for (size_t r = 0; r < RAY_COUNT; r++) {
+			BvhHit hit;
+			hits += bvh->raycast(origins[r], directions[r], hit);
+		}
+	});
+
+	// A few rays against every triangle: same hit distance as the traversal
+	constexpr size_t VERIFY_RAYS = 16;
+	bool identical = true;
+	auto transformOf = [&](uint32_t instance) {
+		return geometry.instanceCount > 0 && geometry.meshCount > 0 ? geometry.instances[instance].transform : glm::mat4(1.0f);
+	};
+	for (size_t r = 0; r < VERIFY_RAYS; r++) {
+		const glm::vec3& origin = origins[r];
+		const glm::vec3& direction = directions[r];
+		float best = std::numeric_limits<float>::max();
+		auto testRange = [&](const glm::mat4& transform, uint32_t firstIndex, uint32_t indexCount) {
+			for (uint32_t i = firstIndex; i + 3 <= firstIndex + indexCount; i += 3) {
+				glm::vec3 corners[3];
+				for (uint32_t c = 0; c < 3; c++) {
+					corners[c] = glm::vec3(transform * glm::vec4(geometry.vertices[geometry.indices[i + c]].pos, 1.0f));
+				}
+				const glm::vec3 e1 = corners[1] - corners[0], e2 = corners[2] - corners[0];
+				const glm::vec3 p = glm::cross(direction, e2);
+				const float det = glm::dot(e1, p);
+				if (det == 0.0f) continue;
+				const glm::vec3 toOrigin = origin - corners[0];
+				const float u = glm::dot(toOrigin, p) / det;
+				const glm::vec3 q = glm::cross(toOrigin, e1);
+				const float v = glm::dot(direction, q) / det;
+				const float t = glm::dot(e2, q) / det;
+				if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f) best = std::min(best, t);
+			}
+		};
+		if (geometry.instanceCount > 0 && geometry.meshCount > 0) {
+			for (uint32_t i = 0; i < geometry.instanceCount; i++) {
+				if (geometry.instances[i].meshIndex >= geometry.meshCount) continue;
+				const MeshRange& mesh = geometry.meshes[geometry.instances[i].meshIndex];
+				testRange(transformOf(i), mesh.firstIndex, mesh.indexCount);
+			}
+		} else {
+			testRange(glm::mat4(1.0f), 0, geometry.indexCount);
+		}
+
+		BvhHit hit;
+		const bool found = bvh->raycast(origin, direction, hit);
+		const bool expected = best != std::numeric_limits<float>::max();
+		if (found != expected || (found && std::abs(hit.distance - best) > 1e-4f * std::max(1.0f, best))) {
+			identical = false;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "[Spell] Bench BVH: " << path << " (" << bvh->getTriangleCount() << " triangles, "
+		<< ranges.size() << " material ranges, best of " << iterations << ")\n"
+		<< "  build : " << buildMs << " ms, " << bvh->getNodeCount() << " nodes, " << bvh->getLeafCount() << " leaves, "
+		<< (bvh->getMemoryBytes() / (1024.0 * 1024.0)) << " MB\n"
+		<< "  rays  : " << RAY_COUNT << " in " << rayMs << " ms, " << (RAY_COUNT / (rayMs * 1000.0)) << " Mrays/s (1 thread), "
+		<< (100.0 * hits / RAY_COUNT) << "% hit\n"
+		<< "  verify: " << VERIFY_RAYS << " rays against every triangle, " << (identical ? "identical" : "MISMATCH") << std::endl;
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int SpellBenchmark::benchBc(const std::vector<std::string>& args) {
+	if (args.size() < 2) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string& path = args[1];
+	int iterations = args.size() > 2 ? std::max(1, std::atoi(args[2].c_str())) : 3;
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels) {
+		std::cerr << "[Spell] Bench BC: cannot decode " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+	const uint32_t w = static_cast<uint32_t>(width), h = static_cast<uint32_t>(height);
+	std::vector<unsigned char> rgba(pixels, pixels + static_cast<size_t>(w) * h * 4);
+	stbi_image_free(pixels);
+
+	const uint32_t blockRows = (h + 3) / 4;
+	const size_t blockCount = static_cast<size_t>((w + 3) / 4) * blockRows;
+	const double megapixels = static_cast<double>(w) * h / 1e6;
+	const BlockSimd supported = detectBlockSimd();
+	const TextureMipChain sourceChain = buildMipChain(rgba.data(), w, h, false);
+	double chainMegapixels = 0.0;
+	for (const TextureMipLevel& level : sourceChain.levels) chainMegapixels += static_cast<double>(level.width) * level.height / 1e6;
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "[Spell] Bench BC: " << path << " (" << w << "x" << h << ", " << sourceChain.levelCount()
+		<< " mips, best of " << iterations << ", CPU: " << blockSimdName(supported) << ")" << std::endl;
+
+	bool identical = true;
+	for (uint32_t f = 0; f < static_cast<uint32_t>(BlockFormat::Count); f++) {
+		const BlockFormat format = static_cast<BlockFormat>(f);
+		const size_t bytes = blockCount * blockFormatBytes(format);
+
+		// Level 0 on one thread with every kernel the CPU runs; scalar is the reference
+		std::vector<unsigned char> reference(bytes), blocks(bytes);
+		std::cout << "  " << blockFormatName(format) << " (" << (bytes / 1024.0) << " KB, "
+			<< (static_cast<double>(w) * h * 4 / bytes) << ":1)\n";
+		for (uint32_t s = 0; s <= static_cast<uint32_t>(supported); s++) {
+			const BlockSimd simd = static_cast<BlockSimd>(s);
+			std::vector<unsigned char>& out = simd == BlockSimd::Scalar ? reference : blocks;
+			double ms = timeBestOfMs(iterations, [&]() { compressBlockRows(rgba.data(), w, h, format, 0, blockRows, out.data(), simd); });
+			std::cout << "    " << std::left << std::setw(7) << blockSimdName(simd) << std::right << ": "
+				<< ms << " ms, " << (megapixels / (ms / 1000.0)) << " MP/s (1 thread)";
+			if (simd != BlockSimd::Scalar) {
+				size_t same = 0;
+				const uint32_t blockBytes = blockFormatBytes(format);
+				for (size_t b = 0; b < blockCount; b++) {
+					same += std::memcmp(&out[b * blockBytes], &reference[b * blockBytes], blockBytes) == 0;
+				}
+				identical = identical && same == blockCount;
+				std::cout << ", " << (100.0 * same / blockCount) << "% blocks match scalar";
+			}
+			std::cout << "\n";
+		}
+
+		double chainMs = timeBestOfMs(iterations, [&]() { compressMipChain(sourceChain, format, false); });
+		std::cout << "    chain  : " << chainMs << " ms, " << (chainMegapixels / (chainMs / 1000.0))
+			<< " MP/s (all mips, " << std::max(1u, std::thread::hardware_concurrency()) << " threads)\n";
+
+		// PSNR over the channels the format keeps
+		const int channelCount = format == BlockFormat::BC1 ? 3 : format == BlockFormat::BC4 ? 1
+			: format == BlockFormat::BC5 ? 2 : 4;
+		std::vector<unsigned char> decoded(rgba.size());
+		decompressBlocks(reference.data(), w, h, format, decoded.data());
+		double squaredError = 0.0;
+		for (size_t i = 0; i < static_cast<size_t>(w) * h; i++) {
+			for (int c = 0; c < channelCount; c++) {
+				const double d = static_cast<double>(decoded[i * 4 + c]) - rgba[i * 4 + c];
+				squaredError += d * d;
+			}
+		}
+		const double mse = squaredError / (static_cast<double>(w) * h * channelCount);
+		std::cout << "    PSNR   : ";
+		if (mse > 0.0) {
+			std::cout << (10.0 * std::log10(255.0 * 255.0 / mse)) << " dB";
+		} else {
+			std::cout << "lossless";
+		}
+		std::cout << " over " << channelCount << " channel" << (channelCount > 1 ? "s" : "") << std::endl;
+	}
+
+	std::cout << "  verify : SIMD kernels " << (identical ? "identical to scalar" : "MISMATCH") << std::endl;
+	return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace Spell
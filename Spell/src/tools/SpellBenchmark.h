@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Spell {
+
+// Headless benchmarks, started with `Spell.exe --bench <name> [args...]`.
+// Runs without a window or Vulkan device and returns a process exit code.
+class SpellBenchmark {
+public:
+	static int run(const std::vector<std::string>& args);
+
+private:
+	static int benchObj(const std::vector<std::string>& args);
+	static int benchLoad(const std::vector<std::string>& args);
+	static int benchVertex(const std::vector<std::string>& args);
+	static int benchBvh(const std::vector<std::string>& args);
+	static int benchBc(const std::vector<std::string>& args);
+	static void printUsage();
+};
+
+} // namespace Spell
@@ -53,7 +53,7 @@ SpellImGui::SpellImGui(SpellWindow& window, SpellDevice& device, VkRenderPass re
 }
 
 SpellImGui::~SpellImGui() {
-	vkDeviceWaitIdle(device_.device());
+	device_.waitIdle();
 	ImGui_ImplVulkan_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -3,9 +3,11 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+
 namespace Spell {
 
-bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData& light, bool& convertYUp, const RenderStats& stats, RenderMode& renderMode) {
+bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData& light, bool& convertYUp, const RenderStats& stats, RenderMode& renderMode, bool& clusterCulling, bool& occlusionCulling, bool& sortDraws, bool& bvhCulling, float& lodPixelError, bool& benchmarkVertexFormats) {
 	bool needReload = false;
 
 	ImGui::Begin("Inspector");
@@ -25,13 +27,97 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 				"CPU 向 GPU 提交的绘制命令数量\n"
 				"过多的 Draw Call 会成为 CPU 端瓶颈");
 
+		if (stats.clusterCulling)
+			ImGui::Text("Draw Order:  GPU culled");
+		else
+			ImGui::Text("Draw Order:  %s, %u material switches", stats.drawsSorted ? "sorted" : "buffer", stats.materialSwitches);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Draw Order / Material Switches\n\n"
+				"绘制顺序 / 材质切换次数\n"
+				"每个子网格只有一种材质，每个材质至少一次 Draw Call\n"
+				"sorted: 按材质分组，组内按包围盒由近到远，提前深度测试可跳过被遮挡的 PBR 着色\n"
+				"buffer: 按索引缓冲顺序绘制，可与 GPU FS 调用数对比");
+
+		if (stats.bvhCulling)
+			ImGui::Text("BVH Culled:  %u draws (%.3f ms)", stats.bvhCulledDraws, stats.bvhQueryMs);
+		else
+			ImGui::Text("BVH Culled:  off");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Draws Culled by the CPU BVH / Query Time\n\n"
+				"CPU BVH 视锥体剔除的 Draw Call / 查询耗时\n"
+				"遍历三角形 BVH，找出视锥体内有三角形的材质区间，\n"
+				"其余区间的子网格不提交（只作用于直接绘制）");
+
 		ImGui::Text("Triangles:   %u", stats.triangles);
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Triangles (CPU-side)\n\n"
 				"三角形数量（CPU 端统计）\n"
-				"由索引数 / 3 计算得出\n"
+				"每个网格的索引数 / 3 × 实例数\n"
 				"表示提交给 GPU 的三角形总数");
 
+		if (stats.lodLevels > 1) {
+			if (stats.activeLodMin == stats.activeLodMax)
+				ImGui::Text("Active LOD:  %u / %u", stats.activeLodMin, stats.lodLevels - 1);
+			else
+				ImGui::Text("Active LOD:  %u-%u / %u", stats.activeLodMin, stats.activeLodMax, stats.lodLevels - 1);
+		} else {
+			ImGui::Text("Active LOD:  -");
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Active LOD Level / Coarsest Level\n\n"
+				"当前使用的 LOD 级别 / 最粗级别\n"
+				"0 为原始网格，每一级约为上一级一半的三角形\n"
+				"按简化误差投影到屏幕的像素大小逐网格选择\n"
+				"模型显示后在后台生成，完成前显示 -");
+
+		ImGui::Text("Tris Saved:  %llu", static_cast<unsigned long long>(stats.trianglesSaved));
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Triangles Saved by LOD\n\n"
+				"LOD 节省的三角形数量\n"
+				"原始网格三角形数 - 所选 LOD 级别的三角形数\n"
+				"（已乘以实例数）");
+
+		ImGui::Text("Instances:   %u", stats.instances);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Mesh Instances\n\n"
+				"网格实例数量\n"
+				"glTF 节点层级中每个引用网格的节点算一个实例\n"
+				"共享同一网格的实例只上传一份顶点/索引，\n"
+				"通过实例化绘制一次提交");
+
+		ImGui::Text("Meshlets:    %u", stats.meshlets);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Meshlets\n\n"
+				"网格簇数量\n"
+				"加载时将每个网格切分为最多 64 顶点 / 124 三角形的小簇，\n"
+				"每个簇带有包围球和法线锥，作为剔除的最小单位");
+
+		if (stats.clusterCulling) {
+			float visiblePct = stats.clusters > 0 ? 100.0f * stats.visibleClusters / stats.clusters : 0.0f;
+			ImGui::Text("Clusters:    %u / %u (%.1f%%)", stats.visibleClusters, stats.clusters, visiblePct);
+		} else {
+			ImGui::Text("Clusters:    %u", stats.clusters);
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Visible Clusters / Total Clusters\n\n"
+				"可见簇 / 总簇数\n"
+				"每个 (网格簇, 实例) 组合为一个簇\n"
+				"GPU 计算着色器做视锥体和背面锥剔除，\n"
+				"只为可见簇生成间接绘制命令（数据来自上一帧）");
+
+		if (stats.clusterCulling) {
+			if (stats.occlusionCulling)
+				ImGui::Text("Occluded:    %u, frustum/cone %u", stats.occludedClusters,
+					stats.clusters - std::min(stats.clusters, stats.visibleClusters + stats.occludedClusters));
+			else
+				ImGui::Text("Occluded:    off");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Occluded Clusters / Frustum, Cone and LOD Culled\n\n"
+					"被遮挡剔除的簇 / 视锥体、背面锥与 LOD 剔除的簇\n"
+					"通过视锥体测试的簇再与上一帧深度金字塔 (HiZ) 比较，\n"
+					"包围盒最近深度比覆盖区域的最远深度还远则剔除");
+		}
+
 		ImGui::Text("Vertices:    %u", stats.vertices);
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Vertices (CPU-side)\n\n"
@@ -46,12 +132,30 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 				"索引缓冲区中的索引总数\n"
 				"通过索引复用顶点，减少显存占用");
 
-		ImGui::Text("Textures:    %u", stats.textureCount);
+		ImGui::Text("Vertex Mem:  %.2f MB (%u B/vtx)", stats.vertexBufferBytes / (1024.0 * 1024.0), stats.vertexStride);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Vertex Buffer Memory\n\n"
+				"顶点缓冲区显存占用\n"
+				"Full: 48 字节/顶点 (float 位置/颜色/法线/UV)\n"
+				"Packed: 16 字节/顶点 (量化位置、八面体法线、半精度 UV)\n"
+				"拆分顶点流时为所有流之和");
+
+		ImGui::Text("Index Mem:   %.2f MB (%s, %u submeshes)", stats.indexBufferBytes / (1024.0 * 1024.0),
+			stats.index16 ? "16-bit" : "32-bit", stats.submeshCount);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Index Buffer Memory\n\n"
+				"索引缓冲区显存占用\n"
+				"每个子网格的顶点跨度不超过 65536 时使用 16 位索引，显存减半\n"
+				"子网格以 vertexOffset 为基准绘制，跨度过大的网格仍使用 32 位索引");
+
+		ImGui::Text("Textures:    %u (%u slots)", stats.textureCount, stats.textureSlotCount);
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Texture Count\n\n"
 				"纹理数量\n"
-				"当前已加载到 GPU 显存的纹理数量\n"
-				"包括漫反射、法线、金属度、粗糙度等贴图");
+				"Bindless 数组中的纹理数量（括号内为材质纹理槽位数量）\n"
+				"包括漫反射、法线、金属度、粗糙度等贴图\n"
+				"引用同一图片（规范路径或内嵌图片内容哈希相同）且格式相同的槽位共享一张纹理\n"
+				"缺少贴图的槽位通过纹理索引表指向启动时创建的 4 张共享默认纹理");
 
 		ImGui::Text("Materials:   %u", stats.materialCount);
 		if (ImGui::IsItemHovered())
@@ -60,6 +164,22 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 				"模型使用的材质数量\n"
 				"每个材质可关联多张纹理贴图");
 
+		if (!stats.pickValid)
+			ImGui::Text("Pick:        click the model");
+		else if (!stats.pickHit)
+			ImGui::Text("Pick:        miss (%.1f us)", stats.pickTimeUs);
+		else
+			ImGui::Text("Pick:        tri %u, inst %u, mat %d", stats.pickTriangle, stats.pickInstance, stats.pickMaterial);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Mouse Picking\n\n"
+				"鼠标拾取\n"
+				"在视口中左键点击，沿光标射线遍历 BVH 求最近三角形\n"
+				"叶节点的 4 个三角形用 SSE 一次求交\n"
+				"显示三角形序号（索引 / 3）、实例和材质");
+		if (stats.pickValid && stats.pickHit)
+			ImGui::Text("  Hit:       (%.2f, %.2f, %.2f) %.2f away, %.1f us", stats.pickPosition.x, stats.pickPosition.y,
+				stats.pickPosition.z, stats.pickDistance, stats.pickTimeUs);
+
 		ImGui::Separator();
 		ImGui::Text("Load Time:   %.1f ms", stats.totalLoadTimeMs);
 		if (ImGui::IsItemHovered())
@@ -74,13 +194,82 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 				"模型加载耗时\n"
 				"包括模型文件解析、顶点去重、\n"
 				"顶点/索引缓冲区创建和 GPU 上传");
+		ImGui::SameLine();
+		if (stats.modelCacheHit)
+			ImGui::TextColored(ImVec4(0.4f, 0.8f, 0.4f, 1.0f), "(cache hit)");
+		else
+			ImGui::TextColored(ImVec4(0.8f, 0.6f, 0.3f, 1.0f), "(cache miss)");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Mesh Cache\n\n"
+				"网格缓存 (.spellmesh)\n"
+				"命中: 直接映射缓存文件并上传顶点/索引\n"
+				"未命中: 解析源文件并写入缓存\n"
+				"缓存以源文件内容哈希为键");
+
+		if (stats.meshOptimized) {
+			ImGui::Text("  ACMR:      %.3f -> %.3f", stats.acmrBefore, stats.acmrAfter);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Average Cache Miss Ratio\n\n"
+					"平均缓存未命中率（优化前 -> 优化后）\n"
+					"每个三角形平均执行的顶点着色器次数\n"
+					"模拟 16 项 FIFO 顶点缓存，理想值约 0.5，最差为 3");
+
+			ImGui::Text("  ATVR:      %.3f -> %.3f", stats.atvrBefore, stats.atvrAfter);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Average Transformed Vertex Ratio\n\n"
+					"平均顶点变换比（优化前 -> 优化后）\n"
+					"顶点着色器执行次数 / 唯一顶点数\n"
+					"理想值为 1，即每个顶点只变换一次");
+
+			if (stats.meshOptimizeTimeMs > 0.0f)
+				ImGui::Text("  Optimize:  %.1f ms", stats.meshOptimizeTimeMs);
+			else
+				ImGui::Text("  Optimize:  (cached)");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Mesh Optimization Time\n\n"
+					"网格优化耗时（包含在模型加载时间内）\n"
+					"顶点缓存重排、Overdraw 重排和顶点拉取重映射，\n"
+					"按材质区间并行执行；结果写入网格缓存");
+		}
+
+		if (stats.bvhNodes > 0) {
+			ImGui::Text("  BVH:       %.1f ms (%u nodes, %.1f MB)", stats.bvhBuildTimeMs, stats.bvhNodes,
+				stats.bvhBytes / (1024.0 * 1024.0));
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("BVH Build Time\n\n"
+					"三角形 BVH 构建耗时\n"
+					"分箱 SAH 构建，上层子树在工作线程上并行，\n"
+					"与纹理上传同时进行；节点为扁平数组，每个叶节点最多 4 个三角形");
+		}
 
 		ImGui::Text("  Textures:  %.1f ms", stats.textureLoadTimeMs);
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Texture Load Time\n\n"
 				"纹理加载耗时\n"
-				"包括图片解码、Staging Buffer 创建、\n"
-				"GPU 纹理上传和 Mipmap 生成");
+				"包括等待图片解码、流式上传 (Staging Ring)\n"
+				"和 Mipmap 生成");
+		if (stats.textureCacheHits + stats.textureCacheMisses > 0) {
+			ImGui::SameLine();
+			ImGui::TextColored(stats.textureCacheMisses == 0 ? ImVec4(0.4f, 0.8f, 0.4f, 1.0f) : ImVec4(0.8f, 0.6f, 0.3f, 1.0f),
+				"(cache %u/%u)", stats.textureCacheHits, stats.textureCacheHits + stats.textureCacheMisses);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Texture Cache\n\n"
+					"纹理缓存 (.ktx2)\n"
+					"命中: 映射缓存文件，所有 Mip 级别直接拷贝到 Staging Buffer，\n"
+					"无需解码和 GPU Mipmap 生成\n"
+					"未命中: 解码并在 CPU 上生成 Mipmap 后写入缓存\n"
+					"缓存以源图片内容哈希和目标格式为键");
+		}
+		if (stats.compressedTextures > 0) {
+			ImGui::SameLine();
+			ImGui::Text("(BC %u)", stats.compressedTextures);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Block-Compressed Textures\n\n"
+					"块压缩纹理数量\n"
+					"漫反射 BC7 / BC1，法线与 glTF 金属度-粗糙度 BC5，\n"
+					"单独的金属度 / 粗糙度 BC4，\n"
+					"由 CPU 编码器 (SSE4.1 / AVX2) 在解码线程上生成");
+		}
 
 		if (stats.decodeOverlapMs > 0.0f) {
 			ImGui::TextColored(ImVec4(0.4f, 0.8f, 0.4f, 1.0f), "  Overlap:  -%.0f ms", stats.decodeOverlapMs);
@@ -90,6 +279,22 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 					"纹理 CPU 解码与模型加载并行执行，\n"
 					"此时间被隐藏在模型加载过程中");
 		}
+
+		const TextureUploadTimeline& timeline = resources.lastUploadTimeline();
+		if (!timeline.uploads.empty()) {
+			ImGui::Text("  Upload:    %zu chunks, overlap %.0f ms", timeline.uploads.size(), timeline.overlapMs);
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Streamed Texture Upload\n\n"
+					"流式纹理上传\n"
+					"每张图片解码完成后立即写入固定大小的 Staging Ring，\n"
+					"Ring 分为 4 块，写满一块即带 Fence 提交，\n"
+					"GPU 拷贝与剩余图片的解码同时进行\n"
+					"Overlap: 解码与上传同时进行的时间");
+			if (ImGui::TreeNode("Upload Timeline")) {
+				drawUploadTimeline(timeline);
+				ImGui::TreePop();
+			}
+		}
 	}
 
 	if (ImGui::CollapsingHeader("GPU Pipeline Stats", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -127,6 +332,13 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 				"片段着色器调用次数\n"
 				"光栅化后执行片段(像素)着色器的次数\n"
 				"相对于屏幕分辨率过高可能意味着 overdraw 严重");
+
+		ImGui::Text("GPU Scene:       %.3f ms", stats.gpuSceneMs);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("GPU Scene Time\n\n"
+				"GPU 场景耗时\n"
+				"由时间戳查询测得的簇剔除和场景绘制耗时（不含 UI）\n"
+				"设备不支持时间戳时为 0");
 	}
 	ImGui::Separator();
 
@@ -139,7 +351,153 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 		}
 	}
 
+	ImGui::Checkbox("GPU Cluster Culling", &clusterCulling);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("GPU Cluster Culling\n\n"
+			"GPU 簇剔除\n"
+			"开启: 计算着色器剔除视锥体外和背向相机的簇，\n"
+			"通过间接绘制只提交可见簇\n"
+			"关闭: 直接实例化绘制全部网格，便于对比 GPU 统计");
+
+	ImGui::Checkbox("Occlusion Culling", &occlusionCulling);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("HiZ Occlusion Culling\n\n"
+			"HiZ 遮挡剔除\n"
+			"每帧结束时由深度缓冲生成深度金字塔，下一帧的簇剔除\n"
+			"用它剔除被前景完全挡住的簇；刚露出的物体最多晚一帧出现\n"
+			"只作用于 GPU 簇剔除的实体显示模式（线框与点云不使用）");
+
+	ImGui::Checkbox("Sort Draws", &sortDraws);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Material-sorted, Front-to-back Draws\n\n"
+			"按材质与远近排序绘制\n"
+			"开启: 同一材质的子网格连续绘制，材质按最近子网格排序，\n"
+			"组内由近到远，减少被遮挡片段的着色 (见 GPU FS 调用数)\n"
+			"只作用于直接绘制（关闭 GPU 簇剔除时）");
+
+	ImGui::Checkbox("BVH Frustum Culling", &bvhCulling);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("CPU BVH Frustum Culling\n\n"
+			"CPU BVH 视锥体剔除\n"
+			"每帧用三角形 BVH 查询可见的材质区间，跳过视锥体外的子网格\n"
+			"只作用于直接绘制（关闭 GPU 簇剔除时）");
+
+	ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.0f, 8.0f, "%.1f px");
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("LOD Screen-space Error\n\n"
+			"LOD 屏幕空间误差阈值\n"
+			"选择简化误差投影后不超过该像素数的最粗级别\n"
+			"值越大越早切换到低精度网格，0 表示始终使用原始网格");
+
+	bool generateLods = resources.generateLods();
+	if (ImGui::Checkbox("Generate LODs", &generateLods)) {
+		resources.setGenerateLods(generateLods);
+		needReload = true;
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Automatic LOD Generation\n\n"
+			"自动生成 LOD\n"
+			"模型显示后在后台线程用二次误差度量简化网格，\n"
+			"生成最多 5 级 LOD 并在帧边界替换\n"
+			"切换后重新加载当前模型");
 	ImGui::Checkbox("Convert Y-up to Z-up", &convertYUp);
+
+	bool optimizeMeshes = resources.optimizeMeshes();
+	if (ImGui::Checkbox("Optimize Meshes", &optimizeMeshes)) {
+		resources.setOptimizeMeshes(optimizeMeshes);
+		needReload = true;
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Post-load Mesh Optimization\n\n"
+			"加载后网格优化\n"
+			"按顶点缓存复用和 Overdraw 重排三角形，\n"
+			"并按首次使用顺序重排顶点\n"
+			"切换后重新加载当前模型");
+
+	bool useTextureCache = resources.useTextureCache();
+	if (ImGui::Checkbox("Texture Cache", &useTextureCache)) {
+		resources.setUseTextureCache(useTextureCache);
+		needReload = true;
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("KTX2 Texture Cache\n\n"
+			"KTX2 纹理缓存\n"
+			"开启: 纹理解码后在 CPU 上生成完整 Mip 链并写入 cache/textures/，\n"
+			"之后的加载直接映射 .ktx2 文件上传\n"
+			"关闭: 每次加载都解码图片并用 GPU Blit 生成 Mipmap\n"
+			"切换后重新加载当前模型");
+
+	if (resources.textureCompressionSupported()) {
+		const char* compressionNames[] = { "None (RGBA8)", "Fast (BC1 diffuse)", "Quality (BC7 diffuse)" };
+		int currentCompression = static_cast<int>(resources.textureCompression());
+		if (ImGui::Combo("Texture Compression", &currentCompression, compressionNames, IM_ARRAYSIZE(compressionNames))) {
+			resources.setTextureCompression(static_cast<TextureCompression>(currentCompression));
+			needReload = true;
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Texture Compression\n\n"
+				"纹理块压缩\n"
+				"None: 漫反射 RGBA8，法线 RG8，金属度 / 粗糙度 R8\n"
+				"Fast: 漫反射 BC1 (每像素 0.5 字节，无 Alpha)\n"
+				"Quality: 漫反射 BC7 (每像素 1 字节)\n"
+				"两种模式下法线与 glTF 金属度-粗糙度均为 BC5 (Shader 重建 Z)，\n"
+				"单独的金属度 / 粗糙度为 BC4\n"
+				"切换后重新加载当前模型");
+	}
+
+	int stagingBudget = static_cast<int>(resources.textureStagingBudgetMb());
+	if (ImGui::SliderInt("Staging Budget (MB)", &stagingBudget, 4, 256)) {
+		resources.setTextureStagingBudgetMb(static_cast<uint32_t>(stagingBudget));
+	}
+	if (ImGui::IsItemDeactivatedAfterEdit()) needReload = true;
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Texture Staging Budget\n\n"
+			"纹理流式上传的内存上限\n"
+			"一半为 Staging Ring，材质纹理经它流式上传；\n"
+			"另一半容纳已解码、等待写入 Ring 的图片，\n"
+			"占满时解码线程暂停，像素写入 Ring 后立即释放\n"
+			"较小: 内存峰值低，解码与上传互相等待\n"
+			"松开滑块后重新加载当前模型");
+
+	{
+		const char* vertexFormatNames[] = { "Full (48 B)", "Packed (16 B)" };
+		int currentFormat = static_cast<int>(resources.vertexFormat());
+		if (ImGui::Combo("Vertex Format", &currentFormat, vertexFormatNames, IM_ARRAYSIZE(vertexFormatNames))) {
+			resources.setVertexFormat(static_cast<VertexFormat>(currentFormat));
+			needReload = true;
+		}
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Vertex Format\n\n"
+				"顶点格式\n"
+				"Full: 原始 float 顶点\n"
+				"Packed: 按网格包围盒量化为 16 位的位置、八面体编码法线、\n"
+				"半精度 UV，去掉顶点颜色，带宽约为 1/3\n"
+				"切换后重新加载当前模型");
+	}
+
+	bool splitStreams = resources.vertexLayout() == VertexLayout::Split;
+	if (ImGui::Checkbox("Split Vertex Streams", &splitStreams)) {
+		resources.setVertexLayout(splitStreams ? VertexLayout::Split : VertexLayout::Interleaved);
+		needReload = true;
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Split Vertex Streams\n\n"
+			"拆分顶点流\n"
+			"位置、着色属性 (法线/UV)、材质索引分别存放在独立的顶点缓冲区，\n"
+			"线框和点云模式只读取位置流（不做光照），减少顶点读取带宽\n"
+			"切换后重新加载当前模型");
+
+	if (stats.vertexBenchmarkActive) {
+		ImGui::Text("Benchmarking vertex formats...");
+	} else if (ImGui::Button("Benchmark Vertex Formats")) {
+		benchmarkVertexFormats = true;
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Vertex Format Benchmark\n\n"
+			"顶点格式对比测试\n"
+			"依次加载每种顶点格式和布局，预热后统计帧时间和 GPU 场景耗时，\n"
+			"结果输出到控制台，结束后恢复原格式\n"
+			"测试期间请保持视角和显示模式不变");
 	ImGui::Separator();
 
 	ImGui::Text("Light");
@@ -168,9 +526,9 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 	if (resources.model()) {
 		ImGui::Text("  Vertices: %u  Indices: %u",
 			resources.model()->getVertexCount(), resources.model()->getIndexCount());
-		ImGui::Text("  Materials: %u  Textures: %u",
+		ImGui::Text("  Materials: %u  Textures: %u (%u slots)",
 			static_cast<uint32_t>(resources.model()->getMaterials().size()),
-			resources.textureCount());
+			resources.textureCount(), resources.textureSlotCount());
 	}
 
 	// Fallback texture selector (used when model has no materials)
@@ -192,6 +550,19 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 		ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "(model uses embedded textures)");
 	}
 
+	// Applied when the drag ends; changed tolerances miss the mesh cache and re-weld the FBX
+	ImGui::DragFloat3("FBX Weld Tol", fbxWeldTolerance_, 0.0001f, 0.0f, 1.0f, "%.4f");
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("FBX Vertex Weld Tolerance (position / normal / uv)\n\n"
+			"FBX 顶点焊接容差 (位置 / 法线 / UV)\n"
+			"各分量差值不超过容差的顶点合并为一个\n"
+			"全部为 0 时只合并完全相同的顶点\n"
+			"修改后重新加载模型");
+	if (ImGui::IsItemDeactivatedAfterEdit()) {
+		resources.setFbxWeldTolerance({ fbxWeldTolerance_[0], fbxWeldTolerance_[1], fbxWeldTolerance_[2] });
+		needReload = true;
+	}
+
 	ImGui::Spacing();
 
 	bool modelChanged = (!availableModels.empty() &&
@@ -211,15 +582,33 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 		ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "(pending changes)");
 	}
 
+	const bool reloading = resources.isReloading();
+	if (reloading) {
+		ImGui::BeginDisabled();
+	}
 	if (ImGui::Button("Force Reload")) {
 		needReload = true;
 	}
+	if (reloading) {
+		ImGui::EndDisabled();
+	}
 	ImGui::SameLine();
 	if (ImGui::Button("Refresh File List")) {
 		resources.scanAvailableFiles();
 		syncSelection(resources);
 	}
 
+	if (reloading) {
+		ReloadProgress progress = resources.reloadProgress();
+		ImGui::ProgressBar(progress.fraction, ImVec2(-1.0f, 0.0f), progress.stage);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Background Reload\n\n"
+				"后台重新加载进度\n"
+				"模型、纹理和描述符集在后台线程构建，\n"
+				"当前模型继续渲染；完成后在帧边界切换，\n"
+				"旧资源在其所在帧的 fence 完成后释放");
+	}
+
 	// Material texture info
 	if (resources.model() && !resources.model()->getMaterials().empty()) {
 		ImGui::Separator();
@@ -242,6 +631,38 @@ bool SpellInspector::draw(SpellResourceManager& resources, LightPushConstantData
 	return needReload;
 }
 
+void SpellInspector::drawUploadTimeline(const TextureUploadTimeline& timeline) {
+	const float endMs = std::max(timeline.endMs(), 1.0f);
+	const float rowHeight = ImGui::GetTextLineHeight();
+	const float labelWidth = 60.0f;
+	const float barWidth = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 1.0f);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+	// Decodes run on parallel threads and overlap each other: translucent bars stack up darker
+	auto drawRow = [&](const char* label, const std::vector<TextureUploadTimeline::Span>& spans, ImU32 color) {
+		ImGui::Text("%s", label);
+		ImGui::SameLine(labelWidth);
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		drawList->AddRectFilled(origin, ImVec2(origin.x + barWidth, origin.y + rowHeight), IM_COL32(40, 40, 40, 255));
+		for (const auto& span : spans) {
+			const float x0 = origin.x + barWidth * std::max(span.startMs, 0.0f) / endMs;
+			const float x1 = std::max(origin.x + barWidth * span.endMs / endMs, x0 + 1.0f);
+			drawList->AddRectFilled(ImVec2(x0, origin.y + 1.0f), ImVec2(x1, origin.y + rowHeight - 1.0f), color);
+		}
+		ImGui::Dummy(ImVec2(barWidth, rowHeight));
+	};
+	drawRow("Decode", timeline.decodes, IM_COL32(90, 160, 230, 120));
+	drawRow("Upload", timeline.uploads, IM_COL32(110, 200, 110, 255));
+
+	ImGui::Text("0 - %.0f ms: %zu decodes, %zu chunks, overlap %.0f ms", endMs, timeline.decodes.size(),
+		timeline.uploads.size(), timeline.overlapMs);
+	ImGui::Text("Ring %.0f MB, %.1f MB uploaded", timeline.stagingBytes / (1024.0 * 1024.0),
+		timeline.uploadedBytes / (1024.0 * 1024.0));
+	ImGui::Text("Decoded held: peak %.1f MB (budget %.0f MB)", timeline.peakPendingBytes / (1024.0 * 1024.0),
+		timeline.decodeBudgetBytes / (1024.0 * 1024.0));
+	ImGui::Text("Stalls: %u (%.1f ms waiting for a free chunk)", timeline.stalls, timeline.stallMs);
+}
+
 void SpellInspector::syncSelection(const SpellResourceManager& resources) {
 	auto& models = resources.availableModels();
 	auto& textures = resources.availableTextures();
@@ -8,15 +8,19 @@ namespace Spell {
 class SpellInspector {
 public:
 	// Returns true if resources need to be reloaded
-	bool draw(SpellResourceManager& resources, LightPushConstantData& light, bool& convertYUp, const RenderStats& stats, RenderMode& renderMode);
+	bool draw(SpellResourceManager& resources, LightPushConstantData& light, bool& convertYUp, const RenderStats& stats, RenderMode& renderMode,
+		bool& clusterCulling, bool& occlusionCulling, bool& sortDraws, bool& bvhCulling, float& lodPixelError, bool& benchmarkVertexFormats);
 
 private:
 	int selectedModelIdx_{ 0 };
 	int selectedTextureIdx_{ 0 };
 	float lightColor_[3]{ 1.0f, 0.92f, 0.9f };
 	float lightIntensity_{ 23.0f };
+	float fbxWeldTolerance_[3]{ 0.0f, 0.0f, 0.0f }; // position, normal, uv
 
 	void syncSelection(const SpellResourceManager& resources);
+	// Decode and upload spans of the last load on a shared time axis
+	void drawUploadTimeline(const TextureUploadTimeline& timeline);
 };
 
 } // namespace Spell